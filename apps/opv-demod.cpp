@@ -1,36 +1,78 @@
 // Copyright 2020 Mobilinkd LLC.
 // Copyright 2022 Open Research Institute, Inc.
 
+#include "AudioSink.h"
+#include "BasebandFile.h"
+#include "CompressedBaseband.h"
+#include "OPVBitstreamDecoder.h"
 #include "OPVCobsDecoder.h"
 #include "OPVDemodulator.h"
 #include "FirFilter.h"
+#include "Instrumentation.h"
+#include "LlrCapture.h"
+#include "Log.h"
 
 #include "Numerology.h"
+#include "PacketDispatcher.h"
+#include "Resampler.h"
+#include "TransmissionIndex.h"
+#include "UDPNetwork.h"
 #include <opus/opus.h>
 
 #include <boost/program_options.hpp>
 #include <boost/optional.hpp>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <csignal>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <vector>
+#include <sys/stat.h>
 
 const char VERSION[] = "0.2";
 
 using namespace mobilinkd;
 
-uint32_t debug_sample_count = 0;
+uint64_t debug_sample_count = 0;
 
 OpusDecoder* opus_decoder;
 OPVCobsDecoder cobs_decoder;
+PacketDispatcher packet_dispatcher;
+AudioSink* audio_sink = nullptr;
+
+int current_viterbi_cost = 0;       // cost of the frame being handled, for the noise blanker
 
 PRBS9 prbs;
 
+Instrumentation* instrumentation = nullptr;    // points at the demodulator's statistics; receiving thread only
+Instrumentation baseband_stats;                 // the baseband demodulator's, once it is done
+
+uint64_t bitstream_bytes = 0;       // bitstream input, for its timing
+
+// Bitstream input keeps time by the bytes received, samples_per_frame to
+// each frame of baseband_frame_packed_bytes. The ratio is not a whole
+// number, so the sample count is worked out from the total.
+void count_bitstream_bytes(size_t count)
+{
+    bitstream_bytes += count;
+    debug_sample_count = bitstream_bytes * samples_per_frame / baseband_frame_packed_bytes;
+}
+
+std::atomic<bool> running{true};
+
+// Intercept ^C and stop receiving from the network.
+void signal_handler(int)
+{
+    running = false;
+}
+
 struct Config
 {
     bool verbose = false;
@@ -38,6 +80,22 @@ struct Config
     bool quiet = false;
     bool invert = false;
     bool noise_blanker = false;
+    size_t jitter_buffer = 4;       // maximum jitter buffer depth, frames
+    bool no_drop = false;           // wait for the audio output rather than drop packets
+    uint32_t stats_interval = 0;    // seconds of input between statistics summaries
+    bool bitstream = false;         // input is a packed bitstream, not baseband
+    std::string input_file;         // read input from this file instead of stdin
+    uint16_t udp_port = 0;          // receive bitstream from this UDP port instead
+    size_t samples_per_symbol = default_samples_per_symbol;    // baseband rate demodulated
+    uint32_t input_rate = 0;        // baseband input rate, resampled if not symbol_rate * samples_per_symbol
+    bool input_rate_set = false;    // given on the command line, rather than from the input
+    bool fft_filter = false;        // matched filter by fast convolution over blocks of input
+    std::string capture_llr;        // write each frame's soft bits to this LLR capture file
+    bool llr = false;               // input is an LLR capture file, decoded without the front end
+    std::string record;             // record the baseband input to this compressed capture file
+    double start = 0;               // seconds into the input file to start at
+    double end = 0;                 // seconds into the input file to stop at, if not 0
+    std::optional<size_t> transmission;     // demodulate only this transmission of the file's index
 
     static std::optional<Config> parse(int argc, char* argv[])
     {
@@ -53,9 +111,40 @@ struct Config
             ("version,V", "Print the application version and exit.")
             ("invert,i", po::bool_switch(&result.invert), "invert the received baseband")
             ("noise-blanker,b", po::bool_switch(&result.noise_blanker), "noise blanker -- silence likely corrupt audio")
+            ("jitter-buffer,j", po::value<size_t>(&result.jitter_buffer)->default_value(4),
+                "maximum audio jitter buffer depth in 40ms frames (bounds the added latency)")
+            ("no-drop", po::bool_switch(&result.no_drop),
+                "wait for the audio output rather than drop packets; for recordings piped in faster than real time")
             ("verbose,v", po::bool_switch(&result.verbose), "verbose output")
             ("debug,d", po::bool_switch(&result.debug), "debug-level output")
             ("quiet,q", po::bool_switch(&result.quiet), "silence all output -- no BERT output")
+            ("stats,s", po::value<uint32_t>(&result.stats_interval)->default_value(0),
+                "print stage timing and frame statistics every N seconds of input (0 = only at exit)")
+            ("bitstream", po::bool_switch(&result.bitstream),
+                "input is a packed bitstream (from opv-mod --bitstream) instead of baseband")
+            ("file,f", po::value<std::string>(&result.input_file),
+                "read input from a file instead of STDIN")
+            ("udp", po::value<uint16_t>(&result.udp_port),
+                "receive bitstream from a UDP port (from opv-mod --network) instead of STDIN; implies --bitstream")
+            ("samples-per-symbol", po::value<size_t>(&result.samples_per_symbol)->default_value(default_samples_per_symbol),
+                "baseband input rate in samples per symbol: 10 (271 ksps), 5 (135.5 ksps), 4 (108.4 ksps) or 2 (54.2 ksps)")
+            ("sample-rate,r", po::value<uint32_t>(&result.input_rate),
+                "baseband input rate in samples per second, if not the samples per symbol rate; "
+                "the input is resampled to that rate")
+            ("fft-filter", po::bool_switch(&result.fft_filter),
+                "run the matched filter by FFT over blocks of input; faster for recordings")
+            ("capture-llr", po::value<std::string>(&result.capture_llr),
+                "write each received frame's soft bits and demodulator state to an LLR capture file")
+            ("record", po::value<std::string>(&result.record),
+                "record the baseband input, losslessly compressed, to a file that opv-demod can read back")
+            ("llr", po::bool_switch(&result.llr),
+                "input (from --file) is an LLR capture; replay it through the frame decoder only")
+            ("start", po::value<double>(&result.start),
+                "start this many seconds into the baseband file, without reading what comes before")
+            ("end", po::value<double>(&result.end),
+                "stop this many seconds into the baseband file")
+            ("transmission,t", po::value<size_t>(),
+                "demodulate only transmission N of the baseband file, from its index (written by opv-index)")
             ;
 
         po::variables_map vm;
@@ -63,7 +152,7 @@ struct Config
 
         if (vm.count("help"))
         {
-            std::cout << "Read OPV baseband from STDIN and write audio to STDOUT\n"
+            std::cout << "Read OPV baseband (or bitstream) from STDIN and write audio to STDOUT\n"
                 << desc << std::endl;
 
             return std::nullopt;
@@ -85,42 +174,122 @@ struct Config
             return std::nullopt;
         }
 
+        if (result.jitter_buffer == 0)
+        {
+            std::cerr << "The jitter buffer must be at least one frame." << std::endl;
+            return std::nullopt;
+        }
+
         if (result.debug + result.verbose + result.quiet > 1)
         {
             std::cerr << "Only one of quiet, verbose or debug may be chosen." << std::endl;
             return std::nullopt;
         }
 
+        switch (result.samples_per_symbol)
+        {
+        case 2: case 4: case 5: case 10:
+            break;
+        default:
+            std::cerr << "Samples per symbol must be 2, 4, 5 or 10." << std::endl;
+            return std::nullopt;
+        }
+
+        result.input_rate_set = vm.count("sample-rate");
+        if (result.input_rate == 0) result.input_rate = symbol_rate * result.samples_per_symbol;
+        if (!Resampler<float>::supported(result.input_rate, symbol_rate * result.samples_per_symbol))
+        {
+            std::cerr << "Cannot resample from " << result.input_rate << " samples per second." << std::endl;
+            return std::nullopt;
+        }
+
+        if (result.llr && (result.input_file.empty() || result.bitstream || result.udp_port))
+        {
+            std::cerr << "An LLR capture is read with --file, and not with bitstream or udp." << std::endl;
+            return std::nullopt;
+        }
+
+        if (result.udp_port)
+        {
+            if (!result.input_file.empty())
+            {
+                std::cerr << "Only one of file and udp may be chosen." << std::endl;
+                return std::nullopt;
+            }
+            result.bitstream = true;
+        }
+
+        if (!result.record.empty() && result.bitstream)
+        {
+            std::cerr << "Only baseband input can be recorded." << std::endl;
+            return std::nullopt;
+        }
+
+        if (vm.count("transmission")) result.transmission = vm["transmission"].as<size_t>();
+        if (result.start || result.end || result.transmission)
+        {
+            if (result.input_file.empty() || result.bitstream || result.llr)
+            {
+                std::cerr << "Start, end and transmission select part of a baseband file read with --file." << std::endl;
+                return std::nullopt;
+            }
+            if (result.transmission && (result.start || result.end))
+            {
+                std::cerr << "Only one of transmission and start or end may be chosen." << std::endl;
+                return std::nullopt;
+            }
+            if (result.start < 0 || (result.end && result.end <= result.start))
+            {
+                std::cerr << "The end must come after the start." << std::endl;
+                return std::nullopt;
+            }
+        }
+
         return result;
     }
 };
 
 std::optional<Config> config;
 
-void decode_and_output_audio(const uint8_t *encoded_audio, int encoded_len, int viterbi_cost)
+/**
+ * Audio decoder for the sink, called on its decoder thread. A null packet
+ * asks Opus for packet loss concealment.
+ */
+int decode_audio(const uint8_t* encoded_audio, size_t encoded_len, int16_t* pcm, size_t samples)
 {
-    std::array<int16_t, audio_samples_per_opv_frame> buf;
-    opus_int32 count;
+    // opus_decode can take the whole packet at once, no need to split out the frames, if any.
+    // The sink times this call itself.
+    int count = opus_decode(opus_decoder, encoded_audio, encoded_audio ? encoded_len : 0, pcm, samples, 0);
 
-    if (config->noise_blanker && viterbi_cost > 80)
+    if (config->verbose && count != int(samples))
     {
-        buf.fill(0);
-        if (config->verbose)
-        {
-            std::cerr << "Frameout blanked" << std::endl;
-        }
+        OPV_LOG_WARN("Opus decode error, {} samples, expected {}", count, samples);
     }
-    else
+
+    return count;
+}
+
+void output_audio(const int16_t* pcm, size_t samples)
+{
+    std::cout.write((const char*)pcm, samples * sizeof(int16_t));
+}
+
+/**
+ * Hand a received Opus packet, at [offset, offset + length) in the packet
+ * buffer, to the audio sink. This never blocks the demodulator; decoding
+ * and output happen on the sink's thread.
+ */
+void decode_and_output_audio(PacketHandle packet, size_t offset, size_t length, int viterbi_cost)
+{
+    bool blank = config->noise_blanker && viterbi_cost > 80;
+    if (blank && config->verbose)
     {
-        // opus_decode can take the whole packet at once, no need to split out the frames, if any.
-        count = opus_decode(opus_decoder, encoded_audio, opus_packet_size_bytes, buf.data(), audio_samples_per_opv_frame, 0);
+        OPV_LOG_INFO("Frameout blanked");
     }
 
-    std::cout.write((const char*)buf.data(), audio_bytes_per_opv_frame);
-
-    if (config->verbose && count != audio_samples_per_opv_frame)
+    if (!audio_sink->push(std::move(packet), offset, length, debug_sample_count, blank) && config->verbose)
     {
-            std::cerr << "Opus decode error, " << count << " samples, expected " << audio_samples_per_opv_frame << std::endl;
+        OPV_LOG_WARN("Audio queue full, packet dropped");
     }
 }
 
@@ -145,6 +314,33 @@ bool decode_bert(OPVFrameDecoder::stream_type1_bytes_t const& bert_data)
 }
 
 
+/**
+ * Voice packets: an RTP header and one Opus packet, sent to voice_udp_port.
+ */
+void handle_voice_packet(PacketHandle packet, const IPv4UDP::Datagram& datagram)
+{
+    RTPHeader rtp;
+    if (!rtp.parse(packet.data() + datagram.offset, datagram.length))
+    {
+        OPV_LOG_DEBUG("Bad RTP header in voice packet");
+        return;
+    }
+
+    size_t length = datagram.length - rtp.length - rtp.padding;
+    OPV_LOG_DEBUG("Opus [{}] seq {}", length, rtp.sequence);
+    decode_and_output_audio(std::move(packet), datagram.offset + rtp.length, length, current_viterbi_cost);
+}
+
+/**
+ * Packets not delivered to a port handler. They are counted by the
+ * dispatcher; there is nothing else to do with them yet.
+ */
+void handle_other_packet(PacketHandle packet, PacketDispatcher::Result result)
+{
+    OPV_LOG_DEBUG("Packet not handled ({}), {} bytes", int(result), packet.size());
+}
+
+
 bool handle_frame(OPVFrameDecoder::output_buffer_t const& frame, int viterbi_cost)
 {
     using FrameType = OPVFrameDecoder::FrameType;
@@ -154,35 +350,51 @@ bool handle_frame(OPVFrameDecoder::output_buffer_t const& frame, int viterbi_cos
     switch (frame.type)
     {
         case FrameType::OPV_COBS:
-            cobs_decoder(frame.data.data(), stream_frame_payload_bytes);
+        {
+            ScopedStageTimer timer(*instrumentation, Stage::COBS);
+            current_viterbi_cost = viterbi_cost;
+            cobs_decoder(frame.data.data(), stream_frame_payload_bytes, [](PacketHandle packet) { packet_dispatcher(std::move(packet)); });
             break;
+        }
         case FrameType::OPV_BERT:
             result = decode_bert(frame.data);
             break;
     }
 
+    if (frame.fheader.flags & OPVFrameHeader::LAST_FRAME)
+    {
+        audio_sink->end_of_stream();
+    }
+
     return result;
 }
 
+void print_ber()
+{
+    auto ber = double(prbs.errors()) / double(prbs.bits());
+    char buffer[40];
+    snprintf(buffer, 40, "BER: %-1.6lf (%lu bits)\r", ber, (long unsigned int)prbs.bits());
+    std::cerr << buffer;
+}
+
 template <typename FloatType>
-void diagnostic_callback(bool dcd, FloatType evm, FloatType deviation, FloatType offset, bool locked,
-    FloatType clock, int sample_index, int sync_index, int clock_index, int viterbi_cost)
+void diagnostic_callback(const OPVDiagnostics<FloatType>& d)
 {
     if (config->debug) {
-        std::cerr << "dcd: " << std::setw(1) << int(dcd)
-            << ", evm: " << std::setfill(' ') << std::setprecision(4) << std::setw(8) << evm * 100 <<"%"
-            << ", deviation: " << std::setprecision(4) << std::setw(8) << deviation
-            << ", freq offset: " << std::setprecision(4) << std::setw(8) << offset
-            << ", locked: " << std::boolalpha << std::setw(6) << locked << std::dec
-            << ", clock: " << std::setprecision(7) << std::setw(8) << clock
-            << ", sample: " << std::setw(1) << sample_index << ", "  << sync_index << ", " << clock_index
-            << ", cost: " << viterbi_cost
+        std::cerr << "dcd: " << std::setw(1) << int(d.dcd)
+            << ", evm: " << std::setfill(' ') << std::setprecision(4) << std::setw(8) << d.evm * 100 <<"%"
+            << ", deviation: " << std::setprecision(4) << std::setw(8) << d.deviation
+            << ", freq offset: " << std::setprecision(4) << std::setw(8) << d.offset
+            << ", locked: " << std::boolalpha << std::setw(6) << d.locked << std::dec
+            << ", clock: " << std::setprecision(7) << std::setw(8) << d.clock
+            << ", sample: " << std::setw(1) << d.sample_index << ", "  << d.sync_index << ", " << d.clock_index
+            << ", cost: " << d.viterbi_cost
             << " at sample " << debug_sample_count
             << " (" << float(debug_sample_count)/samples_per_frame << " frames)"
             << std::endl;
     }
         
-    if (!dcd && prbs.sync()) { // Seems like there should be a better way to do this.
+    if (!d.dcd && prbs.sync()) { // Seems like there should be a better way to do this.
         prbs.reset();
     }
 
@@ -193,36 +405,258 @@ void diagnostic_callback(bool dcd, FloatType evm, FloatType deviation, FloatType
             std::cerr << ", ";
         }
     
-        auto ber = double(prbs.errors()) / double(prbs.bits());
-        char buffer[40];
-        snprintf(buffer, 40, "BER: %-1.6lf (%lu bits)\r", ber, (long unsigned int)prbs.bits());
-        std::cerr << buffer;
+        print_ber();
     }
     std::cerr << std::flush;
 }
 
-
 /**
- * Packet handling callback. Very simple version for now.
- * 
- * Just prints out the packet size, for debug purposes, then assumes it must be voice data.
- * 
- * This should be processing IP, UDP, and RTP and dispatching accordingly. !!!
-*/
-void dummy_packet_callback(const uint8_t *buf, unsigned int len)
+ * Baseband input: raw 16-bit samples, or a compressed capture (recognized
+ * by its header), from a file or STDIN.
+ */
+class BasebandInput
 {
-    if (len == ip_v4_header_bytes+udp_header_bytes+rtp_header_bytes+opus_packet_size_bytes)
+public:
+    explicit BasebandInput(std::istream& input) : input_(input) {}
+
+    /// @return false if the input is a compressed capture that cannot be read.
+    bool open()
     {
-        decode_and_output_audio(buf+ip_v4_header_bytes+udp_header_bytes+rtp_header_bytes, opus_packet_size_bytes, 0);
-        if (config->verbose)
+        input_.read(prefix_.data(), prefix_.size());
+        prefix_length_ = input_.gcount();
+        if (prefix_length_ != prefix_.size() || !CompressedBaseband::is_magic(prefix_.data())) return true;
+
+        prefix_length_ = 0;
+        compressed_.emplace();
+        return compressed_->open(input_, true);
+    }
+
+    bool compressed() const { return compressed_.has_value(); }
+
+    /// The compressed capture's sample rate, or 0.
+    uint32_t sample_rate() const { return compressed_ ? compressed_->sample_rate() : 0; }
+
+    /// Read up to @p count samples. @return the samples read; 0 at the end.
+    size_t read(int16_t* samples, size_t count)
+    {
+        if (compressed_) return compressed_->read(samples, count);
+
+        // The bytes read to look for a header come first.
+        char* out = reinterpret_cast<char*>(samples);
+        size_t bytes = std::min(prefix_length_, count * sizeof(int16_t));
+        std::copy(prefix_.begin(), prefix_.begin() + bytes, out);
+        std::copy(prefix_.begin() + bytes, prefix_.begin() + prefix_length_, prefix_.begin());
+        prefix_length_ -= bytes;
+        input_.read(out + bytes, count * sizeof(int16_t) - bytes);
+        return (bytes + input_.gcount()) / sizeof(int16_t);
+    }
+
+private:
+    std::istream& input_;
+    std::array<char, 8> prefix_;
+    size_t prefix_length_ = 0;
+    std::optional<CompressedBasebandReader> compressed_;
+};
+
+// Demodulate 16-bit baseband at SamplesPerSymbol samples per symbol until
+// the input ends, resampling it first if it comes at another rate.
+// debug_sample_count stays in samples at the default sample_rate, whatever
+// the input rate, so that logs, statistics and audio timing read the same.
+template <size_t SamplesPerSymbol, typename Input, typename FrameHandler, typename DiagnosticHandler, typename Summary>
+void demodulate_baseband(Input& input, FrameHandler frame_handler, DiagnosticHandler diagnostic_handler,
+    Summary& periodic_summary)
+{
+    OPVDemodulator<float, FrameHandler, DiagnosticHandler, SamplesPerSymbol> demod(frame_handler, diagnostic_handler);
+    instrumentation = &demod.instrumentation;
+
+    LlrCaptureWriter capture;
+    if (!config->capture_llr.empty())
+    {
+        if (!capture.open(config->capture_llr, SamplesPerSymbol))
+        {
+            OPV_LOG_ERROR("Failed to open {} for writing", config->capture_llr);
+        }
+        else
         {
-            std::cerr << "Opus [" << len << "]" << std::endl;
+            demod.capture([&capture](const LlrRecord& record) { capture.write(record); });
         }
     }
-    else
+
+    std::optional<Resampler<float>> resampler;
+    if (config->input_rate != Oversampling<SamplesPerSymbol>::sample_rate)
+    {
+        resampler.emplace(config->input_rate, Oversampling<SamplesPerSymbol>::sample_rate);
+        OPV_LOG_INFO("Resampling from {} to {} samples per second", config->input_rate,
+            Oversampling<SamplesPerSymbol>::sample_rate);
+    }
+
+    uint32_t ticks = 0;     // fractions of a sample, in 1/SamplesPerSymbol
+    auto advance = [&]()
+    {
+        auto previous_count = debug_sample_count;
+        ticks += default_samples_per_symbol;
+        debug_sample_count += ticks / SamplesPerSymbol;
+        ticks %= SamplesPerSymbol;
+        periodic_summary(previous_count);
+    };
+
+    // Samples at the demodulator's rate, a block at a time.
+    std::vector<float> samples;
+    std::vector<float> filtered;
+    auto demodulate = [&]()
+    {
+        if (config->fft_filter)
+        {
+            filtered.resize(samples.size());
+            demod.filter_block(samples, filtered);
+            for (size_t i = 0; i != samples.size(); ++i)
+            {
+                demod(samples[i], filtered[i]);
+                advance();
+            }
+        }
+        else
+        {
+            for (auto sample : samples)
+            {
+                demod(sample);
+                advance();
+            }
+        }
+        samples.clear();
+    };
+
+    // Larger blocks for the FFT, which makes each one cost less per sample.
+    std::vector<int16_t> buffer(config->fft_filter ? 16384 : 2048);
+    BasebandRecorder recorder;
+    if (!config->record.empty() && !recorder.start(config->record, config->input_rate))
+    {
+        OPV_LOG_ERROR("Failed to open {} for writing", config->record);
+    }
+
+    while (size_t count = input.read(buffer.data(), buffer.size()))
+    {
+        recorder.push(buffer.data(), count);
+        for (size_t i = 0; i != count; ++i)
+        {
+            int16_t sample = buffer[i];
+            if (config->invert) sample *= -1;
+            float scaled = sample / 44000.0;    // scale 16-bit sample to [-0.74472727,0.744704545]
+            if (resampler) (*resampler)(scaled, [&samples](float y) { samples.push_back(y); });
+            else samples.push_back(scaled);
+        }
+        demodulate();
+    }
+    OPV_LOG_INFO("Input EOF at sample {}", debug_sample_count);
+    if (!config->record.empty())
+    {
+        recorder.stop();
+        OPV_LOG_INFO("Recorded {} samples in {} bytes ({} to 1), {} blocks dropped", recorder.samples(),
+            recorder.bytes(), float(2.0 * recorder.samples() / std::max<uint64_t>(recorder.bytes(), 1)), recorder.dropped());
+    }
+    if (capture.is_open()) OPV_LOG_INFO("Captured {} frames to {}", capture.size(), config->capture_llr);
+
+    baseband_stats = demod.instrumentation;
+    instrumentation = &baseband_stats;
+}
+
+// Limit a baseband file to the part chosen by --start and --end, or to a
+// transmission from its index with a little before and after it, so that
+// the demodulator can find the preamble and the EOS frame. Logs and audio
+// timing count from the start of the file.
+bool select_range(BasebandFile& baseband)
+{
+    const double rate = config->input_rate;
+    uint64_t start = uint64_t(config->start * rate);
+    uint64_t end = config->end ? uint64_t(config->end * rate) : std::numeric_limits<uint64_t>::max();
+
+    if (config->transmission)
+    {
+        auto path = TransmissionIndex::sidecar(config->input_file);
+        TransmissionIndex index;
+        if (!index.load(path))
+        {
+            std::cerr << "Failed to read the index " << path << "; make one with opv-index." << std::endl;
+            return false;
+        }
+        if (*config->transmission >= index.transmissions.size())
+        {
+            std::cerr << "There are " << index.transmissions.size() << " transmissions in " << path << std::endl;
+            return false;
+        }
+        if (index.sample_rate != config->input_rate)
+        {
+            std::cerr << "The index is for " << index.sample_rate << " samples per second, not "
+                << config->input_rate << std::endl;
+            return false;
+        }
+
+        auto& transmission = index.transmissions[*config->transmission];
+        const uint64_t frame = uint64_t(rate * samples_per_frame / sample_rate);
+        start = transmission.start > 2 * frame ? transmission.start - 2 * frame : 0;
+        end = transmission.end + frame;
+        OPV_LOG_INFO("Transmission {} from {} at {} s, {} frames", *config->transmission,
+            transmission.callsign.empty() ? "-" : transmission.callsign, transmission.start / rate, transmission.frames);
+    }
+
+    if (!baseband.range(start, end))
     {
-        std::cerr << "Unknown packet length " << len << std::endl;
+        std::cerr << "The start is past the end of " << config->input_file << std::endl;
+        return false;
     }
+    debug_sample_count = uint64_t(start * (sample_rate / rate));
+    return true;
+}
+
+// Decode the frames of an LLR capture as the demodulator did when it was
+// made, with the same frame decoder state, COBS resets and frame timing.
+template <typename FrameHandler, typename Summary>
+bool replay_llr(const std::string& path, FrameHandler frame_handler, Summary& periodic_summary)
+{
+    LlrCaptureReader reader;
+    if (!reader.open(path))
+    {
+        std::cerr << "Failed to read LLR capture " << path << std::endl;
+        return false;
+    }
+    OPV_LOG_INFO("Replaying {} frames at {} samples per symbol", reader.size(), reader.header().samples_per_symbol);
+
+    OPVFrameDecoder decoder;
+    const uint64_t samples_per_symbol = reader.header().samples_per_symbol;
+    bool confirmed = false;     // as in the demodulator, by the first frame header after a FIRST sync word
+    for (const auto& record : reader)
+    {
+        auto previous_count = debug_sample_count;
+        debug_sample_count = record.sample * default_samples_per_symbol / samples_per_symbol;
+        if (record.sync == OPVSyncType::FIRST)
+        {
+            cobs_decoder.reset();
+            confirmed = false;
+        }
+
+        auto handler = [&](const OPVFrameDecoder::output_buffer_t& frame, int cost)
+        {
+            return confirmed || decoder.header_result_ != OPVFrameHeader::HeaderResult::FAIL
+                ? frame_handler(frame, cost) : true;
+        };
+
+        size_t viterbi_cost;
+        {
+            ScopedStageTimer timer(baseband_stats, Stage::FRAME_DECODE);
+            decoder(std::span<const int8_t, stream_type4_size>(record.llr), viterbi_cost, handler);
+        }
+        bool failed = decoder.header_result_ == OPVFrameHeader::HeaderResult::FAIL;
+        baseband_stats.count([failed, confirmed](auto& c){
+            c.frames++;
+            if (failed) c.header_failures++;
+            if (failed && !confirmed) c.false_locks++;
+        });
+        if (!failed) confirmed = true;
+        OPV_LOG_DEBUG("Frame at sample {}: sync {}, cost {}, evm {}", debug_sample_count, int(record.sync),
+            viterbi_cost, record.evm);
+        periodic_summary(previous_count);
+    }
+    return true;
 }
 
 
@@ -233,6 +667,14 @@ int main(int argc, char* argv[])
 
     int opus_decoder_err;    // return code from Opus function calls
 
+    // Only the audio thread writes std::cout. Tied to it, every read of the
+    // input and every write to std::cerr here would first flush its audio,
+    // and wait on the back end.
+    std::cin.tie(nullptr);
+    std::cerr.tie(nullptr);
+
+    Logger::instance().level(config->debug ? LogLevel::DEBUG : config->quiet ? LogLevel::WARN : LogLevel::INFO);
+
     opus_decoder = ::opus_decoder_create(audio_sample_rate, 1, &opus_decoder_err);
     if (opus_decoder_err != OPUS_OK)
     {
@@ -240,29 +682,211 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+    // Received packets are decoded into pool buffers and held there until
+    // the audio thread is done with them.
+    PacketPool packet_pool(AudioSink::QUEUE_SIZE + AudioSink::MAX_GAP + config->jitter_buffer + 4);
+    cobs_decoder.set_pool(&packet_pool);
+    struct PoolRelease      // give back its slot on every return, while the pool is alive
+    {
+        ~PoolRelease() { cobs_decoder.set_pool(nullptr); }
+    } pool_release;
+
+    packet_dispatcher.route(voice_udp_port, handle_voice_packet);
+    packet_dispatcher.fallback(handle_other_packet);
+
+    AudioSink::Config sink_config;
+    sink_config.max_depth = config->jitter_buffer;
+    // Input known to be recorded (a file, or stdin redirected from one) comes
+    // faster than real time: wait for the sink rather than drop packets. A
+    // pipe may be live, and must never wait on the audio output.
+    struct stat input_stat;
+    bool recorded = !config->input_file.empty()
+        || (fstat(STDIN_FILENO, &input_stat) == 0 && S_ISREG(input_stat.st_mode));
+    sink_config.blocking = config->no_drop || (!config->udp_port && recorded);
+    AudioSink sink(decode_audio, output_audio, sink_config);
+    audio_sink = &sink;
+
     using FloatType = float;
 
-    OPVDemodulator<FloatType> demod(handle_frame);
-    cobs_decoder.set_packet_callback(dummy_packet_callback);
+    // Called directly, so the whole receive chain can be inlined.
+    auto frame_handler = [](const OPVFrameDecoder::output_buffer_t& frame, int viterbi_cost)
+    {
+        return handle_frame(frame, viterbi_cost);
+    };
+    auto diagnostic_handler = [](const OPVDiagnostics<FloatType>& diagnostics)
+    {
+        diagnostic_callback(diagnostics);
+    };
 
-    demod.diagnostics(diagnostic_callback<FloatType>);
+    auto bitstream_frame_handler = [](const OPVFrameDecoder::output_buffer_t& frame, int viterbi_cost)
+    {
+        bool result = handle_frame(frame, viterbi_cost);
+        if (frame.type == OPVFrameDecoder::FrameType::OPV_BERT && prbs.sync() && !config->quiet)
+        {
+            std::cerr << '\r';
+            print_ber();
+            std::cerr << std::flush;
+        }
+        return result;
+    };
+    OPVBitstreamDecoder<decltype(bitstream_frame_handler)> bitstream_decoder(bitstream_frame_handler);
 
-    while (std::cin)
+    instrumentation = &bitstream_decoder.instrumentation;   // until the baseband demodulator starts
+
+    std::ifstream input_file;
+    std::istream* input = &std::cin;
+    if (!config->input_file.empty() && config->bitstream)
     {
-        int16_t sample;
-        std::cin.read(reinterpret_cast<char*>(&sample), 2);
-        if (std::cin.eof())
+        input_file.open(config->input_file, std::ios::binary);
+        if (!input_file)
         {
-            std::cerr << "Input EOF at sample " << debug_sample_count << std::endl;
-            break;
+            std::cerr << "Failed to open " << config->input_file << std::endl;
+            return EXIT_FAILURE;
+        }
+        input = &input_file;
+    }
+
+    const uint64_t stats_samples = uint64_t(config->stats_interval) * sample_rate;
+    auto periodic_summary = [stats_samples](uint64_t previous_count)
+    {
+        if (stats_samples && debug_sample_count / stats_samples != previous_count / stats_samples)
+        {
+            Logger::instance().flush();
+            std::cerr << std::endl;
+            print_summary(std::cerr, *instrumentation, double(debug_sample_count) / sample_rate);
         }
-        if (config->invert) sample *= -1;
-        demod(sample / 44000.0);    // scale 16-bit sample to [-0.74472727,0.744704545] and process
-        debug_sample_count++;
+    };
+
+    if (config->llr)
+    {
+        instrumentation = &baseband_stats;
+        if (!replay_llr(config->input_file, bitstream_frame_handler, periodic_summary)) return EXIT_FAILURE;
     }
+    else if (config->udp_port)
+    {
+        // Bitstream frames as UDP datagrams, until interrupted.
+        UDPNetwork::Config network_config;
+        network_config.batch_size = 16;
+        network_config.receive_buffer = 1 << 20;
+        UDPNetwork udp;
+        if (!udp.open(config->udp_port, network_config))
+        {
+            return EXIT_FAILURE;
+        }
 
+        signal(SIGINT, &signal_handler);
+        while (running)
+        {
+            udp.receive([&bitstream_decoder, &periodic_summary](const uint8_t* data, size_t length)
+            {
+                auto previous_count = debug_sample_count;
+                bitstream_decoder(data, length);
+                count_bitstream_bytes(length);
+                periodic_summary(previous_count);
+            }, 100);
+        }
+        OPV_LOG_INFO("Received {} datagrams", udp.stats().received);
+    }
+    else if (config->bitstream)
+    {
+        // Read in large blocks, but keep time a frame at a time so that
+        // packets reach the audio sink with their frame spacing.
+        std::array<char, baseband_frame_packed_bytes * 16> buffer;
+        while (input->read(buffer.data(), buffer.size()) || input->gcount())
+        {
+            auto previous_count = debug_sample_count;
+            size_t length = input->gcount();
+            for (size_t offset = 0; offset < length; offset += size_t(baseband_frame_packed_bytes))
+            {
+                size_t count = std::min(length - offset, size_t(baseband_frame_packed_bytes));
+                bitstream_decoder(reinterpret_cast<const uint8_t*>(buffer.data()) + offset, count);
+                count_bitstream_bytes(count);
+            }
+            periodic_summary(previous_count);
+        }
+        OPV_LOG_INFO("Input EOF at byte {}", bitstream_bytes);
+    }
+    else
+    {
+        auto demodulate = [&](auto& baseband)
+        {
+            if (baseband.compressed() && !config->input_rate_set) config->input_rate = baseband.sample_rate();
+            if (!Resampler<float>::supported(config->input_rate, symbol_rate * config->samples_per_symbol))
+            {
+                std::cerr << "Cannot resample from " << config->input_rate << " samples per second." << std::endl;
+                return false;
+            }
+
+            switch (config->samples_per_symbol)
+            {
+            case 2:
+                demodulate_baseband<2>(baseband, frame_handler, diagnostic_handler, periodic_summary);
+                break;
+            case 4:
+                demodulate_baseband<4>(baseband, frame_handler, diagnostic_handler, periodic_summary);
+                break;
+            case 5:
+                demodulate_baseband<5>(baseband, frame_handler, diagnostic_handler, periodic_summary);
+                break;
+            default:
+                demodulate_baseband<10>(baseband, frame_handler, diagnostic_handler, periodic_summary);
+                break;
+            }
+            return true;
+        };
+
+        if (config->input_file.empty())
+        {
+            BasebandInput baseband(*input);
+            if (!baseband.open())
+            {
+                std::cerr << "Failed to read the compressed capture." << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!demodulate(baseband)) return EXIT_FAILURE;
+        }
+        else
+        {
+            // Files are read in place, from any point in them.
+            BasebandFile baseband;
+            if (!baseband.open(config->input_file))
+            {
+                std::cerr << "Failed to read " << config->input_file << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (baseband.compressed() && !config->input_rate_set) config->input_rate = baseband.sample_rate();
+            if (!select_range(baseband)) return EXIT_FAILURE;
+            if (!demodulate(baseband)) return EXIT_FAILURE;
+        }
+    }
+
+    sink.stop();    // play out any buffered audio
+
+    Logger::instance().flush();
     std::cerr << std::endl;
 
+    if (config->verbose)
+    {
+        auto& stats = sink.stats();
+        std::cerr << "Audio: " << stats.decoded << " decoded, " << stats.concealed << " concealed, "
+            << stats.blanked << " blanked, " << stats.late << " late, " << stats.overflows << " overflowed, "
+            << "jitter " << stats.jitter / samples_per_frame * 40.0 << " ms, depth " << stats.depth << " frames"
+            << std::endl;
+
+        auto& packets = packet_dispatcher.stats();
+        std::cerr << "Packets: " << packets.packets << " received, " << packets.delivered << " delivered, "
+            << packets.unrouted << " unrouted, " << packets.not_udp << " not UDP, "
+            << packets.malformed << " malformed, " << packets.bad_checksum << " bad checksum"
+            << std::endl;
+    }
+
+    if (Instrumentation::enabled)
+    {
+        Instrumentation summary = *instrumentation;
+        summary.merge(sink.stats().instrumentation);
+        print_summary(std::cerr, summary, double(debug_sample_count) / sample_rate);
+    }
+
     opus_decoder_destroy(opus_decoder);
 
     return EXIT_SUCCESS;
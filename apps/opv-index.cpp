@@ -0,0 +1,215 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#include "BasebandFile.h"
+#include "OPVCobsDecoder.h"
+#include "OPVDemodulator.h"
+#include "Log.h"
+#include "Numerology.h"
+#include "Resampler.h"
+#include "TransmissionIndex.h"
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+const char VERSION[] = "0.1";
+
+using namespace mobilinkd;
+
+// Required by OPVDemodulator. Logging only.
+uint64_t debug_sample_count = 0;
+OPVCobsDecoder cobs_decoder;
+
+// The scan demodulates at the lowest rate the receive chain supports.
+constexpr size_t SCAN_SAMPLES_PER_SYMBOL = 2;
+using scan_rate_t = Oversampling<SCAN_SAMPLES_PER_SYMBOL>;
+
+struct Config
+{
+    std::string input_file;
+    std::string index_file;         // default: the input file's sidecar
+    uint32_t input_rate = 0;        // of raw input; compressed captures give their own
+    bool invert = false;
+    double squelch = -70.0;         // dBFS; quieter blocks are skipped
+    double max_gap = 1.0;           // seconds without frames that end a transmission
+    bool verbose = false;
+
+    static std::optional<Config> parse(int argc, char* argv[])
+    {
+        namespace po = boost::program_options;
+
+        Config result;
+
+        po::options_description desc(
+            "Program options");
+        desc.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("version,V", "Print the application version and exit.")
+            ("file,f", po::value<std::string>(&result.input_file)->required(),
+                "baseband recording to index: raw 16-bit samples, or a capture from opv-demod --record")
+            ("output,o", po::value<std::string>(&result.index_file),
+                "index file to write (default: the recording's name plus .idx)")
+            ("sample-rate,r", po::value<uint32_t>(&result.input_rate),
+                "sample rate of a raw recording (default 271000)")
+            ("invert,i", po::bool_switch(&result.invert), "invert the baseband")
+            ("squelch", po::value<double>(&result.squelch)->default_value(-70.0),
+                "skip blocks of input quieter than this, in dB below full scale")
+            ("max-gap", po::value<double>(&result.max_gap)->default_value(1.0),
+                "seconds without frames that end a transmission with no EOS frame")
+            ("verbose,v", po::bool_switch(&result.verbose), "verbose output")
+            ;
+
+        po::positional_options_description positional;
+        positional.add("file", 1);
+
+        po::variables_map vm;
+        try {
+            po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+
+            if (vm.count("help"))
+            {
+                std::cout << "Find the OPV transmissions in a baseband recording, and write an index of them\n"
+                    << "for opv-demod --transmission\n"
+                    << desc << std::endl;
+                return std::nullopt;
+            }
+
+            if (vm.count("version"))
+            {
+                std::cout << argv[0] << ": " << VERSION << std::endl;
+                return std::nullopt;
+            }
+
+            po::notify(vm);
+        } catch (std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            std::cout << desc << std::endl;
+            return std::nullopt;
+        }
+
+        if (result.index_file.empty()) result.index_file = TransmissionIndex::sidecar(result.input_file);
+        return result;
+    }
+};
+
+std::string timestamp(uint64_t sample, uint32_t rate)
+{
+    std::ostringstream out;
+    double seconds = double(sample) / rate;
+    out << std::setfill('0') << std::setw(2) << int(seconds / 3600) << ':'
+        << std::setw(2) << int(std::fmod(seconds / 60, 60)) << ':'
+        << std::fixed << std::setprecision(2) << std::setw(5) << std::fmod(seconds, 60);
+    return out.str();
+}
+
+int main(int argc, char* argv[])
+{
+    auto config = Config::parse(argc, argv);
+    if (!config) return EXIT_FAILURE;
+
+    Logger::instance().level(config->verbose ? LogLevel::INFO : LogLevel::ERROR);
+
+    BasebandFile file;
+    if (!file.open(config->input_file))
+    {
+        std::cerr << "Failed to read " << config->input_file << std::endl;
+        return EXIT_FAILURE;
+    }
+    uint32_t input_rate = file.compressed() ? file.sample_rate() : config->input_rate ? config->input_rate : sample_rate;
+    if (!Resampler<float>::supported(input_rate, scan_rate_t::sample_rate))
+    {
+        std::cerr << "Cannot resample from " << input_rate << " samples per second." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The scan runs the receive chain on a decimated copy of the input.
+    // Frame positions are taken from the demodulator's sample count, plus
+    // the samples skipped as quiet, scaled back to the input rate.
+    const double scale = double(input_rate) / scan_rate_t::sample_rate;
+    TransmissionTracker tracker(uint64_t(samples_per_frame * double(input_rate) / sample_rate),
+        uint64_t(config->max_gap * input_rate));
+    const OPVFrameDecoder* decoder = nullptr;
+    const uint64_t* demodulated = nullptr;
+    double skipped = 0;     // at the scan rate
+
+    auto frame_handler = [&](const OPVFrameDecoder::output_buffer_t&, int)
+    {
+        tracker.frame(uint64_t((*demodulated + skipped) * scale), decoder->fheader_, decoder->header_result_);
+        return true;
+    };
+
+    using demodulator_t = OPVDemodulator<float, decltype(frame_handler), NoDiagnostics, SCAN_SAMPLES_PER_SYMBOL>;
+    auto demod = std::make_unique<demodulator_t>(frame_handler);
+    demod->cobs(nullptr);
+    decoder = &demod->decoder;
+    demodulated = &demod->sample_count_;
+
+    Resampler<float> resampler(input_rate, scan_rate_t::sample_rate);
+    const double squelch = std::pow(10.0, config->squelch / 10) * 32768.0 * 32768.0;
+    size_t quiet_blocks = 0;
+    size_t blocks = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<int16_t> buffer(16384);
+    while (size_t count = file.read(buffer.data(), buffer.size()))
+    {
+        blocks++;
+        debug_sample_count = uint64_t(file.position() * double(sample_rate) / input_rate);
+
+        double energy = 0;
+        for (size_t i = 0; i != count; ++i) energy += double(buffer[i]) * buffer[i];
+        if (energy < squelch * count)
+        {
+            quiet_blocks++;
+            skipped += count / scale;
+            tracker.advance(file.position());
+            continue;
+        }
+
+        for (size_t i = 0; i != count; ++i)
+        {
+            float sample = (config->invert ? -buffer[i] : buffer[i]) / 44000.0f;
+            resampler(sample, [&demod](float y) { (*demod)(y); });
+        }
+        tracker.advance(file.position());
+    }
+    tracker.finish();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    TransmissionIndex index;
+    index.sample_rate = input_rate;
+    index.samples = file.position();
+    index.transmissions = tracker.transmissions();
+    if (!index.save(config->index_file))
+    {
+        std::cerr << "Failed to write " << config->index_file << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Logger::instance().flush();
+    for (size_t i = 0; i != index.transmissions.size(); ++i)
+    {
+        auto& t = index.transmissions[i];
+        std::cout << std::setw(4) << i << "  " << timestamp(t.start, input_rate) << " - " << timestamp(t.end, input_rate)
+            << "  " << std::setw(6) << t.frames << " frames  " << (t.eos ? "EOS " : "lost") << "  "
+            << (t.callsign.empty() ? "-" : t.callsign) << std::endl;
+    }
+
+    double duration = double(index.samples) / input_rate;
+    std::cerr << index.transmissions.size() << " transmissions in " << std::fixed << std::setprecision(1)
+        << duration << " s of baseband, indexed in " << std::setprecision(2) << elapsed << " s ("
+        << std::setprecision(0) << duration / std::max(elapsed, 1e-9) << "x real time, "
+        << quiet_blocks << " of " << blocks << " blocks skipped as quiet)" << std::endl;
+    std::cerr << "Index written to " << config->index_file << std::endl;
+
+    return EXIT_SUCCESS;
+}
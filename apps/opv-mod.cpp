@@ -1,17 +1,19 @@
 // Copyright 2020 Mobilinkd LLC.
 
 #include "Util.h"
-#include "queue.h"
-#include "FirFilter.h"
-#include "Trellis.h"
-#include "Convolution.h"
-#include "PolynomialInterleaver.h"
-#include "OPVRandomizer.h"
-#include "Util.h"
-#include "Golay24.h"
+#include "ControlSocket.h"
+#include "KeyEvents.h"
+#include "Instrumentation.h"
+#include "OPVModulator.h"
 #include "OPVFrameHeader.h"
+#include "OPVFramePacker.h"
+#include "PcapReader.h"
+#include "Resampler.h"
+#include "SpscQueue.h"
+#include "ThreadAffinity.h"
+#include "TunDevice.h"
 #include "UDPNetwork.h"
-#include "cobs.h"
+#include "Log.h"
 
 #include "Numerology.h"
 #include <opus/opus.h>
@@ -21,22 +23,22 @@
 
 #include <thread>
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <iomanip>
 #include <atomic>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <mutex>
+#include <vector>
 
+#include <cassert>
 #include <cstdlib>
 
 #include <signal.h>
 
-// Generated using scikit-commpy
-const auto rrc_taps = std::array<double, 150>{
-    0.0029364388513841593, 0.0031468394550958484, 0.002699564567597445, 0.001661182944400927, 0.00023319405581230247, -0.0012851320781224025, -0.0025577136087664687, -0.0032843366522956313, -0.0032697038088887226, -0.0024733964729590865, -0.0010285696910973807, 0.0007766690889758685, 0.002553421969211845, 0.0038920145144327816, 0.004451886520053017, 0.00404219185231544, 0.002674727068399207, 0.0005756567993179152, -0.0018493784971116507, -0.004092346891623224, -0.005648131453822014, -0.006126925416243605, -0.005349511529163396, -0.003403189203405097, -0.0006430502751187517, 0.002365929161655135, 0.004957956568090113, 0.006506845894531803, 0.006569574194782443, 0.0050017573119839134, 0.002017321931508163, -0.0018256054303579805, -0.00571615173291049, -0.008746639552588416, -0.010105075751866371, -0.009265784007800534, -0.006136551625729697, -0.001125978562075172, 0.004891777252042491, 0.01071805138282269, 0.01505751553351295, 0.01679337935001369, 0.015256245142156299, 0.01042830577908502, 0.003031522725559901, -0.0055333532968188165, -0.013403099825723372, -0.018598682349642525, -0.01944761739590459, -0.015005271935951746, -0.0053887880354343935, 0.008056525910253532, 0.022816244158307273, 0.035513467692208076, 0.04244131815783876, 0.04025481153629372, 0.02671818654865632, 0.0013810216516704976, -0.03394615682795165, -0.07502635967975885, -0.11540977897637611, -0.14703962203941534, -0.16119995609538576, -0.14969512896336504, -0.10610329539459686, -0.026921412469634916, 0.08757875030779196, 0.23293327870303457, 0.4006012210123992, 0.5786324696325503, 0.7528286479934068, 0.908262741447522, 1.0309661131633199, 1.1095611856548013, 1.1366197723675815, 1.1095611856548013, 1.0309661131633199, 0.908262741447522, 0.7528286479934068, 0.5786324696325503, 0.4006012210123992, 0.23293327870303457, 0.08757875030779196, -0.026921412469634916, -0.10610329539459686, -0.14969512896336504, -0.16119995609538576, -0.14703962203941534, -0.11540977897637611, -0.07502635967975885, -0.03394615682795165, 0.0013810216516704976, 0.02671818654865632, 0.04025481153629372, 0.04244131815783876, 0.035513467692208076, 0.022816244158307273, 0.008056525910253532, -0.0053887880354343935, -0.015005271935951746, -0.01944761739590459, -0.018598682349642525, -0.013403099825723372, -0.0055333532968188165, 0.003031522725559901, 0.01042830577908502, 0.015256245142156299, 0.01679337935001369, 0.01505751553351295, 0.01071805138282269, 0.004891777252042491, -0.001125978562075172, -0.006136551625729697, -0.009265784007800534, -0.010105075751866371, -0.008746639552588416, -0.00571615173291049, -0.0018256054303579805, 0.002017321931508163, 0.0050017573119839134, 0.006569574194782443, 0.006506845894531803, 0.004957956568090113, 0.002365929161655135, -0.0006430502751187517, -0.003403189203405097, -0.005349511529163396, -0.006126925416243605, -0.005648131453822014, -0.004092346891623224, -0.0018493784971116507, 0.0005756567993179152, 0.002674727068399207, 0.00404219185231544, 0.004451886520053017, 0.0038920145144327816, 0.002553421969211845, 0.0007766690889758685, -0.0010285696910973807, -0.0024733964729590865, -0.0032697038088887226, -0.0032843366522956313, -0.0025577136087664687, -0.0012851320781224025, 0.00023319405581230247, 0.001661182944400927, 0.002699564567597445, 0.0031468394550958484, 0.0029364388513841593, 0.0
-};
-
 const char VERSION[] = "0.2";
 
 using namespace mobilinkd;
@@ -51,16 +53,26 @@ struct Config
     bool output_to_network = false; // default is output to stdout
     std::string network_ip;
     uint16_t network_port;
+    size_t network_batch = 1;
     uint32_t bert = 0; // Frames of Bit error rate testing.
     uint64_t token = 0; // authentication token for frame header
     bool invert = false;
+    uint32_t output_rate = sample_rate;     // baseband, resampled if not sample_rate
     bool preamble_only = false;
+    std::string data_file;          // pcap file of data packets
+    uint16_t data_udp_port = 0;     // or UDP port receiving them
+    std::string tun_name;           // or TUN interface
+    bool no_voice = false;          // data only, no audio input
+    bool service = false;           // stay up, keyed by the control socket
+    std::string control_path;
+    std::vector<int> cpus;          // for the voice pipeline stages
 
     static std::optional<Config> parse(int argc, char* argv[])
     {
         namespace po = boost::program_options;
 
         Config result;
+        std::string cpus;
 
         // Declare the supported options.
         po::options_description desc(
@@ -80,10 +92,30 @@ struct Config
                 "IP address (used with --network)")
             ("port", po::value<uint16_t>(&result.network_port)->default_value(7373),
                 "output to port (used with --network)")
+            ("batch", po::value<size_t>(&result.network_batch)->default_value(1),
+                "frames sent per system call (used with --network; more is faster but adds latency)")
             ("bert,B", po::value<uint32_t>(&result.bert)->default_value(0),
                 "number of BERT frames to output (default or 0 to read audio from STDIN instead).")
             ("invert,i", po::bool_switch(&result.invert), "invert the output baseband (ignored for bitstream)")
+            ("sample-rate,r", po::value<uint32_t>(&result.output_rate)->default_value(sample_rate),
+                "baseband output rate in samples per second, e.g. 48000, 250000 or 2400000 "
+                "(resampled from 271000; ignored for bitstream)")
             ("preamble,P", po::bool_switch(&result.preamble_only), "preamble-only output")
+            ("data-file", po::value<std::string>(&result.data_file),
+                "send the IP packets in this pcap file as data.")
+            ("data-udp", po::value<uint16_t>(&result.data_udp_port)->default_value(0),
+                "send as data the IP packet carried by each UDP datagram received on this port.")
+            ("tun", po::value<std::string>(&result.tun_name),
+                "send as data the IP packets routed to this TUN interface.")
+            ("no-voice", po::bool_switch(&result.no_voice),
+                "send data only, without reading audio from STDIN.")
+            ("service", po::bool_switch(&result.service),
+                "stay running and transmit when keyed by commands on the control socket.")
+            ("control", po::value<std::string>(&result.control_path)->default_value("/tmp/opv-mod.sock"),
+                "control socket path (used with --service)")
+            ("cpus", po::value<std::string>(&cpus),
+                "pin the voice pipeline stages (capture, encode, frame, shape, write) to these CPUs, "
+                "e.g. 0,1,2,3,3; - leaves a stage unpinned.")
             ("verbose,v", po::bool_switch(&result.verbose), "verbose output")
             ("debug,d", po::bool_switch(&result.debug), "debug-level output")
             ("quiet,q", po::bool_switch(&result.quiet), "silence all output")
@@ -122,6 +154,43 @@ struct Config
             return std::nullopt;
         }
 
+        int data_sources = !result.data_file.empty() + (result.data_udp_port != 0) + !result.tun_name.empty();
+        if (data_sources > 1)
+        {
+            std::cerr << "Only one of data-file, data-udp or tun may be chosen." << std::endl;
+            return std::nullopt;
+        }
+
+        if (result.no_voice && !data_sources)
+        {
+            std::cerr << "no-voice needs a data source (data-file, data-udp or tun)." << std::endl;
+            return std::nullopt;
+        }
+
+        if (data_sources && (result.bert || result.preamble_only))
+        {
+            std::cerr << "Data cannot be sent with BERT or preamble-only output." << std::endl;
+            return std::nullopt;
+        }
+
+        if (result.service && (result.bert || result.preamble_only || result.no_voice))
+        {
+            std::cerr << "Service mode is for voice; it cannot be used with BERT, preamble-only or no-voice." << std::endl;
+            return std::nullopt;
+        }
+
+        if (!parse_cpu_list(cpus, result.cpus))
+        {
+            std::cerr << "Bad CPU list '" << cpus << "'." << std::endl;
+            return std::nullopt;
+        }
+
+        if (!Resampler<float>::supported(sample_rate, result.output_rate))
+        {
+            std::cerr << "Cannot resample to " << result.output_rate << " samples per second." << std::endl;
+            return std::nullopt;
+        }
+
         if (result.source_address.size() > 9)
         {
             std::cerr << "Source identifier too long." << std::endl;
@@ -137,586 +206,764 @@ std::optional<Config> config;
 std::atomic<bool> running{false};
 UDPNetwork udp;
 
-bool invert = false;
-
-
-// Intercept ^C and just tell the transmit thread to end, which ends the program
-void signal_handler(int)
-{
-    running = false;
-    std::cerr << "quitting" << std::endl;
-}
-
 
-// Convert a dibit into a modulation symbol
-int8_t bits_to_symbol(uint8_t bits)
+// The modulator's baseband at the output rate: passed through as it is,
+// or resampled when --sample-rate asks for another rate.
+class BasebandResampler
 {
-    switch (bits)
+public:
+    BasebandResampler()
     {
-    case 0: return 1;
-    case 1: return 3;
-    case 2: return -1;
-    case 3: return -3;
+        if (config->output_rate != sample_rate) resampler_.emplace(sample_rate, config->output_rate);
+        buffer_.reserve(max_samples());
     }
-    abort();
-}
-
 
-// Convert an unpacked array of bits into an unpacked array of modulation symbols
-template <typename T, size_t N>
-std::array<int8_t, N / 2> bits_to_symbols(const std::array<T, N>& bits)
-{
-    std::array<int8_t, N / 2> result;
-    size_t index = 0;
-    for (size_t i = 0; i != N; i += 2)
+    // The most samples passed to write() at once: a frame at the output rate.
+    static size_t max_samples()
     {
-        result[index++] = bits_to_symbol((bits[i] << 1) | bits[i + 1]);
+        return size_t(uint64_t(samples_per_frame) * config->output_rate / sample_rate) + 2;
     }
-    return result;
-}
-
 
-// Convert a packed array of bits into an unpacked array of modulation symbols
-template <typename T, size_t N>
-std::array<int8_t, N * 4> bytes_to_symbols(const std::array<T, N>& bytes)
-{
-    std::array<int8_t, N * 4> result;
-    size_t index = 0;
-    for (auto b : bytes)
+    // Call write(samples, len) with the samples at the output rate.
+    template <typename Write>
+    void operator()(const int16_t* samples, size_t len, Write&& write)
     {
-        for (size_t i = 0; i != 4; ++i)
+        if (!resampler_)
+        {
+            write(samples, len);
+            return;
+        }
+
+        buffer_.clear();
+        for (size_t i = 0; i != len; ++i)
         {
-            result[index++] = bits_to_symbol(b >> 6);
-            b <<= 2;
+            (*resampler_)(samples[i], [this](float y)
+            {
+                buffer_.push_back(int16_t(std::clamp(std::lround(y), -32768L, 32767L)));
+            });
         }
+        write(buffer_.data(), buffer_.size());
     }
-    return result;
-}
 
+private:
+    std::optional<Resampler<float>> resampler_;
+    std::vector<int16_t> buffer_;
+};
 
-// Convert an unpacked array of modulation symbols into an array of modulation samples.
-// This includes the 10x interpolation using the RRC filter.
-template <size_t N>
-std::array<int16_t, N*10> symbols_to_baseband(std::array<int8_t, N> symbols)
+
+// Where data packets come from: a pcap file, a UDP port or a TUN interface.
+struct DataSource
 {
-    using namespace mobilinkd;
+    enum class Kind { NONE, FILE, UDP, TUN };
 
-    static BaseFirFilter<double, std::tuple_size<decltype(rrc_taps)>::value> rrc = makeFirFilter(rrc_taps);
+    Kind kind = Kind::NONE;
+    bool finished = false;      // the file has been read
+    PcapReader pcap;
+    UDPNetwork socket;
+    TunDevice tun;
+    std::array<uint8_t, OPVFramePacker::MAX_PACKET> buffer;
 
-    std::array<int16_t, N*10> baseband;
-    baseband.fill(0);
-    for (size_t i = 0; i != symbols.size(); ++i)
+    bool open()
     {
-        baseband[i * 10] = symbols[i];
+        if (!config->data_file.empty())
+        {
+            kind = Kind::FILE;
+            if (pcap.open(config->data_file)) return true;
+            std::cerr << "Cannot read " << config->data_file << " as a pcap file" << std::endl;
+            return false;
+        }
+        if (config->data_udp_port)
+        {
+            kind = Kind::UDP;
+            UDPNetwork::Config network_config;
+            network_config.batch_size = 16;
+            network_config.receive_buffer = 1 << 20;
+            return socket.open(config->data_udp_port, network_config);
+        }
+        if (!config->tun_name.empty())
+        {
+            kind = Kind::TUN;
+            return tun.open(config->tun_name);
+        }
+        return true;
     }
 
-    for (auto& b : baseband)
+    /// Packets arrive in real time, rather than being read on demand.
+    bool live() const { return kind == Kind::UDP || kind == Kind::TUN; }
+
+    // Move waiting packets to the packer. A file is read only as far as
+    // the packer has room, so none of it is dropped.
+    void poll(OPVFramePacker& packer)
     {
-        b = rrc(b) * 7168.0 * (invert ? -1.0 : 1.0);
+        auto room = [&packer]() { return packer.data_queued() < OPVFramePacker::MAX_DATA_PACKETS; };
+
+        switch (kind)
+        {
+        case Kind::FILE:
+            while (!finished && room())
+            {
+                const uint8_t* packet;
+                size_t length;
+                if (pcap.next(packet, length)) packer.data(packet, length);
+                else finished = true;
+            }
+            break;
+        case Kind::UDP:
+            while (room() && socket.receive([&packer](const uint8_t* data, size_t length) { packer.data(data, length); }))
+            {}
+            break;
+        case Kind::TUN:
+            while (room())
+            {
+                size_t length = tun.read(buffer.data(), buffer.size());
+                if (!length) break;
+                packer.data(buffer.data(), length);
+            }
+            break;
+        case Kind::NONE:
+            break;
+        }
     }
+};
+
+OPVFramePacker packer;
+DataSource data_source;
 
-    return baseband;
+// Intercept ^C and just tell the transmit thread to end, which ends the program
+void signal_handler(int)
+{
+    running = false;
+    std::cerr << "quitting" << std::endl;
 }
 
 
-// bitstream_t represents a whole frame worth of unpacked bits (not including sync word)
-using bitstream_t = std::array<int8_t, stream_type4_size>;
+// create and output a preamble frame
+void send_preamble(OPVModulator& modulator)
+{
+    if (config->verbose) OPV_LOG_INFO("Sending preamble: {} bits.", stream_type4_size + 16);
+
+    modulator.preamble();
+}
 
 
-// output a frame of type4 bits, including the sync word, to UDP (packed)
-void output_bitstream_to_UDP(std::array<uint8_t, 2> sync_word, const bitstream_t& frame)
+// create and output a frame of dead carrier
+// (We'd like to send silence instead, but can't do that when we're outputting
+// frequency modulation values and not magnitudes.)
+void send_dead_carrier(OPVModulator& modulator)
 {
-    std::array<uint8_t, baseband_frame_packed_bytes> buffer;
-    size_t index = 0;
+    if (config->output_to_network) return;  // don't need dead carrier in this case
 
-    for (auto c : sync_word) buffer[index++] = c;   // output the sync word
-    for (size_t i = 0; i != frame.size(); i += 8)   // output the fheader and data
-    {
-        uint8_t c = 0;
-        for (size_t j = 0; j != 8; ++j)
-        {
-            c <<= 1;
-            c |= frame[i + j];
-        }
-        buffer[index++] = c;
-    }
-    assert(index == baseband_frame_packed_bytes);
+    if (config->verbose) OPV_LOG_INFO("Sending dead carrier: {} bits.", stream_type4_size + 16);
 
-    udp.send_packet(baseband_frame_packed_bytes, (const uint8_t *)buffer.data());
+    modulator.dead_carrier();
 }
 
 
-// output a frame of type4 bits, including the sync word, to cout (packed)
-void output_bitstream_to_stdout(std::array<uint8_t, 2> sync_word, const bitstream_t& frame)
-{
-    for (auto c : sync_word) std::cout << c;        // output the sync word
-    for (size_t i = 0; i != frame.size(); i += 8)   // output the fheader and data
-    {
-        uint8_t c = 0;
-        for (size_t j = 0; j != 8; ++j)
-        {
-            c <<= 1;
-            c |= frame[i + j];
-        }
-        std::cout << c;
-    }
-}
+using audio_frame_t = OPVModulator::audio_frame_t;          // an audio frame is 40ms worth of PCM audio samples
+using opus_packet_t = std::array<uint8_t, opus_packet_size_bytes>;
+using clock_type = std::chrono::steady_clock;
 
 
-// output a frame of type4 bits, including the sync word, to output destination
-void output_bitstream(std::array<uint8_t, 2> sync_word, const bitstream_t& frame)
+void dump_fheader(const OPVModulator::fheader_t header)
 {
-    if (config->output_to_network)
-    {
-        output_bitstream_to_UDP(sync_word, frame);
-    }
-    else
+    std::cerr << "Frame Header: "
+            << std::hex     // output numbers in hex
+            << std::setfill('0');   // fill with 0s
+
+    for (auto hbyte: header)
     {
-        output_bitstream_to_stdout(sync_word, frame);
+        std::cerr << std::setw(2) << int(hbyte) << " ";
     }
+
+    //
+    if (header[6] & 0x80) std::cerr << "last ";
+    if (header[6] & 0x40) std::cerr << "BERT";
+
+    std::cerr << std::endl << std::dec;
 }
 
 
-// output a frame of modulation samples, including the sync word, to cout
-void output_baseband(std::array<uint8_t, 2> sync_word, const bitstream_t& frame)
+// Fill the next payload from the packer; it is the last frame if asked
+// for and nothing is left. Returns whether it is.
+bool next_payload(OPVFramePacker::stream_frame_t& payload, bool last)
 {
-    auto sw = bytes_to_symbols(sync_word);
-    auto symbols = bits_to_symbols(frame);
-
-    std::array<int8_t, baseband_frame_symbols> temp;
-    auto fit = std::copy(sw.begin(), sw.end(), temp.begin());
-    std::copy(symbols.begin(), symbols.end(), fit);
-    auto baseband = symbols_to_baseband(temp);
-    for (auto b : baseband) std::cout << uint8_t(b & 0xFF) << uint8_t(b >> 8);
+    packer.fill(payload);
+    return last && packer.idle();
 }
 
 
-// output a frame, including the sync word, to cout, in the desired format
-void output_frame(std::array<uint8_t, 2> sync_word, const bitstream_t& frame)
+// Send the next frame from the packer.
+bool send_frame(OPVModulator& modulator, bool last)
 {
-    if (config->bitstream) output_bitstream(sync_word, frame);
-    else output_baseband(sync_word, frame);
+    OPVFramePacker::stream_frame_t payload;
+    last = next_payload(payload, last);
+    modulator.frame(payload, last);
+    return last;
 }
 
 
-// create and output a frame with a constant byte value (preamble or dead carrier)
-void send_constant_frame(const uint8_t value)
+// Transmit data only, until the file is done or ^C. Frames from a live
+// source are sent in real time, one every 40ms, idle or not.
+// (preamble has already been sent.)
+void transmit_data(OPVModulator& modulator)
 {
-    std::array<uint8_t, (stream_type4_size + 16)/8> preamble_bytes;
-    preamble_bytes.fill(value);
-    if (config->bitstream)
+    auto next_frame = std::chrono::steady_clock::now();
+    for (;;)
     {
-        if (config->output_to_network)
-        {
-            udp.send_packet(preamble_bytes.size(), (const uint8_t *)preamble_bytes.data());
-        }
-        else
+        if (running) data_source.poll(packer);
+        if (send_frame(modulator, !running || data_source.finished)) break;
+
+        if (data_source.live())
         {
-            for (auto c : preamble_bytes) std::cout << c;
+            next_frame += std::chrono::milliseconds(40);
+            std::this_thread::sleep_until(next_frame);
         }
     }
-    else // baseband
-    {
-        auto preamble_symbols = bytes_to_symbols(preamble_bytes);
-        auto preamble_baseband = symbols_to_baseband(preamble_symbols);
-        for (auto b : preamble_baseband) std::cout << uint8_t(b & 0xFF) << uint8_t(b >> 8);
-    }
-
+    modulator.eot();
 }
 
 
-// create and output a preamble frame to cout
-void send_preamble()
+// The Opus encoder, created once and used for every transmission.
+class VoiceEncoder
 {
-    if (config->verbose) std::cerr << "Sending preamble: " << stream_type4_size + 16 << " bits." << std::endl;
-
-    send_constant_frame(0x77);  // +3, -3, +3, -3 == 01 11 01 11 == 0x77
-}
-
+public:
+    VoiceEncoder()
+    {
+        int encoder_err;    // return code from Opus function calls
 
-// create and output a frame of dead carrier to cout
-// (We'd like to send silence instead, but can't do that when we're outputting
-// frequency modulation values and not magnitudes.)
-void send_dead_carrier()
-{
-    if (config->output_to_network) return;  // don't need dead carrier in this case
+        opus_encoder_ = ::opus_encoder_create(audio_sample_rate, 1, OPUS_APPLICATION_VOIP, &encoder_err);
 
-    if (config->verbose) std::cerr << "Sending dead carrier: " << stream_type4_size + 16 << " bits." << std::endl;
+        if (encoder_err < 0)
+        {
+            std::cerr << "Failed to create an Opus encoder!";
+            abort();
+        }
 
-    send_constant_frame(0);     // +1, +1, +1, +1 = 00 00 00 00 == 0x00
-}
+        encoder_err = opus_encoder_ctl(opus_encoder_, OPUS_SET_BITRATE(opus_bitrate));
 
+        if (encoder_err < 0)
+        {
+            std::cerr << "Failed to set Opus bitrate!";
+            abort();
+        }
 
-constexpr std::array<uint8_t, 2> STREAM_SYNC_WORD = {0xFF, 0x5D};
-constexpr std::array<uint8_t, 2> EOT_SYNC = { 0x55, 0x5D };
+        encoder_err = opus_encoder_ctl(opus_encoder_, OPUS_SET_VBR(0));
 
+        if (encoder_err < 0)
+        {
+            std::cerr << "Failed to set Opus to constant bit rate mode!";
+            abort();
+        }
+    }
 
-// output an end-of-transmission in the desired format
-// EOT is just a sync word and enough tail to push it out through the RRC. Not a frame.
-void output_eot()
-{
-    if (config->bitstream)
+    ~VoiceEncoder()
     {
-        for (auto c : EOT_SYNC) std::cout << c;
-        for (size_t i = 0; i !=10; ++i) std::cout << '\0'; // Flush the imaginary RRC FIR Filter.
+        opus_encoder_destroy(opus_encoder_);
     }
-    else // baseband
+
+    VoiceEncoder(const VoiceEncoder&) = delete;
+    VoiceEncoder& operator=(const VoiceEncoder&) = delete;
+
+    // Encode 40ms of audio.
+    void encode(const audio_frame_t& pcm, opus_packet_t& opus_packet)
     {
-        std::array<int8_t, 48> out_symbols; // EOT symbols + FIR flush.
-        out_symbols.fill(0);    // 0x00 == 00 00 00 00 == +1 +1 +1 +1, why would we send that?
-        auto symbols = bytes_to_symbols(EOT_SYNC);  // overwrite the first 8 symbols
-        for (size_t i = 0; i != symbols.size(); ++i)
+        opus_packet.fill(0);
+        auto count = opus_encode(opus_encoder_, pcm.data(), audio_samples_per_opv_frame, opus_packet.data(), opus_packet_size_bytes);
+        if (count != opus_packet_size_bytes)
         {
-            out_symbols[i] = symbols[i];
+            OPV_LOG_WARN("Got unexpected encoded voice size {}", count);
         }
-        auto baseband = symbols_to_baseband(out_symbols);
-        for (auto b : baseband) std::cout << uint8_t(b & 0xFF) << uint8_t(b >> 8);
     }
-}
 
+    // Start a new stream, as at the start of a transmission.
+    void reset()
+    {
+        opus_encoder_ctl(opus_encoder_, OPUS_RESET_STATE);
+    }
 
-using fheader_t = std::array<uint8_t, fheader_size_bytes>;          // Frame Header (type 1)
-using encoded_fheader_t = std::array<int8_t, encoded_fheader_size>; // Frame Header (type 2/3)
-
-using queue_t = queue<int16_t, audio_samples_per_opv_frame>; // the queue can hold up to 40ms worth of PCM audio samples
-using audio_frame_t = std::array<int16_t, audio_samples_per_opv_frame>;    // an audio frame is 40ms worth of PCM audio samples
-using stream_frame_t = std::array<uint8_t, stream_frame_payload_bytes>; // a stream frame of type1 data bytes
-using type3_data_frame_t = std::array<uint8_t, stream_type3_payload_size>;  // a stream frame of type3 bits
+private:
+    OpusEncoder* opus_encoder_;
+};
 
 
-// Fill in the minimal 12-byte RTP header
-void build_rtp_header(uint8_t* frame_buffer)
+// Voice transmission runs as a pipeline of stages, each on its own thread
+// and optionally pinned to its own CPU (--cpus), handing work along
+// bounded lock-free queues:
+//
+//   capture: read 40ms blocks of audio from STDIN (the main thread)
+//   encode:  Opus-encode them
+//   frame:   wrap them in RTP/UDP/IP, pack them and any data into frame
+//            payloads, FEC-encode, interleave and randomize (transmit()
+//            or serve(), which also decide when transmissions start and end)
+//   shape:   pulse shape the frames into baseband, or pack the bitstream
+//   write:   write the output and time it
+//
+// Every block carries the time its audio was captured (or the transmission
+// keyed), so the writer can measure the latency and jitter of the output.
+
+struct AudioBlock
 {
-    //!!! dummy data
-    memcpy(frame_buffer, "RTP_RTP_RTP_", 12);
-}
+    audio_frame_t pcm;
+    clock_type::time_point captured;
+};
 
-// Fill in the 8-byte UDP header
-void build_udp_header(uint8_t* frame_buffer, int udp_length)
+struct VoiceBlock
 {
-    const uint16_t src_port = 54321;    // should probably be random
-    const uint16_t dst_port = 1234;
-    uint8_t udp_header[8] =
-    {
-        (uint8_t)(src_port/256), (uint8_t)(src_port%256),       // source port
-        (uint8_t)(dst_port/256), (uint8_t)(dst_port%256),       // destination port
-        (uint8_t)(udp_length/256), (uint8_t)(udp_length%256),   // length starting with UDP header
-        0x00, 0x00                                              // checksum
-    };
-
-    memcpy(frame_buffer, udp_header, 8);
-
-    // do we have to come back and fill in the checksum?
-}
-
+    opus_packet_t opus;
+    clock_type::time_point captured;
+    bool last = false;      // the frame of silence ending a transmission
+};
 
-// Fill in the 20-byte IPv4 header
-void build_ip_header(uint8_t* frame_buffer, int packet_len)
+struct FrameBlock
 {
-    uint8_t ip_header[20] = { 0x45, 0x00, (uint8_t)(packet_len/256), (uint8_t)(packet_len%256), // version, x, x, len16
-                              0x00, 0x00, 0x00, 0x00,   // id, flags, frag
-                              64,   17,   0x00, 0x00,   // ttl, protocol=UDP, check16
-                              192,  168,  0,    1,      // src ip
-                              192,  168,  0,    2       // dst ip
-                            };
-
-    memcpy(frame_buffer, ip_header, 20);
-
-    // optionally, come back later and fill in checksum (0x0000 means don't check)
-}
+    enum class Kind { DEAD_CARRIER, PREAMBLE, FRAME, EOT };
 
+    Kind kind = Kind::FRAME;
+    OPVModulator::bitstream_t bits;     // for FRAME
+    clock_type::time_point captured;
+};
 
-// COBS-encode the Opus+RTP+UDP+IP packet
-void cobs_encode_voice_frame(uint8_t* frame, uint8_t* cobs_frame)
+struct OutputBlock
 {
-    cobs_encode_result result;
+    FrameBlock::Kind kind = FrameBlock::Kind::FRAME;
+    size_t length = 0;
+    uint8_t* data = nullptr;        // a frame of bitstream or baseband, at the output rate, in a pipeline buffer
+    clock_type::time_point captured;
+};
 
-    result = cobs_encode(cobs_frame, stream_frame_payload_bytes, frame, stream_frame_payload_bytes - cobs_overhead_bytes_for_opus);
-    if (result.out_len >= stream_frame_payload_bytes || result.status != COBS_ENCODE_OK)
-    {
-        fprintf(stderr, "Failure COBS encoding voice frame.\n");
-    }
-    else
+// What the SDR sink sees: how long each buffer took from capture to being
+// written, and whether it came in time. The sink is taken to start playing
+// at the first buffer of a transmission and to play each for its length;
+// a buffer written after the sink has finished the one before is late (the
+// sink ran dry), and the sink starts again from it.
+struct OutputTiming
+{
+    bool bitstream = false;
+    LatencyHistogram latency;
+    uint64_t min_ns = std::numeric_limits<uint64_t>::max();
+    uint64_t late = 0;
+    uint64_t max_late_ns = 0;
+    bool in_transmission = false;
+    clock_type::time_point due;     // when the sink runs out
+
+    void record(const OutputBlock& block, clock_type::time_point written)
     {
-        // if (result.out_len != stream_frame_payload_bytes - 2)   //!!! a separator and a spare
-        // {
-        //     std::cerr << "Unexpected COBS length " << result.out_len << std::endl;
-        // }
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(written - block.captured).count();
+        latency.record(ns);
+        min_ns = std::min(min_ns, ns);
 
-        for (int i=result.out_len; i < stream_frame_payload_bytes; i++)
+        if (in_transmission && written > due)
         {
-            cobs_frame[i] = 0;  // add zero separator(s) between COBS packets
+            late++;
+            max_late_ns = std::max<uint64_t>(max_late_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(written - due).count());
         }
+        if (!in_transmission || written > due) due = written;
+        due += duration(block.length);
+        in_transmission = block.kind != FrameBlock::Kind::EOT;
     }
-}
-
-// Create the payload for a OPV-RPC frame, which contains a single 40ms Opus packet
-// wrapped in RTP, UDP, and IP, and then framed with COBS.
-stream_frame_t fill_voice_frame(OpusEncoder *opus_encoder, const audio_frame_t& audio)
-{
-    stream_frame_t frame;
-    stream_frame_t cobs_frame;
-    opus_int32 count;
 
-    memset(&frame[0], 0, stream_frame_payload_bytes);   // not really necessary
-
-    count = opus_encode(opus_encoder,
-                        const_cast<int16_t*>(&audio[0]),
-                        audio_samples_per_opv_frame,
-                        &frame[ip_v4_header_bytes+udp_header_bytes+rtp_header_bytes],
-                        opus_packet_size_bytes
-                        );
-
-    if (count != opus_packet_size_bytes)
+    // Play time of a buffer of the given length.
+    std::chrono::nanoseconds duration(size_t length) const
     {
-        std::cerr << "Got unexpected encoded voice size " << count << std::endl;
+        if (!bitstream) return std::chrono::nanoseconds(uint64_t(length / 2) * 1000000000 / config->output_rate);
+        uint64_t symbols = length * 4;
+        return std::chrono::nanoseconds(symbols * 1000000000 / symbol_rate);
     }
 
-    build_rtp_header(&frame[ip_v4_header_bytes+udp_header_bytes]);
-    build_udp_header(&frame[ip_v4_header_bytes], udp_header_bytes+rtp_header_bytes+opus_packet_size_bytes);
-    build_ip_header(&frame[0], ip_v4_header_bytes+udp_header_bytes+rtp_header_bytes+opus_packet_size_bytes);
-
-    assert(ip_v4_header_bytes+udp_header_bytes+rtp_header_bytes+opus_packet_size_bytes+cobs_overhead_bytes_for_opus == stream_frame_payload_bytes);
+    void print(std::ostream& os) const
+    {
+        if (!latency.count()) return;
+        os << "Output: " << latency.count() << " buffers; latency min " << min_ns / 1000
+            << " us, mean " << uint64_t(latency.mean_ns()) / 1000
+            << " us, p99 under " << std::min(latency.percentile_ns(99), latency.max_ns()) / 1000
+            << " us, max " << latency.max_ns() / 1000
+            << " us; jitter " << (latency.max_ns() - min_ns) / 1000
+            << " us; " << late << " late, worst by " << max_late_ns / 1000 << " us" << std::endl;
+    }
+};
 
-    cobs_encode_voice_frame(&frame[0], &cobs_frame[0]);
+struct Pipeline
+{
+    static constexpr const char* STAGES[] = {"capture", "encode", "frame", "shape", "write"};
+
+    SpscQueue<AudioBlock, 8> audio;
+    SpscQueue<VoiceBlock, 4> voice;
+    SpscQueue<FrameBlock, 4> frames;
+    SpscQueue<OutputBlock, 4> output;
+
+    // Output buffers, allocated once for the output rate: enough for a full
+    // output queue and one each in the shape and write stages. The write
+    // stage hands each back when it is written, so nothing is allocated per
+    // frame.
+    static constexpr size_t OUTPUT_BUFFERS = 8;
+    SpscQueue<uint8_t*, OUTPUT_BUFFERS> spare;
+    std::vector<uint8_t> output_storage;
+    size_t output_capacity = 0;         // bytes in each buffer
+
+    void allocate_output(size_t capacity)
+    {
+        output_capacity = capacity;
+        output_storage.resize(OUTPUT_BUFFERS * capacity);
+        for (size_t i = 0; i != OUTPUT_BUFFERS; ++i) spare.push(output_storage.data() + i * capacity);
+    }
 
-    return cobs_frame;
-}
+    KeyEvents keying;                   // the encode stage passes audio on while keyed
+    FrameBlock::Kind shaping = FrameBlock::Kind::FRAME;     // shape stage only
+    clock_type::time_point shaping_captured;
+    OutputTiming timing;                // write stage only
+};
 
 
-// Convert a type1 stream frame to type2/type3. That is, convolutional encode it (and puncture if we used puncturing)
-type3_data_frame_t encode_stream_frame(const stream_frame_t& payload)
+// Capture stage: read audio from STDIN until it ends or we are stopped.
+// Input must be 48000 SPS, 16-bit LE, 1 channel raw audio; a partial
+// block at the end is padded with silence.
+void read_audio(Pipeline& pipeline)
 {
-    std::array<uint8_t, stream_type2_payload_size> encoded;   // rate-1/2 encoded data bits + 4 flush bits, unpacked
-    size_t index = 0;
-    uint32_t memory = 0;
-    for (auto b : payload)
-    {
-        for (size_t i = 0; i != 8; ++i)
-        {
-            uint32_t x = (b & 0x80) >> 7;
-            b <<= 1;
-            memory = update_memory<4>(memory, x);
-            encoded[index++] = convolve_bit(ConvolutionPolyA, memory);
-            encoded[index++] = convolve_bit(ConvolutionPolyB, memory);
-        }
-    }
-    // Flush the encoder.
-    for (size_t i = 0; i != 4; ++i)
+    AudioBlock block;
+    while (running)
     {
-        memory = update_memory<4>(memory, 0);
-        encoded[index++] = convolve_bit(ConvolutionPolyA, memory);
-        encoded[index++] = convolve_bit(ConvolutionPolyB, memory);
+        block.pcm.fill(0);
+        std::cin.read(reinterpret_cast<char*>(block.pcm.data()), sizeof(block.pcm));
+        if (std::cin.gcount() < 2) break;
+        block.captured = clock_type::now();
+        if (!pipeline.audio.push(block) || !std::cin) break;
     }
 
-    return encoded;
+    running = false;
+    pipeline.audio.close();
 }
 
 
-// Create the payload for a BERT frame, exactly the same size as voice frame,
-// but filled with bits from the pseudorandom bit sequence generator.
-// We use a prime number of bits from the PRBS per frame, so that each frame
-// will be unique for a very long while. The rest of the frame is filled up
-// with bits from the beginning of the frame, so that they will have the same
-// statistics. It's up to the receiver whether those filler bits are counted
-// toward the bit error rate.
-template <typename PRBS>
-stream_frame_t fill_bert_frame(PRBS& prbs)
+// Encode stage: Opus-encode audio while keyed, and throw it away
+// otherwise. The end of a transmission (unkeyed, or the end of the audio)
+// is marked by a last packet of silence. The encoder is reset at the start
+// of each transmission. Every key and unkey is acted on, even a pair sent
+// back to back, so each transmission started gets its last packet.
+void encode_audio(Pipeline& pipeline)
 {
-    stream_frame_t bert_bytes;
-    std::array<uint8_t, stream_frame_payload_size> bert_bits;
-    size_t index = 0;
+    VoiceEncoder encoder;
 
-    for (auto bbit: bert_bits)
+    auto end_transmission = [&]()
     {
-        bool bit;
+        VoiceBlock silence;
+        audio_frame_t pcm;
+        pcm.fill(0);
+        encoder.encode(pcm, silence.opus);
+        silence.captured = clock_type::now();
+        silence.last = true;
+        pipeline.voice.push(silence);
+    };
 
-        if (index < bert_frame_prime_size)
+    for (;;)
+    {
+        AudioBlock audio;
+        bool got = pipeline.audio.pop_for(audio, std::chrono::milliseconds(10));
+        bool ending = !got && pipeline.audio.is_finished();
+
+        for (auto event = pipeline.keying.poll(); event != KeyEvents::Event::NONE; event = pipeline.keying.poll())
         {
-            bit = prbs.generate();
+            if (event == KeyEvents::Event::KEY) encoder.reset();
+            else end_transmission();
         }
-        else
+
+        if (ending)
         {
-            bit = bert_bits[index - bert_frame_prime_size];
+            if (pipeline.keying.seen_keyed()) end_transmission();
+            break;
         }
-        bert_bits[index] = bit;
-        index++;
-    }
+        if (!got || !pipeline.keying.seen_keyed()) continue;
 
-    to_byte_array(bert_bits, bert_bytes);
-    std::cerr << "BERT frame" << std::endl;
+        VoiceBlock voice;
+        encoder.encode(audio.pcm, voice.opus);
+        voice.captured = audio.captured;
+        pipeline.voice.push(voice);
+    }
 
-    return bert_bytes;
+    pipeline.voice.close();
 }
 
 
-void dump_fheader(const fheader_t header)
+// Frame stage helpers.
+void queue_marker(Pipeline& pipeline, FrameBlock::Kind kind, clock_type::time_point captured)
 {
-    std::cerr << "Frame Header: "
-            << std::hex     // output numbers in hex
-            << std::setfill('0');   // fill with 0s
-
-    for (auto hbyte: header)
-    {
-        std::cerr << std::setw(2) << int(hbyte) << " ";
-    }
-
-    //
-    if (header[6] & 0x80) std::cerr << "last ";
-    if (header[6] & 0x40) std::cerr << "BERT";
-
-    std::cerr << std::endl << std::dec;
+    FrameBlock block;
+    block.kind = kind;
+    block.captured = captured;
+    pipeline.frames.push(block);
 }
 
 
-// Generate the frame header
-fheader_t fill_fheader(const std::string& source_callsign, OPVFrameHeader::token_t& access_token, bool is_bert)
+// Encode the next frame from the packer for the shape stage.
+bool queue_frame(Pipeline& pipeline, OPVModulator& framer, bool last, clock_type::time_point captured)
 {
-    fheader_t header;
-
-    header.fill(0);
+    OPVFramePacker::stream_frame_t payload;
+    last = next_payload(payload, last);
+    FrameBlock block;
+    block.bits = framer.encode_frame(payload, last);
+    block.captured = captured;
+    pipeline.frames.push(block);
+    return last;
+}
 
-    OPVFrameHeader::call_t callsign;
-    callsign.fill(0);
-    std::copy(source_callsign.begin(), source_callsign.end(), callsign.begin());
-    auto encoded_callsign = OPVFrameHeader::encode_callsign(callsign);
-    uint8_t flags = 0;
-    if (is_bert) flags |= 0x40;
 
-    std::copy(encoded_callsign.begin(), encoded_callsign.end(), header.begin());
-    std::copy(access_token.begin(), access_token.end(), header.begin() + 9);
-    header[6] = flags;
+// Queue a voice packet and send a frame, with any data packets in the
+// room voice leaves. The last packet of a transmission is followed by any
+// data still queued, and EOT.
+void frame_voice(Pipeline& pipeline, OPVModulator& framer, const VoiceBlock& voice)
+{
+    std::array<uint8_t, OPVModulator::voice_packet_bytes> packet;
+    packer.voice(packet.data(), framer.voice_packet(voice.opus.data(), packet.data()));
 
-    if (config->verbose) dump_fheader(header);
+    if (!voice.last)
+    {
+        data_source.poll(packer);
+        queue_frame(pipeline, framer, false, voice.captured);
+        return;
+    }
 
-    return header;
+    while (!queue_frame(pipeline, framer, true, voice.captured)) {}
+    if (config->verbose) dump_fheader(framer.fheader());
+    queue_marker(pipeline, FrameBlock::Kind::EOT, voice.captured);
 }
 
 
-// Modify the frame header to set the EOS (end of stream) bit
-void set_last_frame_bit(fheader_t& fh)
+// Frame stage for a single transmission: dead carrier and preamble, then
+// voice, with any data packets in the frames that voice leaves free,
+// until the audio ends.
+void transmit(Pipeline& pipeline, OPVModulator& framer)
 {
-    fh[6] |= 0x80;
+    auto start = clock_type::now();
+    queue_marker(pipeline, FrameBlock::Kind::DEAD_CARRIER, start);  // in simulation, this coincides with the "initialization" period of the demod
+    queue_marker(pipeline, FrameBlock::Kind::DEAD_CARRIER, start);  // in simulation, this provides some space before the preamble starts
+    queue_marker(pipeline, FrameBlock::Kind::PREAMBLE, start);
+
+    VoiceBlock voice;
+    while (pipeline.voice.pop(voice)) frame_voice(pipeline, framer, voice);
+
+    pipeline.frames.close();
 }
 
 
-// Encode the frame header with multiple words of Golay 12,24 code.
-encoded_fheader_t encode_fheader(fheader_t header)
+// Frame stage for service mode: stay up, transmitting while the control
+// socket has keyed a transmission. The stages stay warm between
+// transmissions. Unkeying ends the transmission when the encode stage's
+// last packet comes through; keying again before then starts the next.
+void serve(Pipeline& pipeline, OPVModulator& framer, ControlSocket& control)
 {
-    encoded_fheader_t bits;
-    size_t bit_index = 0;
-    uint32_t encoded;
+    bool keyed = false;             // by the control socket
+    bool transmitting = false;      // preamble sent, EOT not yet
+    uint64_t transmissions = 0;
+
+    auto command = [&](const std::string& command) -> std::string
+    {
+        if (command == "key")
+        {
+            keyed = true;
+            return "ok keyed";
+        }
+        if (command == "unkey")
+        {
+            keyed = false;
+            pipeline.keying.unkey();
+            return "ok idle";
+        }
+        if (command == "status")
+        {
+            return std::string(keyed ? "keyed " : "idle ") + std::to_string(transmissions);
+        }
+        if (command == "quit")
+        {
+            running = false;
+            keyed = false;
+            pipeline.keying.unkey();
+            return "ok quit";
+        }
+        if (command.empty()) return {};
+        return "error unknown command: " + command;
+    };
 
-    // Each Golay code spans 1.5 bytes. For convenience, we process them in pairs.
-    // Each pair has a first code taking up all of the first byte and half of the second,
-    // and a second code taking up the other half of the second byte and all of the third.
-    for (size_t byte_index = 0; byte_index < fheader_size_bytes; byte_index += 3)
+    while (running || transmitting)
     {
-        encoded = Golay24::encode24(header[byte_index] << 4 | ((header[byte_index+1] >> 4) & 0x0F));
-        for (size_t i = 0; i < 24; i++)
+        if (keyed && !transmitting)
         {
-            bits[bit_index++] = ((encoded & (1 << 23)) != 0);
-            encoded <<= 1;
+            framer.reset();
+            queue_marker(pipeline, FrameBlock::Kind::PREAMBLE, clock_type::now());
+            pipeline.keying.key();
+            transmitting = true;
+            transmissions++;
         }
 
-        encoded = Golay24::encode24((header[byte_index+1] & 0x0F) << 8 | header[byte_index+2]);
-        for (size_t i = 0; i < 24; i++)
+        if (!transmitting)
         {
-            bits[bit_index++] = ((encoded & (1 << 23)) != 0);
-            encoded <<= 1;
+            if (pipeline.voice.is_finished()) break;
+            control.poll(command, 10);
+            continue;
         }
+
+        VoiceBlock voice;
+        if (pipeline.voice.pop_for(voice, std::chrono::milliseconds(10)))
+        {
+            frame_voice(pipeline, framer, voice);
+            if (voice.last)
+            {
+                transmitting = false;
+                OPV_LOG_INFO("Key down: transmission {}", transmissions);
+            }
+        }
+        else if (pipeline.voice.is_finished())
+        {
+            break;
+        }
+        control.poll(command, 0);   // a command takes effect at a frame boundary
     }
 
-    return bits;
+    pipeline.frames.close();
 }
 
 
-// Combine the fheader with the payload, interleave, randomize, and output the frame
-void send_stream_frame(const encoded_fheader_t& fh, const type3_data_frame_t& data)
+// Shape stage: pulse shape (or pack) each frame; the modulator's output
+// callback passes the result to the write stage.
+void shape(Pipeline& pipeline, OPVModulator& modulator)
 {
+    FrameBlock block;
+    while (pipeline.frames.pop(block))
+    {
+        pipeline.shaping = block.kind;
+        pipeline.shaping_captured = block.captured;
+        switch (block.kind)
+        {
+        case FrameBlock::Kind::DEAD_CARRIER:
+            send_dead_carrier(modulator);
+            break;
+        case FrameBlock::Kind::PREAMBLE:
+            if (config->service) modulator.reset();
+            send_preamble(modulator);
+            break;
+        case FrameBlock::Kind::FRAME:
+            modulator.send_encoded(block.bits);
+            break;
+        case FrameBlock::Kind::EOT:
+            modulator.eot();
+            break;
+        }
+    }
 
-    std::array<int8_t, stream_type4_size> temp;
-    auto payload_offset = std::copy(fh.begin(), fh.end(), temp.begin());
-    std::copy(data.begin(), data.end(), payload_offset);
-
-    PolynomialInterleaver<PolynomialInterleaverX, PolynomialInterleaverX2, stream_type4_size> interleaver;
-    OPVRandomizer<stream_type4_size> randomizer;
-
-    interleaver.interleave(temp);
-    randomizer.randomize(temp);
-    output_frame(STREAM_SYNC_WORD, temp);
+    pipeline.output.close();
 }
 
 
-// Thread function that receives PCM audio samples on a queue and transmits OPV.
-// (preamble has already been sent, and fheader has been filled.)
-void transmit(queue_t& queue, fheader_t& fh)
+// The modulator output callbacks for the shape stage.
+void pipeline_output(Pipeline& pipeline, OPVModulator& modulator)
 {
-    int encoder_err;    // return code from Opus function calls
-
-    assert(running);
+    pipeline.allocate_output(std::max<size_t>(baseband_frame_packed_bytes, BasebandResampler::max_samples() * 2));
 
-    auto efh = encode_fheader(fh);
-    
-    OpusEncoder* opus_encoder = ::opus_encoder_create(audio_sample_rate, 1, OPUS_APPLICATION_VOIP, &encoder_err);
-
-    if (encoder_err < 0)
+    // A spare buffer to fill, waiting for the write stage to hand one back.
+    auto take = [&pipeline](size_t length)
     {
-        std::cerr << "Failed to create an Opus encoder!";
-        abort();
-    }
-
-    encoder_err = opus_encoder_ctl(opus_encoder, OPUS_SET_BITRATE(opus_bitrate));
+        OutputBlock block;
+        pipeline.spare.pop(block.data);
+        assert(length <= pipeline.output_capacity);
+        block.length = length;
+        return block;
+    };
 
-    if (encoder_err < 0)
+    auto send = [&pipeline](OutputBlock& block)
     {
-        std::cerr << "Failed to set Opus bitrate!";
-        abort();
-    }
+        block.kind = pipeline.shaping;
+        block.captured = pipeline.shaping_captured;
+        pipeline.output.push(std::move(block));
+    };
 
-    encoder_err = opus_encoder_ctl(opus_encoder, OPUS_SET_VBR(0));
+    modulator.bitstream_output([take, send](const uint8_t* data, size_t len)
+    {
+        OutputBlock block = take(len);
+        std::copy(data, data + len, block.data);
+        send(block);
+    });
 
-    if (encoder_err < 0)
+    auto resample = std::make_shared<BasebandResampler>();
+    modulator.baseband_output([take, send, resample](const int16_t* samples, size_t len)
     {
-        std::cerr << "Failed to set Opus to constant bit rate mode!";
-        abort();
-    }
+        (*resample)(samples, len, [take, send](const int16_t* samples, size_t len)
+        {
+            OutputBlock block = take(len * 2);
+            for (size_t i = 0; i != len; ++i)
+            {
+                auto b = samples[i];
+                block.data[2 * i] = uint8_t(b & 0xFF);
+                block.data[2 * i + 1] = uint8_t(b >> 8);
+            }
+            send(block);
+        });
+    });
+}
 
-    audio_frame_t audio;
-    size_t index = 0;
 
-    while (!queue.is_closed() && queue.empty()) std::this_thread::yield();
-    while (!queue.is_closed())
+// Write stage: write each buffer out as soon as it is ready, and time it.
+// Network output is only pushed out per buffer in service mode, so that
+// --batch still batches a single transmission.
+void write_output(Pipeline& pipeline)
+{
+    uint64_t key_ups = 0;
+    OutputBlock block;
+    while (pipeline.output.pop(block))
     {
-        int16_t sample;
-        if (!queue.get(sample, std::chrono::milliseconds(3000))) break; //!!! this could be smarter
-        audio[index++] = sample;
-        if (index == audio.size())
+        if (config->output_to_network)
+        {
+            udp.send_packet(block.length, block.data);
+            if (config->service) udp.flush();
+        }
+        else
+        {
+            std::cout.write(reinterpret_cast<const char*>(block.data), block.length);
+            std::cout.flush();
+        }
+
+        auto written = clock_type::now();
+        pipeline.spare.push(block.data);    // written (or copied for the network); the shape stage may refill it
+        pipeline.timing.record(block, written);
+        if (config->service && block.kind == FrameBlock::Kind::PREAMBLE)
         {
-            index = 0;
-            auto type4_data = encode_stream_frame(fill_voice_frame(opus_encoder, audio));
-            send_stream_frame(efh, type4_data);
-            audio.fill(0);
-        } 
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(written - block.captured);
+            OPV_LOG_INFO("Key up: transmission {}, preamble out in {} us", ++key_ups, latency.count());
+        }
     }
+}
 
-    if (index > 0)
+
+// Run the pipeline until the audio ends or we are stopped.
+void run_pipeline(OPVModulator& modulator, OPVModulator& framer, ControlSocket* control, const std::vector<int>& cpus)
+{
+    auto pipeline = std::make_unique<Pipeline>();
+    if (!control) pipeline->keying.key();
+    pipeline->timing.bitstream = config->bitstream;
+    pipeline_output(*pipeline, modulator);
+
+    std::thread encode_thread([&pipeline](){ encode_audio(*pipeline); });
+    std::thread frame_thread([&pipeline, &framer, control]()
+    {
+        if (control) serve(*pipeline, framer, *control);
+        else transmit(*pipeline, framer);
+    });
+    std::thread shape_thread([&pipeline, &modulator](){ shape(*pipeline, modulator); });
+    std::thread write_thread([&pipeline](){ write_output(*pipeline); });
+
+    std::array<std::thread*, 5> threads = {nullptr, &encode_thread, &frame_thread, &shape_thread, &write_thread};
+    for (size_t i = 0; i != std::min(cpus.size(), threads.size()); ++i)
     {
-        // send partial frame;
-        auto type4_data = encode_stream_frame(fill_voice_frame(opus_encoder, audio));
-        send_stream_frame(efh, type4_data);
+        bool pinned = threads[i] ? pin_thread(*threads[i], cpus[i]) : pin_current_thread(cpus[i]);
+        if (!pinned) OPV_LOG_WARN("Cannot pin the {} stage to CPU {}", Pipeline::STAGES[i], cpus[i]);
+        else if (cpus[i] >= 0 && config->verbose) OPV_LOG_INFO("{} stage on CPU {}", Pipeline::STAGES[i], cpus[i]);
     }
 
-    // Last frame is an extra frame of silence.
-    audio.fill(0);
-    auto type4_data = encode_stream_frame(fill_voice_frame(opus_encoder, audio));
-    set_last_frame_bit(fh);
-    if (config->verbose) dump_fheader(fh);
-    efh = encode_fheader(fh);
-    send_stream_frame(efh, type4_data);
-    output_eot();
+    read_audio(*pipeline);
+
+    encode_thread.join();
+    frame_thread.join();
+    shape_thread.join();
+    write_thread.join();
 
-    opus_encoder_destroy(opus_encoder);
+    if (config->verbose) pipeline->timing.print(std::cerr);
 }
 
 
@@ -735,12 +982,14 @@ int main(int argc, char* argv[])
     
     if (!config) return 0;
 
-    invert = config->invert;
+    Logger::instance().level(config->debug ? LogLevel::DEBUG : config->quiet ? LogLevel::WARN : LogLevel::INFO);
 
     if (config->output_to_network)
     {
         config->bitstream = true;
-        udp.network_setup(config->network_ip, config->network_port);
+        UDPNetwork::Config network_config;
+        network_config.batch_size = config->network_batch;
+        udp.network_setup(config->network_ip, config->network_port, network_config);
     }
 
     OPVFrameHeader::token_t access_token;
@@ -749,16 +998,44 @@ int main(int argc, char* argv[])
     access_token[1] = (config->token & 0x00ff00) >> 8;
     access_token[2] = (config->token & 0x0000ff);
 
-    auto fh = fill_fheader(config->source_address, access_token, config->bert != 0);
-    auto encoded_fh = encode_fheader(fh);
+    if (!data_source.open()) return EXIT_FAILURE;
+
+    OPVModulator modulator(config->source_address, access_token, config->bert != 0);
+    modulator.invert(config->invert);
+    if (config->bitstream)
+    {
+        modulator.output_mode(OPVModulator::OutputMode::BITSTREAM);
+        modulator.bitstream_output([](const uint8_t* data, size_t len)
+        {
+            if (config->output_to_network) udp.send_packet(len, data);
+            else std::cout.write(reinterpret_cast<const char*>(data), len);
+        });
+    }
+    else
+    {
+        auto resample = std::make_shared<BasebandResampler>();
+        modulator.baseband_output([resample](const int16_t* samples, size_t len)
+        {
+            (*resample)(samples, len, [](const int16_t* samples, size_t len)
+            {
+                for (size_t i = 0; i != len; ++i)
+                {
+                    auto b = samples[i];
+                    std::cout << uint8_t(b & 0xFF) << uint8_t(b >> 8);
+                }
+            });
+        });
+    }
+
+    if (config->verbose) dump_fheader(modulator.fheader());
 
     //!!! debug
-    dump_fheader(fh);
+    dump_fheader(modulator.fheader());
     std::cerr << "Encoded: "
             << std::hex     // output numbers in hex
             << std::setfill('0');   // fill with 0s
 
-    for (auto hbyte: encoded_fh)
+    for (auto hbyte: modulator.encoded_fheader())
     {
         std::cerr << std::setw(2) << int(hbyte) << " ";
     }
@@ -769,24 +1046,34 @@ int main(int argc, char* argv[])
     
     signal(SIGINT, &signal_handler);
 
-    send_dead_carrier();    // in simulation, this coincides with the "initialization" period of the demod
-    send_dead_carrier();    // in simulation, this provides some space before the preamble starts
-    send_preamble();
+    bool pipelined = config->service || !(config->preamble_only || config->bert || config->no_voice);
+    if (!pipelined)
+    {
+        send_dead_carrier(modulator);   // in simulation, this coincides with the "initialization" period of the demod
+        send_dead_carrier(modulator);   // in simulation, this provides some space before the preamble starts
+        send_preamble(modulator);
+    }
+
+    if (config->service) {    // one transmission per key-up
+        ControlSocket control;
+        if (!control.open(config->control_path)) return EXIT_FAILURE;
 
-    if (config->preamble_only) {
+        running = true;
+        OPVModulator framer(config->source_address, access_token);
+
+        std::cerr << "opv-mod service on " << config->control_path << ": key, unkey, status, quit." << std::endl;
+
+        run_pipeline(modulator, framer, &control, config->cpus);
+    } else if (config->preamble_only) {
         running = true;
         std::cerr << "opv-mod sending only preambles" << std::endl;
 
         while (running)
         {
-            send_preamble();
+            send_preamble(modulator);
         }
     } else if (config->bert) {    // BERT mode
-        PRBS9 prbs;
-
         running = true;
-        PolynomialInterleaver<PolynomialInterleaverX, PolynomialInterleaverX2, stream_type4_size> interleaver;
-        OPVRandomizer<stream_type4_size> randomizer;
 
         uint32_t frame_count;
         for (frame_count = 0; frame_count < config->bert; frame_count++)
@@ -795,51 +1082,53 @@ int main(int argc, char* argv[])
             {
                 break;
             }
-            // Create a BERT frame of type3 bits
-            auto frame = encode_stream_frame(fill_bert_frame(prbs));
 
             // If this is the last BERT frame, mark it in the frame header
-            if (frame_count + 1 == config->bert)
+            bool last = frame_count + 1 == config->bert;
+            if (last)
             {
-                set_last_frame_bit(fh);
-                if (config->verbose) dump_fheader(fh);
-                encoded_fh = encode_fheader(fh);
+                modulator.set_last_frame(true);
+                if (config->verbose) dump_fheader(modulator.fheader());
             }
 
-            // Combine with FHeader and make type4 bits
-            std::array<int8_t, stream_type4_size> type4_data;
-            auto payload_offset = std::copy(encoded_fh.begin(), encoded_fh.end(), type4_data.begin());
-            std::copy(frame.begin(), frame.end(), payload_offset);
-
-            interleaver.interleave(type4_data);
-            randomizer.randomize(type4_data);
-            output_frame(STREAM_SYNC_WORD, type4_data);    
+            modulator.bert(last);
         }
 
         std::cerr << "Output " << frame_count << " frames of BERT data." << std::endl;
         
-        output_eot();
-        send_dead_carrier();    // simulate loss of signal
+        modulator.eot();
+        send_dead_carrier(modulator);   // simulate loss of signal
+    } else if (config->no_voice) {    // data only
+        running = true;
+        std::cerr << "opv-mod sending data. ctrl-C to stop." << std::endl;
+        transmit_data(modulator);
     } else {    // Normal mode (voice, data)
         running = true;
-        queue_t queue;
-        std::thread thd([&queue, &fh](){transmit(queue, fh);});
+        OPVModulator framer(config->source_address, access_token);
 
         std::cerr << "opv-mod running. ctrl-D to break." << std::endl;
 
-        // Input must be 48000 SPS, 16-bit LE, 1 channel raw audio.
-        while (running)
-        {
-            int16_t sample;
-            if (!std::cin.read(reinterpret_cast<char*>(&sample), 2)) break;
-            if (!queue.put(sample, std::chrono::seconds(300))) break;
-        }
+        run_pipeline(modulator, framer, nullptr, config->cpus);
+    }
 
-        running = false;
+    if (config->verbose && data_source.kind != DataSource::Kind::NONE)
+    {
+        auto& stats = packer.stats();
+        std::cerr << "Data: " << stats.data_packets << " packets sent, " << stats.data_dropped << " dropped, "
+            << stats.rejected << " too long; " << stats.frames << " frames, "
+            << stats.idle_bytes << " bytes of padding" << std::endl;
+    }
 
-        queue.close();
-        thd.join();
+    if (config->output_to_network)
+    {
+        udp.flush();
+        if (config->verbose)
+        {
+            auto& stats = udp.stats();
+            std::cerr << "Network: " << stats.sent << " frames sent in " << stats.send_calls << " calls, "
+                << stats.dropped << " dropped, " << stats.send_errors << " errors" << std::endl;
+        }
     }
-    
+
     return EXIT_SUCCESS;
 }
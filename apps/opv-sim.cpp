@@ -0,0 +1,352 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#include "ChannelSimulator.h"
+#include "OPVCobsDecoder.h"
+#include "OPVDemodulator.h"
+#include "OPVModulator.h"
+#include "Log.h"
+
+#include "Numerology.h"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+const char VERSION[] = "0.1";
+
+using namespace mobilinkd;
+
+// Required by OPVDemodulator. Logging only; the simulator leaves them alone.
+uint64_t debug_sample_count = 0;
+OPVCobsDecoder cobs_decoder;
+
+struct Config
+{
+    double start = 0.0;
+    double stop = 12.0;
+    double step = 1.0;
+    uint32_t frames = 100;
+    uint32_t burst = 25;
+    uint32_t threads = 0;
+    uint64_t seed = 1;
+    bool pipe = false;
+    bool verbose = false;
+    ChannelImpairments impairments;
+    std::string multipath;
+
+    static std::optional<Config> parse(int argc, char* argv[])
+    {
+        namespace po = boost::program_options;
+
+        Config result;
+
+        // Declare the supported options.
+        po::options_description desc(
+            "Program options");
+        desc.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("version,V", "Print the application version and exit.")
+            ("start", po::value<double>(&result.start)->default_value(0.0), "first Eb/N0 point (dB)")
+            ("stop", po::value<double>(&result.stop)->default_value(12.0), "last Eb/N0 point (dB)")
+            ("step", po::value<double>(&result.step)->default_value(1.0), "Eb/N0 step (dB)")
+            ("frames,f", po::value<uint32_t>(&result.frames)->default_value(100), "BERT frames per Eb/N0 point")
+            ("burst,b", po::value<uint32_t>(&result.burst)->default_value(25), "BERT frames per transmission")
+            ("threads,j", po::value<uint32_t>(&result.threads)->default_value(0), "worker threads (0 = one per core)")
+            ("seed", po::value<uint64_t>(&result.seed)->default_value(1), "base random seed")
+            ("pipe,p", po::bool_switch(&result.pipe),
+                "apply the channel to baseband from STDIN and write it to STDOUT (uses --ebn0)")
+            ("ebn0,e", po::value<double>(&result.impairments.ebn0_db), "Eb/N0 for --pipe (dB, default no noise)")
+            ("deviation", po::value<double>(&result.impairments.deviation_hz)->default_value(2400.0),
+                "FM deviation per symbol unit (Hz)")
+            ("deviation-error", po::value<double>(&result.impairments.deviation_error)->default_value(0.0),
+                "fractional transmit deviation error (0.05 = 5% high)")
+            ("freq-offset", po::value<double>(&result.impairments.frequency_offset_hz)->default_value(0.0),
+                "carrier frequency offset (Hz)")
+            ("clock-ppm", po::value<double>(&result.impairments.clock_ppm)->default_value(0.0),
+                "transmit sample clock error (ppm)")
+            ("if-cutoff", po::value<double>(&result.impairments.if_cutoff_hz)->default_value(0.0),
+                "receive IF filter cutoff (Hz, 0 = automatic)")
+            ("multipath,m", po::value<std::string>(&result.multipath),
+                "echoes as delay:gain[:phase],... (samples, linear amplitude, degrees)")
+            ("verbose,v", po::bool_switch(&result.verbose), "show demodulator log messages")
+            ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help"))
+        {
+            std::cout << "Run OPV BERT frames through a simulated channel and write BER/FER as CSV to STDOUT\n"
+                << desc << std::endl;
+
+            return std::nullopt;
+        }
+
+        if (vm.count("version"))
+        {
+            std::cout << argv[0] << ": " << VERSION << std::endl;
+            return std::nullopt;
+        }
+
+        try {
+            po::notify(vm);
+        } catch (std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            std::cout << desc << std::endl;
+            return std::nullopt;
+        }
+
+        if (!result.multipath.empty() && !parse_multipath(result.multipath, result.impairments.echoes))
+        {
+            std::cerr << "Bad multipath specification: " << result.multipath << std::endl;
+            return std::nullopt;
+        }
+
+        if (result.step <= 0.0 || result.stop < result.start)
+        {
+            std::cerr << "Eb/N0 range must have start <= stop and a positive step." << std::endl;
+            return std::nullopt;
+        }
+
+        if (result.frames == 0 || result.burst == 0)
+        {
+            std::cerr << "At least one frame is needed per point and per transmission." << std::endl;
+            return std::nullopt;
+        }
+
+        return result;
+    }
+
+    static bool parse_multipath(const std::string& spec, std::vector<ChannelImpairments::Echo>& echoes)
+    {
+        std::istringstream input(spec);
+        std::string item;
+        while (std::getline(input, item, ','))
+        {
+            std::istringstream fields(item);
+            ChannelImpairments::Echo echo{0, 0.0, 0.0};
+            char colon;
+            double phase_degrees = 0.0;
+            if (!(fields >> echo.delay >> colon >> echo.gain) || colon != ':') return false;
+            if (fields >> colon)
+            {
+                if (colon != ':' || !(fields >> phase_degrees)) return false;
+            }
+            echo.phase = phase_degrees * M_PI / 180.0;
+            echoes.push_back(echo);
+        }
+        return true;
+    }
+};
+
+struct PointResult
+{
+    double ebn0_db = 0.0;
+    uint32_t frames_sent = 0;
+    uint32_t frames_received = 0;   // distinct BERT frames delivered by the decoder
+    uint32_t frames_good = 0;       // ... with no bit errors
+    uint64_t bits = 0;              // BERT bits compared in received frames
+    uint64_t bit_errors = 0;
+    double seconds = 0.0;
+
+    double ber() const { return bits ? double(bit_errors) / bits : 0.5; }
+    double fer() const { return 1.0 - double(frames_good) / frames_sent; }
+};
+
+/**
+ * Run one Eb/N0 point: modulate BERT frames, pass them through the channel
+ * and the demodulator, and compare what comes out with what went in.
+ *
+ * The frames go out as a series of transmissions of config.burst frames,
+ * each with its own preamble, so that one lost lock costs one burst rather
+ * than the rest of the point. Decoded frames are matched to transmitted
+ * frames by when they arrive, which keeps the comparison honest when
+ * frames are lost or faked.
+ */
+PointResult run_point(const Config& config, double ebn0_db, uint64_t seed)
+{
+    using stream_frame_t = OPVModulator::stream_frame_t;
+
+    PointResult result;
+    result.ebn0_db = ebn0_db;
+    result.frames_sent = config.frames;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // The transmitted payloads, exactly as opv-mod makes them.
+    std::vector<stream_frame_t> sent(config.frames);
+    PRBS9 prbs;
+    for (auto& frame : sent) frame = OPVModulator::fill_bert_frame(prbs);
+    std::vector<uint64_t> frame_end;    // transmitter sample count at the end of each frame
+    frame_end.reserve(config.frames);
+    std::vector<bool> seen(config.frames, false);
+
+    ChannelImpairments impairments = config.impairments;
+    impairments.ebn0_db = ebn0_db;
+    ChannelSimulator channel(impairments, seed);
+
+    uint64_t tx_samples = 0;
+    uint64_t rx_samples = 0;
+    const double resample_step = 1.0 + impairments.clock_ppm * 1e-6;
+
+    auto check_frame = [&](const OPVFrameDecoder::output_buffer_t& frame, int)
+    {
+        if (frame.type != OPVFrameDecoder::FrameType::OPV_BERT) return true;
+
+        // A frame is decoded a little after its last sample arrives.
+        double now = rx_samples * resample_step;
+        auto it = std::upper_bound(frame_end.begin(), frame_end.end(), uint64_t(now));
+        if (it == frame_end.begin()) return true;
+        size_t index = std::distance(frame_end.begin(), it) - 1;
+        if (now - frame_end[index] > samples_per_frame / 2 || seen[index]) return true;
+        seen[index] = true;
+
+        size_t errors = 0;
+        const auto& expected = sent[index];
+        for (size_t bit = 0; bit != bert_frame_prime_size; ++bit)
+        {
+            size_t byte = bit / 8;
+            uint8_t mask = 0x80 >> (bit % 8);
+            errors += (frame.data[byte] & mask) != (expected[byte] & mask);
+        }
+
+        result.frames_received++;
+        result.bits += bert_frame_prime_size;
+        result.bit_errors += errors;
+        if (errors == 0) result.frames_good++;
+        return true;
+    };
+
+    OPVDemodulator<float, decltype(check_frame), NoDiagnostics> demod(check_frame);
+    demod.cobs(nullptr);    // BERT only; keep off the shared COBS decoder
+
+    auto demodulate = [&](double sample)
+    {
+        demod(float(sample / 44000.0));     // same scaling as opv-demod
+        rx_samples++;
+    };
+
+    OPVFrameHeader::token_t token = {0x00, 0x00, 0x00};
+    OPVModulator modulator("SIM", token, true);
+    modulator.baseband_output([&](const int16_t* samples, size_t count)
+    {
+        tx_samples += count;
+        channel(samples, count, demodulate);
+    });
+
+    modulator.dead_carrier();   // let the demodulator initialize
+    for (size_t i = 0; i != sent.size(); ++i)
+    {
+        bool first = i % config.burst == 0;
+        bool last = (i + 1) % config.burst == 0 || i + 1 == sent.size();
+        if (first)
+        {
+            modulator.reset();
+            modulator.dead_carrier();
+            modulator.preamble();
+        }
+        frame_end.push_back(tx_samples + samples_per_frame);
+        modulator.frame(sent[i], last);
+        if (last) modulator.eot();
+    }
+    modulator.dead_carrier();   // flush the last frame through
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+
+// Apply the channel to baseband from stdin, writing the result to stdout.
+int run_pipe(const Config& config)
+{
+    ChannelSimulator channel(config.impairments, config.seed);
+    std::array<int16_t, 1024> input;
+    std::vector<int16_t> output;
+    output.reserve(input.size() * 2);
+
+    while (std::cin)
+    {
+        std::cin.read(reinterpret_cast<char*>(input.data()), input.size() * sizeof(int16_t));
+        size_t count = std::cin.gcount() / sizeof(int16_t);
+        if (count == 0) break;
+
+        output.clear();
+        channel(input.data(), count, [&output](double sample)
+        {
+            output.push_back(int16_t(std::clamp(std::lround(sample), -32768L, 32767L)));
+        });
+        std::cout.write(reinterpret_cast<const char*>(output.data()), output.size() * sizeof(int16_t));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char* argv[])
+{
+    auto config = Config::parse(argc, argv);
+    if (!config) return 0;
+
+    Logger::instance().level(config->verbose ? LogLevel::INFO : LogLevel::OFF);
+
+    if (config->pipe) return run_pipe(*config);
+
+    std::vector<double> points;
+    for (double ebn0 = config->start; ebn0 <= config->stop + config->step / 1000; ebn0 += config->step)
+    {
+        points.push_back(ebn0);
+    }
+
+    size_t threads = config->threads ? config->threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, points.size());
+
+    // Each point gets its own seed, so results don't depend on the thread count.
+    std::vector<PointResult> results(points.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < points.size(); i = next++)
+        {
+            std::seed_seq seq{config->seed, uint64_t(i)};
+            std::array<uint64_t, 1> seed;
+            seq.generate(seed.begin(), seed.end());
+            results[i] = run_point(*config, points[i], seed[0]);
+            std::cerr << "Eb/N0 " << points[i] << " dB done in " << results[i].seconds << " s" << std::endl;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i != threads; ++i) pool.emplace_back(worker);
+    for (auto& thread : pool) thread.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "ebn0_db,esn0_db,frames_sent,frames_received,frames_good,fer,bits,bit_errors,ber\n";
+    for (auto& r : results)
+    {
+        std::cout << r.ebn0_db << ',' << r.ebn0_db + 10.0 * std::log10(2.0) << ','
+            << r.frames_sent << ',' << r.frames_received << ',' << r.frames_good << ','
+            << std::setprecision(6) << r.fer() << ','
+            << r.bits << ',' << r.bit_errors << ',' << r.ber() << '\n';
+    }
+
+    Logger::instance().flush();
+    std::cerr << points.size() << " points, " << config->frames << " frames each, on "
+        << threads << " threads in " << elapsed << " s" << std::endl;
+
+    return EXIT_SUCCESS;
+}
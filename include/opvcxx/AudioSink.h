@@ -0,0 +1,348 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Instrumentation.h"
+#include "Numerology.h"
+#include "PacketPool.h"
+#include "queue.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <thread>
+
+namespace mobilinkd
+{
+
+/**
+ * Asynchronous audio output stage for received voice packets.
+ *
+ * The receiving thread hands each encoded packet to push(), which never
+ * blocks: it queues the packet and returns, dropping it if the queue is
+ * full. A packet given as a PacketHandle is queued by reference; one given
+ * as a pointer is copied into a buffer from the sink's own pool. A sink
+ * configured as blocking waits for room instead, so that recordings can be
+ * decoded faster than real time without losing packets.
+ *
+ * A decoder thread takes packets off the queue, places them in time
+ * slots by their arrival time, holds back a few slots as a jitter buffer,
+ * and decodes them in order. Missing slots are filled by the decoder's
+ * packet loss concealment; packets that arrive out of order are dropped.
+ * Decoding and output (which may block, e.g. on a pipe to aplay) happen
+ * only on the decoder thread.
+ *
+ * Arrival times are in receiver samples (sample_rate), so the buffer
+ * behaves the same for live and recorded input. Packets are expected in
+ * order, one per frame time; the expected arrival time is tracked so that
+ * clock drift does not turn into gaps. The jitter buffer depth
+ * adapts to the measured arrival jitter, between min_depth and max_depth
+ * frames, which also bounds the added latency.
+ *
+ * The codec is supplied by the caller. The decode callback is called as
+ * decode(packet, length, pcm, samples), with packet == nullptr asking for
+ * concealment, and returns the number of samples produced. Its latency is
+ * kept as Stage::OPUS in the sink's own statistics.
+ */
+class AudioSink
+{
+public:
+    using packet_t = std::array<uint8_t, opus_packet_size_bytes>;
+    using pcm_frame_t = std::array<int16_t, audio_samples_per_opv_frame>;
+    using decode_callback_t = std::function<int(const uint8_t*, size_t, int16_t*, size_t)>;
+    using output_callback_t = std::function<void(const int16_t*, size_t)>;
+
+    static constexpr size_t QUEUE_SIZE = 32;            // packets between the threads
+    static constexpr uint64_t FRAME_SAMPLES = samples_per_frame;    // arrival spacing, receiver samples
+    static constexpr size_t MAX_GAP = 12;               // missing frames concealed before starting over
+    static constexpr std::chrono::seconds BLOCKING_TIMEOUT{10};    // longest a blocking push() waits
+
+    struct Config
+    {
+        size_t min_depth = 1;       // frames held back, at least
+        size_t max_depth = 4;       // frames held back, at most
+        bool blocking = false;      // push() waits for room instead of dropping (offline decoding)
+    };
+
+    struct Statistics
+    {
+        std::atomic<uint64_t> packets{0};      // accepted by push()
+        std::atomic<uint64_t> decoded{0};      // frames decoded from packets
+        std::atomic<uint64_t> blanked{0};      // frames output as silence
+        std::atomic<uint64_t> concealed{0};    // frames filled in by concealment
+        std::atomic<uint64_t> overflows{0};    // packets dropped because the queue was full
+        std::atomic<uint64_t> late{0};         // packets dropped because they arrived out of order
+        std::atomic<uint64_t> depth{0};        // current jitter buffer target, frames
+        std::atomic<double> jitter{0.0};       // arrival jitter estimate, receiver samples
+        Instrumentation instrumentation;       // decode calls, as Stage::OPUS; read after stop()
+    };
+
+    AudioSink(decode_callback_t decode, output_callback_t output)
+    : AudioSink(decode, output, Config())
+    {}
+
+    AudioSink(decode_callback_t decode, output_callback_t output, Config config)
+    : decode_(decode), output_(output), config_(config)
+    , pool_(QUEUE_SIZE + MAX_GAP + std::max(config.max_depth, config.min_depth) + 2)
+    {
+        config_.max_depth = std::max(config_.max_depth, config_.min_depth);
+        depth_ = config_.min_depth;
+        stats_.depth = depth_;
+        thread_ = std::thread([this](){ run(); });
+    }
+
+    ~AudioSink()
+    {
+        stop();
+    }
+
+    AudioSink(const AudioSink&) = delete;
+    AudioSink& operator=(const AudioSink&) = delete;
+
+    /**
+     * Queue an encoded packet that arrived at receiver sample @p arrival.
+     * With @p blank set, the slot is output as silence instead (noise
+     * blanker). Never blocks, unless the sink was configured as blocking.
+     *
+     * @return false if the packet was dropped.
+     */
+    bool push(const uint8_t* packet, size_t length, uint64_t arrival, bool blank = false)
+    {
+        PacketHandle buffer = pool_.acquire();
+        if (!buffer)
+        {
+            stats_.overflows++;
+            return false;
+        }
+        length = std::min(length, buffer.capacity());
+        buffer.resize(length);
+        std::memcpy(buffer.data(), packet, length);
+        return push(std::move(buffer), 0, length, arrival, blank);
+    }
+
+    /**
+     * Queue the encoded packet at [offset, offset + length) in @p packet,
+     * without copying it. Never blocks, unless the sink was configured as
+     * blocking.
+     *
+     * @return false if the packet was dropped.
+     */
+    bool push(PacketHandle packet, size_t offset, size_t length, uint64_t arrival, bool blank = false)
+    {
+        Item item;
+        item.kind = blank ? Kind::BLANK : Kind::PACKET;
+        item.arrival = arrival;
+        item.offset = std::min(offset, packet.size());
+        item.length = std::min(length, packet.size() - item.offset);
+        item.packet = std::move(packet);
+
+        if (!queue_.put(std::move(item), config_.blocking ? BLOCKING_TIMEOUT : std::chrono::seconds(0)))
+        {
+            stats_.overflows++;
+            return false;
+        }
+        stats_.packets++;
+        return true;
+    }
+
+    /**
+     * The transmission has ended: play out everything held and start the
+     * next packet as a new stream. Never blocks, unless the sink was
+     * configured as blocking.
+     */
+    void end_of_stream()
+    {
+        Item item;
+        item.kind = Kind::END;
+        queue_.put(std::move(item), config_.blocking ? BLOCKING_TIMEOUT : std::chrono::seconds(0));
+    }
+
+    /// Play out everything queued and stop the decoder thread.
+    void stop()
+    {
+        if (!thread_.joinable()) return;
+        queue_.close();
+        thread_.join();
+    }
+
+    const Statistics& stats() const { return stats_; }
+
+private:
+    enum class Kind { PACKET, BLANK, END };
+
+    struct Item
+    {
+        Kind kind = Kind::PACKET;
+        uint64_t arrival = 0;
+        PacketHandle packet;
+        size_t offset = 0;          // of the encoded audio in packet
+        size_t length = 0;
+    };
+
+    // A slot in the jitter buffer: empty slots are concealed when played.
+    struct Slot
+    {
+        bool filled = false;
+        Item item;
+    };
+
+    decode_callback_t decode_;
+    output_callback_t output_;
+    Config config_;
+    Statistics stats_;
+    PacketPool pool_;               // for packets pushed by pointer
+    queue<Item, QUEUE_SIZE> queue_;
+    std::thread thread_;
+
+    // Decoder thread state.
+    bool active_ = false;           // in a stream
+    double base_arrival_ = 0.0;     // expected arrival time of slot 0
+    uint64_t last_arrival_ = 0;
+    int64_t last_slot_ = 0;         // slot of the last packet
+    int64_t next_slot_ = 0;         // next slot to play
+    std::deque<Slot> slots_;        // slots next_slot_, next_slot_ + 1, ...
+    double jitter_ = 0.0;           // RFC 3550 style interarrival jitter, samples
+    size_t depth_ = 1;
+    pcm_frame_t pcm_;
+
+    void run()
+    {
+        // Without new packets for this long, play out what is held.
+        const auto idle = std::chrono::milliseconds(40) * (config_.max_depth + 1);
+
+        for (;;)
+        {
+            Item item;
+            if (!queue_.get(item, idle))
+            {
+                flush();
+                if (queue_.is_closed()) break;
+                continue;
+            }
+
+            if (item.kind == Kind::END)
+            {
+                flush();
+                continue;
+            }
+
+            insert(item);
+
+            // Play out everything beyond the jitter buffer depth.
+            while (slots_.size() > depth_) play_front();
+        }
+    }
+
+    void insert(Item& item)
+    {
+        if (active_)
+        {
+            if (item.arrival < last_arrival_)
+            {
+                stats_.late++;      // out of order: its slot has already been used
+                return;
+            }
+
+            double position = (double(item.arrival) - base_arrival_) / FRAME_SAMPLES;
+            int64_t slot = std::max(last_slot_ + 1, int64_t(std::llround(position)));
+            if (slot - last_slot_ > int64_t(MAX_GAP))
+            {
+                flush();            // too long a gap: treat it as a new stream
+            }
+            else
+            {
+                // Track the transmitter's frame clock so that drift does not
+                // accumulate into spurious gaps or collisions.
+                double error = double(item.arrival) - (base_arrival_ + double(slot) * FRAME_SAMPLES);
+                base_arrival_ += error / 16.0;
+                update_jitter(std::abs(error));
+                place(slot, item);
+                return;
+            }
+        }
+
+        active_ = true;
+        base_arrival_ = double(item.arrival);
+        next_slot_ = 0;
+        place(0, item);
+    }
+
+    void place(int64_t slot, Item& item)
+    {
+        last_slot_ = slot;
+        last_arrival_ = item.arrival;
+
+        size_t index = slot - next_slot_;
+        if (index >= slots_.size()) slots_.resize(index + 1);
+        slots_[index].filled = true;
+        slots_[index].item = std::move(item);
+    }
+
+    void update_jitter(double deviation)
+    {
+        jitter_ += (deviation - jitter_) / 16.0;
+        stats_.jitter = jitter_;
+
+        // Enough slots to cover three times the jitter, plus one.
+        size_t depth = 1 + size_t(std::ceil(3.0 * jitter_ / FRAME_SAMPLES));
+        depth_ = std::clamp(depth, config_.min_depth, config_.max_depth);
+        stats_.depth = depth_;
+    }
+
+    void play_front()
+    {
+        Slot& slot = slots_.front();
+        int count = 0;
+
+        if (!slot.filled)
+        {
+            count = decode(nullptr, 0);
+            stats_.concealed++;
+        }
+        else if (slot.item.kind == Kind::BLANK)
+        {
+            pcm_.fill(0);
+            count = pcm_.size();
+            stats_.blanked++;
+        }
+        else
+        {
+            count = decode(slot.item.packet.data() + slot.item.offset, slot.item.length);
+            stats_.decoded++;
+        }
+
+        if (count <= 0)
+        {
+            pcm_.fill(0);   // keep the output timing even if the decoder fails
+        }
+        else if (size_t(count) < pcm_.size())
+        {
+            std::fill(pcm_.begin() + count, pcm_.end(), 0);
+        }
+        output_(pcm_.data(), pcm_.size());
+
+        slots_.pop_front();
+        next_slot_++;
+    }
+
+    int decode(const uint8_t* packet, size_t length)
+    {
+        ScopedStageTimer timer(stats_.instrumentation, Stage::OPUS);
+        return decode_(packet, length, pcm_.data(), pcm_.size());
+    }
+
+    void flush()
+    {
+        while (!slots_.empty()) play_front();
+        active_ = false;
+    }
+};
+
+} // mobilinkd
@@ -0,0 +1,105 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "CompressedBaseband.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+
+namespace mobilinkd
+{
+
+/**
+ * A baseband recording on disk, raw 16-bit samples or a compressed capture
+ * (recognized by its header), read from any sample.
+ *
+ * Raw recordings are mapped into memory, so starting an hour into a
+ * day-long recording costs no more than starting at its beginning;
+ * compressed captures seek by their block index.
+ */
+class BasebandFile
+{
+public:
+    /// @return false if the file cannot be read.
+    bool open(const std::string& path)
+    {
+        compressed_.reset();
+        if (!raw_.open(path)) return false;
+        if (raw_.size() >= CompressedBaseband::MAGIC.size()
+            && CompressedBaseband::is_magic(reinterpret_cast<const char*>(raw_.data())))
+        {
+            raw_.close();
+            compressed_.emplace();
+            if (!compressed_->open(path)) return false;
+        }
+        position_ = 0;
+        end_ = std::numeric_limits<uint64_t>::max();
+        return true;
+    }
+
+    bool compressed() const { return compressed_.has_value(); }
+
+    /// The compressed capture's sample rate; 0 for raw samples, which do not say.
+    uint32_t sample_rate() const { return compressed_ ? compressed_->sample_rate() : 0; }
+
+    /// Samples in the recording.
+    uint64_t size()
+    {
+        return compressed_ ? compressed_->size() : raw_.size() / sizeof(int16_t);
+    }
+
+    /**
+     * Read from @p start up to (not including) @p end.
+     * @return false if @p start is past the end of the recording.
+     */
+    bool range(uint64_t start, uint64_t end = std::numeric_limits<uint64_t>::max())
+    {
+        end_ = end;
+        if (compressed_)
+        {
+            if (start == 0 && compressed_->position() == 0) return true;
+            if (!compressed_->seek(start)) return false;
+        }
+        else if (start > raw_.size() / sizeof(int16_t))
+        {
+            return false;
+        }
+        position_ = start;
+        return true;
+    }
+
+    /// The next sample read() will give.
+    uint64_t position() const { return position_; }
+
+    /// Read up to @p count samples. @return the samples read; 0 at the end.
+    size_t read(int16_t* samples, size_t count)
+    {
+        count = size_t(std::min<uint64_t>(count, end_ > position_ ? end_ - position_ : 0));
+        if (compressed_)
+        {
+            count = compressed_->read(samples, count);
+        }
+        else
+        {
+            count = size_t(std::min<uint64_t>(count, raw_.size() / sizeof(int16_t) - position_));
+            if (count) std::memcpy(samples, raw_.data() + position_ * sizeof(int16_t), count * sizeof(int16_t));
+        }
+        position_ += count;
+        return count;
+    }
+
+private:
+    MappedFile raw_;
+    std::optional<CompressedBasebandReader> compressed_;
+    uint64_t position_ = 0;
+    uint64_t end_ = std::numeric_limits<uint64_t>::max();
+};
+
+} // mobilinkd
@@ -0,0 +1,226 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Numerology.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace mobilinkd
+{
+
+/**
+ * Channel impairments applied by ChannelSimulator.
+ *
+ * The defaults describe a perfect channel: the output then matches the
+ * input apart from the IF filter.
+ */
+struct ChannelImpairments
+{
+    struct Echo
+    {
+        size_t delay;       // samples after the direct path
+        double gain;        // amplitude relative to the direct path
+        double phase;       // radians
+    };
+
+    double ebn0_db = std::numeric_limits<double>::infinity();  // per channel bit (2 per symbol)
+    double deviation_hz = 2400.0;       // FM deviation for a baseband value of 1.0 symbol unit
+    double deviation_error = 0.0;       // fractional transmitter deviation error, 0.05 = 5% high
+    double frequency_offset_hz = 0.0;   // transmitter minus receiver carrier frequency
+    double clock_ppm = 0.0;             // transmitter sample clock error, positive = fast
+    double if_cutoff_hz = 0.0;          // receiver IF filter cutoff, 0 = from the deviation
+    std::vector<Echo> echoes;           // static multipath
+};
+
+/**
+ * Monte-Carlo channel simulator for OPV baseband.
+ *
+ * The input is baseband as produced by OPVModulator (16-bit samples at
+ * sample_rate, BASEBAND_SCALE per symbol unit). It is resampled for the
+ * transmitter clock error, FM modulated to complex baseband, passed through
+ * the multipath taps, shifted by the frequency offset and given AWGN, then
+ * filtered and FM demodulated the way a receiver would. The output is in
+ * the same units as the input, ready for OPVDemodulator.
+ *
+ * Each instance owns its random number generator, so instances seeded
+ * differently run independently in parallel.
+ */
+class ChannelSimulator
+{
+public:
+    static constexpr double BASEBAND_SCALE = 7168.0;    // matches OPVModulator
+    static constexpr size_t IF_FILTER_TAPS = 65;
+    static constexpr double CHANNEL_BIT_RATE = 2.0 * symbol_rate;
+
+    using complex_t = std::complex<double>;
+
+    ChannelSimulator(const ChannelImpairments& impairments, uint64_t seed = 1)
+    : impairments_(impairments), rng_(seed)
+    {
+        const double tx_deviation = impairments_.deviation_hz * (1.0 + impairments_.deviation_error);
+        tx_phase_step_ = 2.0 * M_PI * tx_deviation / sample_rate / BASEBAND_SCALE;
+        offset_step_ = 2.0 * M_PI * impairments_.frequency_offset_hz / sample_rate;
+        rx_gain_ = sample_rate / (2.0 * M_PI * impairments_.deviation_hz) * BASEBAND_SCALE;
+        resample_step_ = 1.0 + impairments_.clock_ppm * 1e-6;
+
+        if (std::isfinite(impairments_.ebn0_db))
+        {
+            // Unit signal power, noise density N0 = Eb / (Eb/N0) over the full sample rate.
+            double ebn0 = std::pow(10.0, impairments_.ebn0_db / 10.0);
+            noise_sigma_ = std::sqrt(sample_rate / (CHANNEL_BIT_RATE * ebn0) / 2.0);
+        }
+
+        size_t max_delay = 0;
+        for (auto& echo : impairments_.echoes)
+        {
+            max_delay = std::max(max_delay, echo.delay);
+            echo_taps_.push_back(std::polar(echo.gain, echo.phase));
+        }
+        delay_line_.assign(max_delay + 1, complex_t(0.0, 0.0));
+
+        design_if_filter();
+    }
+
+    const ChannelImpairments& impairments() const { return impairments_; }
+
+    /**
+     * Run @p count input samples through the channel. @p output is called
+     * with each output sample (a double, in the input's units, unclipped).
+     * Clock error makes the output count differ slightly from the input.
+     */
+    template <typename Output>
+    void operator()(const int16_t* input, size_t count, Output&& output)
+    {
+        for (size_t i = 0; i != count; ++i)
+        {
+            double sample = input[i];
+
+            // Transmitter clock error: linear interpolation at the drifted rate.
+            while (resample_pos_ < 1.0)
+            {
+                double value = previous_ + (sample - previous_) * resample_pos_;
+                output(channel(value));
+                resample_pos_ += resample_step_;
+            }
+            resample_pos_ -= 1.0;
+            previous_ = sample;
+        }
+    }
+
+private:
+    ChannelImpairments impairments_;
+    std::mt19937_64 rng_;
+    std::normal_distribution<double> normal_{0.0, 1.0};
+
+    double tx_phase_step_ = 0.0;
+    double offset_step_ = 0.0;
+    double rx_gain_ = 0.0;
+    double noise_sigma_ = 0.0;
+    double resample_step_ = 1.0;
+
+    double previous_ = 0.0;
+    double resample_pos_ = 0.0;
+    double tx_phase_ = 0.0;
+    double offset_phase_ = 0.0;
+
+    std::vector<complex_t> echo_taps_;
+    std::vector<complex_t> delay_line_;
+    size_t delay_pos_ = 0;
+
+    std::array<double, IF_FILTER_TAPS> if_taps_;
+    std::array<complex_t, IF_FILTER_TAPS * 2> if_history_{};   // doubled to avoid wrapping
+    size_t if_pos_ = 0;
+
+    complex_t last_ = {1.0, 0.0};
+
+    // Hamming-windowed sinc low-pass filter at the IF cutoff.
+    void design_if_filter()
+    {
+        double cutoff = impairments_.if_cutoff_hz;
+        if (cutoff <= 0.0)
+        {
+            // Carson's rule, with headroom for the RRC overshoot and deviation error.
+            cutoff = 3.0 * 1.2 * impairments_.deviation_hz * (1.0 + std::abs(impairments_.deviation_error))
+                + symbol_rate / 2.0 + std::abs(impairments_.frequency_offset_hz);
+        }
+        cutoff = std::min(cutoff, sample_rate / 2.0);
+
+        const double fc = cutoff / sample_rate;
+        const double middle = (IF_FILTER_TAPS - 1) / 2.0;
+        double sum = 0.0;
+        for (size_t i = 0; i != IF_FILTER_TAPS; ++i)
+        {
+            double n = i - middle;
+            double sinc = n == 0.0 ? 2.0 * fc : std::sin(2.0 * M_PI * fc * n) / (M_PI * n);
+            double window = 0.54 - 0.46 * std::cos(2.0 * M_PI * i / (IF_FILTER_TAPS - 1));
+            if_taps_[i] = sinc * window;
+            sum += if_taps_[i];
+        }
+        for (auto& tap : if_taps_) tap /= sum;
+    }
+
+    complex_t multipath(complex_t x)
+    {
+        if (echo_taps_.empty()) return x;
+
+        const size_t size = delay_line_.size();
+        delay_line_[delay_pos_] = x;
+        complex_t result = x;
+        for (size_t i = 0; i != echo_taps_.size(); ++i)
+        {
+            size_t index = (delay_pos_ + size - impairments_.echoes[i].delay) % size;
+            result += echo_taps_[i] * delay_line_[index];
+        }
+        if (++delay_pos_ == size) delay_pos_ = 0;
+        return result;
+    }
+
+    complex_t if_filter(complex_t x)
+    {
+        if_history_[if_pos_] = x;
+        if_history_[if_pos_ + IF_FILTER_TAPS] = x;
+        if (++if_pos_ == IF_FILTER_TAPS) if_pos_ = 0;
+
+        // if_history_[if_pos_ .. if_pos_ + N) holds the last N samples, oldest first.
+        double re = 0.0, im = 0.0;
+        const complex_t* history = &if_history_[if_pos_];
+        for (size_t i = 0; i != IF_FILTER_TAPS; ++i)
+        {
+            re += history[i].real() * if_taps_[i];
+            im += history[i].imag() * if_taps_[i];
+        }
+        return {re, im};
+    }
+
+    // One sample through modulator, channel and discriminator.
+    double channel(double baseband)
+    {
+        tx_phase_ = std::remainder(tx_phase_ + tx_phase_step_ * baseband, 2.0 * M_PI);
+        offset_phase_ = std::remainder(offset_phase_ + offset_step_, 2.0 * M_PI);
+
+        complex_t x = multipath(std::polar(1.0, tx_phase_ + offset_phase_));
+
+        if (noise_sigma_ != 0.0)
+        {
+            double re = normal_(rng_);
+            double im = normal_(rng_);
+            x += complex_t(re, im) * noise_sigma_;
+        }
+
+        complex_t y = if_filter(x);
+        double result = std::arg(y * std::conj(last_)) * rx_gain_;
+        last_ = y;
+        return result;
+    }
+};
+
+} // mobilinkd
@@ -0,0 +1,889 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "SpscQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mobilinkd
+{
+
+/**
+ * Lossless compressed capture of 16-bit baseband, for long recordings.
+ *
+ * Samples go in blocks of up to BLOCK_SIZE. Each block is predicted either
+ * by the best of the fixed polynomial predictors of order 0 to MAX_ORDER
+ * or by a linear predictor of order MAX_LPC_ORDER fitted to the block, with
+ * quantized coefficients (as in FLAC). The residuals are Rice coded in
+ * partitions of PARTITION_SIZE, each with its own parameter; a partition
+ * that would not compress is stored in plain binary instead. Baseband is
+ * band-limited and oversampled, so the residuals are far smaller than the
+ * samples.
+ *
+ * Layout, all little-endian:
+ *
+ *  - a 24-byte header: magic "OPVBBZ\0\0", then 32-bit version, sample
+ *    rate, block size and a reserved word;
+ *  - blocks, each a 20-byte header ("OPVB", 64-bit first sample, 16-bit
+ *    sample count, 8-bit predictor, a reserved byte, 32-bit payload
+ *    length) and its payload. The predictor is the fixed order, or LPC
+ *    plus the order; an LPC payload starts with the coefficient precision
+ *    less one (4 bits), the shift (5 bits) and the coefficients;
+ *  - on close, an index of the blocks ("OPVI", 32-bit count, then the
+ *    64-bit first sample and file offset of each) and a 16-byte footer
+ *    (64-bit index offset and "OPVZIDX\0").
+ *
+ * Each block decodes on its own, so a reader can seek to any block by the
+ * index. Blocks follow on from each other, except where samples were lost
+ * in recording: the next block's first sample then leaves a gap. A capture cut short has no index; the reader then finds the
+ * blocks from their headers, and loses only the partial last block.
+ */
+struct CompressedBaseband
+{
+    static constexpr std::array<char, 8> MAGIC = {'O', 'P', 'V', 'B', 'B', 'Z', 0, 0};
+    static constexpr std::array<char, 4> BLOCK_MAGIC = {'O', 'P', 'V', 'B'};
+    static constexpr std::array<char, 4> INDEX_MAGIC = {'O', 'P', 'V', 'I'};
+    static constexpr std::array<char, 8> FOOTER_MAGIC = {'O', 'P', 'V', 'Z', 'I', 'D', 'X', 0};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 24;
+    static constexpr size_t BLOCK_HEADER_SIZE = 20;
+    static constexpr size_t FOOTER_SIZE = 16;
+    static constexpr size_t BLOCK_SIZE = 4096;
+    static constexpr size_t PARTITION_SIZE = 256;
+    static constexpr size_t MAX_ORDER = 4;          // fixed predictors
+    static constexpr size_t MAX_LPC_ORDER = 12;
+    static constexpr unsigned LPC_PRECISION = 14;   // bits per coefficient, with the sign
+    static constexpr uint8_t LPC = 0x80;            // in the block header's predictor byte
+    static constexpr uint32_t ESCAPE = 31;          // Rice parameter for a partition in plain binary
+
+    struct IndexEntry
+    {
+        uint64_t first_sample;
+        uint64_t offset;            // of the block header, from the start of the file
+    };
+
+    static bool is_magic(const char* data)
+    {
+        return std::equal(MAGIC.begin(), MAGIC.end(), data);
+    }
+
+    static void put(std::vector<uint8_t>& out, uint64_t value, size_t bytes)
+    {
+        for (size_t i = 0; i != bytes; ++i) out.push_back(uint8_t(value >> (8 * i)));
+    }
+
+    static uint64_t get(const uint8_t* in, size_t bytes)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i != bytes; ++i) value |= uint64_t(in[i]) << (8 * i);
+        return value;
+    }
+
+    /**
+     * A linear predictor with integer coefficients: x[n] is predicted as
+     * the sum of coefficients[i] * x[n - 1 - i], shifted right by shift.
+     */
+    struct Predictor
+    {
+        size_t order = 0;
+        unsigned shift = 0;
+        std::array<int32_t, MAX_LPC_ORDER> coefficients{};
+
+        /// The fixed polynomial predictor of the given order.
+        static Predictor fixed(size_t order)
+        {
+            static constexpr int32_t taps[MAX_ORDER + 1][MAX_ORDER] = {
+                {}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+            Predictor result;
+            result.order = order;
+            std::copy(taps[order], taps[order] + order, result.coefficients.begin());
+            return result;
+        }
+
+        int32_t operator()(const int32_t* x, size_t n) const
+        {
+            int64_t sum = 0;
+            for (size_t i = 0; i != order; ++i) sum += int64_t(coefficients[i]) * x[n - 1 - i];
+            return int32_t(sum >> shift);
+        }
+    };
+
+    /// Prediction of x[n] by the fixed predictor of the given order.
+    static int32_t predict(const int32_t* x, size_t n, size_t order)
+    {
+        switch (order)
+        {
+        case 1: return x[n - 1];
+        case 2: return 2 * x[n - 1] - x[n - 2];
+        case 3: return 3 * x[n - 1] - 3 * x[n - 2] + x[n - 3];
+        case 4: return 4 * x[n - 1] - 6 * x[n - 2] + 4 * x[n - 3] - x[n - 4];
+        default: return 0;
+        }
+    }
+
+    static uint32_t zigzag(int32_t value) { return (uint32_t(value) << 1) ^ uint32_t(value >> 31); }
+    static int32_t unzigzag(uint32_t value) { return int32_t(value >> 1) ^ -int32_t(value & 1); }
+};
+
+namespace detail
+{
+
+/// Bits, most significant first, appended to a byte vector.
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t value, unsigned bits)
+    {
+        for (unsigned i = bits; i != 0; --i) bit((value >> (i - 1)) & 1);
+    }
+
+    void unary(uint32_t count)
+    {
+        for (uint32_t i = 0; i != count; ++i) bit(0);
+        bit(1);
+    }
+
+    void flush()
+    {
+        if (used_) out_.push_back(uint8_t(byte_ << (8 - used_)));
+        byte_ = 0;
+        used_ = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint8_t byte_ = 0;
+    unsigned used_ = 0;
+
+    void bit(uint32_t b)
+    {
+        byte_ = uint8_t(byte_ << 1 | b);
+        if (++used_ == 8)
+        {
+            out_.push_back(byte_);
+            byte_ = 0;
+            used_ = 0;
+        }
+    }
+};
+
+/// Reads what BitWriter wrote. Reading past the end gives zero bits and sets overrun().
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, size_t length) : data_(data), length_(length) {}
+
+    uint32_t get(unsigned bits)
+    {
+        if (bits == 0) return 0;
+        fill(bits);
+        uint32_t value = uint32_t(cache_ >> (64 - bits));
+        cache_ <<= bits;
+        cached_ -= bits;
+        return value;
+    }
+
+    uint32_t unary()
+    {
+        uint32_t count = 0;
+        for (;;)
+        {
+            fill(1);
+            if (overrun_) return count;
+            unsigned zeros = std::min<unsigned>(std::countl_zero(cache_), cached_);
+            count += zeros;
+            cache_ <<= zeros;
+            cached_ -= zeros;
+            if (cached_ != 0)
+            {
+                cache_ <<= 1;
+                cached_ -= 1;
+                return count;
+            }
+        }
+    }
+
+    bool overrun() const { return overrun_; }
+
+private:
+    const uint8_t* data_;
+    size_t length_;
+    size_t pos_ = 0;
+    uint64_t cache_ = 0;        // bits, left aligned
+    unsigned cached_ = 0;
+    bool overrun_ = false;
+
+    void fill(unsigned bits)
+    {
+        while (cached_ < bits)
+        {
+            if (pos_ == length_)
+            {
+                overrun_ = true;
+                cached_ = 64;       // zeros
+                return;
+            }
+            if (cached_ > 56) return;
+            cache_ |= uint64_t(data_[pos_++]) << (56 - cached_);
+            cached_ += 8;
+        }
+    }
+};
+
+} // detail
+
+/**
+ * Writes a compressed baseband capture. Samples are buffered into blocks;
+ * close() writes the last block and the index.
+ */
+class CompressedBasebandWriter
+{
+public:
+    using Format = CompressedBaseband;
+
+    ~CompressedBasebandWriter() { close(); }
+
+    /// @return false if the file cannot be written.
+    bool open(const std::string& path, uint32_t sample_rate)
+    {
+        close();
+        file_.clear();
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_) return false;
+
+        std::vector<uint8_t> header(Format::MAGIC.begin(), Format::MAGIC.end());
+        Format::put(header, Format::VERSION, 4);
+        Format::put(header, sample_rate, 4);
+        Format::put(header, Format::BLOCK_SIZE, 4);
+        Format::put(header, 0, 4);
+        samples_ = 0;
+        bytes_ = 0;
+        index_.clear();
+        block_.clear();
+        return emit(header);
+    }
+
+    bool write(const int16_t* samples, size_t count)
+    {
+        bool result = true;
+        while (count != 0)
+        {
+            size_t n = std::min(count, Format::BLOCK_SIZE - block_.size());
+            block_.insert(block_.end(), samples, samples + n);
+            samples += n;
+            count -= n;
+            if (block_.size() == Format::BLOCK_SIZE) result = flush() && result;
+        }
+        return result;
+    }
+
+    /// Leave a gap of @p count samples that were lost, so that later blocks keep their time.
+    bool skip(uint64_t count)
+    {
+        bool result = flush();
+        samples_ += count;
+        return result;
+    }
+
+    /// Write any partial block and the index, and close the file.
+    bool close()
+    {
+        if (!file_.is_open()) return true;
+        bool result = flush();
+
+        std::vector<uint8_t> index(Format::INDEX_MAGIC.begin(), Format::INDEX_MAGIC.end());
+        Format::put(index, index_.size(), 4);
+        for (auto& entry : index_)
+        {
+            Format::put(index, entry.first_sample, 8);
+            Format::put(index, entry.offset, 8);
+        }
+        Format::put(index, bytes_, 8);
+        index.insert(index.end(), Format::FOOTER_MAGIC.begin(), Format::FOOTER_MAGIC.end());
+        result = emit(index) && result;
+
+        file_.close();
+        return result;
+    }
+
+    bool is_open() const { return file_.is_open(); }
+
+    /// Samples written, and any skipped.
+    uint64_t samples() const { return samples_ + block_.size(); }
+
+    /// Bytes written to the file so far.
+    uint64_t bytes() const { return bytes_; }
+
+    /**
+     * Compress a block of samples into a payload.
+     * @return the block header's predictor byte.
+     */
+    static uint8_t encode(const int16_t* samples, size_t count, std::vector<uint8_t>& payload)
+    {
+        std::array<int32_t, Format::BLOCK_SIZE> x;
+        std::copy(samples, samples + count, x.begin());
+
+        // The fixed order with the smallest total residual, computed in one pass.
+        std::array<uint64_t, Format::MAX_ORDER + 1> cost{};
+        for (size_t n = Format::MAX_ORDER; n < count; ++n)
+        {
+            for (size_t order = 0; order <= Format::MAX_ORDER; ++order)
+            {
+                cost[order] += std::abs(x[n] - Format::predict(x.data(), n, order));
+            }
+        }
+        size_t order = count > Format::MAX_ORDER
+            ? std::min_element(cost.begin(), cost.end()) - cost.begin()
+            : 0;
+        auto predictor = Format::Predictor::fixed(order);
+        uint8_t type = uint8_t(order);
+
+        // LPC, if it does better by more than its coefficients cost.
+        Format::Predictor lpc;
+        if (count > 4 * Format::MAX_LPC_ORDER && fit_lpc(x.data(), count, lpc))
+        {
+            uint64_t lpc_cost = 0;
+            for (size_t n = Format::MAX_LPC_ORDER; n < count; ++n) lpc_cost += std::abs(x[n] - lpc(x.data(), n));
+            uint64_t overhead = Format::MAX_LPC_ORDER * (Format::LPC_PRECISION + 16) / 2;
+            if (lpc_cost + overhead < cost[order])
+            {
+                predictor = lpc;
+                type = uint8_t(Format::LPC | lpc.order);
+            }
+        }
+        order = predictor.order;
+
+        std::array<uint32_t, Format::BLOCK_SIZE> residual;
+        for (size_t n = order; n < count; ++n) residual[n] = Format::zigzag(x[n] - predictor(x.data(), n));
+
+        detail::BitWriter bits(payload);
+        if (type & Format::LPC)
+        {
+            bits.put(Format::LPC_PRECISION - 1, 4);
+            bits.put(predictor.shift, 5);
+            for (size_t i = 0; i != order; ++i) bits.put(uint32_t(predictor.coefficients[i]), Format::LPC_PRECISION);
+        }
+        for (size_t n = 0; n != order; ++n) bits.put(uint16_t(x[n]), 16);
+        for (size_t start = 0; start < count; start += Format::PARTITION_SIZE)
+        {
+            size_t first = std::max(start, order);
+            size_t end = std::min(start + Format::PARTITION_SIZE, count);
+            encode_partition(residual.data() + first, end > first ? end - first : 0, bits);
+        }
+        bits.flush();
+        return type;
+    }
+
+private:
+    std::ofstream file_;
+    std::vector<int16_t> block_;
+    std::vector<uint8_t> buffer_;
+    std::vector<Format::IndexEntry> index_;
+    uint64_t samples_ = 0;      // in the blocks written
+    uint64_t bytes_ = 0;
+
+    bool emit(const std::vector<uint8_t>& data)
+    {
+        bytes_ += data.size();
+        return bool(file_.write(reinterpret_cast<const char*>(data.data()), data.size()));
+    }
+
+    bool flush()
+    {
+        if (block_.empty()) return true;
+
+        std::vector<uint8_t> payload;
+        payload.reserve(block_.size() * 2);
+        uint8_t order = encode(block_.data(), block_.size(), payload);
+
+        buffer_.assign(Format::BLOCK_MAGIC.begin(), Format::BLOCK_MAGIC.end());
+        Format::put(buffer_, samples_, 8);
+        Format::put(buffer_, block_.size(), 2);
+        Format::put(buffer_, order, 1);
+        Format::put(buffer_, 0, 1);
+        Format::put(buffer_, payload.size(), 4);
+        buffer_.insert(buffer_.end(), payload.begin(), payload.end());
+
+        index_.push_back({samples_, bytes_});
+        samples_ += block_.size();
+        block_.clear();
+        return emit(buffer_);
+    }
+
+    // Fit a predictor of order MAX_LPC_ORDER to the (windowed) block by
+    // Levinson-Durbin recursion, and quantize its coefficients.
+    static bool fit_lpc(const int32_t* x, size_t count, Format::Predictor& predictor)
+    {
+        constexpr size_t P = Format::MAX_LPC_ORDER;
+
+        std::vector<double> windowed(count);
+        for (size_t n = 0; n != count; ++n)
+        {
+            windowed[n] = x[n] * (0.5 - 0.5 * std::cos(2 * M_PI * (n + 0.5) / count));
+        }
+        std::array<double, P + 1> r{};
+        for (size_t k = 0; k <= P; ++k)
+        {
+            for (size_t n = k; n < count; ++n) r[k] += windowed[n] * windowed[n - k];
+        }
+        if (r[0] <= 0) return false;
+        r[0] *= 1.0 + 1e-9;     // a little white noise, for stability
+
+        std::array<double, P> a{};
+        double error = r[0];
+        for (size_t i = 0; i != P; ++i)
+        {
+            double k = r[i + 1];
+            for (size_t j = 0; j != i; ++j) k -= a[j] * r[i - j];
+            k /= error;
+            std::array<double, P> previous = a;
+            a[i] = k;
+            for (size_t j = 0; j != i; ++j) a[j] = previous[j] - k * previous[i - 1 - j];
+            error *= 1 - k * k;
+            if (error <= 0) return false;
+        }
+
+        double largest = 0;
+        for (double c : a) largest = std::max(largest, std::abs(c));
+        if (largest == 0) return false;
+        int shift = int(Format::LPC_PRECISION) - 1 - int(std::floor(std::log2(largest))) - 1;
+        shift = std::clamp(shift, 0, 31);
+        const int32_t limit = (int32_t(1) << (Format::LPC_PRECISION - 1)) - 1;
+        predictor.order = P;
+        predictor.shift = unsigned(shift);
+        for (size_t i = 0; i != P; ++i)
+        {
+            predictor.coefficients[i] = std::clamp(int32_t(std::lround(a[i] * (int64_t(1) << shift))), -limit, limit);
+        }
+        return true;
+    }
+
+    // Rice code a partition's residuals with the cheapest parameter near
+    // log2 of their mean, or store them in binary if that is cheaper.
+    static void encode_partition(const uint32_t* residual, size_t count, detail::BitWriter& bits)
+    {
+        uint64_t sum = 0;
+        uint32_t largest = 0;
+        for (size_t i = 0; i != count; ++i)
+        {
+            sum += residual[i];
+            largest = std::max(largest, residual[i]);
+        }
+
+        auto rice_bits = [residual, count](unsigned k)
+        {
+            uint64_t total = count * uint64_t(k + 1);
+            for (size_t i = 0; i != count; ++i) total += residual[i] >> k;
+            return total;
+        };
+
+        unsigned guess = count ? std::bit_width(sum / count) : 0;
+        unsigned best = 0;
+        uint64_t best_bits = std::numeric_limits<uint64_t>::max();
+        for (unsigned k = guess > 0 ? guess - 1 : 0; k <= std::min(guess + 1, Format::ESCAPE - 1); ++k)
+        {
+            uint64_t total = rice_bits(k);
+            if (total < best_bits)
+            {
+                best = k;
+                best_bits = total;
+            }
+        }
+
+        unsigned width = std::bit_width(largest);
+        if (5 + count * uint64_t(width) < best_bits)
+        {
+            bits.put(Format::ESCAPE, 5);
+            bits.put(width, 5);
+            for (size_t i = 0; i != count; ++i) bits.put(residual[i], width);
+            return;
+        }
+
+        bits.put(best, 5);
+        for (size_t i = 0; i != count; ++i)
+        {
+            bits.unary(residual[i] >> best);
+            bits.put(residual[i] & ((uint32_t(1) << best) - 1), best);
+        }
+    }
+};
+
+/**
+ * Reads a compressed baseband capture from a stream, in order, or from
+ * any sample when the stream is seekable.
+ */
+class CompressedBasebandReader
+{
+public:
+    using Format = CompressedBaseband;
+
+    /// Open a file. @return false if it cannot be read or is not a compressed capture.
+    bool open(const std::string& path)
+    {
+        file_.close();
+        file_.clear();
+        file_.open(path, std::ios::binary);
+        if (!file_) return false;
+        return open(file_);
+    }
+
+    /**
+     * Read from a stream, positioned at the start of a capture or, if the
+     * caller has read and checked the magic, just after it.
+     *
+     * @return false if it is not a compressed capture.
+     */
+    bool open(std::istream& input, bool magic_read = false)
+    {
+        input_ = &input;
+        start_ = magic_read ? -1 : std::streamoff(input.tellg());
+        std::array<uint8_t, Format::HEADER_SIZE> header;
+        size_t skip = magic_read ? Format::MAGIC.size() : 0;
+        if (!read(header.data() + skip, header.size() - skip)) return false;
+        if (!magic_read && !Format::is_magic(reinterpret_cast<const char*>(header.data()))) return false;
+        if (start_ < 0 && input.tellg() >= 0) start_ = std::streamoff(input.tellg()) - std::streamoff(header.size());
+        if (Format::get(header.data() + 8, 4) != Format::VERSION) return false;
+        sample_rate_ = uint32_t(Format::get(header.data() + 12, 4));
+
+        index_.clear();
+        samples_.clear();
+        pos_ = 0;
+        next_sample_ = 0;
+        return true;
+    }
+
+    uint32_t sample_rate() const { return sample_rate_; }
+
+    /// The next sample read() will give, from the start of the capture.
+    uint64_t position() const { return next_sample_ - (samples_.size() - pos_); }
+
+    /**
+     * Read up to @p count samples.
+     * @return the samples read, which is less than asked only at the end.
+     */
+    size_t read(int16_t* out, size_t count)
+    {
+        size_t done = 0;
+        while (done != count)
+        {
+            if (pos_ == samples_.size() && !next_block()) break;
+            size_t n = std::min(count - done, samples_.size() - pos_);
+            std::copy(samples_.begin() + pos_, samples_.begin() + pos_ + n, out + done);
+            pos_ += n;
+            done += n;
+        }
+        return done;
+    }
+
+    /**
+     * Continue reading from the given sample (needs a seekable stream).
+     * @return false if the stream cannot seek or the sample is past the end.
+     */
+    bool seek(uint64_t sample)
+    {
+        if (!load_index() || index_.empty()) return false;
+        auto block = std::upper_bound(index_.begin(), index_.end(), sample,
+            [](uint64_t value, const Format::IndexEntry& entry) { return value < entry.first_sample; });
+        if (block == index_.begin()) return false;
+        --block;
+
+        input_->clear();
+        if (!input_->seekg(start_ + std::streamoff(block->offset))) return false;
+        samples_.clear();
+        pos_ = 0;
+        if (!next_block() || sample >= block->first_sample + samples_.size()) return false;
+        pos_ = sample - block->first_sample;
+        return true;
+    }
+
+    /// Samples in the capture (needs a seekable stream), or 0.
+    uint64_t size()
+    {
+        if (!load_index() || index_.empty()) return 0;
+        auto position = input_->tellg();
+        input_->clear();
+        input_->seekg(start_ + std::streamoff(index_.back().offset));
+        std::array<uint8_t, Format::BLOCK_HEADER_SIZE> header;
+        uint64_t result = read(header.data(), header.size())
+            ? index_.back().first_sample + Format::get(header.data() + 12, 2) : 0;
+        input_->clear();
+        input_->seekg(position);
+        return result;
+    }
+
+    /// The block index: from the file's own, or found by scanning the blocks.
+    const std::vector<Format::IndexEntry>& index()
+    {
+        load_index();
+        return index_;
+    }
+
+    /// Decode a block payload of @p count samples.
+    static bool decode(const uint8_t* payload, size_t length, size_t count, uint8_t type, int16_t* out)
+    {
+        if (count > Format::BLOCK_SIZE) return false;
+
+        detail::BitReader bits(payload, length);
+        Format::Predictor predictor;
+        if (type & Format::LPC)
+        {
+            predictor.order = type & ~Format::LPC;
+            if (predictor.order > Format::MAX_LPC_ORDER) return false;
+            unsigned precision = bits.get(4) + 1;
+            predictor.shift = bits.get(5);
+            for (size_t i = 0; i != predictor.order; ++i)
+            {
+                uint32_t value = bits.get(precision);
+                predictor.coefficients[i] = int32_t(value << (32 - precision)) >> (32 - precision);
+            }
+        }
+        else
+        {
+            if (type > Format::MAX_ORDER) return false;
+            predictor = Format::Predictor::fixed(type);
+        }
+        const size_t order = predictor.order;
+
+        std::array<int32_t, Format::BLOCK_SIZE> x;
+        for (size_t n = 0; n != std::min(order, count); ++n) x[n] = int16_t(bits.get(16));
+        for (size_t start = 0; start < count; start += Format::PARTITION_SIZE)
+        {
+            size_t first = std::max(start, order);
+            size_t end = std::min(start + Format::PARTITION_SIZE, count);
+            if (end <= first) continue;
+            uint32_t k = bits.get(5);
+            uint32_t width = k == Format::ESCAPE ? bits.get(5) : 0;
+            for (size_t n = first; n != end; ++n)
+            {
+                uint32_t value;
+                if (k == Format::ESCAPE)
+                {
+                    value = bits.get(width);
+                }
+                else
+                {
+                    // Two reads from one stream, so in order: quotient, then remainder.
+                    uint32_t q = bits.unary();
+                    uint32_t r = bits.get(k);
+                    value = q << k | r;
+                }
+                x[n] = Format::unzigzag(value) + predictor(x.data(), n);
+            }
+        }
+        if (bits.overrun()) return false;
+
+        std::copy(x.begin(), x.begin() + count, out);
+        return true;
+    }
+
+private:
+    std::ifstream file_;
+    std::istream* input_ = nullptr;
+    std::streamoff start_ = -1;     // of the capture in the stream, if it can seek
+    uint32_t sample_rate_ = 0;
+    std::vector<Format::IndexEntry> index_;
+    std::vector<int16_t> samples_;  // the current block
+    std::vector<uint8_t> payload_;
+    size_t pos_ = 0;                // in samples_
+    uint64_t next_sample_ = 0;
+
+    bool read(uint8_t* data, size_t length)
+    {
+        return bool(input_->read(reinterpret_cast<char*>(data), length));
+    }
+
+    bool next_block()
+    {
+        std::array<uint8_t, Format::BLOCK_HEADER_SIZE> header;
+        if (!read(header.data(), header.size())) return false;
+        if (!std::equal(Format::BLOCK_MAGIC.begin(), Format::BLOCK_MAGIC.end(), header.begin())) return false;
+
+        size_t count = Format::get(header.data() + 12, 2);
+        uint8_t type = header[14];
+        size_t length = Format::get(header.data() + 16, 4);
+        payload_.resize(length);
+        if (!read(payload_.data(), length)) return false;
+
+        samples_.resize(count);
+        if (!decode(payload_.data(), length, count, type, samples_.data())) return false;
+        pos_ = 0;
+        next_sample_ = Format::get(header.data() + 4, 8) + count;
+        return true;
+    }
+
+    bool load_index()
+    {
+        if (!index_.empty()) return true;
+        if (start_ < 0) return false;
+
+        auto position = input_->tellg();
+        bool result = load_footer() || scan_blocks();
+        input_->clear();
+        input_->seekg(position);
+        return result;
+    }
+
+    bool load_footer()
+    {
+        input_->clear();
+        if (!input_->seekg(-std::streamoff(Format::FOOTER_SIZE), std::ios::end)) return false;
+        std::array<uint8_t, Format::FOOTER_SIZE> footer;
+        if (!read(footer.data(), footer.size())) return false;
+        if (!std::equal(Format::FOOTER_MAGIC.begin(), Format::FOOTER_MAGIC.end(), footer.begin() + 8)) return false;
+
+        if (!input_->seekg(start_ + std::streamoff(Format::get(footer.data(), 8)))) return false;
+        std::array<uint8_t, 8> header;
+        if (!read(header.data(), header.size())) return false;
+        if (!std::equal(Format::INDEX_MAGIC.begin(), Format::INDEX_MAGIC.end(), header.begin())) return false;
+
+        std::vector<uint8_t> entries(Format::get(header.data() + 4, 4) * 16);
+        if (!read(entries.data(), entries.size())) return false;
+        for (size_t i = 0; i != entries.size(); i += 16)
+        {
+            index_.push_back({Format::get(entries.data() + i, 8), Format::get(entries.data() + i + 8, 8)});
+        }
+        return true;
+    }
+
+    // Without an index (the capture was cut short), follow the blocks'
+    // headers; only the last block's is checked by decoding it.
+    bool scan_blocks()
+    {
+        index_.clear();
+        uint64_t offset = Format::HEADER_SIZE;
+        for (;;)
+        {
+            input_->clear();
+            if (!input_->seekg(start_ + std::streamoff(offset))) break;
+            std::array<uint8_t, Format::BLOCK_HEADER_SIZE> header;
+            if (!read(header.data(), header.size())) break;
+            if (!std::equal(Format::BLOCK_MAGIC.begin(), Format::BLOCK_MAGIC.end(), header.begin())) break;
+            uint64_t length = Format::get(header.data() + 16, 4);
+            index_.push_back({Format::get(header.data() + 4, 8), offset});
+            offset += Format::BLOCK_HEADER_SIZE + length;
+        }
+
+        // Drop a last block that was not completely written.
+        if (!index_.empty())
+        {
+            input_->clear();
+            input_->seekg(0, std::ios::end);
+            if (std::streamoff(input_->tellg()) < start_ + std::streamoff(offset)) index_.pop_back();
+        }
+        return !index_.empty();
+    }
+};
+
+/**
+ * Records baseband to a compressed capture on a background thread, so that
+ * compression and disk writes never hold up the receiver.
+ *
+ * The receiving thread hands over samples with push(), which copies them
+ * into fixed blocks and queues each full one; it never waits. If the
+ * writer falls a whole queue behind, blocks are dropped and counted, and
+ * the capture has a gap in their place.
+ */
+class BasebandRecorder
+{
+public:
+    static constexpr size_t QUEUE_SIZE = 64;        // blocks, about a second at 271k samples per second
+
+    ~BasebandRecorder() { stop(); }
+
+    /// @return false if the file cannot be written.
+    bool start(const std::string& path, uint32_t sample_rate)
+    {
+        stop();
+        if (!writer_.open(path, sample_rate)) return false;
+        queue_ = std::make_unique<queue_t>();
+        block_.count = 0;
+        block_.first_sample = 0;
+        dropped_ = 0;
+        thread_ = std::thread([this](){ run(); });
+        return true;
+    }
+
+    /// Receiving thread: record samples.
+    void push(const int16_t* samples, size_t count)
+    {
+        if (!queue_) return;
+        while (count != 0)
+        {
+            size_t n = std::min(count, block_.samples.size() - block_.count);
+            std::copy(samples, samples + n, block_.samples.begin() + block_.count);
+            block_.count += n;
+            samples += n;
+            count -= n;
+            if (block_.count == block_.samples.size()) send();
+        }
+    }
+
+    /// Write what is left and close the file.
+    void stop()
+    {
+        if (!thread_.joinable()) return;
+        if (block_.count) send();
+        queue_->close();
+        thread_.join();
+        writer_.close();
+        queue_.reset();
+    }
+
+    /// Blocks of CompressedBaseband::BLOCK_SIZE samples lost because the writer fell behind.
+    size_t dropped() const { return dropped_; }
+
+    /// Samples recorded, including any dropped, and bytes written; read them after stop().
+    uint64_t samples() const { return writer_.samples(); }
+    uint64_t bytes() const { return writer_.bytes(); }
+
+private:
+    struct Block
+    {
+        std::array<int16_t, CompressedBaseband::BLOCK_SIZE> samples;
+        size_t count = 0;
+        uint64_t first_sample = 0;      // from the start of the recording
+    };
+    using queue_t = SpscQueue<Block, QUEUE_SIZE>;
+
+    CompressedBasebandWriter writer_;
+    std::unique_ptr<queue_t> queue_;    // large; kept off the stack
+    Block block_;
+    size_t dropped_ = 0;
+    std::thread thread_;
+
+    void send()
+    {
+        if (!queue_->try_push(block_)) dropped_++;
+        block_.first_sample += block_.count;
+        block_.count = 0;
+    }
+
+    void run()
+    {
+        Block block;
+        while (queue_->pop(block))
+        {
+            if (block.first_sample > writer_.samples()) writer_.skip(block.first_sample - writer_.samples());
+            writer_.write(block.samples.data(), block.count);
+        }
+    }
+};
+
+} // mobilinkd
@@ -0,0 +1,183 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <cmath>
+
+namespace mobilinkd
+{
+
+/**
+ * Math functions usable in constant expressions, for filter tables
+ * computed at compile time (std::sin and friends are not constexpr before
+ * C++26).
+ *
+ * The trigonometric functions are evaluated in double-double arithmetic
+ * and rounded once, so they are correctly rounded for all practical
+ * purposes and almost always agree with the C library to the bit; the RRC
+ * taps computed with them match the table once generated offline with
+ * numpy exactly. Arguments are expected to be modest (|x| < 1e6), as they
+ * are in filter design.
+ */
+namespace constexpr_math
+{
+
+namespace detail
+{
+
+// An unevaluated sum hi + lo, with |lo| <= ulp(hi) / 2.
+struct DoubleDouble
+{
+    double hi;
+    double lo;
+};
+
+constexpr DoubleDouble quick_two_sum(double a, double b)
+{
+    double s = a + b;
+    return {s, b - (s - a)};
+}
+
+constexpr DoubleDouble two_sum(double a, double b)
+{
+    double s = a + b;
+    double bb = s - a;
+    return {s, (a - (s - bb)) + (b - bb)};
+}
+
+// Dekker's exact product, without relying on a fused multiply-add.
+constexpr DoubleDouble two_prod(double a, double b)
+{
+    constexpr double SPLIT = 134217729.0;   // 2^27 + 1
+    double p = a * b;
+    double ta = SPLIT * a;
+    double a_hi = ta - (ta - a);
+    double a_lo = a - a_hi;
+    double tb = SPLIT * b;
+    double b_hi = tb - (tb - b);
+    double b_lo = b - b_hi;
+    return {p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo};
+}
+
+constexpr DoubleDouble add(DoubleDouble a, DoubleDouble b)
+{
+    DoubleDouble s = two_sum(a.hi, b.hi);
+    DoubleDouble t = two_sum(a.lo, b.lo);
+    s = quick_two_sum(s.hi, s.lo + t.hi);
+    return quick_two_sum(s.hi, s.lo + t.lo);
+}
+
+constexpr DoubleDouble mul(DoubleDouble a, DoubleDouble b)
+{
+    DoubleDouble p = two_prod(a.hi, b.hi);
+    return quick_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+constexpr DoubleDouble div(DoubleDouble a, double b)
+{
+    double q = a.hi / b;
+    DoubleDouble p = two_prod(q, b);
+    double r = ((a.hi - p.hi) - p.lo + a.lo) / b;
+    return quick_two_sum(q, r);
+}
+
+// pi/2 to about 160 bits.
+constexpr double PIO2[] = {1.5707963267948966, 6.123233995736766e-17, -1.4973849048591698e-33};
+
+// Reduce x to r in about [-pi/4, pi/4], with x = r + n pi/2; returns n mod 4.
+constexpr int reduce(double x, DoubleDouble& r)
+{
+    double q = x * (2.0 / M_PI);
+    double n = double(long(q + (q < 0 ? -0.5 : 0.5)));
+    r = {x, 0.0};
+    for (double part : PIO2)
+    {
+        DoubleDouble p = two_prod(n, part);
+        r = add(r, {-p.hi, -p.lo});
+    }
+    return int(long(n) & 3);
+}
+
+// Taylor series, nested as x (1 - x^2/(2.3) (1 - x^2/(4.5) (...))).
+constexpr DoubleDouble sin_kernel(DoubleDouble x)
+{
+    DoubleDouble x2 = mul(x, x);
+    DoubleDouble p = {1.0, 0.0};
+    for (int n = 14; n != 0; --n)
+    {
+        DoubleDouble t = div(mul(x2, p), double((2 * n) * (2 * n + 1)));
+        p = add({1.0, 0.0}, {-t.hi, -t.lo});
+    }
+    return mul(x, p);
+}
+
+constexpr DoubleDouble cos_kernel(DoubleDouble x)
+{
+    DoubleDouble x2 = mul(x, x);
+    DoubleDouble p = {1.0, 0.0};
+    for (int n = 14; n != 0; --n)
+    {
+        DoubleDouble t = div(mul(x2, p), double((2 * n - 1) * (2 * n)));
+        p = add({1.0, 0.0}, {-t.hi, -t.lo});
+    }
+    return p;
+}
+
+constexpr double sin_quadrant(double x, int shift)
+{
+    DoubleDouble r{};
+    int quadrant = (reduce(x, r) + shift) & 3;
+    DoubleDouble y = (quadrant & 1) ? cos_kernel(r) : sin_kernel(r);
+    double value = y.hi + y.lo;
+    return (quadrant & 2) ? -value : value;
+}
+
+} // detail
+
+/// Sine of @p x, in radians.
+constexpr double sin(double x)
+{
+    return detail::sin_quadrant(x, 0);
+}
+
+/// Cosine of @p x, in radians.
+constexpr double cos(double x)
+{
+    return detail::sin_quadrant(x, 1);
+}
+
+constexpr double tan(double x)
+{
+    return sin(x) / cos(x);
+}
+
+/// Zeroth-order modified Bessel function of the first kind, for Kaiser windows.
+constexpr double bessel_i0(double x)
+{
+    double term = 1.0;
+    double sum = 1.0;
+    for (int k = 1; k != 50; ++k)
+    {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/// Square root of @p x >= 0, by Newton's method.
+constexpr double sqrt(double x)
+{
+    if (x <= 0) return 0;
+    double y = x > 1 ? x : 1.0;
+    for (int i = 0; i != 100; ++i)
+    {
+        double next = (y + x / y) / 2;
+        if (next >= y) break;
+        y = next;
+    }
+    return y;
+}
+
+} // constexpr_math
+
+} // mobilinkd
@@ -0,0 +1,220 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace mobilinkd
+{
+
+/**
+ * A line-oriented command channel on a UNIX domain stream socket.
+ *
+ * Any number of clients (up to MAX_CLIENTS) may connect, for example
+ * with "socat - UNIX-CONNECT:path". Each line a client sends is a
+ * command; it is passed to the handler given to poll(), and the
+ * handler's reply, if not empty, is written back to that client
+ * followed by a newline. Everything is non-blocking, and all handling
+ * happens inside poll(), on the caller's thread.
+ */
+class ControlSocket
+{
+public:
+    static constexpr size_t MAX_CLIENTS = 8;
+    static constexpr size_t MAX_LINE = 256;     // longer lines are discarded
+
+    ControlSocket() = default;
+    ControlSocket(const ControlSocket&) = delete;
+    ControlSocket& operator=(const ControlSocket&) = delete;
+
+    ~ControlSocket()
+    {
+        close();
+    }
+
+    /**
+     * Listen at @p path, replacing any stale socket there.
+     *
+     * @return false on failure.
+     */
+    bool open(const std::string& path)
+    {
+        close();
+
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path))
+        {
+            OPV_LOG_ERROR("Bad control socket path '{}'", path);
+            return false;
+        }
+        std::copy(path.begin(), path.end(), address.sun_path);
+
+        listener_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener_ < 0)
+        {
+            OPV_LOG_ERROR("Failure creating control socket: {}", strerror(errno));
+            return false;
+        }
+        fcntl(listener_, F_SETFL, fcntl(listener_, F_GETFL) | O_NONBLOCK);
+
+        ::unlink(path.c_str());
+        if (bind(listener_, (const struct sockaddr *)&address, sizeof(address)) < 0 || listen(listener_, 4) < 0)
+        {
+            OPV_LOG_ERROR("Failure binding control socket {}: {}", path, strerror(errno));
+            ::close(listener_);
+            listener_ = -1;
+            return false;
+        }
+        path_ = path;
+        return true;
+    }
+
+    /// Disconnect all clients and remove the socket.
+    void close()
+    {
+        for (auto& client : clients_) ::close(client.fd);
+        clients_.clear();
+        if (listener_ < 0) return;
+        ::close(listener_);
+        ::unlink(path_.c_str());
+        listener_ = -1;
+    }
+
+    bool is_open() const { return listener_ >= 0; }
+
+    /**
+     * Accept connections and handle the commands waiting, calling
+     * handler(command) for each, which returns the reply. Waits up to
+     * @p timeout_ms for something to happen; 0 does not wait.
+     *
+     * @return the number of commands handled.
+     */
+    template <typename Handler>
+    size_t poll(Handler&& handler, int timeout_ms = 0)
+    {
+        if (listener_ < 0) return 0;
+
+        std::vector<struct pollfd> fds;
+        fds.push_back({listener_, POLLIN, 0});
+        for (auto& client : clients_) fds.push_back({client.fd, POLLIN, 0});
+        if (::poll(fds.data(), fds.size(), timeout_ms) <= 0) return 0;
+
+        size_t commands = 0;
+        for (size_t i = 1; i != fds.size(); ++i)
+        {
+            if (fds[i].revents) commands += read(clients_[i - 1], handler);
+        }
+
+        clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+            [](const Client& client) { return client.fd < 0; }), clients_.end());
+
+        if (fds[0].revents & POLLIN) accept_clients();
+        return commands;
+    }
+
+private:
+    struct Client
+    {
+        int fd = -1;
+        std::string line;
+        bool discarding = false;    // the rest of an overlong line
+    };
+
+    int listener_ = -1;
+    std::string path_;
+    std::vector<Client> clients_;
+
+    void accept_clients()
+    {
+        for (;;)
+        {
+            int fd = accept(listener_, nullptr, nullptr);
+            if (fd < 0) return;
+            if (clients_.size() == MAX_CLIENTS)
+            {
+                OPV_LOG_WARN("Too many control connections");
+                ::close(fd);
+                continue;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            clients_.push_back(Client{fd, {}, false});
+        }
+    }
+
+    // Read what the client has sent and handle each complete line. The
+    // client is closed (fd < 0) when it disconnects.
+    template <typename Handler>
+    size_t read(Client& client, Handler& handler)
+    {
+        size_t commands = 0;
+        char buffer[MAX_LINE];
+        for (;;)
+        {
+            ssize_t count = ::read(client.fd, buffer, sizeof(buffer));
+            if (count < 0 && errno == EINTR) continue;
+            if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (count <= 0)
+            {
+                ::close(client.fd);
+                client.fd = -1;
+                break;
+            }
+
+            for (ssize_t i = 0; i != count; ++i)
+            {
+                char c = buffer[i];
+                if (c == '\n')
+                {
+                    if (!client.discarding)
+                    {
+                        reply(client, handler(trim(client.line)));
+                        commands++;
+                    }
+                    client.line.clear();
+                    client.discarding = false;
+                }
+                else if (client.line.size() == MAX_LINE)
+                {
+                    client.discarding = true;
+                }
+                else
+                {
+                    client.line.push_back(c);
+                }
+            }
+        }
+        return commands;
+    }
+
+    void reply(Client& client, std::string text)
+    {
+        if (text.empty() || client.fd < 0) return;
+        text.push_back('\n');
+        // A client that does not read its replies loses them.
+        send(client.fd, text.data(), text.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+
+    static std::string trim(const std::string& text)
+    {
+        auto first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos) return {};
+        auto last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+};
+
+} // mobilinkd
@@ -3,10 +3,13 @@
 
 #pragma once
 
+#include "ConstexprMath.h"
 #include "IirFilter.h"
+#include "Numerology.h"
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdint>
 #include <cstddef>
 #include <type_traits>
@@ -14,15 +17,15 @@
 #include <limits>
 #include <iostream>
 
-extern uint32_t debug_sample_count;
+extern uint64_t debug_sample_count;
 
 namespace mobilinkd {
 
-template <typename FloatType>
+template <typename FloatType, size_t SamplesPerSymbol = default_samples_per_symbol>
 struct Correlator
 {
 	static constexpr size_t SYMBOLS = 8;
-	static constexpr size_t SAMPLES_PER_SYMBOL = 10;
+	static constexpr size_t SAMPLES_PER_SYMBOL = SamplesPerSymbol;
 
 	using value_type = FloatType;
     using buffer_t = std::array<FloatType, SYMBOLS * SAMPLES_PER_SYMBOL>;
@@ -37,13 +40,17 @@ struct Correlator
     size_t prev_buffer_pos_ = 0;
     int code = -1;
 
-    // IIR with Nyquist of 1/240.
-	// I'm not sure what that means.
-	// This is a Butterworth IIR lowpass filter, as designed by MATLAB's filter designer set for minimal taps.
-	// The numerator (which is [1 2 1] in normal form) has the scaling factor incorporated for unity gain.
-	static constexpr FloatType ugsf = 1.341681875516310e-06;	// unity gain scale factor
+	// The limit follows the signal magnitude through a second order Butterworth
+	// lowpass filter with a 100 Hz cutoff, designed by the bilinear transform
+	// for the sample rate (as MATLAB's filter designer did for 10 samples per
+	// symbol). The numerator (which is [1 2 1] in normal form) has the scaling
+	// factor incorporated for unity gain.
+	static constexpr double LIMIT_CUTOFF = 100.0;	// Hz
+	static constexpr double LIMIT_K = constexpr_math::tan(M_PI * LIMIT_CUTOFF / (double(symbol_rate) * SamplesPerSymbol));
+	static constexpr double LIMIT_D = 1.0 + M_SQRT2 * LIMIT_K + LIMIT_K * LIMIT_K;
+	static constexpr FloatType ugsf = LIMIT_K * LIMIT_K / LIMIT_D;	// unity gain scale factor
 	static constexpr std::array<FloatType,3> b = {1.0 * ugsf, 2.0 * ugsf, 1.0 * ugsf};	//numerator
-    static constexpr std::array<FloatType,3> a = {1.0, -1.99672112253324, 0.996726489260742};	// denominator
+	static constexpr std::array<FloatType,3> a = {1.0, 2.0 * (LIMIT_K * LIMIT_K - 1.0) / LIMIT_D, (1.0 - M_SQRT2 * LIMIT_K + LIMIT_K * LIMIT_K) / LIMIT_D};	// denominator
 
     sample_filter_t sample_filter{b, a};
     std::array<int, SYMBOLS> tmp;
@@ -59,6 +66,31 @@ struct Correlator
         if (++buffer_pos_ == buffer_.size()) buffer_pos_ = 0;
     }
 
+    /**
+     * Take a sample for the limit only, leaving its buffer entry stale, when
+     * nothing will correlate before the buffer is refilled with SYMBOLS
+     * symbols of sample() calls. The sample index keeps counting.
+     */
+    void skip(FloatType value)
+    {
+        limit_ = sample_filter(std::abs(value));
+        prev_buffer_pos_ = buffer_pos_;
+        if (++buffer_pos_ == buffer_.size()) buffer_pos_ = 0;
+    }
+
+    /**
+     * Start the limit at the mean magnitude of the samples in the buffer,
+     * as if it had followed them all along, rather than rising slowly from
+     * wherever it was. For a buffer just filled with fresh samples.
+     */
+    void prime()
+    {
+        FloatType sum = 0;
+        for (auto value : buffer_) sum += std::abs(value);
+        limit_ = sum / buffer_.size();
+        sample_filter.reset(limit_);
+    }
+
     FloatType correlate(sync_t sync)
     {
         FloatType result = 0.;
@@ -127,12 +159,12 @@ struct SyncWord
 	using value_type = typename Correlator::value_type;
 
 	using buffer_t = std::array<int8_t, SYMBOLS>;
-	using sample_buffer_t = std::array<value_type, SAMPLES_PER_SYMBOL>;
 
 	buffer_t sync_word_;
-	sample_buffer_t samples_;
 	size_t pos_ = 0;
 	size_t timing_index_ = 0;
+	size_t age_ = 0;			// samples from the peak to the detection
+	value_type peak_ = 0;
 	bool triggered_ = false;
 	int8_t updated_ = 0;
 	value_type magnitude_1_ = 1.;
@@ -157,41 +189,42 @@ struct SyncWord
 	{
 		auto value = triggered(correlator);
 
-		value_type peak_value = 0;
-
 		if (value != 0)
 		{
+			// Follow the peak through the whole triggered run, which can
+			// last more than a symbol at low oversampling.
 			if (!triggered_)
 			{
-				samples_.fill(0);
+				peak_ = 0;
 				triggered_ = true;
 			}
-			samples_[correlator.index()] = value;
+			if (abs(value) > abs(peak_))
+			{
+				peak_ = value;
+				timing_index_ = correlator.index();
+				age_ = 0;
+			}
+			else
+			{
+				age_ += 1;
+			}
 		}
 		else
 		{
 			if (triggered_)
 			{
-				// Calculate the timing index on the falling edge.
+				// Report the peak on the falling edge.
 				triggered_ = false;
-				timing_index_ = 0;
-				peak_value = value;
-				uint8_t index = 0;
-				for (auto f : samples_)
-				{
-					if (abs(f) > abs(peak_value))
-					{
-						peak_value = f;
-						timing_index_ = index;
-					}
-					index += 1;
-				}
-				updated_ = peak_value > 0 ? 1 : -1;
+				age_ += 1;
+				updated_ = peak_ > 0 ? 1 : -1;
 			}
 		}
 		return timing_index_;
 	}
 
+	/// Samples from the latest detection's peak to the sample that reported it.
+	size_t age() const { return age_; }
+
 	int8_t updated()
 	{
 		auto result = updated_;
@@ -38,6 +38,7 @@ struct DataCarrierDetect
     FloatType level_2 = 0.0;
     FloatType level_ = 0.0;
     bool triggered_ = false;
+    bool primed_ = false;
 
     DataCarrierDetect(
         size_t freq1, size_t freq2,
@@ -62,7 +63,13 @@ struct DataCarrierDetect
      */
     void update()
     {
-    	level_ = level_ * 0.8 + 0.2 * (level_1 / level_2);
+    	// Digital silence (nothing out of band either) is no carrier; 0/0
+    	// would leave level_ NaN, and carrier detect off, for good.
+    	FloatType ratio = level_2 > 0 ? level_1 / level_2 : 0;
+    	// The first level is taken as measured rather than smoothed up from
+    	// zero, so that a signal present from the start is detected at once.
+    	level_ = primed_ ? level_ * 0.8 + 0.2 * ratio : ratio;
+    	primed_ = true;
     	level_1 = 0.0;
     	level_2 = 0.0;
         triggered_ = triggered_ ? level_ > ltrigger_ : level_ > htrigger_;
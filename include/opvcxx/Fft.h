@@ -0,0 +1,87 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+
+namespace mobilinkd
+{
+
+/**
+ * In-place complex FFT of a power-of-two size N: iterative radix-2
+ * decimation in time, with the twiddle factors and bit-reversal
+ * permutation tabulated on construction. Self-contained, for fast
+ * convolution; it is not meant to compete with FFTW.
+ *
+ * The inverse transform is unscaled: inverse(forward(x)) is N x.
+ */
+template <typename FloatType, size_t N>
+class Fft
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "FFT size must be a power of two");
+
+public:
+    using complex_t = std::complex<FloatType>;
+    using buffer_t = std::array<complex_t, N>;
+
+    Fft()
+    {
+        for (size_t i = 0; i != N / 2; ++i)
+        {
+            double angle = -2.0 * M_PI * double(i) / N;
+            twiddles_[i] = complex_t(FloatType(std::cos(angle)), FloatType(std::sin(angle)));
+        }
+
+        size_t bits = 0;
+        while ((size_t(1) << bits) != N) ++bits;
+        for (size_t i = 0; i != N; ++i)
+        {
+            size_t reversed = 0;
+            for (size_t b = 0; b != bits; ++b) reversed |= ((i >> b) & 1) << (bits - 1 - b);
+            reversed_[i] = reversed;
+        }
+    }
+
+    void forward(buffer_t& data) const { transform(data, false); }
+    void inverse(buffer_t& data) const { transform(data, true); }
+
+private:
+    std::array<complex_t, N / 2> twiddles_;
+    std::array<size_t, N> reversed_;
+
+    void transform(buffer_t& data, bool inverse) const
+    {
+        for (size_t i = 0; i != N; ++i)
+        {
+            if (i < reversed_[i]) std::swap(data[i], data[reversed_[i]]);
+        }
+
+        // Butterflies in real arithmetic: std::complex multiplication checks
+        // for infinities and NaNs, which costs more than the FFT itself.
+        const FloatType sign = inverse ? -1 : 1;
+        for (size_t half = 1; half != N; half *= 2)
+        {
+            const size_t stride = N / (2 * half);   // through the twiddle table
+            for (size_t start = 0; start != N; start += 2 * half)
+            {
+                for (size_t k = 0; k != half; ++k)
+                {
+                    const complex_t& w = twiddles_[k * stride];
+                    FloatType wr = w.real();
+                    FloatType wi = w.imag() * sign;
+                    complex_t& a = data[start + k];
+                    complex_t& b = data[start + k + half];
+                    FloatType br = b.real() * wr - b.imag() * wi;
+                    FloatType bi = b.real() * wi + b.imag() * wr;
+                    b = complex_t(a.real() - br, a.imag() - bi);
+                    a = complex_t(a.real() + br, a.imag() + bi);
+                }
+            }
+        }
+    }
+};
+
+} // mobilinkd
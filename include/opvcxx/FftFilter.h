@@ -0,0 +1,89 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Fft.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace mobilinkd
+{
+
+/**
+ * FIR filter by fast convolution (overlap-save), for filtering long blocks
+ * of samples: the same output as BaseFirFilter with the same N taps, to
+ * within float rounding, at a fraction of the N multiply-adds per sample.
+ *
+ * The input is cut into segments of FFT_SIZE samples overlapping by N - 1,
+ * each giving STEP outputs. The taps are real, so two segments go through
+ * each FFT, one as the real part and one as the imaginary part.
+ *
+ * The filter holds no stream state: each call is given the N - 1 inputs
+ * before the block, so the caller (usually with a BaseFirFilter alongside,
+ * for sample-at-a-time use) keeps the history.
+ */
+template <typename FloatType, size_t N>
+class FftFilter
+{
+public:
+    static constexpr size_t FFT_SIZE = std::max(std::bit_ceil(8 * N), size_t(256));
+    static constexpr size_t STEP = FFT_SIZE - (N - 1);      // outputs per segment
+
+    using taps_t = std::array<FloatType, N>;
+    using complex_t = std::complex<FloatType>;
+
+    FftFilter(const taps_t& taps)
+    {
+        typename Fft<FloatType, FFT_SIZE>::buffer_t h{};
+        for (size_t i = 0; i != N; ++i) h[i] = taps[i] / FloatType(FFT_SIZE);   // scaled for the inverse
+        fft_.forward(h);
+        response_ = h;
+    }
+
+    /**
+     * Filter @p count samples of @p input into @p output, given the N - 1
+     * inputs before them in @p history, oldest first.
+     */
+    void operator()(const FloatType* history, const FloatType* input, size_t count, FloatType* output)
+    {
+        // The signal [history, input], padded with zeros to whole FFT pairs.
+        const size_t pairs = (count + 2 * STEP - 1) / (2 * STEP);
+        signal_.assign(pairs * 2 * STEP + N - 1, FloatType(0));
+        std::copy(history, history + N - 1, signal_.begin());
+        std::copy(input, input + count, signal_.begin() + (N - 1));
+
+        for (size_t start = 0; start < count; start += 2 * STEP)
+        {
+            const size_t second = start + STEP;
+            const FloatType* a = signal_.data() + start;
+            const FloatType* b = signal_.data() + second;
+            for (size_t k = 0; k != FFT_SIZE; ++k) buffer_[k] = complex_t(a[k], b[k]);
+
+            fft_.forward(buffer_);
+            for (size_t k = 0; k != FFT_SIZE; ++k)
+            {
+                const complex_t& x = buffer_[k];
+                const complex_t& h = response_[k];
+                buffer_[k] = complex_t(x.real() * h.real() - x.imag() * h.imag(), x.real() * h.imag() + x.imag() * h.real());
+            }
+            fft_.inverse(buffer_);
+
+            // The first N - 1 outputs of each segment wrap around; the rest are good.
+            for (size_t k = 0; k != STEP && start + k < count; ++k) output[start + k] = buffer_[N - 1 + k].real();
+            for (size_t k = 0; k != STEP && second + k < count; ++k) output[second + k] = buffer_[N - 1 + k].imag();
+        }
+    }
+
+private:
+    Fft<FloatType, FFT_SIZE> fft_;
+    typename Fft<FloatType, FFT_SIZE>::buffer_t response_;
+    typename Fft<FloatType, FFT_SIZE>::buffer_t buffer_;
+    std::vector<FloatType> signal_;     // scratch
+};
+
+} // mobilinkd
@@ -42,6 +42,24 @@ struct BaseFirFilter : FilterBase<FloatType>
 		return result;
 	}
 
+	/// Take an input sample without computing the output, for outputs not needed.
+	void skip(FloatType input)
+	{
+		history_[pos_++] = input;
+		if (pos_ == N) pos_ = 0;
+	}
+
+	/// Copy the latest N - 1 inputs, oldest first, to @p out.
+	void history(FloatType* out) const
+	{
+		size_t index = pos_;
+		for (size_t i = 0; i != N - 1; ++i)
+		{
+			if (++index == N) index = 0;
+			out[i] = history_[index];
+		}
+	}
+
 	void reset()
 	{
 		history_.fill(0.0);
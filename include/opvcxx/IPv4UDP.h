@@ -0,0 +1,207 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "InternetChecksum.h"
+#include "Numerology.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mobilinkd
+{
+
+namespace detail
+{
+
+inline uint16_t get16(const uint8_t* p) { return uint16_t(p[0] << 8 | p[1]); }
+inline uint32_t get32(const uint8_t* p) { return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3]; }
+inline void put16(uint8_t* p, uint16_t value) { p[0] = value >> 8; p[1] = uint8_t(value); }
+inline void put32(uint8_t* p, uint32_t value) { put16(p, value >> 16); put16(p + 2, uint16_t(value)); }
+
+} // detail
+
+/**
+ * Parsing of UDP over IPv4, in place.
+ *
+ * Only what OPV needs is checked: version, header and datagram lengths,
+ * both checksums (a zero UDP checksum means none was sent), and that the
+ * packet is not a fragment. Options in the IP header are skipped.
+ */
+struct IPv4UDP
+{
+    static constexpr size_t HEADER_BYTES = ip_v4_header_bytes + udp_header_bytes;  // without IP options
+    static constexpr uint8_t PROTOCOL_UDP = 17;
+
+    enum class Result { OK, TRUNCATED, NOT_IPV4, BAD_IP_CHECKSUM, FRAGMENT, NOT_UDP, BAD_UDP_CHECKSUM };
+
+    /// Addresses and ports are in host byte order.
+    struct Datagram
+    {
+        uint32_t source_address = 0;
+        uint32_t dest_address = 0;
+        uint16_t source_port = 0;
+        uint16_t dest_port = 0;
+        size_t offset = 0;          // of the UDP payload in the packet
+        size_t length = 0;          // of the UDP payload
+    };
+
+    static Result parse(const uint8_t* packet, size_t length, Datagram& datagram, bool verify = true)
+    {
+        if (length < ip_v4_header_bytes) return Result::TRUNCATED;
+        if ((packet[0] >> 4) != 4) return Result::NOT_IPV4;
+
+        size_t ip_header = size_t(packet[0] & 0x0F) * 4;
+        size_t total = detail::get16(packet + 2);
+        if (ip_header < ip_v4_header_bytes || total < ip_header || total > length) return Result::TRUNCATED;
+        if (verify && !InternetChecksum::verify(packet, ip_header)) return Result::BAD_IP_CHECKSUM;
+        if (detail::get16(packet + 6) & 0x3FFF) return Result::FRAGMENT;    // MF flag or a fragment offset
+        if (packet[9] != PROTOCOL_UDP) return Result::NOT_UDP;
+
+        const uint8_t* udp = packet + ip_header;
+        size_t udp_length = detail::get16(udp + 4);
+        if (udp_length < udp_header_bytes || ip_header + udp_length > total) return Result::TRUNCATED;
+        if (verify && detail::get16(udp + 6) != 0)
+        {
+            uint32_t sum = InternetChecksum::add(packet + 12, 8);     // pseudo-header: addresses,
+            sum = InternetChecksum::add16(PROTOCOL_UDP, sum);       // protocol,
+            sum = InternetChecksum::add16(uint16_t(udp_length), sum); // and UDP length
+            if (!InternetChecksum::verify(udp, udp_length, sum)) return Result::BAD_UDP_CHECKSUM;
+        }
+
+        datagram.source_address = detail::get32(packet + 12);
+        datagram.dest_address = detail::get32(packet + 16);
+        datagram.source_port = detail::get16(udp);
+        datagram.dest_port = detail::get16(udp + 2);
+        datagram.offset = ip_header + udp_header_bytes;
+        datagram.length = udp_length - udp_header_bytes;
+        return Result::OK;
+    }
+};
+
+/**
+ * Writes IPv4 and UDP headers, with checksums, for one flow.
+ *
+ * The parts of both checksums that do not change from packet to packet
+ * (addresses, ports, protocol, TTL) are summed once at construction, so
+ * each packet costs one pass over its payload.
+ */
+class IPv4UDPBuilder
+{
+public:
+    /// Addresses and ports are in host byte order.
+    IPv4UDPBuilder(uint32_t source_address, uint16_t source_port, uint32_t dest_address, uint16_t dest_port, uint8_t ttl = 64)
+    : source_address_(source_address), dest_address_(dest_address)
+    , source_port_(source_port), dest_port_(dest_port), ttl_(ttl)
+    {
+        uint8_t addresses[8];
+        detail::put32(addresses, source_address);
+        detail::put32(addresses + 4, dest_address);
+
+        uint32_t sum = InternetChecksum::add(addresses, sizeof(addresses));
+        ip_sum_ = InternetChecksum::add16(0x4500, InternetChecksum::add16(uint16_t(ttl << 8 | IPv4UDP::PROTOCOL_UDP), sum));
+        udp_sum_ = InternetChecksum::add16(IPv4UDP::PROTOCOL_UDP,
+            InternetChecksum::add16(source_port, InternetChecksum::add16(dest_port, sum)));
+    }
+
+    /**
+     * Write the headers in front of @p payload_length bytes of payload that
+     * are already at packet + IPv4UDP::HEADER_BYTES.
+     *
+     * @return the length of the whole packet.
+     */
+    size_t build(uint8_t* packet, size_t payload_length)
+    {
+        uint16_t total = uint16_t(IPv4UDP::HEADER_BYTES + payload_length);
+        uint16_t udp_length = uint16_t(udp_header_bytes + payload_length);
+        uint16_t id = id_++;
+
+        uint8_t* ip = packet;
+        ip[0] = 0x45;                   // version 4, 5 word header
+        ip[1] = 0;
+        detail::put16(ip + 2, total);
+        detail::put16(ip + 4, id);
+        detail::put16(ip + 6, 0);       // flags, fragment offset
+        ip[8] = ttl_;
+        ip[9] = IPv4UDP::PROTOCOL_UDP;
+        detail::put32(ip + 12, source_address_);
+        detail::put32(ip + 16, dest_address_);
+        detail::put16(ip + 10, InternetChecksum::finish(InternetChecksum::add16(total, InternetChecksum::add16(id, ip_sum_))));
+
+        uint8_t* udp = packet + ip_v4_header_bytes;
+        detail::put16(udp, source_port_);
+        detail::put16(udp + 2, dest_port_);
+        detail::put16(udp + 4, udp_length);
+
+        // The UDP length is counted twice: in the pseudo-header and the header.
+        uint32_t sum = InternetChecksum::add16(udp_length, InternetChecksum::add16(udp_length, udp_sum_));
+        uint16_t checksum = InternetChecksum::finish(InternetChecksum::add(packet + IPv4UDP::HEADER_BYTES, payload_length, sum));
+        detail::put16(udp + 6, checksum ? checksum : 0xFFFF);  // zero means "no checksum"
+
+        return total;
+    }
+
+private:
+    uint32_t source_address_;
+    uint32_t dest_address_;
+    uint16_t source_port_;
+    uint16_t dest_port_;
+    uint8_t ttl_;
+    uint16_t id_ = 0;
+    uint32_t ip_sum_;       // constant IP header words
+    uint32_t udp_sum_;      // constant pseudo-header and UDP header words
+};
+
+/**
+ * The fixed part of an RTP header (RFC 3550).
+ */
+struct RTPHeader
+{
+    uint8_t payload_type = opus_rtp_payload_type;
+    bool marker = false;
+    uint16_t sequence = 0;
+    uint32_t timestamp = 0;
+    uint32_t ssrc = 0;
+    size_t length = rtp_header_bytes;   // including CSRCs and extension, when parsed
+    size_t padding = 0;                 // bytes of padding at the end of the packet, when parsed
+
+    /**
+     * Parse the RTP header at the start of @p data.
+     *
+     * @return false if it is not a valid version 2 header.
+     */
+    bool parse(const uint8_t* data, size_t size)
+    {
+        if (size < size_t(rtp_header_bytes) || (data[0] >> 6) != 2) return false;
+
+        size_t header = rtp_header_bytes + size_t(data[0] & 0x0F) * 4;
+        if (data[0] & 0x10)
+        {
+            if (size < header + 4) return false;
+            header += 4 + size_t(detail::get16(data + header + 2)) * 4;
+        }
+        size_t trailer = (data[0] & 0x20) ? data[size - 1] : 0;
+        if (header + trailer > size) return false;
+
+        marker = data[1] & 0x80;
+        payload_type = data[1] & 0x7F;
+        sequence = detail::get16(data + 2);
+        timestamp = detail::get32(data + 4);
+        ssrc = detail::get32(data + 8);
+        length = header;
+        padding = trailer;
+        return true;
+    }
+
+    /// Write a header with no CSRCs, extension or padding.
+    void write(uint8_t* data) const
+    {
+        data[0] = 0x80;                 // version 2
+        data[1] = (marker ? 0x80 : 0) | (payload_type & 0x7F);
+        detail::put16(data + 2, sequence);
+        detail::put32(data + 4, timestamp);
+        detail::put32(data + 8, ssrc);
+    }
+};
+
+} // mobilinkd
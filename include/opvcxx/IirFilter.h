@@ -40,6 +40,14 @@ struct BaseIirFilter : FilterBase<FloatType>
 		
 		return result;
 	}
+
+	/// Set the state to the steady state for a constant input of @p value.
+	void reset(FloatType value)
+	{
+		FloatType sum = 0;
+		for (auto a : denominator_) sum += a;
+		history_.fill(value / sum);
+	}
 };
 
 template <typename FloatType, size_t N>
@@ -0,0 +1,257 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+namespace mobilinkd
+{
+
+/**
+ * Optional hot-path instrumentation for the receive chain.
+ *
+ * When OPV_INSTRUMENTATION is defined (cmake -DOPV_INSTRUMENTATION=ON), each
+ * instrumented stage accumulates call counts, elapsed time and a log2
+ * latency histogram, and the demodulator keeps frame and sync counters.
+ * When it is not defined, every member function is an empty inline and
+ * ScopedStageTimer has no state, so the instrumentation compiles away.
+ *
+ * The query API (stage(), counters(), summary()) is the same in both
+ * builds; it simply reports zeros when instrumentation is disabled.
+ */
+
+enum class Stage : uint8_t { FILTER, CORRELATOR, CLOCK_RECOVERY, FRAMER, FRAME_DECODE, COBS, OPUS, COUNT };
+
+inline const char* stage_name(Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::FILTER:         return "filter";
+        case Stage::CORRELATOR:     return "correlator";
+        case Stage::CLOCK_RECOVERY: return "clock recovery";
+        case Stage::FRAMER:         return "framer";
+        case Stage::FRAME_DECODE:   return "frame decode";
+        case Stage::COBS:           return "cobs";
+        case Stage::OPUS:           return "opus";
+        default:                    return "?";
+    }
+}
+
+/**
+ * Latency histogram with power-of-two nanosecond buckets.  Bucket i holds
+ * durations in [2^(i-1), 2^i) ns; bucket 0 holds zero-length durations and
+ * the last bucket collects everything longer.
+ */
+struct LatencyHistogram
+{
+    static constexpr size_t BUCKETS = 32;
+
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t total_ns_ = 0;
+    uint64_t max_ns_ = 0;
+
+    void record(uint64_t ns)
+    {
+        size_t bucket = std::bit_width(ns);
+        if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+        buckets_[bucket] += 1;
+        count_ += 1;
+        total_ns_ += ns;
+        if (ns > max_ns_) max_ns_ = ns;
+    }
+
+    void reset()
+    {
+        buckets_.fill(0);
+        count_ = 0;
+        total_ns_ = 0;
+        max_ns_ = 0;
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i != BUCKETS; ++i) buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        total_ns_ += other.total_ns_;
+        if (other.max_ns_ > max_ns_) max_ns_ = other.max_ns_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t total_ns() const { return total_ns_; }
+    uint64_t max_ns() const { return max_ns_; }
+    double mean_ns() const { return count_ ? double(total_ns_) / count_ : 0.0; }
+
+    /**
+     * Upper bound of the bucket containing the given percentile (0..100).
+     * This over-estimates by at most a factor of two.
+     */
+    uint64_t percentile_ns(double percentile) const
+    {
+        if (count_ == 0) return 0;
+        uint64_t target = uint64_t(count_ * percentile / 100.0);
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i != BUCKETS; ++i)
+        {
+            seen += buckets_[i];
+            if (seen >= target) return i == 0 ? 0 : (uint64_t(1) << i) - 1;
+        }
+        return max_ns_;
+    }
+};
+
+/**
+ * Event counters maintained by the demodulator.
+ */
+struct DemodCounters
+{
+    uint64_t samples = 0;           // samples processed while DCD was on
+    uint64_t frames = 0;            // frames handed to the frame decoder
+    uint64_t eos_frames = 0;        // frames with the LAST_FRAME flag
+    uint64_t header_failures = 0;   // frame headers that failed Golay decoding
+    uint64_t preambles = 0;         // preamble detections
+    uint64_t syncs = 0;             // STREAM sync words detected
+    uint64_t faked_syncs = 0;       // STREAM sync words missed and freewheeled
+    uint64_t sync_losses = 0;       // times frame sync was abandoned
+    uint64_t false_locks = 0;       // stream syncs dropped when the first frame's header failed
+    uint64_t dcd_losses = 0;        // times data carrier was lost
+};
+
+#ifdef OPV_INSTRUMENTATION
+
+struct Instrumentation
+{
+    using clock_t = std::chrono::steady_clock;
+    using time_point_t = clock_t::time_point;
+
+    static constexpr bool enabled = true;
+
+    std::array<LatencyHistogram, size_t(Stage::COUNT)> stages_;
+    DemodCounters counters_;
+
+    static time_point_t now() { return clock_t::now(); }
+
+    void record(Stage stage, time_point_t start)
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - start).count();
+        stages_[size_t(stage)].record(uint64_t(ns));
+    }
+
+    template <typename F>
+    void count(F func)
+    {
+        func(counters_);
+    }
+
+    const LatencyHistogram& stage(Stage stage) const { return stages_[size_t(stage)]; }
+    const DemodCounters& counters() const { return counters_; }
+
+    /// Add the stage timings kept by another thread, e.g. the audio sink's.
+    void merge(const Instrumentation& other)
+    {
+        for (size_t i = 0; i != stages_.size(); ++i) stages_[i].merge(other.stages_[i]);
+    }
+
+    void reset()
+    {
+        for (auto& s : stages_) s.reset();
+        counters_ = DemodCounters{};
+    }
+};
+
+#else
+
+struct Instrumentation
+{
+    struct time_point_t {};
+
+    static constexpr bool enabled = false;
+
+    static time_point_t now() { return {}; }
+    void record(Stage, time_point_t) {}
+    template <typename F> void count(F) {}
+
+    const LatencyHistogram& stage(Stage) const { static const LatencyHistogram empty; return empty; }
+    const DemodCounters& counters() const { static const DemodCounters empty; return empty; }
+    void merge(const Instrumentation&) {}
+    void reset() {}
+};
+
+#endif // OPV_INSTRUMENTATION
+
+/**
+ * RAII timer that charges the enclosing scope to a stage.
+ */
+struct ScopedStageTimer
+{
+#ifdef OPV_INSTRUMENTATION
+    Instrumentation& instrumentation_;
+    Stage stage_;
+    Instrumentation::time_point_t start_;
+
+    ScopedStageTimer(Instrumentation& instrumentation, Stage stage)
+    : instrumentation_(instrumentation), stage_(stage), start_(Instrumentation::now())
+    {}
+
+    ~ScopedStageTimer()
+    {
+        instrumentation_.record(stage_, start_);
+    }
+#else
+    ScopedStageTimer(Instrumentation&, Stage) {}
+#endif
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+};
+
+/**
+ * Write a human-readable summary of the collected statistics.
+ *
+ * @param elapsed_seconds is the stream time covered by the statistics
+ *  (samples / sample rate); it is used to express stage cost as a
+ *  fraction of real time.
+ */
+inline void print_summary(std::ostream& os, const Instrumentation& instrumentation, double elapsed_seconds)
+{
+    if (!Instrumentation::enabled)
+    {
+        os << "Instrumentation disabled at compile time (build with -DOPV_INSTRUMENTATION=ON)" << std::endl;
+        return;
+    }
+
+    auto flags = os.flags();
+    os << std::fixed << std::setprecision(1);
+    os << "stage            calls      mean ns    p99 ns     max ns     % realtime" << std::endl;
+    for (size_t i = 0; i != size_t(Stage::COUNT); ++i)
+    {
+        auto& h = instrumentation.stage(Stage(i));
+        double load = elapsed_seconds > 0 ? 100.0 * h.total_ns() / (elapsed_seconds * 1e9) : 0.0;
+        os << std::left << std::setw(16) << stage_name(Stage(i)) << std::right
+            << std::setw(10) << h.count()
+            << std::setw(11) << h.mean_ns()
+            << std::setw(11) << h.percentile_ns(99)
+            << std::setw(11) << h.max_ns()
+            << std::setw(11) << std::setprecision(3) << load << std::setprecision(1)
+            << std::endl;
+    }
+
+    auto& c = instrumentation.counters();
+    os << "frames: " << c.frames << ", eos: " << c.eos_frames
+        << ", header failures: " << c.header_failures
+        << ", preambles: " << c.preambles
+        << ", syncs: " << c.syncs << ", faked syncs: " << c.faked_syncs
+        << ", sync losses: " << c.sync_losses << ", false locks: " << c.false_locks
+        << ", dcd losses: " << c.dcd_losses
+        << std::endl;
+    os.flags(flags);
+}
+
+} // mobilinkd
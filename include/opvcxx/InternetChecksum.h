@@ -0,0 +1,134 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#endif
+
+namespace mobilinkd
+{
+
+/**
+ * The Internet checksum (RFC 1071) used by IPv4, UDP and TCP: the ones'
+ * complement of the ones' complement sum of the data taken as 16-bit
+ * big-endian words.
+ *
+ * Partial sums are carried as uint32_t values of at most 0xFFFF, so a
+ * checksum over several pieces (e.g. a pseudo-header and a payload) is
+ * add(piece2, len2, add(piece1, len1)). Only the last piece may have an
+ * odd length.
+ *
+ * The bulk of the data is summed 16 bytes at a time with SSE2 or NEON where
+ * available, as little-endian words into 32-bit lanes; the ones' complement
+ * sum of byte-swapped words is the byte-swapped sum (RFC 1071 section
+ * 2(B)), so that is swapped back once at the end.
+ */
+struct InternetChecksum
+{
+    /// Add @p length bytes at @p data to the partial sum @p sum.
+    static uint32_t add(const uint8_t* data, size_t length, uint32_t sum = 0)
+    {
+        const uint8_t* end = data + length;
+        uint64_t total = sum;
+
+#if defined(__SSE2__)
+        if (end - data >= 16)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            uint64_t swapped = 0;
+            while (end - data >= 16)
+            {
+                // Each block adds at most 2 * 0xFFFF to a lane, so a lane
+                // cannot overflow within BLOCKS blocks.
+                const uint8_t* stop = data + std::min<size_t>(size_t(end - data) & ~size_t(15), BLOCKS * 16);
+                __m128i acc = _mm_setzero_si128();
+                for (; data != stop; data += 16)
+                {
+                    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(block, zero));
+                    acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(block, zero));
+                }
+                alignas(16) uint32_t lanes[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+                swapped += uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+            }
+            total += swap(fold(swapped));
+        }
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (end - data >= 16)
+        {
+            uint64_t swapped = 0;
+            while (end - data >= 16)
+            {
+                const uint8_t* stop = data + std::min<size_t>(size_t(end - data) & ~size_t(15), BLOCKS * 16);
+                uint32x4_t acc = vdupq_n_u32(0);
+                for (; data != stop; data += 16)
+                {
+                    acc = vpadalq_u16(acc, vreinterpretq_u16_u8(vld1q_u8(data)));
+                }
+                swapped += uint64_t(vgetq_lane_u32(acc, 0)) + vgetq_lane_u32(acc, 1)
+                    + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+            }
+            total += swap(fold(swapped));
+        }
+#endif
+
+        for (; end - data >= 2; data += 2)
+        {
+            total += uint32_t(data[0]) << 8 | data[1];
+        }
+        if (data != end)
+        {
+            total += uint32_t(data[0]) << 8;   // odd length: pad with zero
+        }
+
+        return fold(total);
+    }
+
+    /// Add a 16-bit value to the partial sum @p sum.
+    static constexpr uint32_t add16(uint16_t value, uint32_t sum = 0)
+    {
+        return fold(uint64_t(sum) + value);
+    }
+
+    /// The checksum to transmit for a partial sum.
+    static constexpr uint16_t finish(uint32_t sum)
+    {
+        return uint16_t(~fold(sum));
+    }
+
+    /// The checksum of @p length bytes at @p data.
+    static uint16_t compute(const uint8_t* data, size_t length, uint32_t sum = 0)
+    {
+        return finish(add(data, length, sum));
+    }
+
+    /// True if data that includes its checksum field sums correctly.
+    static bool verify(const uint8_t* data, size_t length, uint32_t sum = 0)
+    {
+        return add(data, length, sum) == 0xFFFF;
+    }
+
+private:
+    static constexpr size_t BLOCKS = 4096;
+
+    static constexpr uint32_t fold(uint64_t sum)
+    {
+        while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+        return uint32_t(sum);
+    }
+
+    static constexpr uint32_t swap(uint32_t word)
+    {
+        return ((word >> 8) | (word << 8)) & 0xFFFF;
+    }
+};
+
+} // mobilinkd
@@ -0,0 +1,72 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace mobilinkd
+{
+
+/**
+ * Keying handed from one thread to another as a sequence of events, not
+ * a level: a consumer that polls sees every key and unkey in order, even
+ * a pair that comes and goes between two of its polls.
+ *
+ * Keys and unkeys alternate. The producer counts each, and the consumer
+ * counts those it has seen, so no event is lost or repeated.
+ */
+class KeyEvents
+{
+public:
+    enum class Event { NONE, KEY, UNKEY };
+
+    KeyEvents() = default;
+    KeyEvents(const KeyEvents&) = delete;
+    KeyEvents& operator=(const KeyEvents&) = delete;
+
+    /// Producer: start a transmission. Ignored if already keyed.
+    void key()
+    {
+        if (keyed()) return;
+        keys_.store(keys_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Producer: end the transmission. Ignored if not keyed.
+    void unkey()
+    {
+        if (!keyed()) return;
+        unkeys_.store(unkeys_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Producer: whether the last event sent was a key.
+    bool keyed() const
+    {
+        return keys_.load(std::memory_order_relaxed) != unkeys_.load(std::memory_order_relaxed);
+    }
+
+    /// Consumer: the next event not yet seen, or NONE.
+    Event poll()
+    {
+        if (!seen_keyed())
+        {
+            if (seen_keys_ == keys_.load(std::memory_order_acquire)) return Event::NONE;
+            seen_keys_++;
+            return Event::KEY;
+        }
+        if (seen_unkeys_ == unkeys_.load(std::memory_order_acquire)) return Event::NONE;
+        seen_unkeys_++;
+        return Event::UNKEY;
+    }
+
+    /// Consumer: whether the last event seen was a key.
+    bool seen_keyed() const { return seen_keys_ != seen_unkeys_; }
+
+private:
+    std::atomic<uint64_t> keys_{0};
+    std::atomic<uint64_t> unkeys_{0};
+    uint64_t seen_keys_ = 0;       // consumer only
+    uint64_t seen_unkeys_ = 0;
+};
+
+} // mobilinkd
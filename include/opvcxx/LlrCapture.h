@@ -0,0 +1,179 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "MappedFile.h"
+#include "Numerology.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace mobilinkd
+{
+
+/// How the demodulator found the sync word before a frame.
+enum class OPVSyncType : uint8_t
+{
+    FIRST,      // the first of a stream: the COBS decoder was reset
+    STREAM,     // in its window, one frame after the last
+    FAKED,      // missed, and assumed where it should have been
+};
+
+/**
+ * One received frame's soft bits, as the demodulator gave them to
+ * OPVFrameDecoder, with the demodulator's state when the frame ended.
+ * The layout is that of an LLR capture file record.
+ */
+struct alignas(8) LlrRecord
+{
+    uint64_t sample;            // demodulator input samples, up to the frame's end
+    float deviation;
+    float evm;                  // error vector magnitude, as a fraction
+    float offset;               // frequency offset
+    float clock;                // symbol timing loop's transmitter clock estimate
+    OPVSyncType sync;
+    uint8_t sync_index;         // sample of the sync word's peak, within a symbol
+    uint8_t clock_index;        // symbol strobe phase in tenths of a sample
+    uint8_t reserved = 0;
+    std::array<int8_t, stream_type4_size> llr{};    // interleaved and scrambled, as received
+};
+
+/**
+ * LLR capture files: the frames a demodulator received, so that frame
+ * decoding (Golay, Viterbi, COBS) can be rerun without the DSP front end.
+ *
+ * A 32-byte header is followed by fixed-size LlrRecords, in the order
+ * received, in the host's byte order. Records can be found by number
+ * without reading the ones before, and the file can be mapped and used in
+ * place. The record count is not stored; a file cut short by a crash
+ * loses only its partial last record.
+ *
+ * Header: magic "OPVLLR\0\0", then 32-bit version, record size, frame
+ * bits, samples per symbol, sample rate and a reserved word.
+ */
+struct LlrCapture
+{
+    static constexpr std::array<char, 8> MAGIC = {'O', 'P', 'V', 'L', 'L', 'R', 0, 0};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 32;
+
+    struct Header
+    {
+        std::array<char, 8> magic = MAGIC;
+        uint32_t version = VERSION;
+        uint32_t record_size = sizeof(LlrRecord);
+        uint32_t frame_bits = stream_type4_size;
+        uint32_t samples_per_symbol = default_samples_per_symbol;
+        uint32_t sample_rate = mobilinkd::sample_rate;      // of LlrRecord::sample
+        uint32_t reserved = 0;
+    };
+
+    static_assert(sizeof(Header) == HEADER_SIZE);
+    static_assert(sizeof(LlrRecord) % 8 == 0 && HEADER_SIZE % alignof(LlrRecord) == 0,
+        "records are aligned in a mapped file");
+};
+
+/// Writes an LLR capture file, a record at a time.
+class LlrCaptureWriter
+{
+public:
+    /// @return false if the file cannot be written.
+    bool open(const std::string& path, uint32_t samples_per_symbol = default_samples_per_symbol)
+    {
+        file_.close();
+        file_.clear();
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_) return false;
+
+        LlrCapture::Header header;
+        header.samples_per_symbol = samples_per_symbol;
+        header.sample_rate = symbol_rate * samples_per_symbol;
+        count_ = 0;
+        return bool(file_.write(reinterpret_cast<const char*>(&header), sizeof(header)));
+    }
+
+    bool write(const LlrRecord& record)
+    {
+        count_++;
+        return bool(file_.write(reinterpret_cast<const char*>(&record), sizeof(record)));
+    }
+
+    void close() { file_.close(); }
+
+    bool is_open() const { return file_.is_open(); }
+
+    /// Records written.
+    size_t size() const { return count_; }
+
+private:
+    std::ofstream file_;
+    size_t count_ = 0;
+};
+
+/**
+ * Reads an LLR capture file by mapping it into memory. Records are used
+ * in place and stay valid until the reader is closed.
+ */
+class LlrCaptureReader
+{
+public:
+    /// @return false if the file cannot be read or is not an LLR capture of this version.
+    bool open(const std::string& path)
+    {
+        if (!file_.open(path) || file_.size() < LlrCapture::HEADER_SIZE)
+        {
+            file_.close();
+            return false;
+        }
+
+        std::memcpy(&header_, file_.data(), sizeof(header_));
+        if (header_.magic != LlrCapture::MAGIC || header_.version != LlrCapture::VERSION
+            || header_.record_size != sizeof(LlrRecord) || header_.frame_bits != stream_type4_size)
+        {
+            file_.close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() { file_.close(); }
+
+    const LlrCapture::Header& header() const { return header_; }
+
+    /// Complete records in the file.
+    size_t size() const
+    {
+        return file_.data() ? (file_.size() - LlrCapture::HEADER_SIZE) / sizeof(LlrRecord) : 0;
+    }
+
+    const LlrRecord& operator[](size_t index) const
+    {
+        return begin()[index];
+    }
+
+    const LlrRecord* begin() const
+    {
+        if (!file_.data()) return nullptr;
+        return reinterpret_cast<const LlrRecord*>(file_.data() + LlrCapture::HEADER_SIZE);
+    }
+
+    const LlrRecord* end() const { return begin() + size(); }
+
+    /// The first record at or after the given sample.
+    const LlrRecord* find(uint64_t sample) const
+    {
+        return std::lower_bound(begin(), end(), sample,
+            [](const LlrRecord& record, uint64_t value) { return record.sample < value; });
+    }
+
+private:
+    MappedFile file_;
+    LlrCapture::Header header_;
+};
+
+} // mobilinkd
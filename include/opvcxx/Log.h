@@ -0,0 +1,456 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+/**
+ * Compile-time log threshold. Log statements below this level expand to
+ * nothing, and their arguments are not evaluated.
+ *   0 = DEBUG, 1 = INFO, 2 = WARN, 3 = ERROR, 4 = nothing.
+ */
+#ifndef OPV_LOG_LEVEL
+#define OPV_LOG_LEVEL 0
+#endif
+
+namespace mobilinkd
+{
+
+enum class LogLevel : uint8_t { DEBUG = 0, INFO = 1, WARN = 2, ERROR = 3, OFF = 4 };
+
+inline const char* log_level_name(LogLevel level)
+{
+    switch (level)
+    {
+        case LogLevel::DEBUG:   return "DEBUG";
+        case LogLevel::INFO:    return "INFO";
+        case LogLevel::WARN:    return "WARN";
+        case LogLevel::ERROR:   return "ERROR";
+        default:                return "";
+    }
+}
+
+/**
+ * Wrap an integer argument to have it formatted in hex.
+ */
+struct LogHex
+{
+    uint64_t value;
+};
+
+/**
+ * One captured log argument. Strings are copied (truncated) so that the
+ * caller's buffer need not outlive the call.
+ */
+struct LogArg
+{
+    enum class Type : uint8_t { INT, UINT, DOUBLE, HEX, STR };
+
+    static constexpr size_t MAX_STR = 15;
+
+    Type type = Type::INT;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        char s[MAX_STR + 1];
+    };
+
+    LogArg() : i(0) {}
+
+    template <typename T>
+    static LogArg make(const T& value)
+    {
+        LogArg arg;
+        if constexpr (std::is_same_v<T, LogHex>)
+        {
+            arg.type = Type::HEX;
+            arg.u = value.value;
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            arg.type = Type::DOUBLE;
+            arg.d = value;
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            arg.type = Type::INT;
+            arg.i = value;
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            arg.type = Type::UINT;
+            arg.u = value;
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            arg.type = Type::INT;
+            arg.i = static_cast<int64_t>(value);
+        }
+        else if constexpr (std::is_pointer_v<T> && std::is_convertible_v<T, const char*>)
+        {
+            arg.set_string(value, value ? strnlen(value, MAX_STR) : 0);
+        }
+        else if constexpr (std::is_convertible_v<T, const char*>)    // char[N], never null
+        {
+            arg.set_string(value, strnlen(value, MAX_STR));
+        }
+        else    // std::array<char, N>, std::string, std::string_view
+        {
+            arg.set_string(value.data(), strnlen(value.data(), std::min<size_t>(value.size(), MAX_STR)));
+        }
+        return arg;
+    }
+
+    void set_string(const char* str, size_t len)
+    {
+        type = Type::STR;
+        if (len) memcpy(s, str, len);
+        s[len] = 0;
+    }
+
+    void format(std::ostream& os) const
+    {
+        switch (type)
+        {
+            case Type::INT:     os << i; break;
+            case Type::UINT:    os << u; break;
+            case Type::DOUBLE:  os << d; break;
+            case Type::HEX:     os << std::hex << u << std::dec; break;
+            case Type::STR:     os << s; break;
+        }
+    }
+};
+
+/**
+ * A log event as it sits in the ring. The format string must be a string
+ * literal (or otherwise outlive the logger); "{}" marks argument positions.
+ */
+struct LogRecord
+{
+    static constexpr size_t MAX_ARGS = 4;
+
+    const char* fmt = nullptr;
+    std::chrono::steady_clock::time_point time;
+    LogLevel level = LogLevel::INFO;
+    uint8_t nargs = 0;
+    uint32_t suppressed = 0;    // similar messages dropped by the call site's rate limiter
+    std::array<LogArg, MAX_ARGS> args;
+
+    void format(std::ostream& os) const
+    {
+        const char* p = fmt;
+        size_t arg = 0;
+        while (*p)
+        {
+            if (p[0] == '{' && p[1] == '}' && arg < nargs)
+            {
+                args[arg++].format(os);
+                p += 2;
+            }
+            else
+            {
+                os << *p++;
+            }
+        }
+        if (suppressed) os << " (" << suppressed << " similar suppressed)";
+    }
+};
+
+/**
+ * Bounded lock-free multi-producer, single-consumer ring of log records.
+ * Producers never block; when the ring is full the record is dropped and
+ * counted.
+ *
+ * This is the bounded MPMC queue by Dmitry Vyukov, with each slot carrying
+ * a sequence number that tells producers and the consumer whose turn it is.
+ */
+template <size_t N>
+class LogRing
+{
+    static_assert((N & (N - 1)) == 0, "LogRing size must be a power of 2");
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    std::array<Slot, N> slots_;
+    alignas(64) std::atomic<size_t> head_{0};   // next slot to write
+    alignas(64) std::atomic<size_t> tail_{0};   // next slot to read
+    alignas(64) std::atomic<size_t> dropped_{0};
+
+public:
+
+    LogRing()
+    {
+        for (size_t i = 0; i != N; ++i) slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const LogRecord& record)
+    {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot& slot = slots_[pos & (N - 1)];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0)
+            {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.record = record;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;   // full
+            }
+            else
+            {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(LogRecord& record)
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[pos & (N - 1)];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        if (intptr_t(seq) - intptr_t(pos + 1) < 0) return false;   // empty
+
+        record = slot.record;
+        slot.sequence.store(pos + N, std::memory_order_release);
+        tail_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t take_dropped()
+    {
+        return dropped_.exchange(0, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * Per-call-site rate limiter. Allows up to @p limit events per second;
+ * events beyond that are counted and reported with the next allowed one.
+ */
+struct LogRateLimiter
+{
+    std::atomic<int64_t> window_start_{0};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint32_t> suppressed_{0};
+
+    /**
+     * @return true if the event should be logged. @p suppressed receives
+     *  the number of events dropped since the last one that was logged.
+     */
+    bool allow(std::chrono::steady_clock::time_point now, uint32_t limit, uint32_t& suppressed)
+    {
+        if (limit == 0)
+        {
+            suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        int64_t second = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+        if (window_start_.load(std::memory_order_relaxed) != second)
+        {
+            window_start_.store(second, std::memory_order_relaxed);
+            count_.store(0, std::memory_order_relaxed);
+        }
+
+        if (count_.fetch_add(1, std::memory_order_relaxed) >= limit)
+        {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+/**
+ * Asynchronous logger. Hot-path callers only capture their arguments into
+ * a record and push it onto a lock-free ring; a background thread does all
+ * the formatting and writing. Nothing on the calling side allocates, locks
+ * or makes a system call.
+ *
+ * Most code uses the process-wide instance() through the OPV_LOG_* macros.
+ */
+class Logger
+{
+public:
+    static constexpr size_t RING_SIZE = 1024;
+    static constexpr auto IDLE_WAIT = std::chrono::milliseconds(5);
+
+private:
+    LogRing<RING_SIZE> ring_;
+    std::ostream* out_;
+    std::atomic<LogLevel> level_{LogLevel::INFO};
+    std::atomic<uint32_t> rate_limit_{50};
+    std::atomic<bool> running_{true};
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> written_{0};
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+    std::thread thread_;
+
+    void write_pending()
+    {
+        LogRecord record;
+        std::ostringstream text;
+        size_t count = 0;
+
+        while (ring_.pop(record))
+        {
+            auto ms = std::chrono::duration_cast<std::chrono::microseconds>(record.time - start_).count() / 1000.0;
+            text << std::fixed << std::setprecision(3) << std::setw(10) << ms << std::defaultfloat << std::setprecision(6)
+                << ' ' << log_level_name(record.level) << ": ";
+            record.format(text);
+            text << '\n';
+            count += 1;
+        }
+
+        if (auto dropped = ring_.take_dropped())
+        {
+            text << "Log ring full, " << dropped << " messages dropped\n";
+        }
+
+        if (text.tellp() > 0)
+        {
+            *out_ << text.str() << std::flush;
+        }
+        written_.fetch_add(count, std::memory_order_release);
+    }
+
+    void run()
+    {
+        while (running_.load(std::memory_order_acquire))
+        {
+            if (ring_.empty()) std::this_thread::sleep_for(IDLE_WAIT);
+            write_pending();
+        }
+        write_pending();
+    }
+
+public:
+
+    explicit Logger(std::ostream& out = std::cerr)
+    : out_(&out)
+    {
+        thread_ = std::thread([this](){ run(); });
+    }
+
+    ~Logger()
+    {
+        running_.store(false, std::memory_order_release);
+        if (thread_.joinable()) thread_.join();
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger& instance()
+    {
+        static Logger logger;
+        return logger;
+    }
+
+    /// Runtime threshold, applied on top of the compile-time OPV_LOG_LEVEL.
+    void level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+
+    /// Maximum messages per second from any one call site (0 = unlimited).
+    void rate_limit(uint32_t per_second) { rate_limit_.store(per_second, std::memory_order_relaxed); }
+
+    bool enabled(LogLevel level) const { return level >= level_.load(std::memory_order_relaxed); }
+
+    template <typename... Args>
+    void log(LogRateLimiter& limiter, LogLevel level, const char* fmt, const Args&... args)
+    {
+        static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "too many log arguments");
+
+        if (!enabled(level)) return;
+
+        LogRecord record;
+        record.time = std::chrono::steady_clock::now();
+        if (!limiter.allow(record.time, rate_limit_.load(std::memory_order_relaxed), record.suppressed)) return;
+
+        record.fmt = fmt;
+        record.level = level;
+        record.nargs = sizeof...(Args);
+        size_t i = 0;
+        ((record.args[i++] = LogArg::make(args)), ...);
+
+        if (ring_.push(record)) pushed_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Block until everything logged so far has been written. Use this before
+     * writing to the same stream directly, or before exit.
+     */
+    void flush()
+    {
+        auto target = pushed_.load(std::memory_order_relaxed);
+        while (written_.load(std::memory_order_acquire) < target)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+};
+
+} // mobilinkd
+
+// Arguments are only evaluated when the level is enabled at run time.
+#define OPV_LOG_AT(lvl, ...) \
+    do { \
+        static ::mobilinkd::LogRateLimiter opv_log_limiter_; \
+        auto& opv_logger_ = ::mobilinkd::Logger::instance(); \
+        if (opv_logger_.enabled(lvl)) opv_logger_.log(opv_log_limiter_, lvl, __VA_ARGS__); \
+    } while (0)
+
+#if OPV_LOG_LEVEL <= 0
+#define OPV_LOG_DEBUG(...) OPV_LOG_AT(::mobilinkd::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define OPV_LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if OPV_LOG_LEVEL <= 1
+#define OPV_LOG_INFO(...) OPV_LOG_AT(::mobilinkd::LogLevel::INFO, __VA_ARGS__)
+#else
+#define OPV_LOG_INFO(...) do {} while (0)
+#endif
+
+#if OPV_LOG_LEVEL <= 2
+#define OPV_LOG_WARN(...) OPV_LOG_AT(::mobilinkd::LogLevel::WARN, __VA_ARGS__)
+#else
+#define OPV_LOG_WARN(...) do {} while (0)
+#endif
+
+#if OPV_LOG_LEVEL <= 3
+#define OPV_LOG_ERROR(...) OPV_LOG_AT(::mobilinkd::LogLevel::ERROR, __VA_ARGS__)
+#else
+#define OPV_LOG_ERROR(...) do {} while (0)
+#endif
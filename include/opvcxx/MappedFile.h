@@ -0,0 +1,82 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mobilinkd
+{
+
+/**
+ * A file mapped read-only into memory, for reading large recordings in
+ * place: pages are read from disk as they are touched, and any part of the
+ * file is as quick to reach as any other.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    /// @return false if the file cannot be opened or mapped. An empty file maps to nothing.
+    bool open(const std::string& path)
+    {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat status;
+        if (::fstat(fd, &status) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        size_ = status.st_size;
+        if (size_ == 0)
+        {
+            ::close(fd);
+            open_ = true;
+            return true;
+        }
+
+        void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            size_ = 0;
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(data);
+        ::madvise(data, size_, MADV_SEQUENTIAL);
+        open_ = true;
+        return true;
+    }
+
+    void close()
+    {
+        if (data_) ::munmap(const_cast<uint8_t*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+
+    bool is_open() const { return open_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+};
+
+} // mobilinkd
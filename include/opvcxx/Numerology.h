@@ -2,6 +2,7 @@
 
 #include <array>
 #include <cassert>
+#include <cstddef>
 
 namespace mobilinkd
 {
@@ -39,9 +40,21 @@ namespace mobilinkd
     const int bert_frame_prime_size = 971;      // largest prime smaller than bert_frame_total_size
 
     const int symbol_rate = baseband_frame_symbols / 0.04;  // symbols per second
-    const int sample_rate = symbol_rate * 10;               // sample rate
+    const int default_samples_per_symbol = 10;              // baseband oversampling, transmit and receive
+    const int sample_rate = symbol_rate * default_samples_per_symbol;   // sample rate
     const int samples_per_frame = sample_rate * 0.04;       // samples per 40ms frame
 
+    // Baseband rates for a receive chain running at another oversampling
+    // ratio. sample_rate and samples_per_frame above are those of the
+    // default, and remain the time base for logs and audio timing.
+    template <size_t SamplesPerSymbol>
+    struct Oversampling
+    {
+        static constexpr size_t samples_per_symbol = SamplesPerSymbol;
+        static constexpr int sample_rate = symbol_rate * SamplesPerSymbol;
+        static constexpr int samples_per_frame = baseband_frame_symbols * SamplesPerSymbol;
+    };
+
     static_assert((stream_type3_payload_size % 8) == 0, "Type3 payload size not an integer number of bytes");
     static_assert(bert_frame_prime_size < bert_frame_total_size, "BERT prime size not less than BERT total size");
     static_assert(bert_frame_prime_size % 2 != 0, "BERT prime size not prime");
@@ -71,4 +84,7 @@ namespace mobilinkd
 
     // Parameters for data communication
     const int ip_mtu = 1500;    // common Maximum Transmission Unit (MTU) value for Ethernet, in bytes
+    const int voice_udp_port = 1234;        // UDP destination port of Opus voice (RTP) packets
+    const int opus_rtp_payload_type = 96;   // dynamic RTP payload type used for Opus
+    const int opus_rtp_clock_rate = 48000;  // RTP timestamp rate for Opus (RFC 7587)
 }
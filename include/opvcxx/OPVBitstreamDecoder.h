@@ -0,0 +1,212 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Instrumentation.h"
+#include "Log.h"
+#include "Numerology.h"
+#include "OPVFrameDecoder.h"
+#include "Util.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+
+namespace mobilinkd
+{
+
+/**
+ * Receiver for the packed bitstream written by opv-mod --bitstream (and
+ * --network): each frame is a 16-bit sync word followed by the frame's
+ * type4 bits, MSB first, with no modulation.
+ *
+ * This skips the whole DSP front end. Frame sync is found by comparing
+ * the sync word against every bit alignment of each input byte at once,
+ * so the stream need not be byte-aligned; once locked, the next sync word
+ * is only checked where it is expected, allowing a few bit errors, and a
+ * missing one is freewheeled over for up to MAX_MISSED_SYNCS frames. Bits
+ * become hard-decision LLRs (+/- llr_limit<4>()) eight at a time by table
+ * lookup, and complete frames go to OPVFrameDecoder and on to the frame
+ * handler, as in OPVDemodulator.
+ */
+template <OPVFrameHandler FrameHandler = OPVFrameDecoder::callback_t>
+class OPVBitstreamDecoder
+{
+public:
+    static constexpr uint16_t STREAM_SYNC = 0xFF5D;
+    static constexpr uint16_t EOT_SYNC = 0x555D;
+    static constexpr int MAX_SYNC_ERRORS = 2;       // bit errors allowed in an expected sync word
+    static constexpr size_t MAX_MISSED_SYNCS = 2;   // sync words freewheeled before giving up
+    static constexpr int8_t LLR = detail::llr_limit<4>();
+
+    Instrumentation instrumentation;
+
+    explicit OPVBitstreamDecoder(FrameHandler handler)
+    : frame_handler_(std::move(handler))
+    {}
+
+    /// Process the next @p length bytes of the bitstream.
+    void operator()(const uint8_t* data, size_t length)
+    {
+        for (size_t i = 0; i != length; ++i)
+        {
+            bits_ = (bits_ << 8) | data[i];
+            count_ += 8;
+
+            while (count_ >= 8)
+            {
+                if (state_ == State::FRAME)
+                {
+                    ScopedStageTimer timer(instrumentation, Stage::FRAMER);
+                    count_ -= 8;
+                    std::memcpy(frame_.data() + frame_index_, table_[uint8_t(bits_ >> count_)].data(), 8);
+                    frame_index_ += 8;
+                    if (frame_index_ != frame_.size()) continue;
+                }
+                else if (count_ < 16 || !(state_ == State::SEARCH ? search() : expect()))
+                {
+                    break;
+                }
+
+                if (state_ == State::FRAME && frame_index_ == frame_.size()) decode();
+            }
+        }
+    }
+
+    /// Forget any partial frame and search for sync again.
+    void reset()
+    {
+        state_ = State::SEARCH;
+        count_ = 0;
+        frame_index_ = 0;
+        missed_ = 0;
+        decoder_.reset();
+    }
+
+    /// Viterbi cost of the most recent frame.
+    size_t viterbi_cost() const { return viterbi_cost_; }
+
+    /// True when frame sync is held.
+    bool locked() const { return state_ != State::SEARCH; }
+
+private:
+    enum class State { SEARCH, SYNC, FRAME };
+    using llr_table_t = std::array<std::array<int8_t, 8>, 256>;
+
+    static constexpr llr_table_t make_table()
+    {
+        llr_table_t table{};
+        for (size_t byte = 0; byte != 256; ++byte)
+        {
+            for (size_t bit = 0; bit != 8; ++bit)
+            {
+                table[byte][bit] = (byte & (0x80 >> bit)) ? LLR : -LLR;
+            }
+        }
+        return table;
+    }
+
+    static constexpr llr_table_t table_ = make_table();
+
+    FrameHandler frame_handler_;
+    OPVFrameDecoder decoder_;
+    State state_ = State::SEARCH;
+    uint64_t bits_ = 0;             // input bits, newest in the LSBs
+    size_t count_ = 0;              // unconsumed bits in bits_
+    alignas(16) std::array<int8_t, stream_type4_size> frame_;
+    size_t frame_index_ = 0;
+    size_t missed_ = 0;
+    size_t viterbi_cost_ = 0;
+
+    static int distance(uint16_t word, uint16_t sync)
+    {
+        return std::popcount(uint16_t(word ^ sync));
+    }
+
+    // Look for an exact STREAM sync word at every alignment of the
+    // unconsumed bits, earliest first.
+    bool search()
+    {
+        for (size_t shift = count_ - 16 + 1; shift-- != 0; )
+        {
+            if (uint16_t(bits_ >> shift) == STREAM_SYNC)
+            {
+                count_ = shift;
+                start_frame();
+                instrumentation.count([](auto& c){ c.syncs++; });
+                return true;
+            }
+        }
+        count_ = 15;    // a sync word may still end in the next byte
+        return false;
+    }
+
+    // Check for the sync word expected between frames.
+    bool expect()
+    {
+        count_ -= 16;
+        uint16_t word = uint16_t(bits_ >> count_);
+
+        if (distance(word, STREAM_SYNC) <= MAX_SYNC_ERRORS)
+        {
+            missed_ = 0;
+            instrumentation.count([](auto& c){ c.syncs++; });
+        }
+        else if (distance(word, EOT_SYNC) <= MAX_SYNC_ERRORS)
+        {
+            OPV_LOG_DEBUG("EOT");
+            state_ = State::SEARCH;
+            return true;
+        }
+        else if (missed_++ < MAX_MISSED_SYNCS)
+        {
+            instrumentation.count([](auto& c){ c.faked_syncs++; });
+        }
+        else
+        {
+            OPV_LOG_INFO("Lost frame sync");
+            instrumentation.count([](auto& c){ c.sync_losses++; });
+            count_ += 16;   // search these bits again
+            state_ = State::SEARCH;
+            return true;
+        }
+
+        start_frame();
+        return true;
+    }
+
+    void start_frame()
+    {
+        state_ = State::FRAME;
+        frame_index_ = 0;
+    }
+
+    void decode()
+    {
+        OPVFrameDecoder::DecodeResult result;
+        {
+            ScopedStageTimer timer(instrumentation, Stage::FRAME_DECODE);
+            result = decoder_(std::span<const int8_t, stream_type4_size>(frame_), viterbi_cost_, frame_handler_);
+        }
+        instrumentation.count([this](auto& c){
+            c.frames++;
+            if (decoder_.header_result_ == OPVFrameHeader::HeaderResult::FAIL) c.header_failures++;
+        });
+
+        if (result == OPVFrameDecoder::DecodeResult::EOS)
+        {
+            instrumentation.count([](auto& c){ c.eos_frames++; });
+            state_ = State::SEARCH;     // a new transmission may follow immediately
+        }
+        else
+        {
+            state_ = State::SYNC;
+        }
+    }
+};
+
+} // mobilinkd
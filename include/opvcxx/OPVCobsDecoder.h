@@ -2,17 +2,36 @@
 
 #pragma once
 
+#include "Log.h"
 #include "Numerology.h"
+#include "PacketPool.h"
 
 #include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstddef>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 static const int minimum_packet_length = 20;    // smallest valid IP packet (header and no data)
 
+/**
+ * A decoded packet handler: either borrows the packet, as
+ * void(const uint8_t*, unsigned int), and must copy what it keeps, or takes
+ * ownership of a pooled buffer, as void(mobilinkd::PacketHandle).
+ */
+template <typename Handler>
+concept OPVPacketHandler = std::is_invocable_v<Handler&, const uint8_t *, unsigned int>
+    || std::is_invocable_v<Handler&, mobilinkd::PacketHandle>;
+
 struct OPVCobsDecoder
 {
     enum class State { RESET, PACKET_TOO_LONG, CHUNK, CASE255 };
@@ -20,10 +39,19 @@ struct OPVCobsDecoder
     unsigned int decoded_count = 0;     // number of bytes already in decoded output packet buffer
     unsigned int remaining_count = 0;   // countdown of bytes expected in COBS-encoded input block
 
-    // packet assembly buffer
-    uint8_t packet[mobilinkd::ip_mtu+3];    // allow mtu+1 at loop end to accommodate virtual zero, plus up to 2 bytes added per iteration
+    // packet assembly buffer: a pool buffer if there is a pool, otherwise buffer_
+    uint8_t buffer_[mobilinkd::ip_mtu+3];    // allow mtu+1 at loop end to accommodate virtual zero, plus up to 2 bytes added per iteration
+    uint8_t *packet = buffer_;
+    mobilinkd::PacketPool *pool_ = nullptr;
+    mobilinkd::PacketHandle slot_;          // pool buffer that packet points into
+
+    OPVCobsDecoder() = default;
+    OPVCobsDecoder(const OPVCobsDecoder&) = delete;
+    OPVCobsDecoder& operator=(const OPVCobsDecoder&) = delete;
 
     // Packet callback functions must copy the data before returning.
+    // Any OPVPacketHandler can also be passed to operator() directly, for
+    // static dispatch; one taking a PacketHandle needs a pool (set_pool).
     using packet_callback_t = std::function<void(const uint8_t *, unsigned int)>;
     packet_callback_t packet_callback;
 
@@ -37,6 +65,51 @@ struct OPVCobsDecoder
         state_ = State::RESET;
         decoded_count = 0;
         remaining_count = 0;
+
+        if (pool_ && !slot_)
+        {
+            slot_ = pool_->acquire();   // empty if the pool is exhausted
+            packet = slot_ ? slot_.data() : buffer_;
+        }
+    }
+
+
+    /**
+     * Assemble packets directly in buffers from @p pool (nullptr for none),
+     * so that handlers taking a PacketHandle can keep them without copying.
+     * Any partly decoded packet is discarded.
+    */
+    void set_pool(mobilinkd::PacketPool *pool)
+    {
+        slot_.reset();
+        packet = buffer_;
+        pool_ = pool;
+        reset();
+    }
+
+
+    /**
+     * Hand over the completed packet in a pool buffer. If it was assembled
+     * in buffer_ (no pool buffer was free when it started), it is copied to
+     * a pool buffer if one is free now.
+     *
+     * @return the packet, or an empty handle if no pool buffer was free.
+    */
+    mobilinkd::PacketHandle take_packet(unsigned int length)
+    {
+        mobilinkd::PacketHandle result;
+        if (slot_ && packet == slot_.data())
+        {
+            result = std::move(slot_);
+            packet = buffer_;
+        }
+        else if (pool_)
+        {
+            result = pool_->acquire();
+            if (result) std::memcpy(result.data(), packet, length);
+        }
+        if (result) result.resize(length);
+        return result;
     }
 
 
@@ -51,7 +124,7 @@ struct OPVCobsDecoder
         }
         else
         {
-            std::cerr << "Discarding " << packet_length << " byte packet: no callback registered" << std::endl;
+            OPV_LOG_WARN("Discarding {} byte packet: no callback registered", packet_length);
         }
 
     }
@@ -85,92 +158,181 @@ struct OPVCobsDecoder
      *      http://www.stuartcheshire.org/papers/cobsforton.pdf
      *      by Stuart Cheshire and Mary Baker.
     */
-    void process_cobs_data(const uint8_t *cobs_data, int buffer_length)
+    template <OPVPacketHandler Handler>
+    void process_cobs_data(const uint8_t *cobs_data, int buffer_length, Handler&& handler)
     {
-        for (int index = 0; index < buffer_length; index++)
-        {
-            uint8_t byte = cobs_data[index];
+        const uint8_t *next = cobs_data;
+        const uint8_t *end = cobs_data + std::max(buffer_length, 0);
 
+        while (next != end)
+        {
+            // Bulk paths. Each consumes exactly the bytes that process_byte
+            // would consume without doing anything but the same bookkeeping,
+            // and stops short of any byte that needs the full state machine:
+            // a zero, the last byte of a chunk, or the byte that would make
+            // the packet too long.
             if (state_ == State::PACKET_TOO_LONG)
             {
-                if (byte == 0)  // Finally, the too-long packet has ended!
-                {
-                    std::cerr << "Discarded a too-long packet." << std::endl;
-                    reset();
-                }
-                else
-                {
-                // skip over non-zero bytes that would make the too-long packet even longer
-                }
+                // Skip the rest of the too-long packet, up to its terminating zero.
+                next = find_zero(next, end - next);
+                if (next == end) break;
+            }
+            else if (remaining_count > 1)
+            {
+                // Copy the data bytes of the current chunk.
+                size_t count = std::min<size_t>({size_t(remaining_count - 1), size_t(end - next),
+                    size_t(mobilinkd::ip_mtu + 1 - decoded_count)});
+                count = find_zero(next, count) - next;
+                std::memcpy(packet + decoded_count, next, count);
+                decoded_count += count;
+                remaining_count -= count;
+                next += count;
+                if (next == end) break;
+            }
+            else if (remaining_count == 0 && decoded_count == 0)
+            {
+                // Zero filler between packets.
+                while (next != end && *next == 0) ++next;
+                if (next == end) break;
+            }
+
+            process_byte(*next++, handler);
+        }
+    }
 
+
+    /**
+     * The COBS state machine, one byte at a time.
+    */
+    template <typename Handler>
+    void process_byte(uint8_t byte, Handler& handler)
+    {
+
+        if (state_ == State::PACKET_TOO_LONG)
+        {
+            if (byte == 0)  // Finally, the too-long packet has ended!
+            {
+                OPV_LOG_WARN("Discarded a too-long packet.");
+                reset();
+            }
+            else
+            {
+            // skip over non-zero bytes that would make the too-long packet even longer
+            }
+
+        }
+        else if (byte == 0)
+        {
+            if (remaining_count > 0)    // unexpected zero byte within a chunk
+            {
+                OPV_LOG_WARN("Unexpected 0 in COBS data");
+                reset();
             }
-            else if (byte == 0)
+            else if (decoded_count > 0) // we have a packet, and here's the end of it
             {
-                if (remaining_count > 0)    // unexpected zero byte within a chunk
+                if (packet[decoded_count-1] == 0)   // check for extra "virtual zero" at the end
                 {
-                    std::cerr << "Unexpected 0 in COBS data" << std::endl;
-                    reset();
+                    decoded_count--;    // trim it off
                 }
-                else if (decoded_count > 0) // we have a packet, and here's the end of it
+
+                if (decoded_count >= minimum_packet_length && decoded_count <= mobilinkd::ip_mtu)
                 {
-                    if (packet[decoded_count-1] == 0)   // check for extra "virtual zero" at the end
+                    if constexpr (std::is_invocable_v<Handler&, mobilinkd::PacketHandle>)
                     {
-                        decoded_count--;    // trim it off
+                        if (auto handle = take_packet(decoded_count))
+                        {
+                            handler(std::move(handle));
+                        }
+                        else
+                        {
+                            OPV_LOG_WARN("Packet pool exhausted, discarding {} byte packet", decoded_count);
+                        }
                     }
-
-                    if (decoded_count >= minimum_packet_length && decoded_count <= mobilinkd::ip_mtu)
+                    else
                     {
-                        submit_decoded_packet(packet, decoded_count);
+                        handler(packet, decoded_count);
                     }
-                    reset();    // ready for the next packet
-                }
-                else
-                {
-                    // if we got a 0 byte when expecting a new packet, that's just
-                    // filler between packets. Do nothing.
                 }
+                reset();    // ready for the next packet
             }
-            else if (remaining_count > 0)   // This is a data byte within a chunk
+            else
             {
-                packet[decoded_count++] = byte;
-                remaining_count--;
-                if (remaining_count == 0)
+                // if we got a 0 byte when expecting a new packet, that's just
+                // filler between packets. Do nothing.
+            }
+        }
+        else if (remaining_count > 0)   // This is a data byte within a chunk
+        {
+            packet[decoded_count++] = byte;
+            remaining_count--;
+            if (remaining_count == 0)
+            {
+                if (state_ != State::CASE255)
                 {
-                    if (state_ != State::CASE255)
-                    {
-                        packet[decoded_count++] = 0;    // insert implied 0 at end of chunk
-                    }
-                    state_ = State::CHUNK;
+                    packet[decoded_count++] = 0;    // insert implied 0 at end of chunk
                 }
+                state_ = State::CHUNK;
             }
-            else if (byte == 0xff)  // this is a new chunk count, in the special case
+        }
+        else if (byte == 0xff)  // this is a new chunk count, in the special case
+        {
+            remaining_count = 254;
+            state_ = State::CASE255;
+        }
+        else    // this is a new chunk count, common cases
+        {
+            remaining_count = byte - 1;
+            if (byte == 0x01)
+            {
+                packet[decoded_count++] = 0;
+                state_ = State::RESET;
+            }
+            else if (byte == 0xFF)
             {
-                remaining_count = 254;
                 state_ = State::CASE255;
             }
-            else    // this is a new chunk count, common cases
+            else
             {
-                remaining_count = byte - 1;
-                if (byte == 0x01)
-                {
-                    packet[decoded_count++] = 0;
-                    state_ = State::RESET;
-                }
-                else if (byte == 0xFF)
-                {
-                    state_ = State::CASE255;
-                }
-                else
-                {
-                    state_ = State::CHUNK;
-                }
+                state_ = State::CHUNK;
             }
+        }
 
-            if (decoded_count > mobilinkd::ip_mtu+1)    // packet length exceeds MTU (with possible extra virtual 0); discard additional bytes
+        if (decoded_count > mobilinkd::ip_mtu+1)    // packet length exceeds MTU (with possible extra virtual 0); discard additional bytes
+        {
+            state_ = State::PACKET_TOO_LONG;
+        }
+    }
+
+
+    /**
+     * Find the first zero byte in [data, data + length), or data + length
+     * if there is none. Chunks are at most 254 bytes, so this is inline
+     * rather than a call to memchr.
+    */
+    static const uint8_t *find_zero(const uint8_t *data, size_t length)
+    {
+        const uint8_t *end = data + length;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        for (; end - data >= 16; data += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+            if (mask) return data + __builtin_ctz(mask);
+        }
+#elif defined(__ARM_NEON)
+        for (; end - data >= 16; data += 16)
+        {
+            uint8x16_t zeros = vceqzq_u8(vld1q_u8(data));
+            if (vmaxvq_u8(zeros))
             {
-                state_ = State::PACKET_TOO_LONG;
+                while (*data) ++data;
+                return data;
             }
-        }    
+        }
+#endif
+        while (data != end && *data) ++data;
+        return data;
     }
 
 
@@ -183,6 +345,16 @@ struct OPVCobsDecoder
    }
 
 
+    /**
+     * Process COBS data, passing decoded packets to the registered callback.
+    */
+    void process_cobs_data(const uint8_t *cobs_data, int buffer_length)
+    {
+        process_cobs_data(cobs_data, buffer_length,
+            [this](const uint8_t *packet, unsigned int length) { submit_decoded_packet(packet, length); });
+    }
+
+
     /**
      * Receive a sequence of bytes (generally a received frame payload)
      * to be decoded according to OPV COBS rules, and process it.
@@ -194,4 +366,14 @@ struct OPVCobsDecoder
 
         process_cobs_data(buffer, buffer_length);
     }
+
+    /**
+     * As above, passing each decoded packet to @p handler instead of the
+     * registered callback.
+     */
+    template <OPVPacketHandler Handler>
+    void operator()(const uint8_t * buffer, size_t buffer_length, Handler&& handler)
+    {
+        process_cobs_data(buffer, buffer_length, handler);
+    }
 };
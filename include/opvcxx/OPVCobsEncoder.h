@@ -0,0 +1,65 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Header-only COBS encoder, producing the same output as cobs_encode()
+ * in apps/cobs.c, so that library code can COBS-encode without linking
+ * the C implementation.
+ *
+ * See: "Consistent Overhead Byte Stuffing"
+ *      http://www.stuartcheshire.org/papers/cobsforton.pdf
+ *      by Stuart Cheshire and Mary Baker.
+ */
+struct OPVCobsEncoder
+{
+    /**
+     * Worst-case encoded length of a packet of @p length bytes, not
+     * including the zero separator.
+     */
+    static constexpr size_t max_encoded_size(size_t length)
+    {
+        return length + (length + 253) / 254 + (length == 0);
+    }
+
+    /**
+     * COBS-encode @p length bytes from @p src into @p dst, which must have
+     * room for max_encoded_size(length) bytes. No zero separator is added.
+     *
+     * @return the number of bytes written.
+     */
+    static size_t encode(const uint8_t* src, size_t length, uint8_t* dst)
+    {
+        uint8_t* code_ptr = dst;
+        uint8_t* out = dst + 1;
+        uint8_t code = 1;
+
+        for (size_t i = 0; i != length; ++i)
+        {
+            uint8_t byte = src[i];
+            if (byte == 0)
+            {
+                *code_ptr = code;
+                code_ptr = out++;
+                code = 1;
+            }
+            else
+            {
+                *out++ = byte;
+                code++;
+                if (code == 0xFF && i + 1 != length)  // full chunk with more to come
+                {
+                    *code_ptr = code;
+                    code_ptr = out++;
+                    code = 1;
+                }
+            }
+        }
+        *code_ptr = code;
+
+        return out - dst;
+    }
+};
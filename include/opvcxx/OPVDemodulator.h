@@ -3,137 +3,123 @@
 
 #pragma once
 
-#include "ClockRecovery.h"
 #include "Correlator.h"
 #include "DataCarrierDetect.h"
+#include "FftFilter.h"
 #include "FirFilter.h"
 #include "FreqDevEstimator.h"
+#include "Instrumentation.h"
+#include "LlrCapture.h"
+#include "Log.h"
 #include "OPVCobsDecoder.h"
 #include "OPVFrameDecoder.h"
 #include "OPVFramer.h"
 #include "Util.h"
 #include "Numerology.h"
+#include "RRCTaps.h"
+#include "SymbolTiming.h"
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <span>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 extern OPVCobsDecoder cobs_decoder;
 
 namespace mobilinkd {
 
-namespace detail
-{
-
+/**
+ * Demodulator state reported to the diagnostic handler, a few times per
+ * frame time.
+ */
 template <typename FloatType>
-struct Taps
-{};
-
-template <>
-struct Taps<double>
+struct OPVDiagnostics
 {
-	static constexpr auto rrc_taps = std::array<double, 150>{
-		0.0029364388513841593, 0.0031468394550958484, 0.002699564567597445, 0.001661182944400927,
-		0.00023319405581230247, -0.0012851320781224025, -0.0025577136087664687, -0.0032843366522956313,
-		-0.0032697038088887226, -0.0024733964729590865, -0.0010285696910973807, 0.0007766690889758685,
-		0.002553421969211845, 0.0038920145144327816, 0.004451886520053017, 0.00404219185231544,
-		0.002674727068399207, 0.0005756567993179152, -0.0018493784971116507, -0.004092346891623224,
-		-0.005648131453822014, -0.006126925416243605, -0.005349511529163396, -0.003403189203405097,
-		-0.0006430502751187517, 0.002365929161655135, 0.004957956568090113, 0.006506845894531803,
-		0.006569574194782443, 0.0050017573119839134, 0.002017321931508163, -0.0018256054303579805,
-		-0.00571615173291049, -0.008746639552588416, -0.010105075751866371, -0.009265784007800534,
-		-0.006136551625729697, -0.001125978562075172, 0.004891777252042491, 0.01071805138282269,
-		0.01505751553351295, 0.01679337935001369, 0.015256245142156299, 0.01042830577908502,
-		0.003031522725559901, -0.0055333532968188165, -0.013403099825723372, -0.018598682349642525,
-		-0.01944761739590459, -0.015005271935951746, -0.0053887880354343935, 0.008056525910253532,
-		0.022816244158307273, 0.035513467692208076, 0.04244131815783876, 0.04025481153629372,
-		0.02671818654865632, 0.0013810216516704976, -0.03394615682795165, -0.07502635967975885,
-		-0.11540977897637611, -0.14703962203941534, -0.16119995609538576, -0.14969512896336504,
-		-0.10610329539459686, -0.026921412469634916, 0.08757875030779196, 0.23293327870303457,
-		0.4006012210123992, 0.5786324696325503, 0.7528286479934068, 0.908262741447522,
-		1.0309661131633199, 1.1095611856548013, 1.1366197723675815, 1.1095611856548013,
-		1.0309661131633199, 0.908262741447522, 0.7528286479934068, 0.5786324696325503,
-		0.4006012210123992, 0.23293327870303457, 0.08757875030779196, -0.026921412469634916,
-		-0.10610329539459686, -0.14969512896336504, -0.16119995609538576, -0.14703962203941534,
-		-0.11540977897637611, -0.07502635967975885, -0.03394615682795165, 0.0013810216516704976,
-		0.02671818654865632, 0.04025481153629372, 0.04244131815783876, 0.035513467692208076,
-		0.022816244158307273, 0.008056525910253532, -0.0053887880354343935, -0.015005271935951746,
-		-0.01944761739590459, -0.018598682349642525, -0.013403099825723372, -0.0055333532968188165,
-		0.003031522725559901, 0.01042830577908502, 0.015256245142156299, 0.01679337935001369,
-		0.01505751553351295, 0.01071805138282269, 0.004891777252042491, -0.001125978562075172,
-		-0.006136551625729697, -0.009265784007800534, -0.010105075751866371, -0.008746639552588416,
-		-0.00571615173291049, -0.0018256054303579805, 0.002017321931508163, 0.0050017573119839134,
-		0.006569574194782443, 0.006506845894531803, 0.004957956568090113, 0.002365929161655135,
-		-0.0006430502751187517, -0.003403189203405097, -0.005349511529163396, -0.006126925416243605,
-		-0.005648131453822014, -0.004092346891623224, -0.0018493784971116507, 0.0005756567993179152,
-		0.002674727068399207, 0.00404219185231544, 0.004451886520053017, 0.0038920145144327816,
-		0.002553421969211845, 0.0007766690889758685, -0.0010285696910973807, -0.0024733964729590865,
-		-0.0032697038088887226, -0.0032843366522956313, -0.0025577136087664687, -0.0012851320781224025,
-		0.00023319405581230247, 0.001661182944400927, 0.002699564567597445, 0.0031468394550958484,
-		0.0029364388513841593, 0.0
-	};
+	bool dcd;
+	FloatType evm;			// error vector magnitude, as a fraction
+	FloatType deviation;
+	FloatType offset;		// frequency offset
+	bool locked;
+	FloatType clock;		// symbol timing loop's transmitter clock estimate
+	int sample_index;		// sample nearest the symbol strobes, within a symbol
+	int sync_index;			// of the latest sync word
+	int clock_index;		// symbol strobe phase in tenths of a sample
+	int viterbi_cost;		// of the last frame
 };
 
-template <>
-struct Taps<float>
+/**
+ * Diagnostic handler that ignores diagnostics.  Since the handler is called
+ * directly, nothing is gathered for it.
+ */
+struct NoDiagnostics
 {
-	static constexpr auto rrc_taps = std::array<float, 150>{
-		0.0029364388513841593, 0.0031468394550958484, 0.002699564567597445, 0.001661182944400927,
-		0.00023319405581230247, -0.0012851320781224025, -0.0025577136087664687, -0.0032843366522956313,
-		-0.0032697038088887226, -0.0024733964729590865, -0.0010285696910973807, 0.0007766690889758685,
-		0.002553421969211845, 0.0038920145144327816, 0.004451886520053017, 0.00404219185231544,
-		0.002674727068399207, 0.0005756567993179152, -0.0018493784971116507, -0.004092346891623224,
-		-0.005648131453822014, -0.006126925416243605, -0.005349511529163396, -0.003403189203405097,
-		-0.0006430502751187517, 0.002365929161655135, 0.004957956568090113, 0.006506845894531803,
-		0.006569574194782443, 0.0050017573119839134, 0.002017321931508163, -0.0018256054303579805,
-		-0.00571615173291049, -0.008746639552588416, -0.010105075751866371, -0.009265784007800534,
-		-0.006136551625729697, -0.001125978562075172, 0.004891777252042491, 0.01071805138282269,
-		0.01505751553351295, 0.01679337935001369, 0.015256245142156299, 0.01042830577908502,
-		0.003031522725559901, -0.0055333532968188165, -0.013403099825723372, -0.018598682349642525,
-		-0.01944761739590459, -0.015005271935951746, -0.0053887880354343935, 0.008056525910253532,
-		0.022816244158307273, 0.035513467692208076, 0.04244131815783876, 0.04025481153629372,
-		0.02671818654865632, 0.0013810216516704976, -0.03394615682795165, -0.07502635967975885,
-		-0.11540977897637611, -0.14703962203941534, -0.16119995609538576, -0.14969512896336504,
-		-0.10610329539459686, -0.026921412469634916, 0.08757875030779196, 0.23293327870303457,
-		0.4006012210123992, 0.5786324696325503, 0.7528286479934068, 0.908262741447522,
-		1.0309661131633199, 1.1095611856548013, 1.1366197723675815, 1.1095611856548013,
-		1.0309661131633199, 0.908262741447522, 0.7528286479934068, 0.5786324696325503,
-		0.4006012210123992, 0.23293327870303457, 0.08757875030779196, -0.026921412469634916,
-		-0.10610329539459686, -0.14969512896336504, -0.16119995609538576, -0.14703962203941534,
-		-0.11540977897637611, -0.07502635967975885, -0.03394615682795165, 0.0013810216516704976,
-		0.02671818654865632, 0.04025481153629372, 0.04244131815783876, 0.035513467692208076,
-		0.022816244158307273, 0.008056525910253532, -0.0053887880354343935, -0.015005271935951746,
-		-0.01944761739590459, -0.018598682349642525, -0.013403099825723372, -0.0055333532968188165,
-		0.003031522725559901, 0.01042830577908502, 0.015256245142156299, 0.01679337935001369,
-		0.01505751553351295, 0.01071805138282269, 0.004891777252042491, -0.001125978562075172,
-		-0.006136551625729697, -0.009265784007800534, -0.010105075751866371, -0.008746639552588416,
-		-0.00571615173291049, -0.0018256054303579805, 0.002017321931508163, 0.0050017573119839134,
-		0.006569574194782443, 0.006506845894531803, 0.004957956568090113, 0.002365929161655135,
-		-0.0006430502751187517, -0.003403189203405097, -0.005349511529163396, -0.006126925416243605,
-		-0.005648131453822014, -0.004092346891623224, -0.0018493784971116507, 0.0005756567993179152,
-		0.002674727068399207, 0.00404219185231544, 0.004451886520053017, 0.0038920145144327816,
-		0.002553421969211845, 0.0007766690889758685, -0.0010285696910973807, -0.0024733964729590865,
-		-0.0032697038088887226, -0.0032843366522956313, -0.0025577136087664687, -0.0012851320781224025,
-		0.00023319405581230247, 0.001661182944400927, 0.002699564567597445, 0.0031468394550958484,
-		0.0029364388513841593, 0.0
-	};
+	template <typename FloatType>
+	void operator()(const OPVDiagnostics<FloatType>&) {}
 };
 
-} // detail
-
-template <typename FloatType>
+/**
+ * OPV demodulator: baseband samples in, decoded frames out.
+ *
+ * Frames go to a FrameHandler and diagnostics to a DiagnosticHandler.
+ * Both are called directly, so a lambda or function object type given as
+ * the template argument is inlined into the receive chain.  The defaults
+ * are std::function adapters, for callers that set the handlers at run
+ * time.
+ *
+ * The baseband input is at SamplesPerSymbol samples per symbol (2, 4, 5 or
+ * 10), which sets the matched filter, correlator and timing loop rates. The
+ * default is the transmitter's rate; a receiver that resamples to fewer
+ * samples per symbol does proportionally less work per symbol.
+ */
+template <typename FloatType,
+	OPVFrameHandler FrameHandler = OPVFrameDecoder::callback_t,
+	typename DiagnosticHandler = std::function<void(const OPVDiagnostics<FloatType>&)>,
+	size_t SamplesPerSymbol = default_samples_per_symbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
 struct OPVDemodulator
 {
 
+	static_assert(SamplesPerSymbol == 2 || SamplesPerSymbol == 4 || SamplesPerSymbol == 5 || SamplesPerSymbol == 10,
+		"unsupported samples per symbol");
+
+	using profile_t = Oversampling<SamplesPerSymbol>;
+
+	static constexpr size_t SAMPLES_PER_SYMBOL = SamplesPerSymbol;
 	static constexpr uint8_t MAX_MISSING_SYNC = 8;
 	static constexpr FloatType CORRELATION_NEAR_ZERO = 0.1;		// just to avoid a floating point compare to 0.0
-
-	using correlator_t = Correlator<FloatType>;
+	static constexpr FloatType RELOCK_MARGIN = 1.1;		// how much stronger a sync word must be to replace an unconfirmed one
+
+	// Samples after the strobe for a frame's last symbol in which a detection
+	// of the next STREAM sync word is accepted: from the start of the sync
+	// word's last symbol to 0.7 symbols past its end (70 to 87 at 10 samples
+	// per symbol), less the strobes' lag behind the input beyond the two
+	// samples these were tuned with.
+	static constexpr int SYNC_WINDOW_START = (Correlator<FloatType, SamplesPerSymbol>::SYMBOLS - 1) * SamplesPerSymbol
+		+ 2 - SymbolTiming<FloatType, SamplesPerSymbol>::DELAY;
+	static constexpr int SYNC_WINDOW_END = Correlator<FloatType, SamplesPerSymbol>::SYMBOLS * SamplesPerSymbol
+		+ SamplesPerSymbol * 7 / 10 + 2 - SymbolTiming<FloatType, SamplesPerSymbol>::DELAY;
+
+	// Largest disagreement, in samples, between the timing loop and a sync
+	// word that is left for the loop to track: 0.15 symbols, but at least
+	// the correlator's resolution of half a sample and a little more.
+	static constexpr FloatType MAX_TIMING_SLIP = std::max(FloatType(0.15) * SamplesPerSymbol, FloatType(0.75));
+
+	// DCD updates, in samples: five per frame time while unlocked, two when locked.
+	static constexpr size_t DCD_INTERVAL_UNLOCKED = profile_t::samples_per_frame / 5;
+	static constexpr size_t DCD_INTERVAL_LOCKED = profile_t::samples_per_frame / 2;
+
+	using correlator_t = Correlator<FloatType, SamplesPerSymbol>;
 	using sync_word_t = SyncWord<correlator_t>;
 	using callback_t = OPVFrameDecoder::callback_t;
+	using diagnostics_t = OPVDiagnostics<FloatType>;
 	using diagnostic_callback_t = std::function<void(bool, FloatType, FloatType, FloatType, bool, FloatType, int, int, int, int)>;
+	using capture_callback_t = std::function<void(const LlrRecord&)>;
 
 	// In the UNLOCKED state we are expecting to lock onto symbol timing and find a preamble.
 	// In the FIRST_SYNC state we are expecting to find a STREAM syncword, but we don't know when.
@@ -151,14 +137,20 @@ struct OPVDemodulator
 	// ...
 	enum class DemodState { UNLOCKED, FIRST_SYNC, STREAM_SYNC, FRAME };
 
-	BaseFirFilter<FloatType, detail::Taps<FloatType>::rrc_taps.size()> demod_filter{detail::Taps<FloatType>::rrc_taps};
-	DataCarrierDetect<FloatType, sample_rate, 500> dcd{13500, 21500, 1.0, 4.0};	//!!! may need to revise these values
+	using taps_t = detail::Taps<FloatType, SamplesPerSymbol>;
+
+	// Samples that prime the matched filter and fill the correlator on
+	// startup, before anything is looked for.
+	static constexpr size_t PRIME_SAMPLES = taps_t::rrc_taps.size() + correlator_t::SYMBOLS * SamplesPerSymbol;
+
+	BaseFirFilter<FloatType, taps_t::rrc_taps.size()> demod_filter{taps_t::rrc_taps};
+	DataCarrierDetect<FloatType, profile_t::sample_rate, 500> dcd{13500, 21500, 1.0, 4.0};	//!!! may need to revise these values
 	//!!! I think this is half the sample rate, rounded off to 500 Hz bins,
 	//!!! and 1.6 times that, again rounded off to 500 Hz bins. The first frequency
 	//!!! should respond strongly if there's anything modulated at the symbol rate,
 	//!!! especially so if it's the preamble (alternating +3 and -3).
 	
-	ClockRecovery<FloatType, sample_rate, symbol_rate> clock_recovery;
+	SymbolTiming<FloatType, SamplesPerSymbol> timing;
 
 	correlator_t correlator;
 	sync_word_t preamble_sync{{+3,-3,+3,-3,+3,-3,+3,-3}, 29.f};		// accept only positive correlation
@@ -167,6 +159,9 @@ struct OPVDemodulator
 	FreqDevEstimator<FloatType> dev;
 	FloatType idev;
 	size_t count_ = 0;
+	uint64_t sample_count_ = 0;	// input samples, since construction
+	int16_t initializing_ = PRIME_SAMPLES;	// samples left to pump through before looking for sync words
+	bool initialized_ = false; //!!! debug
 
 	int8_t polarity = 1;
 	OPVFramer<stream_type4_size> framer;
@@ -175,30 +170,42 @@ struct OPVDemodulator
 	uint8_t sample_index = 0;
 
 	bool dcd_ = false;
-	bool need_clock_reset_ = false;
-	bool need_clock_update_ = false;
+	FloatType last_filtered_ = 0;	// the latest matched filter output computed
+	uint8_t skip_strobes_ = 0;	// strobes still to come for sync word symbols
+	OPVSyncType frame_sync_ = OPVSyncType::FIRST;	// how the current frame's sync word was found
+	bool confirmed_ = false;	// a frame header has decoded since the first sync word
+	FloatType lock_peak_ = 0;	// correlation of the first sync word, while not confirmed
 
 	bool passall_ = false;
 	size_t viterbi_cost = 0;
 	int sync_count = 0;
 	int missing_sync_count = 0;
+	uint8_t cost_count = 0;		// consecutive high Viterbi cost frames, weighted
 	uint8_t sync_sample_index = 0;
-	diagnostic_callback_t diagnostic_callback;
-
-	OPVDemodulator(callback_t callback)
-	: decoder(callback)
+	FrameHandler frame_handler;
+	DiagnosticHandler diagnostic_handler;
+	OPVCobsDecoder* cobs_ = &cobs_decoder;	// reset at each stream sync
+	capture_callback_t capture_;	// given each frame's soft bits, if set
+	Instrumentation instrumentation;
+
+	OPVDemodulator(FrameHandler handler, DiagnosticHandler diagnostics = DiagnosticHandler())
+	: frame_handler(std::move(handler)), diagnostic_handler(std::move(diagnostics))
 	{}
 
 	virtual ~OPVDemodulator() {}
 
 	void dcd_on();
 	void dcd_off();
-	void initialize(const FloatType input);
+	void initialize(const FloatType input, const FloatType* filtered);
 	void update_dcd();
 	void do_unlocked();
 	void do_first_sync();
 	void do_stream_sync();
-	void do_frame(FloatType filtered_sample);
+	void do_frame(FloatType symbol);
+	void lock_stream_sync(uint8_t sync_index);
+	bool recheck_sync();
+	void start_timing(uint8_t sync_index, size_t age);
+	void align_timing(size_t age);
 
 	bool locked() const
 	{
@@ -211,26 +218,146 @@ struct OPVDemodulator
 		// decoder.passall(enabled);
 	}
 
+	void diagnostics(DiagnosticHandler handler)
+	{
+		diagnostic_handler = std::move(handler);
+	}
+
+	/// Adapter for the original diagnostic callback, with one argument per field.
 	void diagnostics(diagnostic_callback_t callback)
+	requires std::is_same_v<DiagnosticHandler, std::function<void(const diagnostics_t&)>>
 	{
-		diagnostic_callback = callback;
+		if (!callback)
+		{
+			diagnostic_handler = nullptr;
+			return;
+		}
+		diagnostic_handler = [callback](const diagnostics_t& d)
+		{
+			callback(d.dcd, d.evm, d.deviation, d.offset, d.locked, d.clock,
+				d.sample_index, d.sync_index, d.clock_index, d.viterbi_cost);
+		};
+	}
+
+	void report_diagnostics();
+
+	/// Where in the symbol the timing loop strobes, in tenths of a sample.
+	int clock_phase() const
+	{
+		constexpr FloatType SPS = SAMPLES_PER_SYMBOL;
+		FloatType position = std::fmod(FloatType(correlator.index()) - timing.since_strobe(), SPS);
+		if (position < 0) position += SPS;
+		return int(position * 10);
+	}
+
+	/// Select the COBS decoder to reset on stream sync (nullptr for none).
+	void cobs(OPVCobsDecoder* decoder)
+	{
+		cobs_ = decoder;
+	}
+
+	/**
+	 * Give each received frame's soft bits and the demodulator state to
+	 * @p handler, before it is decoded (nullptr for none).  For an LLR
+	 * capture file, to rerun the frame decoder without the front end.
+	 */
+	void capture(capture_callback_t handler)
+	{
+		capture_ = std::move(handler);
 	}
 
 	void update_values(uint8_t index);
 
-	void operator()(const FloatType input);
+	/**
+	 * Per-stage timing and event counters.  All zero unless built with
+	 * OPV_INSTRUMENTATION.
+	 */
+	const Instrumentation& stats() const;
+
+	void operator()(const FloatType input)
+	{
+		step(input, nullptr);
+	}
+
+	/**
+	 * Run the matched filter over a block of input, by fast convolution,
+	 * ahead of demodulating it: each input sample then goes to
+	 * operator()(input, filtered) with its output, in order, before the
+	 * next block is filtered. This costs far less than filtering a sample
+	 * at a time for blocks of a few thousand samples, as when reading a
+	 * recording, and matches it to within float rounding.
+	 */
+	void filter_block(std::span<const FloatType> input, std::span<FloatType> output)
+	{
+		if (!fft_filter_) fft_filter_ = std::make_unique<fft_filter_t>(taps_t::rrc_taps);
+		std::array<FloatType, taps_t::rrc_taps.size() - 1> history;
+		demod_filter.history(history.data());
+
+		ScopedStageTimer timer(instrumentation, Stage::FILTER);
+		(*fft_filter_)(history.data(), input.data(), std::min(input.size(), output.size()), output.data());
+	}
+
+	/// Demodulate a sample whose matched filter output was computed by filter_block().
+	void operator()(const FloatType input, const FloatType filtered)
+	{
+		step(input, &filtered);
+	}
+
+private:
+	using fft_filter_t = FftFilter<FloatType, taps_t::rrc_taps.size()>;
+
+	std::unique_ptr<fft_filter_t> fft_filter_;	// made on first use
+
+	void step(const FloatType input, const FloatType* filtered);
 };
 
-template <typename FloatType>
-void OPVDemodulator<FloatType>::update_values(uint8_t index)
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::update_values(uint8_t index)
 {
 	correlator.apply([this,index](FloatType t){dev.sample(t);}, index);
 	dev.update();
 	sync_sample_index = index;
 }
 
-template <typename FloatType>
-void OPVDemodulator<FloatType>::dcd_on()
+// Start the symbol timing loop from a sync word whose last symbol peaked
+// at sync_index, age samples ago, with the next strobe on the symbol after it.
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::start_timing(uint8_t sync_index, size_t age)
+{
+	timing.reset(FloatType(SAMPLES_PER_SYMBOL) - FloatType(age), true);
+	skip_strobes_ = 0;
+	sample_index = sync_index;
+}
+
+// Check the symbol timing loop against a sync word whose last symbol peaked
+// age samples ago. The loop normally agrees to within a sample and is left
+// to track; the next strobe taken must still be the symbol after the sync
+// word, and the strobes for the sync word's last symbols may not have come
+// out yet (the interpolator lags the input by a few samples, which at low
+// oversampling can be more than a symbol). If the loop has slipped, it is
+// restarted from the sync word.
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::align_timing(size_t age)
+{
+	constexpr FloatType SPS = SAMPLES_PER_SYMBOL;
+	FloatType lead = timing.since_strobe() - age;	// from the latest strobe to the peak
+	FloatType phase = lead - SPS * std::round(lead / SPS);
+	if (std::abs(phase) > MAX_TIMING_SLIP)
+	{
+		OPV_LOG_DEBUG("Symbol timing off by {} samples at sample {}; restarting", phase, debug_sample_count);
+		timing.reset(SPS - FloatType(age));
+		skip_strobes_ = 0;
+		return;
+	}
+	skip_strobes_ = uint8_t(std::max(FloatType(0), std::round(lead / SPS)));
+}
+
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::dcd_on()
 {
 	// Data carrier newly detected.
 	dcd_ = true;
@@ -240,32 +367,55 @@ void OPVDemodulator<FloatType>::dcd_on()
 	dev.reset();
 	framer.reset();
 	decoder.reset();
+
+	// The correlator was not fed while there was no carrier; fill it with
+	// fresh samples before looking for sync words.
+	initializing_ = correlator_t::SYMBOLS * SAMPLES_PER_SYMBOL;
 }
 
-template <typename FloatType>
-void OPVDemodulator<FloatType>::dcd_off()
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::dcd_off()
 {
 	// Just lost data carrier.
 	dcd_ = false;
 	demodState = DemodState::UNLOCKED;
-	std::cerr << "DCD lost at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl;	//!!! debug
+	instrumentation.count([](auto& c){ c.dcd_losses++; });
+	OPV_LOG_INFO("DCD lost at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
 }
 
-template <typename FloatType>
-void OPVDemodulator<FloatType>::initialize(const FloatType input)
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::initialize(const FloatType input, const FloatType* filtered)
 {
-	auto filtered_sample = demod_filter(input);
+	FloatType filtered_sample;
+	if (filtered)
+	{
+		demod_filter.skip(input);
+		filtered_sample = *filtered;
+	}
+	else
+	{
+		filtered_sample = demod_filter(input);
+	}
 	correlator.sample(filtered_sample);
 }
 
-template <typename FloatType>
-void OPVDemodulator<FloatType>::update_dcd()
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+const Instrumentation& OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::stats() const
+{
+	return instrumentation;
+}
+
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::update_dcd()
 {
 	if (!dcd_ && dcd.dcd())
 	{
 		// fputs("\nAOS\n", stderr);
 		dcd_on();
-		need_clock_reset_ = true;
 	}
 	else if (dcd_ && !dcd.dcd())
 	{
@@ -274,46 +424,72 @@ void OPVDemodulator<FloatType>::update_dcd()
 	}
 }
 
-template <typename FloatType>
-void OPVDemodulator<FloatType>::do_unlocked()
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::do_unlocked()
 {
-	// We expect to find the preamble immediately after DCD.
-	if (missing_sync_count < samples_per_frame)
+	// Look for the preamble and the STREAM sync word together: at the start
+	// of a transmission the preamble comes first, and when joining in the
+	// middle the next STREAM sync word gives frame timing straight away.
+	auto preamble_index = preamble_sync(correlator);
+	if (preamble_sync.updated())
 	{
-		missing_sync_count += 1;
-		auto sync_index = preamble_sync(correlator);
-		auto sync_updated = preamble_sync.updated();
-		if (sync_updated)
-		{
-			std::cerr << "Detected preamble at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl;	//!!! debug
-			sync_count = 0;
-			missing_sync_count = 0;
-			need_clock_reset_ = true;
-			dev.reset();
-			update_values(sync_index);
-			sample_index = sync_index;
-			demodState = DemodState::FIRST_SYNC;	// now looking for a stream sync word
-		}
-		return;
-	}
-
-	// We didn't find preamble; check for the STREAM syncword in case we're joining in the middle
-	auto sync_index = stream_sync(correlator);
-	auto sync_updated = stream_sync.updated();
-	if (sync_updated)
-	{
-		std::cerr << "Stream sync detected while unlocked at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl; //!!! debug
-
+		OPV_LOG_INFO("Detected preamble at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+		instrumentation.count([](auto& c){ c.preambles++; });
 		sync_count = 0;
 		missing_sync_count = 0;
-		need_clock_reset_ = true;
 		dev.reset();
-		update_values(sync_index);
-		sample_index = sync_index;
-		cobs_decoder.reset();
-		demodState = DemodState::FRAME;
+		update_values(preamble_index);
+		start_timing(preamble_index, preamble_sync.age());
+		demodState = DemodState::FIRST_SYNC;	// now looking for a stream sync word
 		return;
 	}
+
+	auto sync_index = stream_sync(correlator);
+	if (stream_sync.updated()) lock_stream_sync(sync_index);
+}
+
+// A STREAM sync word found by searching every sample gives both symbol and
+// frame timing. The lock is confirmed by the first frame's header.
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::lock_stream_sync(uint8_t sync_index)
+{
+	OPV_LOG_INFO("Stream sync detected while unlocked at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+	instrumentation.count([](auto& c){ c.syncs++; });
+
+	sync_count = 0;
+	missing_sync_count = 0;
+	cost_count = 0;
+	dev.reset();
+	update_values(sync_index);
+	start_timing(sync_index, stream_sync.age());
+	if (cobs_) cobs_->reset();
+	frame_sync_ = OPVSyncType::FIRST;
+	confirmed_ = false;
+	lock_peak_ = stream_sync.peak_;
+	demodState = DemodState::FRAME;
+}
+
+// Until the first frame's header confirms the lock, keep looking for STREAM
+// sync words. One clearly stronger than the sync word locked to means that
+// was a chance match in a frame's payload: start the frame again from it,
+// rather than lose the frame it begins.
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+bool OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::recheck_sync()
+{
+	auto sync_index = stream_sync(correlator);
+	if (!stream_sync.updated() || stream_sync.peak_ < lock_peak_ * RELOCK_MARGIN) return false;
+
+	OPV_LOG_INFO("Stronger stream sync at sample {} ({} frames); restarting the frame", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+	instrumentation.count([](auto& c){ c.syncs++; });
+	lock_peak_ = stream_sync.peak_;
+	dev.reset();
+	update_values(sync_index);
+	start_timing(sync_index, stream_sync.age());
+	framer.reset();
+	return true;
 }
 
 
@@ -323,11 +499,22 @@ void OPVDemodulator<FloatType>::do_unlocked()
 // aren't very common but are not especially unusual. Either way, we will keep
 // looking until we've matched the syncword (success), or until we've seen a frame worth of
 // symbols that match neither preamble nor the STREAM syncword (fail back to UNLOCKED).
-template <typename FloatType>
-void OPVDemodulator<FloatType>::do_first_sync()
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::do_first_sync()
 {
 	FloatType sync_triggered;	//!!! no need to initialize = 0.;
 
+	// The preamble may have been a chance match in a frame's payload, with
+	// the wrong symbol timing; so search every sample for the STREAM sync
+	// word too.
+	auto sync_index = stream_sync(correlator);
+	if (stream_sync.updated())
+	{
+		lock_stream_sync(sync_index);
+		return;
+	}
+
 	if (correlator.index() != sample_index) return;	// We already have symbol timing, we can skip non-peak samples.
 
 	// std::cerr << "FIRST sample " << debug_sample_count << std::endl;	//!!! debug
@@ -346,11 +533,16 @@ void OPVDemodulator<FloatType>::do_first_sync()
 	if (sync_triggered > CORRELATION_NEAR_ZERO)
 	{
 		// Found the STREAM syncword. Now we have frame timing and can process frames.
-		std::cerr << "Detected first STREAM sync word at sample " << debug_sample_count  << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl; //!!! debug
+		OPV_LOG_INFO("Detected first STREAM sync word at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+		instrumentation.count([](auto& c){ c.syncs++; });
 		missing_sync_count = 0;
-		need_clock_update_ = true;
+		cost_count = 0;
 		update_values(sample_index);
-		cobs_decoder.reset();
+		align_timing(0);	// this sample is the peak
+		if (cobs_) cobs_->reset();
+		frame_sync_ = OPVSyncType::FIRST;
+		confirmed_ = false;
+		lock_peak_ = sync_triggered;
 		demodState = DemodState::FRAME;
 	}
 	else
@@ -358,19 +550,18 @@ void OPVDemodulator<FloatType>::do_first_sync()
 		// Didn't find preamble or STREAM syncword; count these and check if we've had too many.
 		// Normally there should be only one frame of preamble, and a syncword every frame thereafter,
 		// so if we go a frame (or so) without seeing the syncword, we've failed.
-		// Even if we had accurate timing when we entered this state, timing may have drifted off, so
-		// we declare failure as soon as we can.
-		//!!! It might be better to keep a symbol timing tracking loop running all the time.
+		// The symbol timing loop keeps tracking meanwhile, but the preamble may have been a false hit.
 		if (++missing_sync_count > baseband_frame_symbols)
 		{
-			std::cerr << "FAILED to find first syncword by sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl;	//!! debug
+			OPV_LOG_WARN("FAILED to find first syncword by sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+			instrumentation.count([](auto& c){ c.sync_losses++; });
 			demodState = DemodState::UNLOCKED;
 			missing_sync_count = 0;
 		}
 		else
 		{
 			// We haven't found the syncword yet, but we're still looking.
-			// Just keep the deviation tracker fed. Timing doesn't change.
+			// Just keep the deviation tracker fed.
 			update_values(sample_index);
 		}
 	}
@@ -384,11 +575,13 @@ void OPVDemodulator<FloatType>::do_first_sync()
 // If we don't detect the STREAM sync word, that's OK for a while. We just go on
 // as if we had. But if that happens too many times, we assume that we've lost
 // synchronization with the signal.
+// The symbol timing loop keeps tracking through missed sync words, so
+// freewheeling keeps the symbol timing; only frame timing is assumed.
 //!!! It's possible we could do something smarter, maybe trust the Golay codes
-//!!! in the fheader to validate a longer freewheeling period. Or maybe it'd
-//!!! just be better to have a live symbol tracking loop.
-template <typename FloatType>
-void OPVDemodulator<FloatType>::do_stream_sync()
+//!!! in the fheader to validate a longer freewheeling period.
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::do_stream_sync()
 {
 	uint8_t sync_index = stream_sync(correlator);
 	int8_t sync_updated = stream_sync.updated();
@@ -396,28 +589,36 @@ void OPVDemodulator<FloatType>::do_stream_sync()
 	if (sync_updated)
 	{
 		missing_sync_count = 0;
-		if (sync_count > 70)	// sample 71 is the first that's nominally in the last symbol of the sync word
+		if (sync_count > SYNC_WINDOW_START)	// the first sample that's nominally in the last symbol of the sync word
 		{
-			std::cerr << "Detected STREAM sync word at sample " << debug_sample_count  << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl; //!!! debug
+			OPV_LOG_DEBUG("Detected STREAM sync word at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+			instrumentation.count([](auto& c){ c.syncs++; });
 			// std::cerr << ".";
 			update_values(sync_index);
+			align_timing(stream_sync.age());
+			frame_sync_ = OPVSyncType::STREAM;
 			demodState = DemodState::FRAME;
 		}
 		return;
 	}
-	else if (sync_count > 87)	// sample 87 is the latest we'll accept a sync word detection as matching
+	else if (sync_count > SYNC_WINDOW_END)	// the latest we'll accept a sync word detection as matching
 	{
-		update_values(sync_index);
+		// The sync word's last symbol has been strobed; the next strobe starts the frame.
+		update_values(sample_index);
+		skip_strobes_ = 0;
 		missing_sync_count += 1;
 		if (missing_sync_count < MAX_MISSING_SYNC)
 		{
-			std::cerr << "Faking a STREAM sync word " << missing_sync_count << " at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl; //!!! debug
+			OPV_LOG_INFO("Faking a STREAM sync word {} at sample {} ({} frames)", missing_sync_count, debug_sample_count, float(debug_sample_count)/samples_per_frame);
+			instrumentation.count([](auto& c){ c.faked_syncs++; });
 			// std::cerr << "!";
+			frame_sync_ = OPVSyncType::FAKED;
 			demodState = DemodState::FRAME;
 		}
 		else
 		{
-			std::cerr << "Done faking sync words at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl;	//!! debug
+			OPV_LOG_WARN("Done faking sync words at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+			instrumentation.count([](auto& c){ c.sync_losses++; });
 			// std::cerr << "X";
 			// fputs("\n!SYNC\n", stderr);
 			demodState = DemodState::FIRST_SYNC;
@@ -429,15 +630,12 @@ void OPVDemodulator<FloatType>::do_stream_sync()
 // Process a frame.
 // We have frame timing, thanks to the STREAM syncword. Either we just detected one, or else
 // we are freewheeling based on an older (but still recent) syncword detection.
-template <typename FloatType>
-void OPVDemodulator<FloatType>::do_frame(FloatType filtered_sample)
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::do_frame(FloatType symbol)
 {
-	if (correlator.index() != sample_index) return;	// we have symbol timing; no need to process non-peak samples
-
-	static uint8_t cost_count = 0;
-
-	// Correct the input sample (representing an input symbol) for estimated deviation magnitude, offset, and polarity.
-	auto sample = filtered_sample - dev.offset();
+	// Correct the symbol sample for estimated deviation magnitude, offset, and polarity.
+	auto sample = symbol - dev.offset();
 	sample *= dev.idev();
 	sample *= polarity;
 
@@ -448,17 +646,59 @@ void OPVDemodulator<FloatType>::do_frame(FloatType filtered_sample)
 	// converting from symbols to bits, and returning nonzero (the frame length in bits) only
 	// when the buffer is full.
 	int8_t* framer_buffer_ptr;
-	auto len = framer(llr_symbol, &framer_buffer_ptr);
+	size_t len;
+	{
+		ScopedStageTimer timer(instrumentation, Stage::FRAMER);
+		len = framer(llr_symbol, &framer_buffer_ptr);
+	}
 	if (len != 0)
 	{
 		// std::cerr << "Framer returned " << len << " at sample " << debug_sample_count << std::endl;
 		assert(len == stream_type4_size);
 
-		need_clock_update_ = true;
+		if (capture_)
+		{
+			LlrRecord record{sample_count_, float(dev.deviation()), float(dev.error()), float(dev.offset()),
+				float(timing.clock()), frame_sync_, sync_sample_index, uint8_t(clock_phase())};
+			std::copy(framer_buffer_ptr, framer_buffer_ptr + len, record.llr.begin());
+			capture_(record);
+		}
+
+		// Until a frame header decodes, the sync word may have been a chance
+		// match in noise or in another frame's payload, and the frame is not
+		// passed on.
+		auto handler = [this](const OPVFrameDecoder::output_buffer_t& frame, int cost)
+		{
+			return confirmed_ || decoder.header_result_ != OPVFrameHeader::HeaderResult::FAIL
+				? frame_handler(frame, cost) : true;
+		};
 
-		OPVFrameDecoder::frame_type4_buffer_t buffer;
-		std::copy(framer_buffer_ptr, framer_buffer_ptr + len, buffer.begin());
-		auto frame_decode_result = decoder(buffer, viterbi_cost);
+		// Frame decode time includes the COBS and Opus work done in the frame callback.
+		OPVFrameDecoder::DecodeResult frame_decode_result;
+		{
+			ScopedStageTimer timer(instrumentation, Stage::FRAME_DECODE);
+			frame_decode_result = decoder(std::span<const int8_t, stream_type4_size>(framer_buffer_ptr, len), viterbi_cost, handler);
+		}
+		instrumentation.count([this](auto& c){
+			c.frames++;
+			if (decoder.header_result_ == OPVFrameHeader::HeaderResult::FAIL) c.header_failures++;
+		});
+
+		// The first frame's header confirms the lock; without it, go
+		// straight back to looking for sync words rather than freewheeling.
+		// (About one random header in a hundred passes the Golay check, so
+		// noise still locks now and then.)
+		if (!confirmed_)
+		{
+			if (decoder.header_result_ == OPVFrameHeader::HeaderResult::FAIL)
+			{
+				OPV_LOG_INFO("False lock, no frame header at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+				instrumentation.count([](auto& c){ c.false_locks++; });
+				demodState = DemodState::UNLOCKED;
+				return;
+			}
+			confirmed_ = true;
+		}
 
 		cost_count = viterbi_cost > 90 ? cost_count + 1 : 0;
 		cost_count = viterbi_cost > 100 ? cost_count + 1 : cost_count;
@@ -466,7 +706,8 @@ void OPVDemodulator<FloatType>::do_frame(FloatType filtered_sample)
 
 		if (cost_count > 75)
 		{
-			std::cerr << "Viterbi cost high too long at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl;	//!!! debug
+			OPV_LOG_WARN("Viterbi cost high too long at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+			instrumentation.count([](auto& c){ c.sync_losses++; });
 			cost_count = 0;
 			demodState = DemodState::UNLOCKED;
 			// fputs("\nCOST\n", stderr);
@@ -478,7 +719,8 @@ void OPVDemodulator<FloatType>::do_frame(FloatType filtered_sample)
 		switch (frame_decode_result)
 		{
 		case OPVFrameDecoder::DecodeResult::EOS:
-			std::cerr << "EOS at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl;	//!!! debug
+			OPV_LOG_INFO("EOS at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+			instrumentation.count([](auto& c){ c.eos_frames++; });
 			//!!! EOS is just a hint to upper layers; here's where we'd pass it up somehow.
 
 			// It's OK for a new stream to start immediately without a new preamble.
@@ -492,79 +734,108 @@ void OPVDemodulator<FloatType>::do_frame(FloatType filtered_sample)
 	}
 }
 
-template <typename FloatType>
-void OPVDemodulator<FloatType>::operator()(const FloatType input)
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::report_diagnostics()
 {
-	static int16_t initializing = samples_per_frame;
-	static bool initialized = false; //!!! debug
+	if constexpr (std::is_same_v<DiagnosticHandler, std::function<void(const diagnostics_t&)>>)
+	{
+		if (!diagnostic_handler) return;
+	}
 
+	diagnostic_handler(diagnostics_t{dcd_, dev.error(), dev.deviation(), dev.offset(), demodState != DemodState::UNLOCKED,
+		timing.clock(), sample_index, sync_sample_index, clock_phase(), int(viterbi_cost)});
+}
+
+template <typename FloatType, OPVFrameHandler FrameHandler, typename DiagnosticHandler, size_t SamplesPerSymbol>
+requires std::is_invocable_v<DiagnosticHandler&, const OPVDiagnostics<FloatType>&>
+void OPVDemodulator<FloatType, FrameHandler, DiagnosticHandler, SamplesPerSymbol>::step(const FloatType input, const FloatType* filtered)
+{
 	// std::cerr << "Sample " << debug_sample_count << ": " << input << std::endl;	//!!! debug
 
 	count_++;
+	sample_count_++;
 
 	dcd(input);
 
-	// We need to pump a few ms of data through on startup to initialize
-	// the demodulator.
-	if (initializing) // [[unlikely]]
+	// Prime the matched filter and the correlator on startup, and refill
+	// the correlator when carrier is detected.
+	if (initializing_) // [[unlikely]]
 	{
-		--initializing;
-		initialize(input);
+		--initializing_;
+		initialize(input, filtered);
+		if (!initializing_) correlator.prime();
 		count_ = 0;
 		return;
 	}
 
-	if (! initialized) std::cerr << "Initialize complete at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl;	//!!! debug
-	initialized = true;//!!! debug
+	if (! initialized_) OPV_LOG_DEBUG("Initialize complete at sample {} ({} frames)", debug_sample_count, float(debug_sample_count)/samples_per_frame);
+	initialized_ = true;//!!! debug
 
 	if (!dcd_)
 	{
-		if (count_ % (baseband_frame_symbols * 2) == 0)
+		demod_filter.skip(input);	// keep the filter history continuous for filter_block()
+		if (count_ % DCD_INTERVAL_UNLOCKED == 0)
 		{
+			dcd.update();	// act on this interval's level, not the last one's
 			update_dcd();
-			dcd.update();
-			if (diagnostic_callback)
-			{
-				diagnostic_callback(int(dcd_), dev.error(), dev.deviation(), dev.offset(), (demodState != DemodState::UNLOCKED),
-					clock_recovery.clock_estimate(), sample_index, sync_sample_index, clock_recovery.sample_index(), viterbi_cost);
-			}
+			report_diagnostics();
 			count_ = 0;
 		}
 		return;
 	}
 
-	auto filtered_sample = demod_filter(input);
-
-//	std::cerr << "@ " << debug_sample_count << " filtered_sample = " << filtered_sample << std::endl;	//!!!debug
-	correlator.sample(filtered_sample);
+	instrumentation.count([](auto& c){ c.samples++; });
+
+	// Within a frame, nothing looks for sync words until the next one is
+	// due, so only the samples the symbol timing interpolator will use need
+	// the matched filter, and the correlator only keeps count and follows
+	// the signal level (over a skipped sample, from the one before).
+	// Full-rate filtering resumes a correlator's length before the frame
+	// ends, so the correlator holds only fresh samples when the search
+	// starts. A frame not yet confirmed by its header is filtered in full,
+	// for recheck_sync().
+	bool locked = demodState == DemodState::FRAME && confirmed_
+		&& framer.size() - framer.index_ > 2 * correlator_t::SYMBOLS;
+
+	FloatType filtered_sample = last_filtered_;
+	if (filtered)
+	{
+		demod_filter.skip(input);
+		filtered_sample = *filtered;
+		last_filtered_ = filtered_sample;
+	}
+	else if (locked && !timing.wants_sample())
+	{
+		demod_filter.skip(input);
+	}
+	else
+	{
+		ScopedStageTimer timer(instrumentation, Stage::FILTER);
+		filtered_sample = demod_filter(input);
+		last_filtered_ = filtered_sample;
+	}
 
-	if (correlator.index() == 0)
 	{
-		if (need_clock_reset_)
-		{
-			clock_recovery.reset();
-			need_clock_reset_ = false;
-		}
-		else if (need_clock_update_) // must avoid update immediately after reset.
-		{
-			clock_recovery.update();
-			uint8_t clock_index = clock_recovery.sample_index();
-			uint8_t clock_diff = std::abs(sample_index - clock_index);
-			uint8_t sync_diff = std::abs(sample_index - sync_sample_index);
-			bool clock_diff_ok = clock_diff <= 1 || clock_diff == 9;
-			bool sync_diff_ok = sync_diff <= 1 || sync_diff == 9;
-			if (clock_diff_ok) sample_index = clock_index;
-			else if (sync_diff_ok) sample_index = sync_sample_index;
-			// else unchanged.
-			need_clock_update_ = false;
-		}
+		ScopedStageTimer timer(instrumentation, Stage::CORRELATOR);
+		if (locked) correlator.skip(filtered_sample);
+		else correlator.sample(filtered_sample);
 	}
 
-	clock_recovery(filtered_sample);
+	bool strobe;
+	{
+		ScopedStageTimer timer(instrumentation, Stage::CLOCK_RECOVERY);
+		strobe = timing(filtered_sample);
+	}
 
-	if (demodState != DemodState::UNLOCKED && correlator.index() == sample_index)
+	if (strobe)
 	{
-		dev.sample(filtered_sample);
+		// Follow the timing loop with the sample index used for sync word checks.
+		constexpr int SPS = SAMPLES_PER_SYMBOL;
+		int nearest = int(correlator.index()) - int(std::lround(timing.since_strobe()));
+		sample_index = uint8_t((nearest % SPS + SPS) % SPS);
+
+		if (demodState != DemodState::UNLOCKED) dev.sample(timing.symbol());
 	}
 
 	switch (demodState)
@@ -582,19 +853,20 @@ void OPVDemodulator<FloatType>::operator()(const FloatType input)
 		do_stream_sync();
 		break;
 	case DemodState::FRAME:
-		do_frame(filtered_sample);
+		if (!confirmed_ && recheck_sync()) break;
+		if (strobe)
+		{
+			if (skip_strobes_ != 0) skip_strobes_ -= 1;
+			else do_frame(timing.symbol());
+		}
 		break;
 	}
 
-	if (count_ % (baseband_frame_symbols * 5) == 0)
+	if (count_ % DCD_INTERVAL_LOCKED == 0)
 	{
 		update_dcd();
 		count_ = 0;
-		if (diagnostic_callback)
-		{
-			diagnostic_callback(int(dcd_), dev.error(), dev.deviation(), dev.offset(), (demodState != DemodState::UNLOCKED),
-				clock_recovery.clock_estimate(), sample_index, sync_sample_index, clock_recovery.sample_index(), viterbi_cost);
-		}
+		report_diagnostics();
 		dcd.update();
 	}
 }
@@ -9,6 +9,7 @@
 #include "Viterbi.h"
 #include "OPVFrameHeader.h"
 #include "Golay24.h"
+#include "Log.h"
 #include "Numerology.h"
 
 #include <algorithm>
@@ -16,6 +17,8 @@
 #include <cstddef>
 #include <functional>
 #include <iostream>
+#include <span>
+#include <type_traits>
 
 
 namespace mobilinkd
@@ -23,9 +26,9 @@ namespace mobilinkd
 
 struct OPVFrameDecoder
 {
+    using randomizer_t = OPVRandomizer<stream_type4_size>;
+    using interleaver_t = PolynomialInterleaver<PolynomialInterleaverX, PolynomialInterleaverX2, stream_type4_size>;
 
-    OPVRandomizer<stream_type4_size> derandomize_;
-    PolynomialInterleaver<PolynomialInterleaverX, PolynomialInterleaverX2, stream_type4_size> interleaver_;
     Trellis<4,2> trellis_{makeTrellis<4, 2>({ConvolutionPolyA,ConvolutionPolyB})};
     Viterbi<decltype(trellis_), 4> viterbi_{trellis_};
  
@@ -55,12 +58,34 @@ struct OPVFrameDecoder
      * Callback function for frame types.  The caller is expected to return
      * true if the data was good or unknown and false if the data is known
      * to be bad.
+     *
+     * Any handler callable as bool(const output_buffer_t&, int) can be
+     * passed to the decode functions directly, so that the compiler can
+     * inline it; callback_t is the type-erased form, used by the overloads
+     * without a handler.
      */
     using callback_t = std::function<bool(const output_buffer_t&, int)>;
 
     callback_t callback_;
     output_buffer_t output_buffer;
     OPVFrameHeader fheader_;
+    OPVFrameHeader::HeaderResult header_result_ = OPVFrameHeader::HeaderResult::NOCHANGE;   // result for the most recent frame
+
+    // Deinterleaving permutation with the derandomizer folded in:
+    // deinterleaved_[i] = buffer[source_[i]] * sign_[i]. Built at compile
+    // time and shared by every decoder.
+    static constexpr std::array<uint16_t, stream_type4_size> source_ = interleaver_t::index_;
+    static constexpr std::array<int8_t, stream_type4_size> sign_ = []
+    {
+        std::array<int8_t, stream_type4_size> result{};
+        for (size_t i = 0; i != stream_type4_size; ++i) result[i] = randomizer_t::dc_[source_[i]];
+        return result;
+    }();
+    alignas(16) frame_type4_buffer_t deinterleaved_;
+
+    OPVFrameDecoder()
+    : OPVFrameDecoder(callback_t())
+    {}
 
     OPVFrameDecoder(callback_t callback)
     : callback_(callback)
@@ -73,12 +98,11 @@ struct OPVFrameDecoder
     }
 
 
-    DecodeResult decode_stream(OPVFrameHeader fheader, stream_type3_buffer_t& buffer, size_t& viterbi_cost)
+    template <typename Handler>
+    requires std::is_invocable_r_v<bool, Handler&, const output_buffer_t&, int>
+    DecodeResult decode_stream(OPVFrameHeader fheader, std::span<const int8_t, stream_type3_payload_size> buffer, size_t& viterbi_cost, Handler&& handler)
     {
-        stream_type1_buffer_t decode_buffer;
-
-        viterbi_cost = viterbi_.decode(buffer, decode_buffer);
-        to_byte_array(decode_buffer, output_buffer.data);
+        viterbi_cost = viterbi_.decode(buffer, std::span(output_buffer.data));
 
         if (fheader.flags & OPVFrameHeader::LAST_FRAME)
         {
@@ -87,7 +111,7 @@ struct OPVFrameDecoder
         }
 
         output_buffer.type = (fheader.flags & OPVFrameHeader::BERT_MODE) ? FrameType::OPV_BERT : FrameType::OPV_COBS;
-        callback_(output_buffer, viterbi_cost);
+        handler(output_buffer, viterbi_cost);
 
         return (fheader.flags & OPVFrameHeader::LAST_FRAME) ? DecodeResult::EOS : DecodeResult::OK;
     }
@@ -98,25 +122,29 @@ struct OPVFrameDecoder
      * 
      * Before calling this function, we've already detected the sync word for
      * streaming OPV. We get the interleaved and scrambled frame contents
-     * (excluding the sync word).
+     * (excluding the sync word), as a view of the framer's buffer.
+     *
+     * Derandomizing and deinterleaving are done together in one pass into
+     * deinterleaved_; the frame header and payload are then decoded from
+     * views of it, and the Viterbi decoder writes packed bytes directly
+     * into output_buffer.
      */
-    DecodeResult operator()(frame_type4_buffer_t& buffer, size_t& viterbi_cost)
+    template <typename Handler>
+    requires std::is_invocable_r_v<bool, Handler&, const output_buffer_t&, int>
+    DecodeResult operator()(std::span<const int8_t, stream_type4_size> buffer, size_t& viterbi_cost, Handler&& handler)
     {
-        encoded_fheader_t encoded_fheader;
-        fheader_flags_t fheader_flags;
-        stream_type3_buffer_t encoded_payload;
-        stream_type1_buffer_t payload;
-
-        derandomize_(buffer);
-        interleaver_.deinterleave(buffer);
+        for (size_t i = 0; i != stream_type4_size; ++i)
+        {
+            deinterleaved_[i] = buffer[source_[i]] * sign_[i];
+        }
 
-        std::copy(buffer.begin(), buffer.begin() + encoded_fheader_size, encoded_fheader.begin());
-        std::copy(buffer.begin() + encoded_fheader_size, buffer.end(), encoded_payload.begin());
+        auto frame = std::span<const int8_t, stream_type4_size>(deinterleaved_);
 
-        switch (fheader_.update_frame_header(encoded_fheader))
+        header_result_ = fheader_.update_frame_header(frame.first<encoded_fheader_size>());
+        switch (header_result_)
         {
             case OPVFrameHeader::HeaderResult::FAIL:
-                std::cerr << "Failed to decode frame header" << std::endl;
+                OPV_LOG_WARN("Failed to decode frame header");
                 break;
 
             case OPVFrameHeader::HeaderResult::UPDATED:
@@ -127,8 +155,21 @@ struct OPVFrameDecoder
                 break;
         }
 
-        return decode_stream(fheader_, encoded_payload, viterbi_cost);
+        return decode_stream(fheader_, frame.last<stream_type3_payload_size>(), viterbi_cost, handler);
+    }
+
+    /// Decode a frame, passing it to the callback given at construction.
+    DecodeResult operator()(std::span<const int8_t, stream_type4_size> buffer, size_t& viterbi_cost)
+    {
+        return (*this)(buffer, viterbi_cost, callback_);
     }
 };
 
+/**
+ * A frame handler that can be given to OPVFrameDecoder (and OPVDemodulator)
+ * for static dispatch.
+ */
+template <typename Handler>
+concept OPVFrameHandler = std::is_invocable_r_v<bool, Handler&, const OPVFrameDecoder::output_buffer_t&, int>;
+
 } // mobilinkd
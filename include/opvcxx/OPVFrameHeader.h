@@ -4,17 +4,19 @@
 #pragma once
 
 #include "Golay24.h"
+#include "Log.h"
 #include "Numerology.h"
 #include "Util.h"
 
 #include <array>
 #include <cstdint>
-#include <string_view> // Don't have std::span in C++17.
+#include <span>
+#include <string_view>
 #include <stdexcept>
 #include <algorithm>
 #include <iostream>
 
-extern uint32_t debug_sample_count;
+extern uint64_t debug_sample_count;
 
 namespace mobilinkd
 {
@@ -130,20 +132,25 @@ struct OPVFrameHeader
 
     // Initialize/update the frame header info from a received frame header.
     // Any failure to decode a Golay24 codeword will abort this procedure.  !!! this could be smarter
-    HeaderResult update_frame_header(encoded_fheader_t efh_soft_bits)
+    HeaderResult update_frame_header(std::span<const int8_t, encoded_fheader_size> efh_soft_bits)
     {
         uint32_t received, decoded;
         raw_fheader_t raw_fh;
         std::array<uint8_t, fheader_size_bytes * 2> nibbles;
         encoded_call_t  call;
         HeaderResult result = HeaderResult::NOCHANGE;
-        encoded_fheader_t efh_hard_bits;
 
-        for (size_t i = 0; i < encoded_fheader_size; i++)
+        // Hard decisions, packed MSB first straight from the soft bits.
+        std::array<uint8_t, encoded_fheader_size / 8> efh;
+        for (size_t i = 0; i < efh.size(); i++)
         {
-            efh_hard_bits[i] = (efh_soft_bits[i] > 0);
+            uint8_t byte = 0;
+            for (size_t j = 0; j != 8; j++)
+            {
+                byte = (byte << 1) | (efh_soft_bits[i * 8 + j] > 0);
+            }
+            efh[i] = byte;
         }
-        auto efh = to_byte_array(efh_hard_bits);
 
         // std::cerr << "\nGolay decoding a frame at sample " << debug_sample_count << std::endl; //!!! debug
 
@@ -154,12 +161,6 @@ struct OPVFrameHeader
             std::cerr << +b << " ";
         }
         std::cerr << std::endl;
-        std::cerr << "Encoded fheader as bits: ";
-        for (auto b:efh_hard_bits)
-        {
-            std::cerr << +b << " ";
-        }
-        std::cerr << std::endl;
 
         std::cerr << "Encoded fheader: " << std::hex;
         for (size_t i = 0; i < fheader_size_bytes * 2; i++)
@@ -176,7 +177,7 @@ struct OPVFrameHeader
             received = ((efh[i+0] << 16) & 0xff0000) | ((efh[i+1] << 8) & 0x00ff00) | (efh[i+2] & 0x0000ff);
             if (! Golay24::decode(received, decoded))
             {
-                std::cerr << "Golay decode fail, input " << std::hex << received << std::dec << " at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl; //!!! debug
+                OPV_LOG_WARN("Golay decode fail, input {} at sample {} ({} frames)", LogHex{received}, debug_sample_count, float(debug_sample_count)/samples_per_frame);
                 return HeaderResult::FAIL;
             }
 //            std::cerr << "Golay " << std::hex << received << " decoded to " << decoded << std::dec << std::endl;    //!!! debug
@@ -205,9 +206,6 @@ struct OPVFrameHeader
             result = HeaderResult::UPDATED;
             std::copy(raw_fh.begin(), raw_fh.begin() + 6, call.begin());
             callsign = decode_callsign(call);
-            std::cerr << "Callsign: ";
-            for (auto x : callsign) if (x) std::cerr << x;
-            std::cerr << " ";
         }
 
         // If the decoded flags have changed, store them
@@ -215,8 +213,6 @@ struct OPVFrameHeader
         {
             result = HeaderResult::UPDATED;
             flags = ((raw_fh[6] << 16) & 0xff0000) | ((raw_fh[7] << 8) & 0x00ff00) | (raw_fh[8] & 0x0000ff);
-            std::cerr << "Flags: " << std::hex << flags << std::dec;
-            std::cerr << " ";
         }
 
         // If the decoded authentication token has changed, store it
@@ -224,14 +220,13 @@ struct OPVFrameHeader
         {
             result = HeaderResult::UPDATED;
             std::copy(raw_fh.begin() + 9, raw_fh.end(), token.begin());
-            std::cerr << "Token: " << std::hex << +token[0] << +token[1] << +token[2] << std::dec;
         }
 
         if (result == HeaderResult::UPDATED)
         {
-            std::cerr << std::endl;
             std::copy(raw_fh.begin(), raw_fh.end(), raw_fheader_.begin());
-            std::cerr << "Frame header updated" << std::endl;
+            OPV_LOG_INFO("Frame header updated: callsign {} flags {} token {}",
+                callsign, LogHex{flags}, LogHex{uint32_t(token[0] << 16 | token[1] << 8 | token[2])});
         }
         else
         {
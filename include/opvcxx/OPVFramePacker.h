@@ -0,0 +1,197 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Numerology.h"
+#include "OPVCobsEncoder.h"
+#include "PacketPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+
+namespace mobilinkd
+{
+
+/**
+ * Packs IP packets into stream frame payloads as one continuous COBS
+ * stream: each packet is COBS-encoded and followed by a zero separator,
+ * and packets run on from one frame into the next, so a frame may hold
+ * the end of one packet and the start of another, and a packet may span
+ * many frames. Unused space is padded with zeros, which the decoder
+ * skips. OPVCobsDecoder already reassembles packets across frames.
+ *
+ * Voice and data packets are queued separately and scheduled per frame:
+ *
+ * - A voice packet is always next, ahead of any queued data.
+ * - While voice is active (a voice packet went in this frame or the one
+ *   before), a data packet is only started if it ends in this frame, so
+ *   that data never delays the next voice packet.
+ * - Otherwise data packets are packed back to back, filling every frame.
+ *   The first voice packet of a talk spurt waits for the end of the data
+ *   packet in progress, so long data packets add latency at its start.
+ *
+ * A voice packet (IP, UDP, RTP and one Opus packet) fills a frame
+ * exactly, so data goes in the frames between talk spurts, and in
+ * transmissions without voice, which carry data at the full frame rate.
+ *
+ * Packets are copied into buffers from the packer's own pool when
+ * queued; a packet that does not fit in the queue is dropped and counted.
+ */
+class OPVFramePacker
+{
+public:
+    using stream_frame_t = std::array<uint8_t, stream_frame_payload_bytes>;
+
+    static constexpr size_t MAX_VOICE_PACKETS = 4;      // queued voice packets
+    static constexpr size_t MAX_DATA_PACKETS = 64;      // queued data packets
+    static constexpr size_t MAX_PACKET = ip_mtu;
+
+    struct Statistics
+    {
+        uint64_t frames = 0;            // payloads filled
+        uint64_t voice_packets = 0;     // started in a frame
+        uint64_t data_packets = 0;      // started in a frame
+        uint64_t voice_dropped = 0;     // voice queue full
+        uint64_t data_dropped = 0;      // data queue full
+        uint64_t rejected = 0;          // empty or longer than MAX_PACKET
+        uint64_t idle_bytes = 0;        // padding sent
+    };
+
+    OPVFramePacker()
+    : pool_(MAX_VOICE_PACKETS + MAX_DATA_PACKETS)
+    {}
+
+    OPVFramePacker(const OPVFramePacker&) = delete;
+    OPVFramePacker& operator=(const OPVFramePacker&) = delete;
+
+    /**
+     * Queue a voice packet for the next frame with room for it.
+     *
+     * @return false if it was dropped.
+     */
+    bool voice(const uint8_t* packet, size_t length)
+    {
+        return enqueue(voice_, MAX_VOICE_PACKETS, packet, length, stats_.voice_dropped);
+    }
+
+    /**
+     * Queue a data packet.
+     *
+     * @return false if it was dropped.
+     */
+    bool data(const uint8_t* packet, size_t length)
+    {
+        return enqueue(data_, MAX_DATA_PACKETS, packet, length, stats_.data_dropped);
+    }
+
+    /// Fill the type1 payload of the next frame.
+    void fill(stream_frame_t& payload)
+    {
+        size_t index = 0;
+        bool voice_now = false;
+
+        while (index != payload.size())
+        {
+            if (offset_ == length_)
+            {
+                size_t room = payload.size() - index;
+                if (!voice_.empty())
+                {
+                    start(voice_);
+                    stats_.voice_packets++;
+                    voice_now = true;
+                }
+                else if (!data_.empty()
+                    && (!(voice_recent_ || voice_now) || encoded_size(data_.front().size()) <= room))
+                {
+                    start(data_);
+                    stats_.data_packets++;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            size_t count = std::min(length_ - offset_, payload.size() - index);
+            std::memcpy(payload.data() + index, current_.data() + offset_, count);
+            offset_ += count;
+            index += count;
+        }
+
+        std::fill(payload.begin() + index, payload.end(), 0);
+        stats_.idle_bytes += payload.size() - index;
+        stats_.frames++;
+        voice_recent_ = voice_now;
+    }
+
+    /// True when nothing is queued or partly sent.
+    bool idle() const { return offset_ == length_ && voice_.empty() && data_.empty(); }
+
+    /// Queued data packets, not counting one partly sent.
+    size_t data_queued() const { return data_.size(); }
+
+    /// Drop everything queued or partly sent.
+    void reset()
+    {
+        voice_.clear();
+        data_.clear();
+        offset_ = length_ = 0;
+        voice_recent_ = false;
+    }
+
+    const Statistics& stats() const { return stats_; }
+
+    /// Bytes a packet of @p length takes in the stream, at most.
+    static constexpr size_t encoded_size(size_t length)
+    {
+        return OPVCobsEncoder::max_encoded_size(length) + 1;
+    }
+
+private:
+    PacketPool pool_;
+    std::deque<PacketHandle> voice_;
+    std::deque<PacketHandle> data_;
+    std::array<uint8_t, OPVCobsEncoder::max_encoded_size(MAX_PACKET) + 1> current_;  // packet being sent, encoded
+    size_t length_ = 0;
+    size_t offset_ = 0;             // of the next byte of current_ to send
+    bool voice_recent_ = false;     // voice went in the previous frame
+    Statistics stats_;
+
+    bool enqueue(std::deque<PacketHandle>& queue, size_t limit, const uint8_t* packet, size_t length, uint64_t& dropped)
+    {
+        if (length == 0 || length > MAX_PACKET)
+        {
+            stats_.rejected++;
+            return false;
+        }
+
+        PacketHandle buffer;
+        if (queue.size() < limit) buffer = pool_.acquire();
+        if (!buffer)
+        {
+            dropped++;
+            return false;
+        }
+
+        std::memcpy(buffer.data(), packet, length);
+        buffer.resize(length);
+        queue.push_back(std::move(buffer));
+        return true;
+    }
+
+    void start(std::deque<PacketHandle>& queue)
+    {
+        const PacketHandle& packet = queue.front();
+        length_ = OPVCobsEncoder::encode(packet.data(), packet.size(), current_.data());
+        current_[length_++] = 0;    // separator
+        offset_ = 0;
+        queue.pop_front();
+    }
+};
+
+} // mobilinkd
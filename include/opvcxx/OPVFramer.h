@@ -10,12 +10,21 @@
 namespace mobilinkd
 {
 
+/**
+ * Collects soft bits into frames.
+ *
+ * The framer is double-buffered: when a frame completes, the pointer
+ * returned refers to that frame's buffer and stays valid, unchanged, while
+ * the next frame is collected into the other buffer. The frame decoder
+ * works on it in place, without copying it first.
+ */
 template <size_t N> // N = bits in a frame, not including sync word
 struct OPVFramer
 {
     using buffer_t = std::array<int8_t, N>;
 
-    alignas(16) buffer_t buffer_;
+    alignas(16) std::array<buffer_t, 2> buffers_;
+    size_t active_ = 0;     // buffer being filled
     size_t index_ = 0;
 
     OPVFramer()
@@ -27,26 +36,20 @@ struct OPVFramer
 
     size_t operator()(int dibit, int8_t** result)
     {
-        buffer_[index_++] = (dibit >> 1) ? 1 : -1;
-        buffer_[index_++] = (dibit & 1) ? 1 : -1;
-        if (index_ == N)
-        {
-            index_ = 0;
-            *result = buffer_.data();
-            return N;
-        }
-        return 0;
+        return operator()(std::make_tuple<int8_t, int8_t>((dibit >> 1) ? 1 : -1, (dibit & 1) ? 1 : -1), result);
     }
 
     // LLR mode
     size_t operator()(std::tuple<int8_t, int8_t> symbol, int8_t** result)
     {
-        buffer_[index_++] = std::get<0>(symbol);
-        buffer_[index_++] = std::get<1>(symbol);
+        buffer_t& buffer = buffers_[active_];
+        buffer[index_++] = std::get<0>(symbol);
+        buffer[index_++] = std::get<1>(symbol);
         if (index_ == N)
         {
             index_ = 0;
-            *result = buffer_.data();
+            active_ ^= 1;
+            *result = buffer.data();
             return N;
         }
         return 0;
@@ -54,7 +57,8 @@ struct OPVFramer
     
     void reset()
     { 
-        buffer_.fill(0);
+        for (auto& buffer : buffers_) buffer.fill(0);
+        active_ = 0;
         index_ = 0;
     }
 };
@@ -0,0 +1,519 @@
+// Copyright 2020 Mobilinkd LLC.
+// Copyright 2022-2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Convolution.h"
+#include "FirFilter.h"
+#include "Golay24.h"
+#include "IPv4UDP.h"
+#include "Log.h"
+#include "Numerology.h"
+#include "OPVCobsEncoder.h"
+#include "OPVFrameHeader.h"
+#include "OPVRandomizer.h"
+#include "PolynomialInterleaver.h"
+#include "RRCTaps.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace mobilinkd
+{
+
+/**
+ * Streaming OPV modulator.
+ *
+ * Frames are pushed in one at a time -- Opus packets, PCM audio (through a
+ * caller-supplied encoder), raw IP packets, BERT frames or complete COBS
+ * payloads -- and each produces one block of output, delivered to the
+ * registered output callback before the call returns. The output is either
+ * baseband (16-bit samples at sample_rate, pulse shaped with the RRC
+ * filter) or a packed bitstream (four symbols per byte, sync word first).
+ *
+ * All state (frame header, encoder tables, RRC filter history, BERT PRBS)
+ * lives in the object, so any number of modulators can run side by side.
+ *
+ * A transmission is: dead_carrier() (optional), preamble(), any number of
+ * frames, the last of them with last = true, then eot().
+ */
+struct OPVModulator
+{
+    enum class OutputMode { BASEBAND, BITSTREAM };
+
+    using fheader_t = std::array<uint8_t, fheader_size_bytes>;              // Frame Header (type 1)
+    using encoded_fheader_t = std::array<int8_t, encoded_fheader_size>;     // Frame Header (type 2/3)
+    using stream_frame_t = std::array<uint8_t, stream_frame_payload_bytes>; // a stream frame of type1 data bytes
+    using type3_data_frame_t = std::array<uint8_t, stream_type3_payload_size>;  // a stream frame of type3 bits
+    using bitstream_t = std::array<int8_t, stream_type4_size>;              // a frame of type4 bits (no sync word)
+    using audio_frame_t = std::array<int16_t, audio_samples_per_opv_frame>; // 40ms of PCM audio
+    using sync_word_t = std::array<uint8_t, 2>;
+
+    // Output blocks. Data is only valid for the duration of the call.
+    using baseband_callback_t = std::function<void(const int16_t*, size_t)>;
+    using bitstream_callback_t = std::function<void(const uint8_t*, size_t)>;
+
+    static constexpr sync_word_t STREAM_SYNC_WORD = {0xFF, 0x5D};
+    static constexpr sync_word_t EOT_SYNC = {0x55, 0x5D};
+    static constexpr uint8_t PREAMBLE_BYTE = 0x77;     // +3, -3, +3, -3 == 01 11 01 11 == 0x77
+    static constexpr uint8_t DEAD_CARRIER_BYTE = 0x00; // +1, +1, +1, +1 = 00 00 00 00 == 0x00
+    static constexpr size_t EOT_SYMBOLS = 48;          // EOT sync word plus enough to flush the RRC filter
+    static constexpr size_t SAMPLES_PER_SYMBOL = sample_rate / symbol_rate;
+    static constexpr double BASEBAND_SCALE = 7168.0;
+
+    static constexpr uint16_t UDP_SOURCE_PORT = 54321;    // should probably be random
+    static constexpr uint16_t UDP_DEST_PORT = voice_udp_port;
+    static constexpr uint32_t IP_SOURCE_ADDRESS = 0xC0A80001;   // 192.168.0.1
+    static constexpr uint32_t IP_DEST_ADDRESS = 0xC0A80002;     // 192.168.0.2
+    static constexpr size_t voice_packet_bytes = ip_v4_header_bytes + udp_header_bytes + rtp_header_bytes + opus_packet_size_bytes;
+
+    OutputMode mode_ = OutputMode::BASEBAND;
+    bool invert_ = false;
+    baseband_callback_t baseband_callback_;
+    bitstream_callback_t bitstream_callback_;
+
+    fheader_t fheader_;
+    encoded_fheader_t encoded_fheader_;
+
+    PolynomialInterleaver<PolynomialInterleaverX, PolynomialInterleaverX2, stream_type4_size> interleaver_;
+    OPVRandomizer<stream_type4_size> randomizer_;
+    BaseFirFilter<double, detail::Taps<double>::rrc_taps.size()> rrc_{detail::Taps<double>::rrc_taps};
+    PRBS9 prbs_;
+
+    IPv4UDPBuilder voice_headers_{IP_SOURCE_ADDRESS, UDP_SOURCE_PORT, IP_DEST_ADDRESS, UDP_DEST_PORT};
+    RTPHeader rtp_header_;
+
+    std::array<int16_t, baseband_frame_symbols * SAMPLES_PER_SYMBOL> baseband_;
+
+    OPVModulator(const std::string& source_callsign, const OPVFrameHeader::token_t& token, bool bert = false)
+    {
+        fheader_ = make_fheader(source_callsign, token, bert);
+        encoded_fheader_ = encode_fheader(fheader_);
+        rtp_header_.ssrc = detail::get32(fheader_.data() + 2);  // from the encoded callsign, stable per station
+        rtp_header_.marker = true;
+    }
+
+    void output_mode(OutputMode mode) { mode_ = mode; }
+    OutputMode output_mode() const { return mode_; }
+
+    /// Invert the baseband output (ignored for bitstream).
+    void invert(bool enabled) { invert_ = enabled; }
+
+    void baseband_output(baseband_callback_t callback) { baseband_callback_ = callback; }
+    void bitstream_output(bitstream_callback_t callback) { bitstream_callback_ = callback; }
+
+    const fheader_t& fheader() const { return fheader_; }
+    const encoded_fheader_t& encoded_fheader() const { return encoded_fheader_; }
+
+    /**
+     * Clear the LAST_FRAME flag and the filter history, ready for a new
+     * transmission with the same frame header.
+     */
+    void reset()
+    {
+        set_last_frame(false);
+        rrc_.reset();
+        rtp_header_.marker = true;  // the first voice packet starts a talkspurt
+    }
+
+    /// Set or clear the LAST_FRAME (end of stream) flag in the frame header.
+    void set_last_frame(bool last)
+    {
+        bool is_last = fheader_[6] & 0x80;
+        if (last == is_last) return;
+        if (last) fheader_[6] |= 0x80;
+        else fheader_[6] &= ~0x80;
+        encoded_fheader_ = encode_fheader(fheader_);
+    }
+
+    // ------------------------------------------------------------------
+    // Transmission framing
+
+    /// A frame of dead carrier (preceding the preamble on a real transmitter).
+    void dead_carrier()
+    {
+        constant_frame(DEAD_CARRIER_BYTE);
+    }
+
+    /// A preamble frame; every transmission starts with one.
+    void preamble()
+    {
+        constant_frame(PREAMBLE_BYTE);
+    }
+
+    /// End of transmission: the EOT sync word and a tail to flush the RRC filter.
+    void eot()
+    {
+        if (mode_ == OutputMode::BITSTREAM)
+        {
+            std::array<uint8_t, EOT_SYMBOLS / 4> bytes{};
+            std::copy(EOT_SYNC.begin(), EOT_SYNC.end(), bytes.begin());
+            emit_bitstream(bytes.data(), bytes.size());
+        }
+        else
+        {
+            std::array<int8_t, EOT_SYMBOLS> symbols;
+            symbols.fill(0);    // zero input, just flushing the RRC filter
+            auto sync = bytes_to_symbols(EOT_SYNC);
+            std::copy(sync.begin(), sync.end(), symbols.begin());
+            emit_baseband(symbols.data(), symbols.size());
+        }
+    }
+
+    // ------------------------------------------------------------------
+    // Frames
+
+    /**
+     * Send one frame whose type1 payload is already COBS-framed (or is
+     * BERT data). This is the common path for all frame types.
+     */
+    void frame(const stream_frame_t& payload, bool last = false)
+    {
+        send_encoded(encode_frame(payload, last));
+    }
+
+    /**
+     * The first half of frame(): the frame header and FEC-encoded,
+     * interleaved and randomized payload, ready for send_encoded().
+     *
+     * The two halves touch disjoint state (frame header, interleaver and
+     * randomizer here; filter and output there), so a pipelined
+     * transmitter may run them on different threads, each with its own
+     * modulator.
+     */
+    bitstream_t encode_frame(const stream_frame_t& payload, bool last = false)
+    {
+        set_last_frame(last);
+
+        bitstream_t frame;
+        auto type3 = encode_stream_frame(payload);
+        auto payload_offset = std::copy(encoded_fheader_.begin(), encoded_fheader_.end(), frame.begin());
+        std::copy(type3.begin(), type3.end(), payload_offset);
+
+        interleaver_.interleave(frame);
+        randomizer_.randomize(frame);
+        return frame;
+    }
+
+    /// The second half of frame(): the sync word and frame, pulse shaped and output.
+    void send_encoded(const bitstream_t& frame)
+    {
+        output_frame(STREAM_SYNC_WORD, frame);
+    }
+
+    /**
+     * Send a raw IP packet that fits in one frame, COBS-encoded and
+     * padded with zero separators.
+     *
+     * @return false if the packet is too long for a single frame.
+     */
+    bool packet(const uint8_t* ip_packet, size_t length, bool last = false)
+    {
+        stream_frame_t payload;
+        if (OPVCobsEncoder::max_encoded_size(length) >= payload.size()) return false;
+
+        auto encoded = OPVCobsEncoder::encode(ip_packet, length, payload.data());
+        std::fill(payload.begin() + encoded, payload.end(), 0);  // zero separator(s) between COBS packets
+        frame(payload, last);
+        return true;
+    }
+
+    /**
+     * Send an encoded 40ms Opus packet, wrapped in RTP, UDP and IP.
+     */
+    void voice(const uint8_t* opus_packet, bool last = false)
+    {
+        std::array<uint8_t, voice_packet_bytes> packet;
+        voice_packet(opus_packet, packet.data());
+        if (!this->packet(packet.data(), packet.size(), last))
+        {
+            OPV_LOG_ERROR("Failure COBS encoding voice frame.");
+        }
+    }
+
+    /**
+     * Wrap an encoded 40ms Opus packet in RTP, UDP and IP without sending
+     * it, for callers that schedule frames themselves (OPVFramePacker).
+     * @p packet must have room for voice_packet_bytes.
+     *
+     * @return the length of the packet.
+     */
+    size_t voice_packet(const uint8_t* opus_packet, uint8_t* packet)
+    {
+        std::copy(opus_packet, opus_packet + opus_packet_size_bytes, packet + IPv4UDP::HEADER_BYTES + rtp_header_bytes);
+        build_voice_headers(packet);
+        return voice_packet_bytes;
+    }
+
+    /**
+     * Encode and send 40ms of PCM audio.
+     *
+     * @param encoder is called as encoder(pcm, samples, out, max_bytes) and
+     *  must return the number of bytes written (e.g. a wrapper for
+     *  opus_encode()). This keeps the library independent of the codec.
+     */
+    template <typename Encoder>
+    void audio(Encoder&& encoder, const audio_frame_t& pcm, bool last = false)
+    {
+        std::array<uint8_t, opus_packet_size_bytes> opus_packet{};
+        auto count = encoder(pcm.data(), audio_samples_per_opv_frame, opus_packet.data(), int(opus_packet_size_bytes));
+        if (count != opus_packet_size_bytes)
+        {
+            OPV_LOG_WARN("Got unexpected encoded voice size {}", count);
+        }
+        voice(opus_packet.data(), last);
+    }
+
+    /**
+     * Send a frame of BERT data from the modulator's PRBS9 generator.
+     */
+    void bert(bool last = false)
+    {
+        frame(fill_bert_frame(prbs_), last);
+    }
+
+    // ------------------------------------------------------------------
+    // Frame construction helpers
+
+    // Generate the frame header
+    static fheader_t make_fheader(const std::string& source_callsign, const OPVFrameHeader::token_t& access_token, bool is_bert)
+    {
+        fheader_t header;
+        header.fill(0);
+
+        OPVFrameHeader::call_t callsign;
+        callsign.fill(0);
+        std::copy(source_callsign.begin(), source_callsign.begin() + std::min(source_callsign.size(), callsign.size() - 1), callsign.begin());
+        auto encoded_callsign = OPVFrameHeader::encode_callsign(callsign);
+        uint8_t flags = 0;
+        if (is_bert) flags |= 0x40;
+
+        std::copy(encoded_callsign.begin(), encoded_callsign.end(), header.begin());
+        std::copy(access_token.begin(), access_token.end(), header.begin() + 9);
+        header[6] = flags;
+
+        return header;
+    }
+
+    // Encode the frame header with multiple words of Golay 12,24 code.
+    static encoded_fheader_t encode_fheader(const fheader_t& header)
+    {
+        encoded_fheader_t bits;
+        size_t bit_index = 0;
+        uint32_t encoded;
+
+        // Each Golay code spans 1.5 bytes. For convenience, we process them in pairs.
+        // Each pair has a first code taking up all of the first byte and half of the second,
+        // and a second code taking up the other half of the second byte and all of the third.
+        for (size_t byte_index = 0; byte_index < fheader_size_bytes; byte_index += 3)
+        {
+            encoded = Golay24::encode24(header[byte_index] << 4 | ((header[byte_index+1] >> 4) & 0x0F));
+            for (size_t i = 0; i < 24; i++)
+            {
+                bits[bit_index++] = ((encoded & (1 << 23)) != 0);
+                encoded <<= 1;
+            }
+
+            encoded = Golay24::encode24((header[byte_index+1] & 0x0F) << 8 | header[byte_index+2]);
+            for (size_t i = 0; i < 24; i++)
+            {
+                bits[bit_index++] = ((encoded & (1 << 23)) != 0);
+                encoded <<= 1;
+            }
+        }
+
+        return bits;
+    }
+
+    // Convert a type1 stream frame to type2/type3. That is, convolutional encode it (and puncture if we used puncturing)
+    static type3_data_frame_t encode_stream_frame(const stream_frame_t& payload)
+    {
+        type3_data_frame_t encoded;   // rate-1/2 encoded data bits + 4 flush bits, unpacked
+        size_t index = 0;
+        uint32_t memory = 0;
+        for (auto b : payload)
+        {
+            for (size_t i = 0; i != 8; ++i)
+            {
+                uint32_t x = (b & 0x80) >> 7;
+                b <<= 1;
+                memory = update_memory<4>(memory, x);
+                encoded[index++] = convolve_bit(ConvolutionPolyA, memory);
+                encoded[index++] = convolve_bit(ConvolutionPolyB, memory);
+            }
+        }
+        // Flush the encoder.
+        for (size_t i = 0; i != 4; ++i)
+        {
+            memory = update_memory<4>(memory, 0);
+            encoded[index++] = convolve_bit(ConvolutionPolyA, memory);
+            encoded[index++] = convolve_bit(ConvolutionPolyB, memory);
+        }
+
+        return encoded;
+    }
+
+    // Create the payload for a BERT frame, exactly the same size as voice frame,
+    // but filled with bits from the pseudorandom bit sequence generator.
+    // We use a prime number of bits from the PRBS per frame, so that each frame
+    // will be unique for a very long while. The rest of the frame is filled up
+    // with bits from the beginning of the frame, so that they will have the same
+    // statistics. It's up to the receiver whether those filler bits are counted
+    // toward the bit error rate.
+    template <typename PRBS>
+    static stream_frame_t fill_bert_frame(PRBS& prbs)
+    {
+        stream_frame_t bert_bytes;
+        std::array<uint8_t, stream_frame_payload_size> bert_bits;
+
+        for (size_t index = 0; index != bert_bits.size(); ++index)
+        {
+            if (index < bert_frame_prime_size)
+            {
+                bert_bits[index] = prbs.generate();
+            }
+            else
+            {
+                bert_bits[index] = bert_bits[index - bert_frame_prime_size];
+            }
+        }
+
+        to_byte_array(bert_bits, bert_bytes);
+        OPV_LOG_DEBUG("BERT frame");
+
+        return bert_bytes;
+    }
+
+    // Fill in the IP, UDP and RTP headers in front of an Opus packet, and
+    // advance the RTP sequence number and timestamp.
+    void build_voice_headers(uint8_t* packet)
+    {
+        rtp_header_.write(packet + IPv4UDP::HEADER_BYTES);
+        voice_headers_.build(packet, rtp_header_bytes + opus_packet_size_bytes);
+
+        rtp_header_.marker = false;
+        rtp_header_.sequence++;
+        rtp_header_.timestamp += opus_rtp_clock_rate / 25;  // 40ms
+    }
+
+    // ------------------------------------------------------------------
+    // Symbol mapping and output
+
+    // Convert a dibit into a modulation symbol
+    static int8_t bits_to_symbol(uint8_t bits)
+    {
+        switch (bits)
+        {
+        case 0: return 1;
+        case 1: return 3;
+        case 2: return -1;
+        case 3: return -3;
+        }
+        abort();
+    }
+
+    // Convert a packed array of bits into an unpacked array of modulation symbols
+    template <size_t N>
+    static std::array<int8_t, N * 4> bytes_to_symbols(const std::array<uint8_t, N>& bytes)
+    {
+        std::array<int8_t, N * 4> result;
+        size_t index = 0;
+        for (auto b : bytes)
+        {
+            for (size_t i = 0; i != 4; ++i)
+            {
+                result[index++] = bits_to_symbol(b >> 6);
+                b <<= 2;
+            }
+        }
+        return result;
+    }
+
+    // Pulse shape symbols into baseband samples (with 10x interpolation) and emit them.
+    void emit_baseband(const int8_t* symbols, size_t count)
+    {
+        const double scale = BASEBAND_SCALE * (invert_ ? -1.0 : 1.0);
+        size_t out = 0;
+
+        for (size_t i = 0; i != count; ++i)
+        {
+            baseband_[out++] = rrc_(symbols[i]) * scale;
+            for (size_t j = 1; j != SAMPLES_PER_SYMBOL; ++j)
+            {
+                baseband_[out++] = rrc_(0) * scale;
+            }
+
+            if (out == baseband_.size())
+            {
+                if (baseband_callback_) baseband_callback_(baseband_.data(), out);
+                out = 0;
+            }
+        }
+
+        if (out && baseband_callback_) baseband_callback_(baseband_.data(), out);
+    }
+
+    void emit_bitstream(const uint8_t* bytes, size_t count)
+    {
+        if (bitstream_callback_) bitstream_callback_(bytes, count);
+    }
+
+    // Output a frame of type4 bits, including the sync word, in the selected format
+    void output_frame(const sync_word_t& sync_word, const bitstream_t& frame)
+    {
+        if (mode_ == OutputMode::BITSTREAM)
+        {
+            std::array<uint8_t, baseband_frame_packed_bytes> buffer;
+            size_t index = 0;
+
+            for (auto c : sync_word) buffer[index++] = c;   // output the sync word
+            for (size_t i = 0; i != frame.size(); i += 8)   // output the fheader and data
+            {
+                uint8_t c = 0;
+                for (size_t j = 0; j != 8; ++j)
+                {
+                    c <<= 1;
+                    c |= frame[i + j];
+                }
+                buffer[index++] = c;
+            }
+            emit_bitstream(buffer.data(), buffer.size());
+        }
+        else
+        {
+            std::array<int8_t, baseband_frame_symbols> symbols;
+            auto sw = bytes_to_symbols(sync_word);
+            auto it = std::copy(sw.begin(), sw.end(), symbols.begin());
+            for (size_t i = 0; i != frame.size(); i += 2)
+            {
+                *it++ = bits_to_symbol((frame[i] << 1) | frame[i + 1]);
+            }
+            emit_baseband(symbols.data(), symbols.size());
+        }
+    }
+
+    // Create and output a frame with a constant byte value (preamble or dead carrier)
+    void constant_frame(uint8_t value)
+    {
+        std::array<uint8_t, baseband_frame_packed_bytes> bytes;
+        bytes.fill(value);
+        if (mode_ == OutputMode::BITSTREAM)
+        {
+            emit_bitstream(bytes.data(), bytes.size());
+        }
+        else
+        {
+            auto symbols = bytes_to_symbols(bytes);
+            emit_baseband(symbols.data(), symbols.size());
+        }
+    }
+};
+
+} // mobilinkd
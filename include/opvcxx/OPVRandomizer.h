@@ -18,7 +18,7 @@ namespace detail
 // Opulent Voice + RTP randomization matrix.
 // Generated at random using MATLAB live script
 // OpulentVoiceNumerology.mlx
-inline auto DC = std::array<uint8_t, stream_type4_bytes> {
+inline constexpr auto DC = std::array<uint8_t, stream_type4_bytes> {
     0xAC, 0x61, 0xC6, 0xE1, 0x61, 0x85, 0x94, 0xE9,
     0x6E, 0x96, 0xAD, 0x4D, 0xA4, 0x57, 0xA2, 0x87,
     0x53, 0x6D, 0xCC, 0x6B, 0x5A, 0x30, 0x35, 0x6A,
@@ -54,27 +54,30 @@ inline auto DC = std::array<uint8_t, stream_type4_bytes> {
     0x71, 0x35, 0xCF, 0x37, 0xE9, 0xEE, 0xFD, 0xAC,
     0xF4, 0xA5, 0x1B, 0x18, 0x95
     };
+
+// The randomization matrix as signs, -1 for a 1 bit, MSB first.
+template <size_t N>
+constexpr std::array<int8_t, N> make_dc_signs()
+{
+    std::array<int8_t, N> result{};
+    for (size_t i = 0; i != N; ++i)
+    {
+        result[i] = (DC[i / 8] >> (7 - i % 8)) & 1 ? -1 : 1;
+    }
+    return result;
+}
 }
 
 template <size_t N = stream_type4_size>
 struct OPVRandomizer
 {
-    std::array<int8_t, N> dc_;
+    static_assert(N <= detail::DC.size() * 8);
 
-    OPVRandomizer()
-    {
-        size_t i = 0;
-        for (auto b : detail::DC)
-        {
-            for (size_t j = 0; j != 8; ++j)
-            {
-                dc_[i++] = (b >> (7 - j)) & 1 ? -1 : 1;
-            }
-        }
-    }
+    // Built at compile time and shared by every instance.
+    static constexpr std::array<int8_t, N> dc_ = detail::make_dc_signs<N>();
 
     // Randomize and derandomize are the same operation.
-    void operator()(std::array<int8_t, N>& frame)
+    void operator()(std::array<int8_t, N>& frame) const
     {
         for (size_t i = 0; i != N; ++i)
         {
@@ -82,7 +85,7 @@ struct OPVRandomizer
         }
     }
 
-    void randomize(std::array<int8_t, N>& frame)
+    void randomize(std::array<int8_t, N>& frame) const
     {
         for (size_t i = 0; i != N; ++i)
         {
@@ -0,0 +1,119 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "IPv4UDP.h"
+#include "PacketPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace mobilinkd
+{
+
+/**
+ * Receive-side dispatch of decoded IP packets.
+ *
+ * Each packet is parsed in place as UDP over IPv4, its checksums verified,
+ * and the packet handed to the handler registered for its UDP destination
+ * port, together with where the UDP payload is. Anything else (bad
+ * checksums, other protocols, ports with no handler) goes to the fallback
+ * handler, if one is set, and is counted. Nothing is printed or copied.
+ *
+ * Takes the PacketHandle form of OPVCobsDecoder's packet handler, so
+ * handlers may keep the packet after returning.
+ */
+class PacketDispatcher
+{
+public:
+    using Result = IPv4UDP::Result;
+    using udp_handler_t = std::function<void(PacketHandle, const IPv4UDP::Datagram&)>;
+    using fallback_handler_t = std::function<void(PacketHandle, Result)>;
+
+    struct Statistics
+    {
+        uint64_t packets = 0;       // all packets seen
+        uint64_t delivered = 0;     // to a port handler
+        uint64_t unrouted = 0;      // UDP, but no handler for the port
+        uint64_t not_udp = 0;       // other protocols, other IP versions and fragments
+        uint64_t malformed = 0;     // truncated or inconsistent lengths
+        uint64_t bad_checksum = 0;  // IP or UDP checksum failed
+    };
+
+    /// Send UDP packets for @p port to @p handler, replacing any previous one.
+    void route(uint16_t port, udp_handler_t handler)
+    {
+        for (auto& route : routes_)
+        {
+            if (route.port == port)
+            {
+                route.handler = std::move(handler);
+                return;
+            }
+        }
+        routes_.push_back(Route{port, std::move(handler)});
+    }
+
+    /// Handler for packets that are not delivered to a port handler.
+    void fallback(fallback_handler_t handler) { fallback_ = std::move(handler); }
+
+    /// Checksums are verified unless this is turned off.
+    void verify_checksums(bool enabled) { verify_ = enabled; }
+
+    Result operator()(PacketHandle packet)
+    {
+        stats_.packets++;
+
+        IPv4UDP::Datagram datagram;
+        auto result = IPv4UDP::parse(packet.data(), packet.size(), datagram, verify_);
+        switch (result)
+        {
+        case Result::OK:
+            for (auto& route : routes_)
+            {
+                if (route.port == datagram.dest_port)
+                {
+                    stats_.delivered++;
+                    route.handler(std::move(packet), datagram);
+                    return result;
+                }
+            }
+            stats_.unrouted++;
+            break;
+        case Result::TRUNCATED:
+            stats_.malformed++;
+            break;
+        case Result::BAD_IP_CHECKSUM:
+        case Result::BAD_UDP_CHECKSUM:
+            stats_.bad_checksum++;
+            break;
+        case Result::NOT_IPV4:
+        case Result::FRAGMENT:
+        case Result::NOT_UDP:
+            stats_.not_udp++;
+            break;
+        }
+
+        if (fallback_) fallback_(std::move(packet), result);
+        return result;
+    }
+
+    const Statistics& stats() const { return stats_; }
+
+private:
+    struct Route
+    {
+        uint16_t port;
+        udp_handler_t handler;
+    };
+
+    std::vector<Route> routes_;
+    fallback_handler_t fallback_;
+    bool verify_ = true;
+    Statistics stats_;
+};
+
+} // mobilinkd
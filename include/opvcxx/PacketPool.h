@@ -0,0 +1,191 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Numerology.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace mobilinkd
+{
+
+class PacketPool;
+
+namespace detail
+{
+
+struct PacketSlot
+{
+    static constexpr size_t CAPACITY = ip_mtu + 3;  // room for the COBS decoder's working bytes
+
+    std::atomic<uint32_t> refs{0};
+    std::atomic<uint32_t> next{0};      // free list link
+    uint32_t length = 0;
+    PacketPool* pool = nullptr;
+    alignas(16) uint8_t data[CAPACITY];
+};
+
+} // detail
+
+/**
+ * Reference-counted handle to a packet buffer in a PacketPool.
+ *
+ * Copying a handle shares the buffer; the buffer goes back to its pool
+ * when the last handle to it is destroyed or reset. Handles may be passed
+ * to and released on any thread. The contents should not be changed once
+ * the handle has been shared.
+ */
+class PacketHandle
+{
+public:
+    PacketHandle() = default;
+
+    PacketHandle(const PacketHandle& other)
+    : slot_(other.slot_)
+    {
+        if (slot_) slot_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    PacketHandle(PacketHandle&& other) noexcept
+    : slot_(std::exchange(other.slot_, nullptr))
+    {}
+
+    PacketHandle& operator=(PacketHandle other) noexcept
+    {
+        std::swap(slot_, other.slot_);
+        return *this;
+    }
+
+    ~PacketHandle()
+    {
+        reset();
+    }
+
+    inline void reset();
+
+    explicit operator bool() const { return slot_ != nullptr; }
+
+    uint8_t* data() { return slot_->data; }
+    const uint8_t* data() const { return slot_->data; }
+    size_t size() const { return slot_->length; }
+    static constexpr size_t capacity() { return detail::PacketSlot::CAPACITY; }
+    void resize(size_t length) { slot_->length = std::min(length, capacity()); }
+
+    uint32_t use_count() const { return slot_ ? slot_->refs.load(std::memory_order_relaxed) : 0; }
+
+private:
+    friend class PacketPool;
+
+    explicit PacketHandle(detail::PacketSlot* slot)
+    : slot_(slot)
+    {}
+
+    detail::PacketSlot* slot_ = nullptr;
+};
+
+/**
+ * Fixed pool of MTU-sized packet buffers.
+ *
+ * All buffers are allocated when the pool is constructed; acquire() and
+ * release never touch the heap. The free list is a lock-free stack with a
+ * version tag against ABA, so buffers can be acquired on one thread and
+ * released on others. The pool must outlive every handle taken from it.
+ */
+class PacketPool
+{
+public:
+    explicit PacketPool(size_t slots)
+    : size_(slots), slots_(std::make_unique<detail::PacketSlot[]>(slots))
+    {
+        for (size_t i = 0; i != size_; ++i)
+        {
+            slots_[i].pool = this;
+            slots_[i].next.store(i + 1 == size_ ? NONE : uint32_t(i + 1), std::memory_order_relaxed);
+        }
+        head_.store(size_ ? 0 : NONE, std::memory_order_release);
+    }
+
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    /**
+     * Take an empty buffer from the pool.
+     *
+     * @return the buffer, or an empty handle if the pool is exhausted.
+     */
+    PacketHandle acquire()
+    {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        for (;;)
+        {
+            uint32_t index = uint32_t(head);
+            if (index == NONE)
+            {
+                exhausted_.fetch_add(1, std::memory_order_relaxed);
+                return PacketHandle();
+            }
+            uint32_t next = slots_[index].next.load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, tagged(next, head), std::memory_order_acquire, std::memory_order_acquire))
+            {
+                auto& slot = slots_[index];
+                slot.refs.store(1, std::memory_order_relaxed);
+                slot.length = 0;
+                available_.fetch_sub(1, std::memory_order_relaxed);
+                return PacketHandle(&slot);
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    /// Buffers not currently held by any handle.
+    size_t available() const { return available_.load(std::memory_order_relaxed); }
+
+    /// Number of times acquire() found the pool empty.
+    uint64_t exhausted() const { return exhausted_.load(std::memory_order_relaxed); }
+
+private:
+    friend class PacketHandle;
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Free list head: slot index in the low half, version tag in the high half.
+    static uint64_t tagged(uint32_t index, uint64_t previous)
+    {
+        return (((previous >> 32) + 1) << 32) | index;
+    }
+
+    void release(detail::PacketSlot* slot)
+    {
+        uint32_t index = uint32_t(slot - slots_.get());
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        do
+        {
+            slot->next.store(uint32_t(head), std::memory_order_relaxed);
+        }
+        while (!head_.compare_exchange_weak(head, tagged(index, head), std::memory_order_release, std::memory_order_relaxed));
+        available_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t size_;
+    std::unique_ptr<detail::PacketSlot[]> slots_;
+    std::atomic<uint64_t> head_{NONE};
+    std::atomic<size_t> available_{size_};
+    std::atomic<uint64_t> exhausted_{0};
+};
+
+inline void PacketHandle::reset()
+{
+    if (slot_ && slot_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        slot_->pool->release(slot_);
+    }
+    slot_ = nullptr;
+}
+
+} // mobilinkd
@@ -0,0 +1,152 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace mobilinkd
+{
+
+/**
+ * Reads IP packets from a pcap capture file (as written by tcpdump -w),
+ * in either byte order and timestamp resolution.
+ *
+ * Raw IP captures (e.g. from a TUN interface), Ethernet and Linux
+ * "cooked" captures (tcpdump -i any) are understood; link-layer headers
+ * are stripped, and frames that are not IPv4 or IPv6 are skipped, as are
+ * packets longer than the buffer or truncated by the capture.
+ */
+class PcapReader
+{
+public:
+    static constexpr size_t MAX_PACKET = 65535;
+
+    enum LinkType : uint32_t
+    {
+        LINKTYPE_ETHERNET = 1,
+        LINKTYPE_RAW = 101,
+        LINKTYPE_LINUX_SLL = 113,
+        LINKTYPE_IPV4 = 228,
+        LINKTYPE_IPV6 = 229,
+    };
+
+    /// @return false if the file cannot be read or is not a pcap file.
+    bool open(const std::string& path)
+    {
+        file_.close();
+        file_.clear();
+        file_.open(path, std::ios::binary);
+        if (!file_) return false;
+
+        std::array<uint8_t, 24> header;
+        if (!read(header.data(), header.size())) return false;
+
+        // The magic number (microsecond or nanosecond timestamps) gives
+        // the byte order of the rest of the file.
+        uint32_t magic = get32(header.data(), false);
+        if (magic == 0xA1B2C3D4 || magic == 0xA1B23C4D) little_endian_ = false;
+        else if (magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1) little_endian_ = true;
+        else return false;
+
+        link_type_ = get32(header.data() + 20, little_endian_) & 0x0FFFFFFF;     // upper bits are FCS flags
+        return link_type_ == LINKTYPE_ETHERNET || link_type_ == LINKTYPE_RAW
+            || link_type_ == LINKTYPE_LINUX_SLL || link_type_ == LINKTYPE_IPV4 || link_type_ == LINKTYPE_IPV6;
+    }
+
+    /**
+     * Read the next IP packet. The data stays valid until the next call.
+     *
+     * @return false at the end of the file.
+     */
+    bool next(const uint8_t*& packet, size_t& length)
+    {
+        std::array<uint8_t, 16> header;
+        while (read(header.data(), header.size()))
+        {
+            size_t captured = get32(header.data() + 8, little_endian_);
+            size_t original = get32(header.data() + 12, little_endian_);
+            if (captured > buffer_.size())
+            {
+                skipped_++;
+                if (!file_.seekg(captured, std::ios::cur)) return false;
+                continue;
+            }
+            if (!read(buffer_.data(), captured)) return false;
+
+            size_t offset = 0;
+            if (captured != original || !ip_offset(captured, offset))
+            {
+                skipped_++;
+                continue;
+            }
+
+            packet = buffer_.data() + offset;
+            length = captured - offset;
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t link_type() const { return link_type_; }
+
+    /// Records skipped so far.
+    size_t skipped() const { return skipped_; }
+
+private:
+    std::ifstream file_;
+    bool little_endian_ = false;
+    uint32_t link_type_ = 0;
+    size_t skipped_ = 0;
+    std::array<uint8_t, MAX_PACKET> buffer_;
+
+    bool read(uint8_t* data, size_t length)
+    {
+        return bool(file_.read(reinterpret_cast<char*>(data), length));
+    }
+
+    static uint32_t get32(const uint8_t* p, bool little_endian)
+    {
+        return little_endian
+            ? uint32_t(p[3]) << 24 | uint32_t(p[2]) << 16 | uint32_t(p[1]) << 8 | p[0]
+            : uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+    }
+
+    // Find the IP header in a captured frame.
+    bool ip_offset(size_t length, size_t& offset) const
+    {
+        uint16_t ethertype = 0;
+        switch (link_type_)
+        {
+        case LINKTYPE_ETHERNET:
+            offset = 14;
+            if (length < offset) return false;
+            ethertype = uint16_t(buffer_[12] << 8 | buffer_[13]);
+            if (ethertype == 0x8100 && length >= 18)    // one VLAN tag
+            {
+                offset = 18;
+                ethertype = uint16_t(buffer_[16] << 8 | buffer_[17]);
+            }
+            if (ethertype != 0x0800 && ethertype != 0x86DD) return false;
+            break;
+        case LINKTYPE_LINUX_SLL:
+            offset = 16;
+            if (length < offset) return false;
+            ethertype = uint16_t(buffer_[14] << 8 | buffer_[15]);
+            if (ethertype != 0x0800 && ethertype != 0x86DD) return false;
+            break;
+        default:
+            offset = 0;
+            break;
+        }
+
+        if (length <= offset) return false;
+        uint8_t version = buffer_[offset] >> 4;
+        return version == 4 || version == 6;
+    }
+};
+
+} // mobilinkd
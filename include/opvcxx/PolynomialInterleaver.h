@@ -8,10 +8,28 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 
 namespace mobilinkd
 {
 
+namespace detail
+{
+
+// The interleaver permutation, i -> (F1 * i + F2 * i^2) mod K.
+template <size_t F1, size_t F2, size_t K>
+constexpr std::array<uint16_t, K> make_interleaver_index()
+{
+    std::array<uint16_t, K> result{};
+    for (size_t i = 0; i != K; ++i)
+    {
+        // 32-bit arithmetic is just a bit too small to handle F2*i*i for OPV.
+        result[i] = static_cast<uint16_t>(((F1 * i) + ((uint64_t)F2 * i * i)) % K);
+    }
+    return result;
+}
+}
+
 // This interleaver is optimized for 16,000bps Opulent Voice frames,
 // and achieves a minimum distance proportional to that of the M17
 // interleaver. 
@@ -21,25 +39,27 @@ struct PolynomialInterleaver
     using buffer_t = std::array<int8_t, K>;
     using bytes_t = std::array<uint8_t, K / 8>;
 
-    alignas(16) buffer_t buffer_;
+    static_assert(K <= 65536);
 
-    size_t index(size_t i)
+    // Built at compile time and shared by every instance.
+    static constexpr std::array<uint16_t, K> index_ = detail::make_interleaver_index<F1, F2, K>();
+
+    static constexpr size_t index(size_t i)
     {
-        return ((F1 * i) + ((uint64_t)F2 * i * i)) % K;
-        // 32-bit arithmetic is just a bit too small to handle F2*i*i for OPV.
+        return index_[i];
     }
     
-    void interleave(buffer_t& data)
+    void interleave(buffer_t& data) const
     {
-        buffer_.fill(0);
+        alignas(16) buffer_t buffer;
 
         for (size_t i = 0; i != K; ++i)
-            buffer_[index(i)] = data[i];
+            buffer[index(i)] = data[i];
         
-        std::copy(std::begin(buffer_), std::end(buffer_), std::begin(data));
+        std::copy(std::begin(buffer), std::end(buffer), std::begin(data));
     }
 
-    void interleave(bytes_t& data)
+    void interleave(bytes_t& data) const
     {
         bytes_t buffer;
         buffer.fill(0);
@@ -50,20 +70,20 @@ struct PolynomialInterleaver
         std::copy(buffer.begin(), buffer.end(), data.begin());
     }
 
-    void deinterleave(buffer_t& frame)
+    void deinterleave(buffer_t& frame) const
     {
-        buffer_.fill(0);
+        alignas(16) buffer_t buffer;
 
         for (size_t i = 0; i != K; ++i)
         {
             auto idx = index(i);
-            buffer_[i] = frame[idx];
+            buffer[i] = frame[idx];
         }
         
-        std::copy(buffer_.begin(), buffer_.end(), frame.begin());
+        std::copy(buffer.begin(), buffer.end(), frame.begin());
     }
 
-    void deinterleave(bytes_t& data)
+    void deinterleave(bytes_t& data) const
     {
         bytes_t buffer;
         buffer.fill(0);
@@ -0,0 +1,72 @@
+// Copyright 2020-2021 Rob Riggs <rob@mobilinkd.com>
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "ConstexprMath.h"
+#include "Numerology.h"
+
+#include <array>
+#include <cstddef>
+
+namespace mobilinkd {
+
+// Root raised cosine filter taps, shared by the transmit pulse shaping
+// filter and the receive matched filter.
+namespace detail
+{
+
+constexpr double RRC_ROLLOFF = 0.5;     // excess bandwidth
+constexpr size_t RRC_SPAN = 15;         // filter length in symbols
+
+/**
+ * Root raised cosine impulse response with RRC_ROLLOFF excess bandwidth,
+ * sampled at SamplesPerSymbol and unnormalized (the peak is
+ * 1 - a + 4a/pi). The taps are centred in an odd-length response spanning
+ * just under RRC_SPAN symbols, zero-padded to RRC_SPAN * SamplesPerSymbol
+ * taps, which reproduces the table that was generated with scikit-commpy
+ * for 10 samples per symbol.
+ */
+template <typename FloatType, size_t SamplesPerSymbol>
+constexpr std::array<FloatType, RRC_SPAN * SamplesPerSymbol> make_rrc_taps()
+{
+    constexpr size_t N = RRC_SPAN * SamplesPerSymbol;
+    constexpr int CENTRE = (N - 1) / 2;
+    constexpr double a = RRC_ROLLOFF;
+
+    std::array<FloatType, N> taps{};
+    for (int i = 0; i <= 2 * CENTRE; ++i)
+    {
+        // Evaluated in the same order as scikit-commpy, for the same rounding.
+        double t = double(i - CENTRE) * (1.0 / SamplesPerSymbol);  // in symbols
+        double d = 1.0 - (4.0 * a * t) * (4.0 * a * t);
+        double h;
+        if (i == CENTRE)
+        {
+            h = 1.0 - a + 4.0 * a / M_PI;
+        }
+        else if (d > -1e-12 && d < 1e-12)
+        {
+            // t = +/-1/(4a), where the general form is 0/0.
+            h = a / M_SQRT2 * ((1.0 + 2.0 / M_PI) * constexpr_math::sin(M_PI / (4.0 * a))
+                + (1.0 - 2.0 / M_PI) * constexpr_math::cos(M_PI / (4.0 * a)));
+        }
+        else
+        {
+            h = (constexpr_math::sin(M_PI * t * (1.0 - a)) + 4.0 * a * t * constexpr_math::cos(M_PI * t * (1.0 + a)))
+                / (M_PI * t * d);
+        }
+        taps[i] = FloatType(h);
+    }
+    return taps;
+}
+
+template <typename FloatType, size_t SamplesPerSymbol = default_samples_per_symbol>
+struct Taps
+{
+    static constexpr auto rrc_taps = make_rrc_taps<FloatType, SamplesPerSymbol>();
+};
+
+} // detail
+
+} // mobilinkd
@@ -0,0 +1,177 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "ConstexprMath.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace mobilinkd
+{
+
+/**
+ * Rational polyphase resampler, for baseband at a rate other than the
+ * modem's own: from an SDR front end, a sound card, or to a transmitter
+ * that wants 48k, 250k or 2.4M samples per second.
+ *
+ * The rates' ratio is reduced to L / M, and the input is (notionally)
+ * interpolated by L, low-pass filtered and decimated by M. The filter is a
+ * Kaiser-windowed sinc cut off at 0.45 of the lower rate, split into its L
+ * phases; only the phase each output sample falls on is computed, so an
+ * output sample costs taps_per_phase() multiply-adds, whatever L and M.
+ *
+ * Filter designs are cached by ratio and shared between instances (and
+ * threads), so opening a resampler for a ratio already in use is cheap.
+ * Ratios needing more than MAX_PHASES phases (rates with only a small
+ * common factor) are rejected.
+ */
+template <typename FloatType>
+class Resampler
+{
+public:
+    static constexpr size_t MAX_PHASES = 4096;
+    static constexpr size_t DEFAULT_TAPS = 32;      // per phase, per input sample of the lower rate
+    static constexpr double CUTOFF = 0.45;          // of the lower rate
+    static constexpr double KAISER_BETA = 8.0;      // about 80dB stop band
+
+    struct Design
+    {
+        size_t interpolation;       // L
+        size_t decimation;          // M
+        size_t taps;                // per phase
+        std::vector<FloatType> coefficients;    // L phases of taps, each oldest input first
+    };
+
+    /**
+     * @param input_rate and @param output_rate are in samples per second.
+     * @param taps sets the filter length, in taps per phase when not
+     *  decimating. It is scaled up by the decimation ratio, so the
+     *  transition band stays the same fraction of the output rate.
+     * @throw invalid_argument if a rate is zero or the ratio needs more
+     *  than MAX_PHASES phases.
+     */
+    Resampler(uint32_t input_rate, uint32_t output_rate, size_t taps = DEFAULT_TAPS)
+    {
+        if (!supported(input_rate, output_rate)) throw std::invalid_argument("unsupported resampling ratio");
+        size_t common = std::gcd(input_rate, output_rate);
+        size_t interpolation = output_rate / common;
+        size_t decimation = input_rate / common;
+        taps *= (decimation + interpolation - 1) / interpolation;
+        design_ = design(interpolation, decimation, taps);
+        history_.assign(2 * taps, 0);
+    }
+
+    /// True when a resampler can be made for these rates.
+    static bool supported(uint32_t input_rate, uint32_t output_rate)
+    {
+        if (input_rate == 0 || output_rate == 0) return false;
+        return output_rate / std::gcd(input_rate, output_rate) <= MAX_PHASES;
+    }
+
+    /**
+     * The filter for interpolation L, decimation M and the given taps per
+     * phase, designed on first use and then shared.
+     */
+    static std::shared_ptr<const Design> design(size_t interpolation, size_t decimation, size_t taps)
+    {
+        static std::mutex mutex;
+        static std::map<std::tuple<size_t, size_t, size_t>, std::shared_ptr<const Design>> cache;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& entry = cache[{interpolation, decimation, taps}];
+        if (!entry) entry = make_design(interpolation, decimation, taps);
+        return entry;
+    }
+
+    /**
+     * Take one input sample, calling @p output with each output sample
+     * it completes (none, one or several).
+     */
+    template <typename Output>
+    void operator()(FloatType sample, Output&& output)
+    {
+        const size_t taps = design_->taps;
+        history_[pos_] = sample;
+        history_[pos_ + taps] = sample;
+        if (++pos_ == taps) pos_ = 0;
+
+        // history_[pos_, pos_ + taps) now holds the latest inputs, oldest first.
+        const FloatType* x = history_.data() + pos_;
+        for (; phase_ < design_->interpolation; phase_ += design_->decimation)
+        {
+            const FloatType* h = design_->coefficients.data() + phase_ * taps;
+            FloatType y = 0;
+            for (size_t k = 0; k != taps; ++k) y += h[k] * x[k];
+            output(y);
+        }
+        phase_ -= design_->interpolation;
+    }
+
+    /// Clear the filter history.
+    void reset()
+    {
+        std::fill(history_.begin(), history_.end(), 0);
+        pos_ = 0;
+        phase_ = 0;
+    }
+
+    size_t interpolation() const { return design_->interpolation; }
+    size_t decimation() const { return design_->decimation; }
+    size_t taps_per_phase() const { return design_->taps; }
+
+    /// The filter's delay, in input samples.
+    double delay() const { return (design_->taps * design_->interpolation - 1) / 2.0 / design_->interpolation; }
+
+private:
+    std::shared_ptr<const Design> design_;
+    std::vector<FloatType> history_;    // the latest inputs, twice over, so they are contiguous
+    size_t pos_ = 0;
+    size_t phase_ = 0;                  // of the next output, in 1/L input samples after the latest
+
+    static std::shared_ptr<const Design> make_design(size_t interpolation, size_t decimation, size_t taps)
+    {
+        const size_t length = interpolation * taps;
+        const double centre = (length - 1) / 2.0;
+        const double cutoff = 2 * CUTOFF / std::max(interpolation, decimation);   // of the interpolated rate's Nyquist
+        const double window_gain = constexpr_math::bessel_i0(KAISER_BETA);
+
+        std::vector<double> prototype(length);
+        double sum = 0;
+        for (size_t n = 0; n != length; ++n)
+        {
+            double t = n - centre;
+            double sinc = t == 0 ? cutoff : std::sin(M_PI * cutoff * t) / (M_PI * t);
+            double z = t / (length / 2.0);
+            double window = constexpr_math::bessel_i0(KAISER_BETA * std::sqrt(std::max(0.0, 1.0 - z * z))) / window_gain;
+            prototype[n] = sinc * window;
+            sum += prototype[n];
+        }
+
+        // Phase p takes prototype taps p, p + L, p + 2L, ... newest input
+        // first; store them oldest first, scaled for unity gain at DC.
+        auto result = std::make_shared<Design>();
+        result->interpolation = interpolation;
+        result->decimation = decimation;
+        result->taps = taps;
+        result->coefficients.resize(length);
+        for (size_t p = 0; p != interpolation; ++p)
+        {
+            for (size_t k = 0; k != taps; ++k)
+            {
+                result->coefficients[p * taps + k] = FloatType(prototype[p + (taps - 1 - k) * interpolation] * interpolation / sum);
+            }
+        }
+        return result;
+    }
+};
+
+} // mobilinkd
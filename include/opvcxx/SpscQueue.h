@@ -0,0 +1,154 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+namespace mobilinkd
+{
+
+/**
+ * A bounded, lock-free queue between exactly one producer thread and one
+ * consumer thread, for handing work from one pipeline stage to the next.
+ *
+ * The items live in a ring of SIZE slots (a power of two) inside the
+ * queue, so nothing is allocated after construction; large items make a
+ * large queue, which is best kept off the stack. Items are moved in and
+ * out.
+ *
+ * The blocking calls wait by spinning briefly, then yielding, then
+ * sleeping in steps of at most MAX_SLEEP, so a handoff to a waiting
+ * thread costs at most that much latency, and an idle stage almost no CPU.
+ *
+ * close() is called by the producer when it is done; the consumer then
+ * drains what is left, after which pop() returns false, and push()
+ * refuses new items.
+ */
+template <typename T, size_t SIZE>
+class SpscQueue
+{
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    static constexpr auto MAX_SLEEP = std::chrono::microseconds(100);
+
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /// Producer: add an item if there is room. @return false if full or closed.
+    bool try_push(T&& value)
+    {
+        if (closed_.load(std::memory_order_relaxed)) return false;
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == SIZE) return false;
+        buffer_[tail & (SIZE - 1)] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& value)
+    {
+        T copy(value);
+        return try_push(std::move(copy));
+    }
+
+    /// Producer: add an item, waiting for room. @return false if closed.
+    bool push(T value)
+    {
+        unsigned waits = 0;
+        while (!try_push(std::move(value)))
+        {
+            if (closed_.load(std::memory_order_relaxed)) return false;
+            wait(waits);
+        }
+        return true;
+    }
+
+    /// Consumer: take the oldest item, if any. @return false if empty.
+    bool try_pop(T& value)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        value = std::move(buffer_[head & (SIZE - 1)]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer: take the oldest item, waiting for one. @return false once closed and empty.
+    bool pop(T& value)
+    {
+        unsigned waits = 0;
+        for (;;)
+        {
+            if (try_pop(value)) return true;
+            // Anything pushed before close() is visible once closed_ is.
+            if (closed_.load(std::memory_order_acquire)) return try_pop(value);
+            wait(waits);
+        }
+    }
+
+    /**
+     * Consumer: take the oldest item, waiting up to @p timeout for one.
+     *
+     * @return false on timeout, or once closed and empty.
+     */
+    template <typename Rep, typename Period>
+    bool pop_for(T& value, std::chrono::duration<Rep, Period> timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        unsigned waits = 0;
+        for (;;)
+        {
+            if (try_pop(value)) return true;
+            if (closed_.load(std::memory_order_acquire)) return try_pop(value);
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+            wait(waits);
+        }
+    }
+
+    /// Producer: no more items will be pushed.
+    void close() { closed_.store(true, std::memory_order_release); }
+
+    bool is_closed() const { return closed_.load(std::memory_order_acquire); }
+
+    /// Closed, and the consumer has taken everything.
+    bool is_finished() const { return is_closed() && empty(); }
+
+    /// Items waiting; exact only on the producer or consumer thread.
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return SIZE; }
+
+private:
+    // Head and tail are only ever incremented; their difference is the
+    // number of items. Each is written by one thread and kept on its own
+    // cache line, away from the other.
+    alignas(64) std::atomic<size_t> head_{0};  // next to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail_{0};  // next to push, written by the producer
+    alignas(64) std::atomic<bool> closed_{false};
+    std::array<T, SIZE> buffer_{};
+
+    static void wait(unsigned& waits)
+    {
+        // Spin for the first 64 tries, yield for the next 64, then sleep
+        // for a little longer each time, up to MAX_SLEEP.
+        if (waits >= 128)
+        {
+            auto sleep = std::chrono::microseconds(waits - 127);
+            std::this_thread::sleep_for(sleep < MAX_SLEEP ? sleep : MAX_SLEEP);
+        }
+        else if (waits >= 64)
+        {
+            std::this_thread::yield();
+        }
+        ++waits;
+    }
+};
+
+} // mobilinkd
@@ -0,0 +1,267 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "ConstexprMath.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace mobilinkd
+{
+
+namespace detail
+{
+
+/**
+ * Interpolating filter coefficients for SymbolTiming at low oversampling:
+ * Kaiser-windowed sinc, Taps long, for Phases + 1 fractional delays mu in
+ * [0, 1] (each row normalized to unit gain). Row p interpolates at mu =
+ * p / Phases between the inputs Taps / 2 - 1 and Taps / 2 of its window.
+ */
+template <typename FloatType, size_t Taps, size_t Phases>
+constexpr std::array<std::array<FloatType, Taps>, Phases + 1> make_sinc_interpolator()
+{
+    constexpr double BETA = 6.0;    // Kaiser window shape
+    constexpr double HALF = Taps / 2;
+
+    std::array<std::array<FloatType, Taps>, Phases + 1> table{};
+    for (size_t p = 0; p <= Phases; ++p)
+    {
+        double mu = double(p) / Phases;
+        double sin_mu = constexpr_math::sin(M_PI * mu);     // sin(pi (mu - k)) = +/-sin(pi mu)
+        std::array<double, Taps> h{};
+        double sum = 0;
+        for (size_t k = 0; k != Taps; ++k)
+        {
+            int j = int(k) - int(Taps / 2 - 1);      // input position
+            double d = mu - j;
+            double sinc = (d > -0.5 && d < 0.5 && (p == 0 || p == Phases))
+                ? 1.0 : (j % 2 ? -sin_mu : sin_mu) / (M_PI * d);
+            double z = d / HALF;
+            double window = constexpr_math::bessel_i0(BETA * constexpr_math::sqrt(1.0 - z * z))
+                / constexpr_math::bessel_i0(BETA);
+            h[k] = sinc * window;
+            sum += h[k];
+        }
+        for (size_t k = 0; k != Taps; ++k) table[p][k] = FloatType(h[k] / sum);
+    }
+    return table;
+}
+
+template <typename FloatType, size_t Taps, size_t Phases>
+inline constexpr auto sinc_interpolator = make_sinc_interpolator<FloatType, Taps, Phases>();
+
+} // detail
+
+/**
+ * Symbol timing recovery: a Gardner timing-error detector driving an
+ * interpolator, which turns matched-filter output at SamplesPerSymbol
+ * samples per symbol into exactly one sample per symbol, taken at the
+ * estimated symbol centre.
+ *
+ * The interpolator is cubic Lagrange, in Farrow form, at 4 samples per
+ * symbol and more. At 2 samples per symbol that would lose several dB at
+ * the edge of the signal's band and add ISI, so an 8-tap Kaiser-windowed
+ * sinc is used instead, with its coefficients for 128 fractional delays
+ * tabulated at compile time.
+ *
+ * The interpolator runs at two strobes per symbol: one on time and one
+ * midway between symbols. For each symbol, the Gardner detector compares
+ * the mid strobe with the midpoint of the on-time samples either side of
+ * it, weighted by the difference between them,
+ *
+ *   e = (mid - (y[k] + y[k-1]) / 2) * (y[k] - y[k-1])
+ *
+ * which, unlike the plain Gardner detector, is unbiased for four-level
+ * symbols as well as two. It needs no symbol decisions, so it tracks
+ * before the deviation and offset are known. The error is normalized by
+ * the signal power, and a proportional-integral loop filter turns it into
+ * a phase correction and a symbol period estimate, so the loop follows a
+ * transmitter clock offset without a standing phase error.
+ *
+ * Strobes lag the input by DELAY samples (two for the cubic, four for the
+ * sinc) less the fractional interpolation point, as the interpolator needs
+ * samples either side of the pair it interpolates between. The phase of the strobes is set with reset(),
+ * from a sync word's position, and then tracked.
+ */
+template <typename FloatType, size_t SamplesPerSymbol>
+class SymbolTiming
+{
+public:
+    static constexpr FloatType NOMINAL_PERIOD = SamplesPerSymbol;
+    static constexpr FloatType MAX_CLOCK_ERROR = 0.002;     // 2000 ppm
+    static constexpr size_t INTERPOLATOR_TAPS = SamplesPerSymbol < 4 ? 8 : 4;
+    static constexpr size_t INTERPOLATOR_PHASES = 128;      // of the sinc interpolator
+    static constexpr size_t DELAY = INTERPOLATOR_TAPS / 2;  // samples of look-ahead
+
+    /**
+     * @param loop_bandwidth is the loop's noise bandwidth, normalized to
+     *  the symbol rate (BnT).
+     * @param damping is the loop's damping factor.
+     */
+    SymbolTiming(FloatType loop_bandwidth = 0.005, FloatType damping = 1.0)
+    {
+        bandwidth(loop_bandwidth, damping);
+        reset(0);
+    }
+
+    /// Set the loop's noise bandwidth (normalized to the symbol rate) and damping.
+    void bandwidth(FloatType loop_bandwidth, FloatType damping = 1.0)
+    {
+        FloatType theta = loop_bandwidth / (damping + 1 / (4 * damping));
+        FloatType d = 1 + 2 * damping * theta + theta * theta;
+        kp_ = 4 * damping * theta / d / TED_GAIN;
+        ki_ = 4 * theta * theta / d / TED_GAIN;
+    }
+
+    /**
+     * Place the next on-time strobe @p delay samples after the latest
+     * input sample, as when a sync word gives the symbol timing. The
+     * delay may be negative, down to 1 - DELAY, for a strobe on samples
+     * already taken. The symbol period estimate and signal power are kept
+     * unless @p full; the input history is always kept.
+     */
+    void reset(FloatType delay, bool full = false)
+    {
+        next_ = std::max(delay + DELAY, FloatType(1));
+        mid_next_ = false;
+        have_last_ = false;
+        since_ = 0;
+        if (full)
+        {
+            period_ = NOMINAL_PERIOD;
+            power_ = 0;
+        }
+    }
+
+    /**
+     * Take one input sample.
+     *
+     * @return true when an on-time strobe has been produced; symbol()
+     *  then holds the symbol sample.
+     */
+    bool operator()(FloatType sample)
+    {
+        std::copy(history_.begin() + 1, history_.end(), history_.begin());
+        history_.back() = sample;
+
+        since_ += 1;
+        next_ -= 1;
+
+        // At two samples per symbol, a half period may be under a sample,
+        // so a mid strobe and an on-time strobe can share an interval. A
+        // strobe that has fallen behind (next_ < 0) waits for the next
+        // sample instead, as it does after a large correction.
+        bool on_time = false;
+        for (int pass = 0; pass != 2 && next_ < 1 && (pass == 0 || next_ >= 0); ++pass)
+        {
+            on_time |= strobe();
+        }
+        return on_time;
+    }
+
+    /**
+     * Whether the next input sample will be interpolated by a strobe. If
+     * not, its value is never used, so the caller may skip computing it
+     * and pass anything.
+     */
+    bool wants_sample() const { return next_ < INTERPOLATOR_TAPS + 1; }
+
+    /// The latest on-time symbol sample.
+    FloatType symbol() const { return symbol_; }
+
+    /// Samples from the latest on-time strobe's sampling instant to the latest input sample.
+    FloatType since_strobe() const { return since_; }
+
+    /// Estimated transmitter clock relative to ours (> 1 is fast).
+    FloatType clock() const { return NOMINAL_PERIOD / period_; }
+
+    /// The estimated symbol period in samples.
+    FloatType period() const { return period_; }
+
+    /// The latest normalized timing error (roughly in samples; positive is late).
+    FloatType error() const { return error_ / TED_GAIN; }
+
+private:
+    // Detector output per sample of timing error, for raised-cosine
+    // pulses at 10 samples per symbol and random four-level symbols,
+    // normalized by the signal power.
+    static constexpr FloatType TED_GAIN = FloatType(0.15) * 10 / SamplesPerSymbol;
+    static constexpr FloatType POWER_ALPHA = FloatType(1) / 64;
+
+    std::array<FloatType, INTERPOLATOR_TAPS> history_{};
+    FloatType next_ = 0;            // time of the next strobe, relative to history_[DELAY - 1]
+    FloatType mu_ = 0;
+    FloatType period_ = NOMINAL_PERIOD;
+    FloatType kp_ = 0;
+    FloatType ki_ = 0;
+    bool mid_next_ = false;
+    bool have_last_ = false;
+    FloatType mid_ = 0;
+    FloatType last_ = 0;
+    FloatType symbol_ = 0;
+    FloatType power_ = 0;
+    FloatType error_ = 0;
+    FloatType since_ = 0;
+
+    // Take the strobe due at next_, which falls between history_[DELAY - 1]
+    // and history_[DELAY]. Returns true for an on-time strobe.
+    bool strobe()
+    {
+        mu_ = std::max(FloatType(0), next_);
+        FloatType y = interpolate(mu_);
+
+        if (mid_next_)
+        {
+            mid_ = y;
+            mid_next_ = false;
+            next_ += period_ / 2;
+            return false;
+        }
+
+        symbol_ = y;
+        power_ += (y * y - power_) * POWER_ALPHA;
+        error_ = 0;
+        if (have_last_ && power_ > 0)
+        {
+            error_ = (mid_ - (y + last_) / 2) * (y - last_) / power_;
+            period_ -= ki_ * error_;
+            period_ = std::clamp(period_, NOMINAL_PERIOD * (1 - MAX_CLOCK_ERROR), NOMINAL_PERIOD * (1 + MAX_CLOCK_ERROR));
+        }
+        last_ = y;
+        have_last_ = true;
+        since_ = FloatType(DELAY) - mu_;
+
+        // A positive error means the strobes are late: bring the next ones in.
+        next_ += period_ / 2 - kp_ * error_;
+        mid_next_ = true;
+        return true;
+    }
+
+    // Interpolate between history_[DELAY - 1] and history_[DELAY].
+    FloatType interpolate(FloatType mu) const
+    {
+        const auto& x = history_;
+        if constexpr (INTERPOLATOR_TAPS == 4)
+        {
+            // Cubic Lagrange, in Farrow form.
+            FloatType v3 = (x[3] - x[0]) / 6 + (x[1] - x[2]) / 2;
+            FloatType v2 = (x[0] + x[2]) / 2 - x[1];
+            FloatType v1 = x[2] - x[1] - v3 - v2;
+            return ((v3 * mu + v2) * mu + v1) * mu + x[1];
+        }
+        else
+        {
+            // Windowed sinc, at the nearest tabulated fractional delay.
+            const auto& h = detail::sinc_interpolator<FloatType, INTERPOLATOR_TAPS, INTERPOLATOR_PHASES>[
+                size_t(mu * INTERPOLATOR_PHASES + FloatType(0.5))];
+            FloatType y = 0;
+            for (size_t k = 0; k != INTERPOLATOR_TAPS; ++k) y += h[k] * x[k];
+            return y;
+        }
+    }
+};
+
+} // mobilinkd
@@ -0,0 +1,91 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace mobilinkd
+{
+
+/**
+ * Pin @p thread to run only on CPU @p cpu. A negative cpu leaves it free.
+ *
+ * @return false if the CPU does not exist or pinning is not supported
+ *  on this platform (it is on Linux).
+ */
+inline bool pin_thread(std::thread::native_handle_type thread, int cpu)
+{
+    if (cpu < 0) return true;
+#if defined(__linux__)
+    if (cpu >= CPU_SETSIZE) return false;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(thread, sizeof(cpus), &cpus) == 0;
+#else
+    (void) thread;
+    return false;
+#endif
+}
+
+inline bool pin_thread(std::thread& thread, int cpu)
+{
+    return pin_thread(thread.native_handle(), cpu);
+}
+
+/// Pin the calling thread to CPU @p cpu.
+inline bool pin_current_thread(int cpu)
+{
+#if defined(__linux__)
+    return pin_thread(pthread_self(), cpu);
+#else
+    return cpu < 0;
+#endif
+}
+
+/**
+ * Parse a comma-separated list of CPU numbers, such as "2,3,-,5", where
+ * "-" (or an empty entry) means unpinned (-1).
+ *
+ * @return false if an entry is not a number.
+ */
+inline bool parse_cpu_list(const std::string& text, std::vector<int>& cpus)
+{
+    cpus.clear();
+    if (text.empty()) return true;
+
+    std::istringstream list(text);
+    std::string entry;
+    while (std::getline(list, entry, ','))
+    {
+        if (entry.empty() || entry == "-")
+        {
+            cpus.push_back(-1);
+            continue;
+        }
+        size_t used = 0;
+        int cpu;
+        try
+        {
+            cpu = std::stoi(entry, &used);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        if (used != entry.size() || cpu < 0) return false;
+        cpus.push_back(cpu);
+    }
+    if (text.back() == ',') cpus.push_back(-1);
+    return true;
+}
+
+} // mobilinkd
@@ -0,0 +1,168 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "OPVFrameHeader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace mobilinkd
+{
+
+/// One transmission found in a recording; samples are at the recording's rate.
+struct Transmission
+{
+    uint64_t start = 0;         // estimated start of the preamble
+    uint64_t end = 0;           // end of the last frame received
+    uint32_t frames = 0;        // frames received
+    bool eos = false;           // ended with an end-of-stream frame, rather than fading out
+    std::string callsign;       // from the first frame header decoded, or empty
+
+    bool operator==(const Transmission&) const = default;
+};
+
+/**
+ * The transmissions in a baseband recording, kept in a text sidecar file
+ * next to it (the recording's name plus ".idx"), so that a receiver can go
+ * straight to one of them.
+ *
+ * The file has a version line, the sample rate and total samples, then one
+ * line per transmission: number, start and end sample, frames, whether it
+ * ended with an EOS frame, and callsign ("-" if none was decoded).
+ */
+struct TransmissionIndex
+{
+    static constexpr const char* HEADER = "# OPV transmission index 1";
+
+    uint32_t sample_rate = 0;
+    uint64_t samples = 0;
+    std::vector<Transmission> transmissions;
+
+    static std::string sidecar(const std::string& recording) { return recording + ".idx"; }
+
+    bool save(const std::string& path) const
+    {
+        std::ofstream out(path);
+        if (!out) return false;
+        out << HEADER << '\n'
+            << "sample_rate " << sample_rate << '\n'
+            << "samples " << samples << '\n'
+            << "# number start end frames eos callsign\n";
+        for (size_t i = 0; i != transmissions.size(); ++i)
+        {
+            auto& t = transmissions[i];
+            out << i << ' ' << t.start << ' ' << t.end << ' ' << t.frames << ' ' << int(t.eos) << ' '
+                << (t.callsign.empty() ? "-" : t.callsign) << '\n';
+        }
+        return bool(out);
+    }
+
+    /// @return false if the file cannot be read or is not an index.
+    bool load(const std::string& path)
+    {
+        std::ifstream in(path);
+        std::string line;
+        if (!std::getline(in, line) || line != HEADER) return false;
+
+        transmissions.clear();
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream fields(line);
+            std::string first;
+            fields >> first;
+            if (first == "sample_rate") fields >> sample_rate;
+            else if (first == "samples") fields >> samples;
+            else
+            {
+                Transmission t;
+                int eos = 0;
+                if (!(fields >> t.start >> t.end >> t.frames >> eos >> t.callsign)) return false;
+                t.eos = eos;
+                if (t.callsign == "-") t.callsign.clear();
+                transmissions.push_back(t);
+            }
+        }
+        return sample_rate != 0;
+    }
+};
+
+/**
+ * Groups received frames into transmissions. A transmission ends with an
+ * EOS frame, or when no frame has come for max_gap samples; a fade shorter
+ * than that is part of the same transmission.
+ */
+class TransmissionTracker
+{
+public:
+    /**
+     * @param frame_samples is the length of a frame in samples.
+     * @param max_gap is the longest time without frames within a
+     *  transmission, in samples.
+     */
+    TransmissionTracker(uint64_t frame_samples, uint64_t max_gap)
+    : frame_samples_(frame_samples), max_gap_(max_gap)
+    {}
+
+    /**
+     * A frame was received, ending at sample @p end. The header is used
+     * only if it was decoded (not HeaderResult::FAIL), since the decoder
+     * otherwise keeps the previous frame's.
+     */
+    void frame(uint64_t end, const OPVFrameHeader& header, OPVFrameHeader::HeaderResult result)
+    {
+        if (open_ && end > current_.end + max_gap_) close();
+        if (!open_)
+        {
+            // Back over this frame and the preamble before it.
+            current_ = Transmission{};
+            current_.start = end > 2 * frame_samples_ ? end - 2 * frame_samples_ : 0;
+            open_ = true;
+        }
+
+        current_.frames++;
+        current_.end = end;
+        if (result == OPVFrameHeader::HeaderResult::FAIL) return;
+        if (current_.callsign.empty()) current_.callsign = header.callsign.data();
+        if (header.flags & OPVFrameHeader::LAST_FRAME)
+        {
+            current_.eos = true;
+            close();
+        }
+    }
+
+    /// The recording has reached @p sample: close a transmission that has ended by then.
+    void advance(uint64_t sample)
+    {
+        if (open_ && sample > current_.end + max_gap_) close();
+    }
+
+    /// The end of the recording.
+    void finish()
+    {
+        if (open_) close();
+    }
+
+    const std::vector<Transmission>& transmissions() const { return transmissions_; }
+
+private:
+    uint64_t frame_samples_;
+    uint64_t max_gap_;
+    bool open_ = false;
+    Transmission current_;
+    std::vector<Transmission> transmissions_;
+
+    void close()
+    {
+        transmissions_.push_back(current_);
+        open_ = false;
+    }
+};
+
+} // mobilinkd
@@ -0,0 +1,117 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Log.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#if defined(__linux__)
+#include <net/if.h>
+#include <linux/if_tun.h>
+#endif
+
+namespace mobilinkd
+{
+
+/**
+ * A Linux TUN interface, read and written one IP packet at a time.
+ *
+ * The interface must already exist and be configured (for example with
+ * "ip tuntap add dev opv0 mode tun user $USER", then "ip addr" and
+ * "ip link set opv0 up"), or the process must have CAP_NET_ADMIN to
+ * create it. The descriptor is non-blocking.
+ */
+class TunDevice
+{
+public:
+    TunDevice() = default;
+    TunDevice(const TunDevice&) = delete;
+    TunDevice& operator=(const TunDevice&) = delete;
+
+    ~TunDevice()
+    {
+        close();
+    }
+
+    /// Attach to the interface @p name. @return false on failure.
+    bool open(const std::string& name)
+    {
+        close();
+#if defined(__linux__)
+        fd_ = ::open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+        if (fd_ < 0)
+        {
+            OPV_LOG_ERROR("Failure opening /dev/net/tun: {}", strerror(errno));
+            return false;
+        }
+
+        struct ifreq request;
+        memset(&request, 0, sizeof(request));
+        request.ifr_flags = IFF_TUN | IFF_NO_PI;    // bare IP packets
+        strncpy(request.ifr_name, name.c_str(), IFNAMSIZ - 1);
+        if (ioctl(fd_, TUNSETIFF, &request) < 0)
+        {
+            OPV_LOG_ERROR("Failure attaching to TUN interface {}: {}", name, strerror(errno));
+            close();
+            return false;
+        }
+        name_ = request.ifr_name;
+        return true;
+#else
+        OPV_LOG_ERROR("TUN interfaces are only supported on Linux ({})", name);
+        return false;
+#endif
+    }
+
+    void close()
+    {
+        if (fd_ < 0) return;
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    /**
+     * Read one packet into @p buffer, waiting up to @p timeout_ms for it;
+     * 0 does not wait.
+     *
+     * @return its length, or 0 if none was waiting.
+     */
+    size_t read(uint8_t* buffer, size_t capacity, int timeout_ms = 0)
+    {
+        if (fd_ < 0) return 0;
+        for (;;)
+        {
+            ssize_t result = ::read(fd_, buffer, capacity);
+            if (result > 0) return size_t(result);
+            if (result < 0 && errno == EINTR) continue;
+            if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+            if (timeout_ms <= 0) return 0;
+
+            struct pollfd fd = {fd_, POLLIN, 0};
+            if (poll(&fd, 1, timeout_ms) <= 0) return 0;
+            timeout_ms = 0;
+        }
+    }
+
+    /// Write one packet to the interface. @return false if it was not taken.
+    bool write(const uint8_t* packet, size_t length)
+    {
+        return fd_ >= 0 && ::write(fd_, packet, length) == ssize_t(length);
+    }
+
+    const std::string& name() const { return name_; }
+
+private:
+    int fd_ = -1;
+    std::string name_;
+};
+
+} // mobilinkd
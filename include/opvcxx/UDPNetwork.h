@@ -2,59 +2,320 @@
 
 #pragma once
 
+#include "Log.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 #include <stdio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+/**
+ * Batched, non-blocking UDP transport.
+ *
+ * Outgoing datagrams are copied into a batch and sent together with one
+ * sendmmsg() call when the batch is full or flush() is called; with a
+ * batch size of 1 each datagram is sent as it is queued. Incoming
+ * datagrams are read up to a batch at a time with recvmmsg().
+ *
+ * The socket is non-blocking. If the kernel cannot take a batch, the rest
+ * of it is dropped and counted rather than stalling the caller; receive()
+ * only waits if given a timeout. Nothing is logged per packet: see stats().
+ *
+ * An object is used from one thread at a time.
+ */
 struct UDPNetwork
 {
-    int udp_socket = 0;
+    static constexpr size_t MAX_DATAGRAM = 2048;    // larger datagrams are sent on their own
+
+    struct Config
+    {
+        size_t batch_size = 1;      // datagrams per sendmmsg()/recvmmsg()
+        int send_buffer = 0;        // SO_SNDBUF, bytes (0 = system default)
+        int receive_buffer = 0;     // SO_RCVBUF, bytes (0 = system default)
+        int busy_poll = 0;          // SO_BUSY_POLL, microseconds (0 = off)
+    };
+
+    struct Statistics
+    {
+        uint64_t sent = 0;              // datagrams
+        uint64_t send_calls = 0;        // system calls used to send them
+        uint64_t dropped = 0;           // not sent because the socket was full
+        uint64_t send_errors = 0;       // not sent because of any other error
+        uint64_t received = 0;          // datagrams
+        uint64_t receive_calls = 0;     // system calls that returned datagrams
+        uint64_t truncated = 0;         // received datagrams longer than MAX_DATAGRAM
+        uint64_t receive_errors = 0;
+    };
+
+    int udp_socket = -1;
     struct sockaddr_in dest_address;
 
+    UDPNetwork() = default;
+    UDPNetwork(const UDPNetwork&) = delete;
+    UDPNetwork& operator=(const UDPNetwork&) = delete;
+
+    ~UDPNetwork()
+    {
+        close();
+    }
+
+    /**
+     * Create the socket, bound to @p local_port on all interfaces (0 picks
+     * a free port).
+     *
+     * @return false on failure.
+     */
+    bool open(uint16_t local_port)
+    {
+        return open(local_port, Config());
+    }
+
+    bool open(uint16_t local_port, const Config& config)
+    {
+        close();
+        config_ = config;
+        if (config_.batch_size == 0) config_.batch_size = 1;
+
+        udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (udp_socket < 0)
+        {
+            OPV_LOG_ERROR("Failure creating network socket: {}", strerror(errno));
+            return false;
+        }
+        fcntl(udp_socket, F_SETFL, fcntl(udp_socket, F_GETFL) | O_NONBLOCK);
+
+        if (config_.send_buffer) set_option(SO_SNDBUF, config_.send_buffer, "SO_SNDBUF");
+        if (config_.receive_buffer) set_option(SO_RCVBUF, config_.receive_buffer, "SO_RCVBUF");
+#ifdef SO_BUSY_POLL
+        if (config_.busy_poll) set_option(SO_BUSY_POLL, config_.busy_poll, "SO_BUSY_POLL");
+#endif
+
+        struct sockaddr_in my_address;
+        memset(&my_address, 0, sizeof(my_address));
+        my_address.sin_family = AF_INET;
+        my_address.sin_port = htons(local_port);
+        my_address.sin_addr.s_addr = INADDR_ANY;
+
+        if (bind(udp_socket, (const struct sockaddr *)&my_address, sizeof(my_address)) < 0)
+        {
+            OPV_LOG_ERROR("Failure binding to network socket: {}", strerror(errno));
+            ::close(udp_socket);
+            udp_socket = -1;
+            return false;
+        }
+
+        send_buffers_.assign(config_.batch_size * MAX_DATAGRAM, 0);
+        receive_buffers_.assign(config_.batch_size * MAX_DATAGRAM, 0);
+        send_lengths_.assign(config_.batch_size, 0);
+        messages_.resize(config_.batch_size);
+        iovecs_.resize(config_.batch_size);
+        pending_ = 0;
+        return true;
+    }
+
+    /// Where send_packet() sends to.
+    bool destination(const std::string& ipaddr, uint16_t port)
+    {
+        memset(&dest_address, 0, sizeof(dest_address));
+        dest_address.sin_family = AF_INET;
+        dest_address.sin_port = htons(port);
+        return inet_pton(AF_INET, ipaddr.c_str(), &dest_address.sin_addr) == 1;
+    }
+
+    /// Send any queued datagrams and close the socket.
+    void close()
+    {
+        if (udp_socket < 0) return;
+        flush();
+        ::close(udp_socket);
+        udp_socket = -1;
+    }
+
+    /// The port the socket is bound to.
+    uint16_t local_port() const
+    {
+        struct sockaddr_in address;
+        socklen_t length = sizeof(address);
+        if (udp_socket < 0 || getsockname(udp_socket, (struct sockaddr *)&address, &length) < 0) return 0;
+        return ntohs(address.sin_port);
+    }
+
+    /**
+     * Queue a datagram for the destination, sending the batch if it is
+     * full.
+     */
     void send_packet(const int length, const uint8_t *buffer)
     {
-        if (udp_socket > 0)
+        if (udp_socket < 0) return;
+
+        if (size_t(length) > MAX_DATAGRAM)
         {
-            if ((sendto(udp_socket, buffer, length, 0, (const struct sockaddr *)&dest_address, (socklen_t)sizeof(dest_address))) < 0)
+            flush();
+            stats_.send_calls++;
+            if (sendto(udp_socket, buffer, length, 0, (const struct sockaddr *)&dest_address, sizeof(dest_address)) < 0)
             {
-                std::cerr << "Error sending to network socket" << std::endl;
+                send_failed(1);
             }
             else
             {
-                std::cerr << "frame out to UDP " << length << " bytes" << std::endl;
+                stats_.sent++;
             }
+            return;
         }
+
+        memcpy(send_buffers_.data() + pending_ * MAX_DATAGRAM, buffer, length);
+        send_lengths_[pending_++] = length;
+        if (pending_ == config_.batch_size) flush();
     }
 
-    void network_setup(std::string ipaddr, const uint16_t port)
+    /// Send the queued datagrams now.
+    void flush()
     {
-        struct sockaddr_in my_address_;
-        char readback[INET_ADDRSTRLEN];
+        size_t next = 0;
+        while (next != pending_)
+        {
+            size_t count = pending_ - next;
+            for (size_t i = 0; i != count; ++i)
+            {
+                iovecs_[i].iov_base = send_buffers_.data() + (next + i) * MAX_DATAGRAM;
+                iovecs_[i].iov_len = send_lengths_[next + i];
+                prepare(messages_[i], iovecs_[i], &dest_address);
+            }
 
-        udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
-        if (udp_socket < 0)
+            stats_.send_calls++;
+            int result = sendmmsg(udp_socket, messages_.data(), count, 0);
+            if (result < 0)
+            {
+                if (errno == EINTR) continue;
+                send_failed(count);
+                break;
+            }
+            stats_.sent += result;
+            next += result;
+        }
+        pending_ = 0;
+    }
+
+    /**
+     * Read up to a batch of the datagrams waiting on the socket, passing
+     * each to @p handler as handler(data, length). Waits up to
+     * @p timeout_ms for one to arrive; 0 does not wait.
+     *
+     * @return the number of datagrams received.
+     */
+    template <typename Handler>
+    size_t receive(Handler&& handler, int timeout_ms = 0)
+    {
+        if (udp_socket < 0) return 0;
+
+        size_t count = config_.batch_size;
+        for (size_t i = 0; i != count; ++i)
         {
-            std::cerr << "Failure creating network socket" << std::endl;
+            iovecs_[i].iov_base = receive_buffers_.data() + i * MAX_DATAGRAM;
+            iovecs_[i].iov_len = MAX_DATAGRAM;
+            prepare(messages_[i], iovecs_[i], nullptr);
         }
 
-        memset(&my_address_, 0, sizeof(my_address_));
-        my_address_.sin_family = AF_INET;
-        my_address_.sin_port = htons(port);
-        my_address_.sin_addr.s_addr = INADDR_ANY;
+        int result;
+        for (;;)
+        {
+            result = recvmmsg(udp_socket, messages_.data(), count, MSG_DONTWAIT, nullptr);
+            if (result >= 0) break;
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                stats_.receive_errors++;
+                return 0;
+            }
+            if (timeout_ms <= 0) return 0;
+
+            struct pollfd fd = {udp_socket, POLLIN, 0};
+            if (poll(&fd, 1, timeout_ms) <= 0) return 0;
+            timeout_ms = 0;     // waited once
+        }
 
-        if (bind(udp_socket, (const struct sockaddr *)&my_address_, sizeof(my_address_)) < 0)
+        stats_.receive_calls++;
+        for (int i = 0; i != result; ++i)
         {
-            std::cerr << "Failure binding to network socket" << std::endl;
-            udp_socket = 0;
+            if (messages_[i].msg_hdr.msg_flags & MSG_TRUNC) stats_.truncated++;
+            handler(static_cast<const uint8_t*>(iovecs_[i].iov_base), size_t(messages_[i].msg_len));
         }
+        stats_.received += result;
+        return result;
+    }
 
-        dest_address.sin_family = AF_INET;
-        dest_address.sin_port = htons(port);
-        inet_pton(AF_INET, const_cast<char*>(ipaddr.c_str()), &(dest_address.sin_addr));
+    /**
+     * Open a socket that sends to @p ipaddr, @p port. It is bound to any
+     * free local port, so that a receiver on the same host can use @p port.
+     */
+    void network_setup(std::string ipaddr, const uint16_t port)
+    {
+        network_setup(ipaddr, port, Config());
+    }
+
+    void network_setup(std::string ipaddr, const uint16_t port, const Config& config)
+    {
+        char readback[INET_ADDRSTRLEN];
+
+        if (!open(0, config))
+        {
+            std::cerr << "Failure setting up network socket" << std::endl;
+        }
+
+        destination(ipaddr, port);
         inet_ntop(AF_INET, &(dest_address.sin_addr), readback, INET_ADDRSTRLEN);
         std::cerr << "Output to network IP = " << readback << " port = " << port << std::endl;
     }
-};
\ No newline at end of file
+
+    const Statistics& stats() const { return stats_; }
+
+private:
+    Config config_;
+    Statistics stats_;
+    std::vector<uint8_t> send_buffers_;     // batch_size slots of MAX_DATAGRAM bytes
+    std::vector<uint8_t> receive_buffers_;
+    std::vector<size_t> send_lengths_;
+    std::vector<struct mmsghdr> messages_;
+    std::vector<struct iovec> iovecs_;
+    size_t pending_ = 0;
+
+    static void prepare(struct mmsghdr& message, struct iovec& iov, struct sockaddr_in* address)
+    {
+        memset(&message, 0, sizeof(message));
+        message.msg_hdr.msg_iov = &iov;
+        message.msg_hdr.msg_iovlen = 1;
+        message.msg_hdr.msg_name = address;
+        message.msg_hdr.msg_namelen = address ? sizeof(*address) : 0;
+    }
+
+    void set_option(int option, int value, const char* name)
+    {
+        if (setsockopt(udp_socket, SOL_SOCKET, option, &value, sizeof(value)) < 0)
+        {
+            OPV_LOG_WARN("Failure setting {}: {}", name, strerror(errno));
+        }
+    }
+
+    void send_failed(size_t count)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+        {
+            stats_.dropped += count;
+        }
+        else
+        {
+            if (stats_.send_errors == 0) OPV_LOG_WARN("Error sending to network socket: {}", strerror(errno));
+            stats_.send_errors += count;
+        }
+    }
+};
@@ -13,6 +13,8 @@
 #include <cstdint>
 #include <iterator>
 #include <limits>
+#include <span>
+#include <tuple>
 
 namespace mobilinkd
 {
@@ -20,11 +22,10 @@ namespace mobilinkd
 /**
  * Compile-time build of the trellis forward state transitions.
  *
- * @param is the trellis -- used only for type deduction.
  * @return a 2-D array of source, dest, cost.
  */
 template <typename Trellis_>
-constexpr std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)> makeNextState(Trellis_)
+constexpr std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)> makeNextState()
 {
     std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)> result{};
     for (size_t i = 0; i != (1 << Trellis_::K); ++i)
@@ -37,16 +38,24 @@ constexpr std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)
     return result;
 }
 
+/**
+ * @param is the trellis -- used only for type deduction.
+ */
+template <typename Trellis_>
+constexpr std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)> makeNextState(Trellis_)
+{
+    return makeNextState<Trellis_>();
+}
+
 
 /**
  * Compile-time build of the trellis reverse state transitions, for efficient
  * reverse traversal during chainback.
  *
- * @param is the trellis -- used only for type deduction.
  * @return a 2-D array of dest, source, cost.
  */
 template <typename Trellis_>
-constexpr std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)> makePrevState(Trellis_)
+constexpr std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)> makePrevState()
 {
     constexpr size_t NumStates = (1 << Trellis_::K);
     constexpr size_t HalfStates = NumStates / 2;
@@ -64,6 +73,15 @@ constexpr std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)
     return result;
 }
 
+/**
+ * @param is the trellis -- used only for type deduction.
+ */
+template <typename Trellis_>
+constexpr std::array<std::array<uint8_t, (1 << Trellis_::k)>, (1 << Trellis_::K)> makePrevState(Trellis_)
+{
+    return makePrevState<Trellis_>();
+}
+
 /**
  * Compile-time generation of the trellis path cost for LLR.
  *
@@ -108,10 +126,14 @@ struct Viterbi
     using cost_t = std::array<std::array<int16_t, n>, NumStates>;
     using state_transition_t = std::array<std::array<uint8_t, 2>, NumStates>;
 
+    // The state transitions depend only on the trellis size, and are built
+    // at compile time and shared. The cost table depends on the trellis's
+    // polynomials, which are given at run time, but is small.
+    static constexpr state_transition_t nextState_ = makeNextState<Trellis_>();
+    static constexpr state_transition_t prevState_ = makePrevState<Trellis_>();
+
     metrics_t pathMetrics_{};
     cost_t cost_;
-    state_transition_t nextState_;
-    state_transition_t prevState_;
 
     metrics_t prevMetrics, currMetrics;
 
@@ -122,8 +144,6 @@ struct Viterbi
 
     Viterbi(Trellis_ trellis)
     : cost_(makeCost<Trellis_, LLR_>(trellis))
-    , nextState_(makeNextState(trellis))
-    , prevState_(makePrevState(trellis))
     {}
 
     void calculate_path_metric(
@@ -162,6 +182,66 @@ struct Viterbi
      */
     template <size_t IN, size_t OUT>
     size_t decode(std::array<int8_t, IN> const& in, std::array<uint8_t, OUT>& out)
+    {
+        auto [cost, next_element] = forward<IN>(in.data());
+
+        // Do chainback.
+        auto oit = std::rbegin(out);
+        auto hit = std::make_reverse_iterator(history_.begin() + IN / 2);   // rbegin
+        auto hrend = std::make_reverse_iterator(history_.begin());          // rend
+        size_t index = IN / 2;
+        while (oit != std::rend(out) && hit != hrend)
+        {
+            auto v = (*hit++)[next_element];
+            if (index-- <= OUT) *oit++ = next_element & 1;
+            next_element = prevState_[next_element][v];
+        }
+
+        return cost;
+    }
+
+    /**
+     * Viterbi soft decoder writing the decoded bits packed MSB first, for
+     * decoding straight into a frame's byte buffer.  The flush (tail) bits
+     * at the end of the input are dropped.
+     *
+     * @return path metric for estimating BER.
+     */
+    template <size_t IN, size_t BYTES>
+    size_t decode(std::span<const int8_t, IN> in, std::span<uint8_t, BYTES> out)
+    {
+        constexpr size_t OUT = BYTES * 8;
+        static_assert(OUT <= IN / 2);
+
+        auto [cost, next_element] = forward<IN>(in.data());
+
+        // Skip the flush bits, then chain back through the output bits,
+        // last bit first, shifting each into the top of the current byte.
+        size_t hindex = IN / 2;
+        while (hindex != OUT)
+        {
+            next_element = prevState_[next_element][history_[--hindex][next_element]];
+        }
+
+        uint8_t byte = 0;
+        while (hindex != 0)
+        {
+            byte = (byte >> 1) | ((next_element & 1) << 7);
+            next_element = prevState_[next_element][history_[--hindex][next_element]];
+            if ((hindex & 7) == 0) out[hindex / 8] = byte;
+        }
+
+        return cost;
+    }
+
+    /**
+     * Forward pass: run the add-compare-select over IN soft bits, filling
+     * history_.
+     *
+     * @return the path cost and the final state to start chainback from.
+     */
+    template <size_t IN>
+    std::tuple<size_t, size_t> forward(const int8_t* in)
     {
         static_assert(sizeof(history_) >= IN / 2);
 
@@ -170,9 +250,6 @@ struct Viterbi
         prevMetrics.fill(MAX_METRIC);
         prevMetrics[0] = 0;     // Starting point.
 
-        auto hbegin = history_.begin();
-        auto hend = history_.begin() + IN / 2;
-
         constexpr size_t BUTTERFLY_SIZE = NumStates / 2;
 
         size_t hindex = 0;
@@ -222,21 +299,7 @@ struct Viterbi
         }
 
         size_t cost = std::round(min_cost / float(detail::llr_limit<LLR_>()));
-
-        // Do chainback.
-        auto oit = std::rbegin(out);
-        auto hit = std::make_reverse_iterator(hend);        // rbegin
-        auto hrend = std::make_reverse_iterator(hbegin);    // rend
-        size_t next_element = min_element;
-        size_t index = IN / 2;
-        while (oit != std::rend(out) && hit != hrend)
-        {
-            auto v = (*hit++)[next_element];
-            if (index-- <= OUT) *oit++ = next_element & 1;
-            next_element = prevState_[next_element][v];
-        }
-
-        return cost;
+        return {cost, min_element};
     }
 };
 
@@ -0,0 +1,185 @@
+#include "AudioSink.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class AudioSinkTest : public ::testing::Test {
+ protected:
+
+  // The fake codec marks each output frame with the packet's first byte,
+  // or -1 for concealment.
+  std::mutex mutex;
+  std::vector<int> played;
+  std::atomic<bool> hold{false};
+
+  AudioSink::decode_callback_t decode = [](const uint8_t* packet, size_t, int16_t* pcm, size_t samples)
+  {
+      for (size_t i = 0; i != samples; ++i) pcm[i] = packet ? packet[0] : -1;
+      return int(samples);
+  };
+
+  AudioSink::output_callback_t output = [this](const int16_t* pcm, size_t samples)
+  {
+      while (hold) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      EXPECT_EQ(samples, size_t(audio_samples_per_opv_frame));
+      std::lock_guard<std::mutex> lock(mutex);
+      played.push_back(pcm[0]);
+  };
+
+  static bool push(AudioSink& sink, uint8_t id, uint64_t frame, int64_t jitter = 0, bool blank = false)
+  {
+      AudioSink::packet_t packet{};
+      packet[0] = id;
+      return sink.push(packet.data(), packet.size(), frame * samples_per_frame + jitter, blank);
+  }
+
+  // Retry while the queue is full, for tests that push more than it holds.
+  static void push_paced(AudioSink& sink, uint8_t id, uint64_t frame, int64_t jitter = 0)
+  {
+      while (!push(sink, id, frame, jitter)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+};
+
+TEST_F(AudioSinkTest, plays_in_order)
+{
+    AudioSink sink(decode, output);
+    for (uint8_t i = 1; i != 11; ++i) EXPECT_TRUE(push(sink, i, i));
+    sink.stop();
+
+    EXPECT_EQ(played, std::vector<int>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+    EXPECT_EQ(sink.stats().decoded, 10u);
+    EXPECT_EQ(sink.stats().concealed, 0u);
+    EXPECT_EQ(sink.stats().instrumentation.stage(Stage::OPUS).count(), Instrumentation::enabled ? 10u : 0u);
+}
+
+TEST_F(AudioSinkTest, conceals_missing_frames)
+{
+    AudioSink sink(decode, output);
+    push(sink, 1, 1);
+    push(sink, 2, 2);
+    push(sink, 5, 5);
+    push(sink, 6, 6);
+    sink.stop();
+
+    EXPECT_EQ(played, std::vector<int>({1, 2, -1, -1, 5, 6}));
+    EXPECT_EQ(sink.stats().concealed, 2u);
+}
+
+TEST_F(AudioSinkTest, long_gap_starts_new_stream)
+{
+    AudioSink sink(decode, output);
+    push(sink, 1, 1);
+    push(sink, 2, 2 + AudioSink::MAX_GAP + 5);
+    sink.stop();
+
+    EXPECT_EQ(played, std::vector<int>({1, 2}));
+}
+
+TEST_F(AudioSinkTest, drops_out_of_order_packets)
+{
+    AudioSink::Config config;
+    config.min_depth = 3;
+    AudioSink sink(decode, output, config);
+    push(sink, 1, 1);
+    push(sink, 3, 3);
+    push(sink, 2, 2);
+    push(sink, 4, 4);
+    sink.stop();
+
+    EXPECT_EQ(played, std::vector<int>({1, -1, 3, 4}));
+    EXPECT_EQ(sink.stats().late, 1u);
+}
+
+TEST_F(AudioSinkTest, follows_clock_drift)
+{
+    AudioSink sink(decode, output);
+    // 1% slow: without tracking this would open a gap every 50 frames.
+    for (uint8_t i = 1; i != 200; ++i) push_paced(sink, i, i, i * samples_per_frame / 100);
+    sink.stop();
+
+    EXPECT_EQ(played.size(), 199u);
+    EXPECT_EQ(sink.stats().concealed, 0u);
+}
+
+TEST_F(AudioSinkTest, blanks_frames)
+{
+    AudioSink sink(decode, output);
+    push(sink, 1, 1);
+    push(sink, 2, 2, 0, true);
+    push(sink, 3, 3);
+    sink.stop();
+
+    EXPECT_EQ(played, std::vector<int>({1, 0, 3}));
+    EXPECT_EQ(sink.stats().blanked, 1u);
+}
+
+TEST_F(AudioSinkTest, end_of_stream_flushes)
+{
+    AudioSink::Config config;
+    config.min_depth = 4;
+    AudioSink sink(decode, output, config);
+    push(sink, 1, 1);
+    push(sink, 2, 2);
+    sink.end_of_stream();
+
+    for (int i = 0; i != 1000; ++i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (played.size() == 2) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(played, std::vector<int>({1, 2}));
+    }
+    sink.stop();
+}
+
+TEST_F(AudioSinkTest, jitter_deepens_buffer)
+{
+    AudioSink::Config config;
+    config.max_depth = 6;
+    AudioSink sink(decode, output, config);
+    for (uint8_t i = 1; i != 60; ++i) push_paced(sink, i, i, (i % 2) ? samples_per_frame / 3 : 0);
+    sink.stop();
+
+    EXPECT_GT(sink.stats().jitter, samples_per_frame / 8);
+    EXPECT_GT(sink.stats().depth, 1u);
+    EXPECT_LE(sink.stats().depth, 6u);
+}
+
+TEST_F(AudioSinkTest, push_never_blocks)
+{
+    hold = true;    // a stalled audio output
+    AudioSink sink(decode, output);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t accepted = 0;
+    for (uint64_t i = 0; i != 4 * AudioSink::QUEUE_SIZE; ++i) accepted += push(sink, 1, i);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_LT(elapsed, std::chrono::milliseconds(100));
+    EXPECT_LT(accepted, 4 * AudioSink::QUEUE_SIZE);
+    EXPECT_EQ(sink.stats().overflows, 4 * AudioSink::QUEUE_SIZE - accepted);
+
+    hold = false;
+    sink.stop();
+}
@@ -0,0 +1,137 @@
+#include "BasebandFile.h"
+#include "CompressedBaseband.h"
+#include "MappedFile.h"
+#include "TempPath.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class BasebandFileTest : public ::testing::Test {
+ protected:
+
+  std::string path = temp_path(".raw");
+
+  // A ramp that gives each sample's number.
+  std::vector<int16_t> samples(size_t count)
+  {
+      std::vector<int16_t> result(count);
+      for (size_t i = 0; i != count; ++i) result[i] = int16_t(i * 3 - 15000);
+      return result;
+  }
+
+  void write_raw(const std::vector<int16_t>& data)
+  {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(int16_t));
+  }
+
+  void write_compressed(const std::vector<int16_t>& data)
+  {
+      CompressedBasebandWriter writer;
+      ASSERT_TRUE(writer.open(path, 250000));
+      ASSERT_TRUE(writer.write(data.data(), data.size()));
+      ASSERT_TRUE(writer.close());
+  }
+
+  // Read to the end, in odd-sized pieces.
+  std::vector<int16_t> read_all(BasebandFile& file)
+  {
+      std::vector<int16_t> result;
+      std::vector<int16_t> buffer(777);
+      while (size_t count = file.read(buffer.data(), buffer.size()))
+      {
+          result.insert(result.end(), buffer.begin(), buffer.begin() + count);
+      }
+      return result;
+  }
+
+  // void SetUp() override {}
+  void TearDown() override { std::remove(path.c_str()); }
+
+};
+
+TEST_F(BasebandFileTest, mapped_file)
+{
+    MappedFile file;
+    EXPECT_FALSE(file.open(path));
+    EXPECT_FALSE(file.is_open());
+
+    write_raw({});
+    ASSERT_TRUE(file.open(path));
+    EXPECT_EQ(file.size(), 0u);
+    EXPECT_EQ(file.data(), nullptr);
+
+    write_raw({1, 2, 3});
+    ASSERT_TRUE(file.open(path));
+    ASSERT_EQ(file.size(), 6u);
+    EXPECT_EQ(file.data()[2], 2);
+    file.close();
+    EXPECT_FALSE(file.is_open());
+}
+
+TEST_F(BasebandFileTest, raw)
+{
+    auto data = samples(10000);
+    write_raw(data);
+
+    BasebandFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_FALSE(file.compressed());
+    EXPECT_EQ(file.sample_rate(), 0u);
+    EXPECT_EQ(file.size(), data.size());
+    EXPECT_EQ(read_all(file), data);
+    EXPECT_EQ(file.position(), data.size());
+}
+
+TEST_F(BasebandFileTest, raw_range)
+{
+    auto data = samples(10000);
+    write_raw(data);
+
+    BasebandFile file;
+    ASSERT_TRUE(file.open(path));
+    ASSERT_TRUE(file.range(1234, 5678));
+    EXPECT_EQ(file.position(), 1234u);
+    EXPECT_EQ(read_all(file), std::vector<int16_t>(data.begin() + 1234, data.begin() + 5678));
+
+    // To the end, and past it.
+    ASSERT_TRUE(file.range(9000, 20000));
+    EXPECT_EQ(read_all(file), std::vector<int16_t>(data.begin() + 9000, data.end()));
+    EXPECT_TRUE(file.range(10000));
+    EXPECT_TRUE(read_all(file).empty());
+    EXPECT_FALSE(file.range(10001));
+}
+
+TEST_F(BasebandFileTest, compressed_range)
+{
+    auto data = samples(3 * CompressedBaseband::BLOCK_SIZE + 100);
+    write_compressed(data);
+
+    BasebandFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_TRUE(file.compressed());
+    EXPECT_EQ(file.sample_rate(), 250000u);
+    EXPECT_EQ(file.size(), data.size());
+    EXPECT_EQ(read_all(file), data);
+
+    // Within a block, and across blocks from the middle of one.
+    ASSERT_TRUE(file.range(5000, 5010));
+    EXPECT_EQ(read_all(file), std::vector<int16_t>(data.begin() + 5000, data.begin() + 5010));
+    ASSERT_TRUE(file.range(100, 9000));
+    EXPECT_EQ(read_all(file), std::vector<int16_t>(data.begin() + 100, data.begin() + 9000));
+    ASSERT_TRUE(file.range(12000));
+    EXPECT_EQ(read_all(file), std::vector<int16_t>(data.begin() + 12000, data.end()));
+    EXPECT_FALSE(file.range(data.size() + 1));
+}
@@ -0,0 +1,145 @@
+#include "ChannelSimulator.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class ChannelSimulatorTest : public ::testing::Test {
+ protected:
+
+  std::vector<int16_t> input;
+
+  void SetUp() override
+  {
+    // A slow tone, well inside the IF bandwidth, at about one symbol unit.
+    input.resize(20000);
+    for (size_t i = 0; i != input.size(); ++i)
+    {
+        input[i] = int16_t(7168.0 * std::sin(2.0 * M_PI * 1000.0 * i / sample_rate));
+    }
+  }
+
+  std::vector<double> run(const ChannelImpairments& impairments, uint64_t seed = 1)
+  {
+    ChannelSimulator channel(impairments, seed);
+    std::vector<double> output;
+    channel(input.data(), input.size(), [&output](double sample) { output.push_back(sample); });
+    return output;
+  }
+
+  // void TearDown() override {}
+
+};
+
+TEST_F(ChannelSimulatorTest, clean_channel_passes_baseband)
+{
+    ChannelImpairments impairments;
+    auto output = run(impairments);
+    ASSERT_EQ(output.size(), input.size());
+
+    // The IF filter delays the signal by half its length, the resampler by one sample.
+    const size_t delay = (ChannelSimulator::IF_FILTER_TAPS - 1) / 2 + 1;
+    for (size_t i = 1000; i != input.size(); ++i)
+    {
+        EXPECT_NEAR(output[i], input[i - delay], 100.0) << "at " << i;
+    }
+}
+
+TEST_F(ChannelSimulatorTest, frequency_offset_is_dc)
+{
+    ChannelImpairments impairments;
+    impairments.frequency_offset_hz = 600.0;
+    auto output = run(impairments);
+
+    double sum = 0.0;
+    for (size_t i = 1000; i != 1000 + 16260; ++i) sum += output[i];   // whole cycles of the tone
+    double expected = 600.0 / impairments.deviation_hz * ChannelSimulator::BASEBAND_SCALE;
+    EXPECT_NEAR(sum / 16260, expected, 20.0);
+}
+
+TEST_F(ChannelSimulatorTest, deviation_error_scales)
+{
+    ChannelImpairments impairments;
+    impairments.deviation_error = 0.1;
+    auto output = run(impairments);
+
+    const size_t delay = (ChannelSimulator::IF_FILTER_TAPS - 1) / 2 + 1;
+    for (size_t i = 1000; i < input.size(); i += 97)
+    {
+        EXPECT_NEAR(output[i], 1.1 * input[i - delay], 120.0) << "at " << i;
+    }
+}
+
+TEST_F(ChannelSimulatorTest, clock_error_changes_length)
+{
+    ChannelImpairments impairments;
+    impairments.clock_ppm = 1000.0;
+    auto fast = run(impairments);
+    impairments.clock_ppm = -1000.0;
+    auto slow = run(impairments);
+
+    EXPECT_NEAR(double(fast.size()), input.size() / 1.001, 1.0);
+    EXPECT_NEAR(double(slow.size()), input.size() / 0.999, 1.0);
+}
+
+TEST_F(ChannelSimulatorTest, noise_follows_ebn0)
+{
+    auto noise_power = [this](double ebn0_db)
+    {
+        ChannelImpairments clean;
+        ChannelImpairments noisy;
+        noisy.ebn0_db = ebn0_db;
+        auto reference = run(clean);
+        auto output = run(noisy);
+        double power = 0.0;
+        for (size_t i = 1000; i != output.size(); ++i)
+        {
+            double error = output[i] - reference[i];
+            power += error * error;
+        }
+        return power / (output.size() - 1000);
+    };
+
+    auto high = noise_power(20.0);
+    auto low = noise_power(30.0);
+    EXPECT_GT(high, 0.0);
+    // Above threshold FM noise power goes as 1/CNR: 10 dB more Eb/N0 is 10x less noise.
+    EXPECT_NEAR(10.0 * std::log10(high / low), 10.0, 1.5);
+}
+
+TEST_F(ChannelSimulatorTest, seeds_are_independent)
+{
+    ChannelImpairments impairments;
+    impairments.ebn0_db = 15.0;
+
+    auto first = run(impairments, 1);
+    auto again = run(impairments, 1);
+    auto second = run(impairments, 2);
+
+    EXPECT_EQ(first, again);
+    EXPECT_NE(first, second);
+}
+
+TEST_F(ChannelSimulatorTest, multipath_echo)
+{
+    ChannelImpairments impairments;
+    impairments.echoes.push_back({5, 0.5, M_PI});
+    auto output = run(impairments);
+    ASSERT_EQ(output.size(), input.size());
+
+    // A weak echo leaves the (slow) modulation mostly intact.
+    const size_t delay = (ChannelSimulator::IF_FILTER_TAPS - 1) / 2 + 1;
+    double error = 0.0;
+    for (size_t i = 1000; i != input.size(); ++i) error += std::abs(output[i] - input[i - delay]);
+    EXPECT_LT(error / (input.size() - 1000), 0.2 * 7168.0);
+    EXPECT_GT(error / (input.size() - 1000), 1.0);
+}
@@ -0,0 +1,290 @@
+#include "CompressedBaseband.h"
+#include "FirFilter.h"
+#include "RRCTaps.h"
+#include "TempPath.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class CompressedBasebandTest : public ::testing::Test {
+ protected:
+
+  std::string path = temp_path(".opvz");
+
+  // 4-FSK symbols through the RRC filter at 10 samples per symbol, with a
+  // little noise: like the modulator's output.
+  std::vector<int16_t> baseband(size_t count, double noise = 2.0)
+  {
+      std::mt19937 rng(1);
+      std::normal_distribution<double> gaussian(0, noise);
+      BaseFirFilter<double, detail::Taps<double, 10>::rrc_taps.size()> rrc{detail::Taps<double, 10>::rrc_taps};
+      std::vector<int16_t> result;
+      const int levels[] = {-3, -1, 1, 3};
+      for (size_t i = 0; i != count; ++i)
+      {
+          double symbol = i % 10 == 0 ? levels[rng() % 4] : 0.0;
+          result.push_back(int16_t(std::lround(rrc(symbol) * 3000 + gaussian(rng))));
+      }
+      return result;
+  }
+
+  std::vector<int16_t> read_all(CompressedBasebandReader& reader)
+  {
+      std::vector<int16_t> result;
+      std::array<int16_t, 1000> buffer;
+      while (size_t count = reader.read(buffer.data(), buffer.size())) result.insert(result.end(), buffer.begin(), buffer.begin() + count);
+      return result;
+  }
+
+  void write(const std::vector<int16_t>& samples, size_t chunk = 1000)
+  {
+      CompressedBasebandWriter writer;
+      ASSERT_TRUE(writer.open(path, 271000));
+      for (size_t i = 0; i < samples.size(); i += chunk)
+      {
+          ASSERT_TRUE(writer.write(samples.data() + i, std::min(chunk, samples.size() - i)));
+      }
+      EXPECT_EQ(writer.samples(), samples.size());
+      EXPECT_TRUE(writer.close());
+  }
+
+  // void SetUp() override {}
+  void TearDown() override { std::remove(path.c_str()); }
+
+};
+
+TEST_F(CompressedBasebandTest, bits_round_trip)
+{
+    std::vector<uint8_t> data;
+    detail::BitWriter writer(data);
+    writer.put(5, 3);
+    writer.unary(0);
+    writer.unary(70);
+    writer.put(0x1FFFFF, 21);
+    writer.put(0, 0);
+    writer.flush();
+
+    detail::BitReader reader(data.data(), data.size());
+    EXPECT_EQ(reader.get(3), 5u);
+    EXPECT_EQ(reader.unary(), 0u);
+    EXPECT_EQ(reader.unary(), 70u);
+    EXPECT_EQ(reader.get(21), 0x1FFFFFu);
+    EXPECT_FALSE(reader.overrun());
+    reader.get(16);
+    EXPECT_TRUE(reader.overrun());
+}
+
+TEST_F(CompressedBasebandTest, lossless)
+{
+    // Smooth baseband, white noise, extremes and silence, each in blocks of
+    // their own and mixed, with a partial last block.
+    std::vector<std::vector<int16_t>> signals;
+    signals.push_back(baseband(20000));
+
+    std::mt19937 rng(2);
+    std::vector<int16_t> noise(9000);
+    for (auto& x : noise) x = int16_t(rng());
+    signals.push_back(noise);
+
+    std::vector<int16_t> extremes(5000);
+    for (size_t i = 0; i != extremes.size(); ++i) extremes[i] = i % 2 ? INT16_MAX : INT16_MIN;
+    signals.push_back(extremes);
+
+    signals.push_back(std::vector<int16_t>(4096 * 2 + 3, 0));
+    signals.push_back(std::vector<int16_t>(3, -7));
+
+    std::vector<int16_t> mixed;
+    for (auto& signal : signals) mixed.insert(mixed.end(), signal.begin(), signal.end());
+    signals.push_back(mixed);
+
+    for (size_t i = 0; i != signals.size(); ++i)
+    {
+        write(signals[i]);
+        CompressedBasebandReader reader;
+        ASSERT_TRUE(reader.open(path));
+        EXPECT_EQ(reader.sample_rate(), 271000u);
+        EXPECT_EQ(read_all(reader), signals[i]) << "signal " << i;
+    }
+}
+
+TEST_F(CompressedBasebandTest, compresses_baseband)
+{
+    auto signal = baseband(271000);
+    write(signal);
+    double ratio = 2.0 * signal.size() / std::filesystem::file_size(path);
+    std::cout << "Compression ratio " << ratio << std::endl;
+    EXPECT_GT(ratio, 2.0);
+
+    // Silence takes almost nothing.
+    write(std::vector<int16_t>(271000, 0));
+    EXPECT_LT(std::filesystem::file_size(path), 271000u / 50);
+}
+
+TEST_F(CompressedBasebandTest, seek)
+{
+    auto signal = baseband(50000);
+    write(signal);
+
+    CompressedBasebandReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.size(), signal.size());
+    EXPECT_EQ(reader.index().size(), (signal.size() + 4095) / 4096);
+
+    for (uint64_t sample : {uint64_t(0), uint64_t(1), uint64_t(4095), uint64_t(4096), uint64_t(30001), uint64_t(49999)})
+    {
+        ASSERT_TRUE(reader.seek(sample)) << sample;
+        EXPECT_EQ(reader.position(), sample);
+        std::array<int16_t, 10> buffer;
+        size_t count = reader.read(buffer.data(), buffer.size());
+        ASSERT_EQ(count, std::min<size_t>(10, signal.size() - sample));
+        for (size_t i = 0; i != count; ++i) EXPECT_EQ(buffer[i], signal[sample + i]) << sample + i;
+    }
+    EXPECT_FALSE(reader.seek(50000));
+}
+
+TEST_F(CompressedBasebandTest, gap)
+{
+    // A block lost in recording leaves a gap; the blocks after it keep
+    // their time.
+    auto signal = baseband(3 * 4096);
+    CompressedBasebandWriter writer;
+    ASSERT_TRUE(writer.open(path, 271000));
+    ASSERT_TRUE(writer.write(signal.data(), 4096));
+    ASSERT_TRUE(writer.skip(4096));
+    ASSERT_TRUE(writer.write(signal.data() + 2 * 4096, 4096));
+    EXPECT_EQ(writer.samples(), signal.size());
+    ASSERT_TRUE(writer.close());
+
+    CompressedBasebandReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.size(), signal.size());
+    ASSERT_EQ(reader.index().size(), 2u);
+    EXPECT_EQ(reader.index()[1].first_sample, 2u * 4096);
+    EXPECT_FALSE(reader.seek(5000));
+    ASSERT_TRUE(reader.seek(9000));
+    EXPECT_EQ(reader.position(), 9000u);
+    EXPECT_EQ(read_all(reader), std::vector<int16_t>(signal.begin() + 9000, signal.end()));
+}
+
+TEST_F(CompressedBasebandTest, truncated_capture)
+{
+    // Cut short in its eighth block, with no index: the first seven can
+    // still be read and seeked.
+    auto signal = baseband(50000);
+    write(signal);
+    CompressedBasebandReader reader;
+    ASSERT_TRUE(reader.open(path));
+    uint64_t cut = reader.index()[7].offset + 100;
+    reader = CompressedBasebandReader();
+    std::filesystem::resize_file(path, cut);
+
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.index().size(), 7u);
+    EXPECT_EQ(reader.size(), 7u * 4096);
+    ASSERT_TRUE(reader.seek(5000));
+    EXPECT_EQ(read_all(reader), std::vector<int16_t>(signal.begin() + 5000, signal.begin() + 7 * 4096));
+}
+
+TEST_F(CompressedBasebandTest, stream)
+{
+    // Read from a stream whose header the caller has checked.
+    auto signal = baseband(10000);
+    write(signal);
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream stream;
+    stream << file.rdbuf();
+
+    std::array<char, 8> magic;
+    stream.read(magic.data(), magic.size());
+    ASSERT_TRUE(CompressedBaseband::is_magic(magic.data()));
+    CompressedBasebandReader reader;
+    ASSERT_TRUE(reader.open(stream, true));
+    EXPECT_EQ(read_all(reader), signal);
+
+    ASSERT_TRUE(reader.seek(9000)) << "a string stream can seek";
+    EXPECT_EQ(read_all(reader).size(), 1000u);
+}
+
+TEST_F(CompressedBasebandTest, rejects_other_files)
+{
+    std::vector<int16_t> raw(1000, 5);
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(raw.data()), raw.size() * 2);
+    }
+    CompressedBasebandReader reader;
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_FALSE(reader.open(path + ".missing"));
+}
+
+TEST_F(CompressedBasebandTest, recorder)
+{
+    auto signal = baseband(100000);
+    {
+        BasebandRecorder recorder;
+        ASSERT_TRUE(recorder.start(path, 271000));
+        for (size_t i = 0; i < signal.size(); i += 2048)
+        {
+            recorder.push(signal.data() + i, std::min<size_t>(2048, signal.size() - i));
+        }
+        recorder.stop();
+        EXPECT_EQ(recorder.dropped(), 0u);
+        EXPECT_EQ(recorder.samples(), signal.size());
+        EXPECT_EQ(recorder.bytes(), std::filesystem::file_size(path));
+    }
+
+    CompressedBasebandReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(read_all(reader), signal);
+}
+
+TEST_F(CompressedBasebandTest, benchmark)
+{
+    // Encoding and decoding speed; for information, with only a loose bound.
+    auto signal = baseband(271000 * 2);
+    std::vector<uint8_t> payload;
+    std::vector<std::pair<size_t, uint8_t>> blocks;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < signal.size(); i += 4096)
+    {
+        size_t begin = payload.size();
+        uint8_t type = CompressedBasebandWriter::encode(signal.data() + i, std::min<size_t>(4096, signal.size() - i), payload);
+        blocks.push_back({payload.size() - begin, type});
+    }
+    auto encode_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<int16_t> decoded(signal.size());
+    start = std::chrono::steady_clock::now();
+    size_t offset = 0;
+    for (size_t b = 0; b != blocks.size(); ++b)
+    {
+        size_t count = std::min<size_t>(4096, signal.size() - b * 4096);
+        ASSERT_TRUE(CompressedBasebandReader::decode(payload.data() + offset, blocks[b].first, count, blocks[b].second,
+            decoded.data() + b * 4096));
+        offset += blocks[b].first;
+    }
+    auto decode_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(decoded, signal);
+    std::cout << "encode " << double(encode_ns) / signal.size() << " ns per sample, decode "
+        << double(decode_ns) / signal.size() << " ns per sample, "
+        << 8.0 * payload.size() / signal.size() << " bits per sample" << std::endl;
+    EXPECT_LT(double(encode_ns) / signal.size(), 3690.0) << "slower than real time";
+}
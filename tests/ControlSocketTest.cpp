@@ -0,0 +1,148 @@
+#include "ControlSocket.h"
+#include "TempPath.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class ControlSocketTest : public ::testing::Test {
+ protected:
+
+  std::string path = temp_path(".sock");
+  ControlSocket control;
+  std::vector<std::string> commands;
+
+  std::function<std::string(const std::string&)> handler = [this](const std::string& command) {
+    commands.push_back(command);
+    return command.empty() ? std::string() : "ok " + command;
+  };
+
+  int connect_client()
+  {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::copy(path.begin(), path.end(), address.sun_path);
+    if (connect(fd, (const struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+  }
+
+  void send_text(int fd, const std::string& text)
+  {
+    ASSERT_EQ(write(fd, text.data(), text.size()), ssize_t(text.size()));
+  }
+
+  std::string receive_text(int fd)
+  {
+    char buffer[256];
+    ssize_t count = read(fd, buffer, sizeof(buffer));
+    return count > 0 ? std::string(buffer, count) : std::string();
+  }
+
+  // Poll until @p count commands have been handled in total, or give up.
+  void poll_for(size_t count)
+  {
+    for (int i = 0; i != 50 && commands.size() < count; ++i) control.poll(handler, 10);
+  }
+
+  void SetUp() override
+  {
+    ASSERT_TRUE(control.open(path));
+  }
+
+  // void TearDown() override {}
+
+};
+
+TEST_F(ControlSocketTest, command_and_reply)
+{
+    int client = connect_client();
+    ASSERT_GE(client, 0);
+
+    send_text(client, "key\n");
+    poll_for(1);
+    ASSERT_EQ(commands.size(), 1);
+    EXPECT_EQ(commands[0], "key");
+    EXPECT_EQ(receive_text(client), "ok key\n");
+
+    close(client);
+}
+
+TEST_F(ControlSocketTest, partial_lines_and_whitespace)
+{
+    int client = connect_client();
+    ASSERT_GE(client, 0);
+
+    send_text(client, "  sta");
+    poll_for(1);
+    EXPECT_TRUE(commands.empty());
+
+    send_text(client, "tus\r\nunkey\n");
+    poll_for(2);
+    ASSERT_EQ(commands.size(), 2);
+    EXPECT_EQ(commands[0], "status");
+    EXPECT_EQ(commands[1], "unkey");
+
+    close(client);
+}
+
+TEST_F(ControlSocketTest, several_clients)
+{
+    int first = connect_client();
+    int second = connect_client();
+    ASSERT_GE(first, 0);
+    ASSERT_GE(second, 0);
+
+    send_text(first, "key\n");
+    send_text(second, "status\n");
+    poll_for(2);
+    ASSERT_EQ(commands.size(), 2);
+    EXPECT_EQ(receive_text(first), "ok key\n");
+    EXPECT_EQ(receive_text(second), "ok status\n");
+
+    // A client leaving does not disturb the others.
+    close(first);
+    control.poll(handler, 10);
+    send_text(second, "unkey\n");
+    poll_for(3);
+    EXPECT_EQ(commands.back(), "unkey");
+
+    close(second);
+}
+
+TEST_F(ControlSocketTest, overlong_line_discarded)
+{
+    int client = connect_client();
+    ASSERT_GE(client, 0);
+
+    send_text(client, std::string(ControlSocket::MAX_LINE + 10, 'x') + "\nquit\n");
+    poll_for(1);
+    ASSERT_EQ(commands.size(), 1);
+    EXPECT_EQ(commands[0], "quit");
+
+    close(client);
+}
+
+TEST_F(ControlSocketTest, close_removes_socket)
+{
+    control.close();
+    EXPECT_FALSE(control.is_open());
+    EXPECT_LT(connect_client(), 0);
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+}
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 
 
@@ -51,3 +52,21 @@ TEST_F(DataCarrierDetectTest, dcd_off)
 
     EXPECT_FALSE(dcd.dcd());
 }
+
+TEST_F(DataCarrierDetectTest, dcd_after_silence)
+{
+    constexpr std::array<float, 24> input = {1,1,1,1,1,1,1,1,1,1,1,1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
+
+    auto dcd = mobilinkd::DataCarrierDetect<float, 48000, 1000>(2000,3000,1.0,5.0);
+    for (size_t i = 0; i != 48; ++i) dcd(0);
+    dcd.update();
+    EXPECT_FALSE(dcd.dcd());
+    EXPECT_FALSE(std::isnan(dcd.level()));
+
+    std::for_each(input.begin(), input.end(), [&dcd](float x){dcd(x);});
+    std::for_each(input.begin(), input.end(), [&dcd](float x){dcd(x);});
+    std::for_each(input.begin(), input.end(), [&dcd](float x){dcd(x);});
+    dcd.update();
+
+    EXPECT_TRUE(dcd.dcd());
+}
@@ -0,0 +1,134 @@
+#include "FftFilter.h"
+#include "FirFilter.h"
+#include "RRCTaps.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class FftFilterTest : public ::testing::Test {
+ protected:
+
+  using taps_t = detail::Taps<float, 10>;
+  static constexpr size_t N = taps_t::rrc_taps.size();
+
+  std::vector<float> noise(size_t count)
+  {
+      std::mt19937 rng(1);
+      std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+      std::vector<float> result(count);
+      for (auto& x : result) x = dist(rng);
+      return result;
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(FftFilterTest, fft_round_trip)
+{
+    Fft<double, 64> fft;
+    Fft<double, 64>::buffer_t data, original;
+    for (size_t i = 0; i != 64; ++i) data[i] = original[i] = {std::sin(i * 0.3), std::cos(i * 1.7)};
+
+    fft.forward(data);
+    EXPECT_NEAR(data[0].real(), [&]{ double s = 0; for (auto& x : original) s += x.real(); return s; }(), 1e-9);
+    fft.inverse(data);
+    for (size_t i = 0; i != 64; ++i)
+    {
+        EXPECT_NEAR(data[i].real() / 64, original[i].real(), 1e-12);
+        EXPECT_NEAR(data[i].imag() / 64, original[i].imag(), 1e-12);
+    }
+}
+
+TEST_F(FftFilterTest, fft_tone)
+{
+    // A complex tone on bin 5 comes out in bin 5 only.
+    Fft<double, 32> fft;
+    Fft<double, 32>::buffer_t data;
+    for (size_t i = 0; i != 32; ++i) data[i] = std::polar(1.0, 2 * M_PI * 5 * i / 32);
+    fft.forward(data);
+    for (size_t k = 0; k != 32; ++k) EXPECT_NEAR(std::abs(data[k]), k == 5 ? 32.0 : 0.0, 1e-9) << k;
+}
+
+TEST_F(FftFilterTest, matches_fir_filter)
+{
+    // Any block size, including ones shorter than a segment or than the
+    // filter, and ones not a multiple of the segment pair.
+    auto input = noise(20000);
+    for (size_t block : {1u, 7u, 100u, 2048u, 16384u})
+    {
+        BaseFirFilter<float, N> direct{taps_t::rrc_taps};
+        FftFilter<float, N> fft{taps_t::rrc_taps};
+        std::array<float, N - 1> history{};
+        std::vector<float> output(block);
+
+        for (size_t start = 0; start + block <= input.size(); start += block)
+        {
+            fft(history.data(), input.data() + start, block, output.data());
+            for (size_t i = 0; i != block; ++i)
+            {
+                ASSERT_NEAR(output[i], direct(input[start + i]), 1e-5) << "block " << block << " sample " << start + i;
+            }
+            direct.history(history.data());
+        }
+    }
+}
+
+TEST_F(FftFilterTest, history)
+{
+    // FirFilter::history gives the latest N - 1 inputs, oldest first.
+    BaseFirFilter<float, N> filter{taps_t::rrc_taps};
+    for (size_t i = 0; i != N + 10; ++i) filter(float(i));
+    std::array<float, N - 1> history;
+    filter.history(history.data());
+    for (size_t i = 0; i != N - 1; ++i) EXPECT_EQ(history[i], float(i + 11)) << i;
+
+    // skip() is part of the history too.
+    filter.skip(-1.0f);
+    filter.history(history.data());
+    EXPECT_EQ(history.back(), -1.0f);
+    EXPECT_EQ(history.front(), 12.0f);
+}
+
+TEST_F(FftFilterTest, benchmark)
+{
+    // Cost per sample, block against direct; for information, with only a
+    // loose bound.
+    auto input = noise(271000);
+    std::vector<float> output(input.size());
+    std::array<float, N - 1> history{};
+
+    BaseFirFilter<float, N> direct{taps_t::rrc_taps};
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i != input.size(); ++i) output[i] = direct(input[i]);
+    auto direct_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    float check = output.back();
+
+    FftFilter<float, N> fft{taps_t::rrc_taps};
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < input.size(); i += 16384)
+    {
+        size_t count = std::min<size_t>(16384, input.size() - i);
+        fft(history.data(), input.data() + i, count, output.data() + i);
+        std::copy(input.data() + i + count - (N - 1), input.data() + i + count, history.begin());
+    }
+    auto fft_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << N << " taps: direct " << double(direct_ns) / input.size() << " ns per sample, FFT "
+        << double(fft_ns) / input.size() << " ns per sample (" << FftFilter<float, N>::FFT_SIZE << " point)" << std::endl;
+    EXPECT_NEAR(output.back(), check, 1e-5);
+    EXPECT_LT(double(fft_ns) / input.size(), 20000.0);
+}
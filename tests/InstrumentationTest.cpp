@@ -0,0 +1,79 @@
+#include "Instrumentation.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <thread>
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class InstrumentationTest : public ::testing::Test {
+ protected:
+  void SetUp() override { instrumentation.reset(); }
+
+  // void TearDown() override {}
+
+  mobilinkd::Instrumentation instrumentation;
+};
+
+TEST_F(InstrumentationTest, histogram_buckets)
+{
+    mobilinkd::LatencyHistogram h;
+
+    h.record(0);
+    h.record(1);
+    h.record(1000);
+    h.record(1000);
+
+    EXPECT_EQ(h.count(), 4);
+    EXPECT_EQ(h.total_ns(), 2001);
+    EXPECT_EQ(h.max_ns(), 1000);
+    EXPECT_EQ(h.buckets_[0], 1);
+    EXPECT_EQ(h.buckets_[1], 1);
+    EXPECT_EQ(h.buckets_[10], 2);   // 512 <= 1000 < 1024
+    EXPECT_EQ(h.percentile_ns(25), 0);
+    EXPECT_EQ(h.percentile_ns(99), 1023);
+}
+
+TEST_F(InstrumentationTest, histogram_overflow)
+{
+    mobilinkd::LatencyHistogram h;
+
+    h.record(uint64_t(1) << 40);
+    EXPECT_EQ(h.buckets_[mobilinkd::LatencyHistogram::BUCKETS - 1], 1);
+}
+
+TEST_F(InstrumentationTest, scoped_timer)
+{
+    using mobilinkd::Stage;
+
+    EXPECT_TRUE(mobilinkd::Instrumentation::enabled);
+    {
+        mobilinkd::ScopedStageTimer timer(instrumentation, Stage::COBS);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(instrumentation.stage(Stage::COBS).count(), 1);
+    EXPECT_GE(instrumentation.stage(Stage::COBS).total_ns(), 1000000);
+    EXPECT_EQ(instrumentation.stage(Stage::OPUS).count(), 0);
+}
+
+TEST_F(InstrumentationTest, counters_and_summary)
+{
+    instrumentation.count([](auto& c){ c.frames += 3; c.syncs++; });
+
+    EXPECT_EQ(instrumentation.counters().frames, 3);
+    EXPECT_EQ(instrumentation.counters().syncs, 1);
+
+    std::ostringstream os;
+    mobilinkd::print_summary(os, instrumentation, 1.0);
+    EXPECT_NE(os.str().find("frame decode"), std::string::npos);
+    EXPECT_NE(os.str().find("frames: 3"), std::string::npos);
+
+    instrumentation.reset();
+    EXPECT_EQ(instrumentation.counters().frames, 0);
+}
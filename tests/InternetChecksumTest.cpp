@@ -0,0 +1,93 @@
+#include "InternetChecksum.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class InternetChecksumTest : public ::testing::Test {
+ protected:
+
+  // Straightforward RFC 1071 sum, for comparison.
+  static uint16_t reference(const uint8_t* data, size_t length)
+  {
+      uint64_t sum = 0;
+      for (size_t i = 0; i + 1 < length; i += 2) sum += data[i] << 8 | data[i + 1];
+      if (length & 1) sum += data[length - 1] << 8;
+      while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+      return uint16_t(~sum);
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+};
+
+TEST_F(InternetChecksumTest, rfc1071_example)
+{
+    uint8_t data[] = {0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7};
+    EXPECT_EQ(InternetChecksum::add(data, sizeof(data)), 0xddf2u);
+    EXPECT_EQ(InternetChecksum::compute(data, sizeof(data)), 0x220d);
+}
+
+TEST_F(InternetChecksumTest, ipv4_header)
+{
+    uint8_t header[] = {
+        0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11,
+        0x00, 0x00, 0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8, 0x00, 0xc7};
+    EXPECT_EQ(InternetChecksum::compute(header, sizeof(header)), 0xb861);
+
+    header[10] = 0xb8;
+    header[11] = 0x61;
+    EXPECT_TRUE(InternetChecksum::verify(header, sizeof(header)));
+    header[15] ^= 0x01;
+    EXPECT_FALSE(InternetChecksum::verify(header, sizeof(header)));
+}
+
+TEST_F(InternetChecksumTest, matches_reference)
+{
+    std::mt19937 rng(4321);
+    std::vector<uint8_t> buffer(70000);
+    for (auto& b : buffer) b = rng();
+
+    // All short lengths at every alignment, then some long ones.
+    for (size_t offset = 0; offset != 16; ++offset)
+    {
+        for (size_t length = 0; length != 200; ++length)
+        {
+            ASSERT_EQ(InternetChecksum::compute(buffer.data() + offset, length), reference(buffer.data() + offset, length))
+                << "offset " << offset << " length " << length;
+        }
+    }
+    for (size_t length : {1499, 1500, 65535, 69999})
+    {
+        EXPECT_EQ(InternetChecksum::compute(buffer.data() + 1, length), reference(buffer.data() + 1, length));
+    }
+
+    // All 0xFF words stress the carries.
+    std::vector<uint8_t> ones(70000, 0xFF);
+    EXPECT_EQ(InternetChecksum::compute(ones.data(), ones.size()), reference(ones.data(), ones.size()));
+}
+
+TEST_F(InternetChecksumTest, pieces)
+{
+    std::mt19937 rng(99);
+    std::vector<uint8_t> buffer(1000);
+    for (auto& b : buffer) b = rng();
+
+    for (size_t split : {0, 2, 12, 40, 998})
+    {
+        uint32_t sum = InternetChecksum::add(buffer.data(), split);
+        EXPECT_EQ(InternetChecksum::compute(buffer.data() + split, buffer.size() - split, sum),
+            reference(buffer.data(), buffer.size()));
+    }
+    EXPECT_EQ(InternetChecksum::finish(InternetChecksum::add16(0x0102, InternetChecksum::add16(0xf203))),
+        InternetChecksum::compute(std::vector<uint8_t>{0x01, 0x02, 0xf2, 0x03}.data(), 4));
+}
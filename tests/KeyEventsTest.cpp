@@ -0,0 +1,92 @@
+#include "KeyEvents.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class KeyEventsTest : public ::testing::Test {
+ protected:
+
+  using Event = KeyEvents::Event;
+
+  KeyEvents keying;
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(KeyEventsTest, key_unkey_back_to_back)
+{
+    // A key and unkey before the consumer polls are both seen, in order.
+    keying.key();
+    keying.unkey();
+    EXPECT_FALSE(keying.keyed());
+
+    EXPECT_EQ(keying.poll(), Event::KEY);
+    EXPECT_TRUE(keying.seen_keyed());
+    EXPECT_EQ(keying.poll(), Event::UNKEY);
+    EXPECT_FALSE(keying.seen_keyed());
+    EXPECT_EQ(keying.poll(), Event::NONE);
+
+    // And the next transmission is not blocked.
+    keying.key();
+    EXPECT_EQ(keying.poll(), Event::KEY);
+    EXPECT_EQ(keying.poll(), Event::NONE);
+}
+
+TEST_F(KeyEventsTest, repeats_ignored)
+{
+    keying.unkey();
+    EXPECT_EQ(keying.poll(), Event::NONE);
+
+    keying.key();
+    keying.key();
+    EXPECT_EQ(keying.poll(), Event::KEY);
+    EXPECT_EQ(keying.poll(), Event::NONE);
+
+    keying.unkey();
+    keying.unkey();
+    EXPECT_EQ(keying.poll(), Event::UNKEY);
+    EXPECT_EQ(keying.poll(), Event::NONE);
+}
+
+TEST_F(KeyEventsTest, polling_thread_sees_every_event)
+{
+    // As in the opv-mod service: commands on one thread, a stage polling
+    // on another. Every transmission keyed is seen to start and end.
+    constexpr size_t TRANSMISSIONS = 10000;
+    std::atomic<bool> done{false};
+    std::vector<Event> events;
+
+    std::thread consumer([&]()
+    {
+        for (;;)
+        {
+            bool finished = done.load();
+            for (auto event = keying.poll(); event != Event::NONE; event = keying.poll()) events.push_back(event);
+            if (finished) break;
+            std::this_thread::yield();
+        }
+    });
+
+    for (size_t i = 0; i != TRANSMISSIONS; ++i)
+    {
+        keying.key();
+        keying.unkey();
+    }
+    done = true;
+    consumer.join();
+
+    ASSERT_EQ(events.size(), 2 * TRANSMISSIONS);
+    for (size_t i = 0; i != events.size(); ++i) EXPECT_EQ(events[i], i % 2 ? Event::UNKEY : Event::KEY) << i;
+}
@@ -0,0 +1,130 @@
+#include "LlrCapture.h"
+#include "TempPath.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class LlrCaptureTest : public ::testing::Test {
+ protected:
+
+  std::string path = temp_path(".llr");
+
+  LlrRecord record(uint64_t sample, OPVSyncType sync = OPVSyncType::STREAM)
+  {
+      LlrRecord result{sample, 0.9f, 0.03f, -0.01f, 1.0001f, sync, 7, 42};
+      for (size_t i = 0; i != result.llr.size(); ++i) result.llr[i] = int8_t((i * 7 + sample) % 15 - 7);
+      return result;
+  }
+
+  // Write records for samples 1000, 2000, ... count * 1000.
+  void write(size_t count, uint32_t samples_per_symbol = 10)
+  {
+      LlrCaptureWriter writer;
+      ASSERT_TRUE(writer.open(path, samples_per_symbol));
+      for (size_t i = 1; i <= count; ++i) ASSERT_TRUE(writer.write(record(i * 1000, i == 1 ? OPVSyncType::FIRST : OPVSyncType::STREAM)));
+      EXPECT_EQ(writer.size(), count);
+  }
+
+  // void SetUp() override {}
+  void TearDown() override { std::remove(path.c_str()); }
+
+};
+
+TEST_F(LlrCaptureTest, round_trip)
+{
+    write(5, 4);
+
+    LlrCaptureReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.header().samples_per_symbol, 4u);
+    EXPECT_EQ(reader.header().sample_rate, uint32_t(symbol_rate * 4));
+    ASSERT_EQ(reader.size(), 5u);
+
+    for (size_t i = 0; i != reader.size(); ++i)
+    {
+        auto expected = record((i + 1) * 1000);
+        const auto& actual = reader[i];
+        EXPECT_EQ(actual.sample, expected.sample);
+        EXPECT_EQ(actual.sync, i == 0 ? OPVSyncType::FIRST : OPVSyncType::STREAM);
+        EXPECT_FLOAT_EQ(actual.deviation, 0.9f);
+        EXPECT_FLOAT_EQ(actual.evm, 0.03f);
+        EXPECT_FLOAT_EQ(actual.offset, -0.01f);
+        EXPECT_FLOAT_EQ(actual.clock, 1.0001f);
+        EXPECT_EQ(actual.sync_index, 7);
+        EXPECT_EQ(actual.clock_index, 42);
+        EXPECT_EQ(actual.llr, expected.llr);
+    }
+}
+
+TEST_F(LlrCaptureTest, file_size)
+{
+    write(3);
+    EXPECT_EQ(std::filesystem::file_size(path), LlrCapture::HEADER_SIZE + 3 * sizeof(LlrRecord));
+    EXPECT_EQ(sizeof(LlrRecord) % 8, 0u);
+}
+
+TEST_F(LlrCaptureTest, find)
+{
+    write(10);
+    LlrCaptureReader reader;
+    ASSERT_TRUE(reader.open(path));
+
+    EXPECT_EQ(reader.find(0), reader.begin());
+    EXPECT_EQ(reader.find(1000)->sample, 1000u);
+    EXPECT_EQ(reader.find(1001)->sample, 2000u);
+    EXPECT_EQ(reader.find(10000)->sample, 10000u);
+    EXPECT_EQ(reader.find(10001), reader.end());
+}
+
+TEST_F(LlrCaptureTest, partial_record_is_ignored)
+{
+    write(3);
+    std::filesystem::resize_file(path, LlrCapture::HEADER_SIZE + 2 * sizeof(LlrRecord) + 100);
+
+    LlrCaptureReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.size(), 2u);
+}
+
+TEST_F(LlrCaptureTest, empty_capture)
+{
+    write(0);
+    LlrCaptureReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_EQ(reader.size(), 0u);
+    EXPECT_EQ(reader.begin(), reader.end());
+}
+
+TEST_F(LlrCaptureTest, rejects_other_files)
+{
+    LlrCaptureReader reader;
+    EXPECT_FALSE(reader.open(path)) << "missing";
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "not an LLR capture, but long enough for a header";
+    }
+    EXPECT_FALSE(reader.open(path)) << "bad magic";
+    EXPECT_EQ(reader.size(), 0u);
+
+    write(1);
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(8);
+        uint32_t version = LlrCapture::VERSION + 1;
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    EXPECT_FALSE(reader.open(path)) << "other version";
+}
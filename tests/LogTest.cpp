@@ -0,0 +1,120 @@
+#include "Log.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class LogTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+
+  // void TearDown() override {}
+};
+
+TEST_F(LogTest, format)
+{
+    mobilinkd::LogRecord record;
+    std::array<char, 10> callsign = {'W', '5', 'N', 'Y', 'V', 0};
+
+    record.fmt = "a {} b {} c {} d {}";
+    record.nargs = 4;
+    record.args[0] = mobilinkd::LogArg::make(-3);
+    record.args[1] = mobilinkd::LogArg::make(2.5);
+    record.args[2] = mobilinkd::LogArg::make(mobilinkd::LogHex{0xc00000});
+    record.args[3] = mobilinkd::LogArg::make(callsign);
+
+    std::ostringstream os;
+    record.format(os);
+    EXPECT_EQ(os.str(), "a -3 b 2.5 c c00000 d W5NYV");
+}
+
+TEST_F(LogTest, string_truncated)
+{
+    auto arg = mobilinkd::LogArg::make("0123456789abcdefghij");
+    std::ostringstream os;
+    arg.format(os);
+    EXPECT_EQ(os.str(), "0123456789abcde");
+}
+
+TEST_F(LogTest, ring_full)
+{
+    mobilinkd::LogRing<4> ring;
+    mobilinkd::LogRecord record;
+
+    for (int i = 0; i != 4; ++i)
+    {
+        record.nargs = i;
+        EXPECT_TRUE(ring.push(record));
+    }
+    EXPECT_FALSE(ring.push(record));
+    EXPECT_EQ(ring.take_dropped(), 1);
+
+    for (int i = 0; i != 4; ++i)
+    {
+        EXPECT_TRUE(ring.pop(record));
+        EXPECT_EQ(record.nargs, i);
+    }
+    EXPECT_FALSE(ring.pop(record));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST_F(LogTest, ring_multiple_producers)
+{
+    mobilinkd::LogRing<1024> ring;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t != 4; ++t)
+    {
+        threads.emplace_back([&ring, t](){
+            mobilinkd::LogRecord record;
+            record.nargs = t;
+            for (int i = 0; i != 200; ++i) ring.push(record);
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    std::array<int, 4> counts{};
+    mobilinkd::LogRecord record;
+    while (ring.pop(record)) counts[record.nargs] += 1;
+    for (auto c : counts) EXPECT_EQ(c, 200);
+}
+
+TEST_F(LogTest, rate_limit)
+{
+    mobilinkd::LogRateLimiter limiter;
+    auto now = std::chrono::steady_clock::now();
+    uint32_t suppressed = 0;
+    int allowed = 0;
+
+    for (int i = 0; i != 10; ++i) allowed += limiter.allow(now, 3, suppressed);
+    EXPECT_EQ(allowed, 3);
+
+    EXPECT_TRUE(limiter.allow(now + std::chrono::seconds(1), 3, suppressed));
+    EXPECT_EQ(suppressed, 7);
+}
+
+TEST_F(LogTest, logger_levels)
+{
+    std::ostringstream os;
+    {
+        mobilinkd::Logger logger(os);
+        mobilinkd::LogRateLimiter limiter;
+
+        logger.level(mobilinkd::LogLevel::INFO);
+        logger.log(limiter, mobilinkd::LogLevel::DEBUG, "hidden {}", 1);
+        logger.log(limiter, mobilinkd::LogLevel::WARN, "shown {}", 2);
+        logger.flush();
+    }
+
+    EXPECT_EQ(os.str().find("hidden"), std::string::npos);
+    EXPECT_NE(os.str().find("WARN: shown 2"), std::string::npos);
+}
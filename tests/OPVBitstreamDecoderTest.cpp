@@ -0,0 +1,160 @@
+#include "OPVBitstreamDecoder.h"
+#include "OPVModulator.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+using namespace mobilinkd;
+
+uint64_t debug_sample_count = 0;    // referenced by the frame header logging
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class OPVBitstreamDecoderTest : public ::testing::Test {
+ protected:
+
+  OPVFrameHeader::token_t token = {0x34, 0x56, 0x78};
+  std::vector<uint8_t> bitstream;
+  size_t bert_frames = 0;
+  int total_cost = 0;
+
+  std::function<bool(const OPVFrameDecoder::output_buffer_t&, int)> handler =
+    [this](const OPVFrameDecoder::output_buffer_t& frame, int cost) {
+      if (frame.type == OPVFrameDecoder::FrameType::OPV_BERT) bert_frames++;
+      total_cost += cost;
+      return true;
+    };
+
+  // A transmission of @p frames BERT frames, as opv-mod --bitstream writes it.
+  void transmission(size_t frames)
+  {
+    OPVModulator modulator("W5NYV", token, true);
+    modulator.output_mode(OPVModulator::OutputMode::BITSTREAM);
+    modulator.bitstream_output([this](const uint8_t* bytes, size_t len) {
+        bitstream.insert(bitstream.end(), bytes, bytes + len);
+    });
+
+    modulator.preamble();
+    for (size_t i = 0; i != frames; ++i) modulator.bert(i + 1 == frames);
+    modulator.eot();
+  }
+
+  // Shift the whole bitstream later by @p bits (1..7), filling with @p fill.
+  void shift(int bits, uint8_t fill)
+  {
+    std::vector<uint8_t> shifted(bitstream.size() + 1);
+    uint8_t previous = fill;
+    for (size_t i = 0; i != bitstream.size(); ++i)
+    {
+        shifted[i] = uint8_t(previous << (8 - bits)) | (bitstream[i] >> bits);
+        previous = bitstream[i];
+    }
+    shifted.back() = uint8_t(previous << (8 - bits));
+    bitstream = shifted;
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(OPVBitstreamDecoderTest, decodes_transmission)
+{
+    transmission(10);
+    OPVBitstreamDecoder<decltype(handler)> decoder(handler);
+
+    decoder(bitstream.data(), bitstream.size());
+
+    EXPECT_EQ(bert_frames, 10);
+    EXPECT_EQ(total_cost, 0);
+    EXPECT_EQ(decoder.instrumentation.counters().frames, 10);
+    EXPECT_EQ(decoder.instrumentation.counters().eos_frames, 1);
+    EXPECT_FALSE(decoder.locked());
+}
+
+TEST_F(OPVBitstreamDecoderTest, any_chunk_size)
+{
+    transmission(5);
+
+    for (size_t chunk : {1, 2, 7, 270, 271, 272, 1000})
+    {
+        bert_frames = 0;
+        OPVBitstreamDecoder<decltype(handler)> decoder(handler);
+        for (size_t i = 0; i < bitstream.size(); i += chunk)
+        {
+            decoder(bitstream.data() + i, std::min(chunk, bitstream.size() - i));
+        }
+        EXPECT_EQ(bert_frames, 5) << "chunk " << chunk;
+    }
+}
+
+TEST_F(OPVBitstreamDecoderTest, unaligned)
+{
+    transmission(5);
+    auto aligned = bitstream;
+
+    for (int bits = 1; bits != 8; ++bits)
+    {
+        bitstream = aligned;
+        shift(bits, 0xA5);
+        bert_frames = 0;
+        total_cost = 0;
+        OPVBitstreamDecoder<decltype(handler)> decoder(handler);
+        decoder(bitstream.data(), bitstream.size());
+        EXPECT_EQ(bert_frames, 5) << "shift " << bits;
+        EXPECT_EQ(total_cost, 0) << "shift " << bits;
+    }
+}
+
+TEST_F(OPVBitstreamDecoderTest, damaged_sync_word)
+{
+    transmission(5);
+
+    // Two bit errors in the second frame's sync word are tolerated; the
+    // third frame's sync word is destroyed and freewheeled over.
+    bitstream[2 * baseband_frame_packed_bytes] ^= 0x81;
+    bitstream[3 * baseband_frame_packed_bytes] ^= 0xFF;
+    bitstream[3 * baseband_frame_packed_bytes + 1] ^= 0xFF;
+
+    OPVBitstreamDecoder<decltype(handler)> decoder(handler);
+    decoder(bitstream.data(), bitstream.size());
+
+    EXPECT_EQ(bert_frames, 5);
+    EXPECT_EQ(decoder.instrumentation.counters().faked_syncs, 1);
+    EXPECT_EQ(decoder.instrumentation.counters().sync_losses, 0);
+}
+
+TEST_F(OPVBitstreamDecoderTest, loses_sync_in_noise)
+{
+    transmission(20);
+
+    // Replace six frames with data that has no sync words in it.
+    std::fill(bitstream.begin() + 3 * baseband_frame_packed_bytes,
+        bitstream.begin() + 9 * baseband_frame_packed_bytes, 0x33);
+
+    OPVBitstreamDecoder<decltype(handler)> decoder(handler);
+    decoder(bitstream.data(), bitstream.size());
+
+    // Sync is given up on after freewheeling, then found again.
+    EXPECT_EQ(decoder.instrumentation.counters().faked_syncs, OPVBitstreamDecoder<decltype(handler)>::MAX_MISSED_SYNCS);
+    EXPECT_EQ(decoder.instrumentation.counters().sync_losses, 1);
+    EXPECT_EQ(decoder.instrumentation.counters().eos_frames, 1);
+    EXPECT_GE(bert_frames, 14);
+}
+
+TEST_F(OPVBitstreamDecoderTest, back_to_back_transmissions)
+{
+    transmission(3);
+    transmission(4);
+
+    OPVBitstreamDecoder<decltype(handler)> decoder(handler);
+    decoder(bitstream.data(), bitstream.size());
+
+    EXPECT_EQ(bert_frames, 7);
+    EXPECT_EQ(decoder.instrumentation.counters().eos_frames, 2);
+}
@@ -6,7 +6,9 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <random>
 #include <stdlib.h>
+#include <vector>
 
 using namespace mobilinkd;
 
@@ -181,3 +183,140 @@ TEST_F(OPVCobsDecoderRandomTest, many_random_packets)
 
     std::cerr << "Tested " << target_packet_count << " packets in " << frame_count << " frames." << std::endl;
 }
+
+
+/**
+ * The original byte-at-a-time decoder, kept as the reference for the
+ * bulk decoder's behaviour.
+ */
+struct ReferenceCobsDecoder
+{
+    using State = OPVCobsDecoder::State;
+    State state_ = State::RESET;
+    unsigned int decoded_count = 0;
+    unsigned int remaining_count = 0;
+    uint8_t packet[mobilinkd::ip_mtu+3];
+    std::vector<std::vector<uint8_t>> packets;
+
+    void reset()
+    {
+        state_ = State::RESET;
+        decoded_count = 0;
+        remaining_count = 0;
+    }
+
+    void operator()(const uint8_t *cobs_data, int buffer_length)
+    {
+        for (int index = 0; index < buffer_length; index++)
+        {
+            uint8_t byte = cobs_data[index];
+
+            if (state_ == State::PACKET_TOO_LONG)
+            {
+                if (byte == 0) reset();
+            }
+            else if (byte == 0)
+            {
+                if (remaining_count > 0)
+                {
+                    reset();
+                }
+                else if (decoded_count > 0)
+                {
+                    if (packet[decoded_count-1] == 0) decoded_count--;
+                    if (decoded_count >= minimum_packet_length && decoded_count <= mobilinkd::ip_mtu)
+                    {
+                        packets.emplace_back(packet, packet + decoded_count);
+                    }
+                    reset();
+                }
+            }
+            else if (remaining_count > 0)
+            {
+                packet[decoded_count++] = byte;
+                remaining_count--;
+                if (remaining_count == 0)
+                {
+                    if (state_ != State::CASE255) packet[decoded_count++] = 0;
+                    state_ = State::CHUNK;
+                }
+            }
+            else if (byte == 0xff)
+            {
+                remaining_count = 254;
+                state_ = State::CASE255;
+            }
+            else
+            {
+                remaining_count = byte - 1;
+                if (byte == 0x01)
+                {
+                    packet[decoded_count++] = 0;
+                    state_ = State::RESET;
+                }
+                else
+                {
+                    state_ = State::CHUNK;
+                }
+            }
+
+            if (decoded_count > mobilinkd::ip_mtu+1) state_ = State::PACKET_TOO_LONG;
+        }
+    }
+};
+
+TEST_F(OPVCobsDecoderRandomTest, matches_reference_on_corrupt_streams)
+{
+    std::mt19937 rng(2026);
+    std::vector<std::vector<uint8_t>> decoded;
+    ReferenceCobsDecoder reference;
+    cobs_decoder.reset();
+
+    auto handler = [&decoded](const uint8_t *packet, unsigned int len)
+    {
+        decoded.emplace_back(packet, packet + len);
+    };
+
+    for (int round = 0; round != 2000; ++round)
+    {
+        // A packet of any length from one byte to well past the MTU, with
+        // long zero-free runs (to exercise 255-byte chunks) or many zeros.
+        std::vector<uint8_t> packet(1 + rng() % (mobilinkd::ip_mtu + 300));
+        bool sparse = rng() % 2;
+        for (auto& b : packet) b = sparse ? (rng() % 8 ? 1 + rng() % 255 : 0) : rng() % 256;
+
+        std::vector<uint8_t> encoded(packet.size() + packet.size() / 254 + 16);
+        auto result = cobs_encode(encoded.data(), encoded.size(), packet.data(), packet.size());
+        ASSERT_EQ(result.status, COBS_ENCODE_OK);
+        encoded.resize(result.out_len);
+        encoded.push_back(0);
+
+        // Corrupt some of them: flipped bytes, inserted zeros, truncation.
+        switch (rng() % 8)
+        {
+            case 0: encoded[rng() % encoded.size()] ^= 1 + rng() % 255; break;
+            case 1: encoded[rng() % encoded.size()] = 0; break;
+            case 2: encoded.resize(rng() % encoded.size()); break;
+            case 3: encoded.insert(encoded.begin(), rng() % 20, 0); break;
+            default: break;
+        }
+
+        // Feed both decoders in randomly sized pieces.
+        size_t offset = 0;
+        while (offset < encoded.size())
+        {
+            size_t length = std::min<size_t>(1 + rng() % 300, encoded.size() - offset);
+            cobs_decoder(encoded.data() + offset, length, handler);
+            reference(encoded.data() + offset, length);
+            offset += length;
+
+            ASSERT_EQ(cobs_decoder.state_, reference.state_) << "round " << round;
+            ASSERT_EQ(cobs_decoder.decoded_count, reference.decoded_count) << "round " << round;
+            ASSERT_EQ(cobs_decoder.remaining_count, reference.remaining_count) << "round " << round;
+        }
+    }
+
+    ASSERT_EQ(decoded.size(), reference.packets.size());
+    for (size_t i = 0; i != decoded.size(); ++i) EXPECT_EQ(decoded[i], reference.packets[i]) << "packet " << i;
+    EXPECT_GT(decoded.size(), 1000u);
+}
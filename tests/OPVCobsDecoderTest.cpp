@@ -270,4 +270,27 @@ TEST_F(OPVCobsDecoderTest, mtu_plus_one)
   remaining = 0;
 
   EXPECT_EQ(packet_count, 0) << "Failed to discard long packet";
-}
\ No newline at end of file
+}
+TEST_F(OPVCobsDecoderTest, direct_handler)
+{
+    uint8_t frame[stream_frame_payload_bytes];
+
+    uint8_t data[] = "123456789012345678901234567890";
+
+    memset(frame, 0, stream_frame_payload_bytes);   // fill frame with zero
+    frame[50] = sizeof(data); // +1 is taken care of by the string-terminating 0
+    memcpy(frame+51, data, sizeof(data)-1);
+    frame[51+sizeof(data)] = 0;
+
+    unsigned int length = 0;
+    int handled = 0;
+    cobs_decoder(frame, stream_frame_payload_bytes, [&](const uint8_t *packet, unsigned int len)
+    {
+        length = len;
+        handled += memcmp(packet, data, 30) == 0;
+    });
+
+    EXPECT_EQ(handled, 1) << "Handler did not get the packet.";
+    EXPECT_EQ(length, 30u);
+    EXPECT_EQ(packet_count, 0) << "Registered callback should be bypassed.";
+}
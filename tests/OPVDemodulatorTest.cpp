@@ -0,0 +1,162 @@
+#include "OPVDemodulator.h"
+#include "OPVModulator.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd;
+
+// Required by OPVDemodulator. Logging only.
+uint64_t debug_sample_count = 0;
+OPVCobsDecoder cobs_decoder;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class OPVDemodulatorTest : public ::testing::Test {
+ protected:
+
+  using demodulator_t = OPVDemodulator<float>;
+
+  std::vector<float> baseband;        // scaled as opv-demod scales its input
+  std::vector<size_t> frame_start;    // first sample of each stream frame sent
+
+  // Frames decoded: the transmitted frame each one was, by when it came.
+  std::vector<size_t> received;
+  size_t position = 0;                // of the next sample into the demodulator
+
+  // Append @p samples of digital silence.
+  void silence(size_t samples)
+  {
+      baseband.insert(baseband.end(), samples, 0.0f);
+  }
+
+  // Append a transmission of @p frames BERT frames, with its preamble.
+  // The first @p junk frames sent after the preamble have a sync word but
+  // random bits in place of the frame, and are not counted as frames.
+  void transmission(size_t frames, size_t junk = 0)
+  {
+      OPVFrameHeader::token_t token = {0x34, 0x56, 0x78};
+      OPVModulator modulator("W5NYV", token, true);
+      modulator.baseband_output([this](const int16_t* samples, size_t count) {
+          for (size_t i = 0; i != count; ++i) baseband.push_back(samples[i] / 44000.0f);
+      });
+
+      PRBS9 prbs;
+      modulator.dead_carrier();
+      modulator.preamble();
+      std::mt19937 rng(1);
+      for (size_t i = 0; i != junk; ++i)
+      {
+          OPVModulator::bitstream_t bits;
+          for (auto& bit : bits) bit = rng() & 1;
+          modulator.send_encoded(bits);
+      }
+      for (size_t i = 0; i != frames; ++i)
+      {
+          frame_start.push_back(baseband.size());
+          modulator.frame(OPVModulator::fill_bert_frame(prbs), i + 1 == frames);
+      }
+      modulator.eot();
+      modulator.dead_carrier();
+  }
+
+  // Demodulate the baseband from sample @p from, counting frames received.
+  demodulator_t::callback_t handler = [this](const OPVFrameDecoder::output_buffer_t& frame, int) {
+      if (frame.type != OPVFrameDecoder::FrameType::OPV_BERT) return true;
+      // A frame is decoded shortly after its last sample arrives.
+      auto it = std::upper_bound(frame_start.begin(), frame_start.end(), position - samples_per_frame / 2);
+      if (it != frame_start.begin()) received.push_back(std::distance(frame_start.begin(), it) - 1);
+      return true;
+  };
+
+  Instrumentation demodulate(size_t from)
+  {
+      received.clear();
+      auto demod = std::make_unique<demodulator_t>(handler);
+      demod->cobs(nullptr);
+      for (position = from; position != baseband.size(); ++position) (*demod)(baseband[position]);
+      return demod->instrumentation;
+  }
+
+  // The first frame that starts at or after sample @p sample.
+  size_t next_frame(size_t sample)
+  {
+      return std::distance(frame_start.begin(), std::lower_bound(frame_start.begin(), frame_start.end(), sample));
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(OPVDemodulatorTest, decodes_transmission)
+{
+    transmission(10);
+    auto stats = demodulate(0);
+
+    EXPECT_EQ(received.size(), 10u);
+    EXPECT_EQ(stats.counters().false_locks, 0u);
+    EXPECT_EQ(stats.counters().eos_frames, 1u);
+}
+
+TEST_F(OPVDemodulatorTest, late_join)
+{
+    transmission(20);
+
+    // Join at points spread over a frame, mid-transmission. Every frame
+    // from the first one decoded is decoded. That is the first frame whose
+    // sync word comes after the join, unless it comes before carrier is
+    // detected, and then the one after.
+    double total_wait = 0;
+    size_t joins = 0;
+    for (size_t join = frame_start[5] + 150; join < frame_start[6] + 150; join += samples_per_frame / 8)
+    {
+        demodulate(join);
+        ASSERT_FALSE(received.empty()) << "join at " << join;
+        size_t first = next_frame(join);
+        EXPECT_GE(received.front(), first) << "join at " << join;
+        EXPECT_LE(received.front(), first + 1) << "join at " << join;
+        EXPECT_EQ(received.size(), frame_start.size() - received.front()) << "join at " << join;
+
+        total_wait += double(frame_start[received.front()] - join) / samples_per_frame;
+        joins++;
+    }
+
+    // Waiting for the next sync word takes half a frame on average.
+    double wait = total_wait / joins;
+    std::cout << "Late join: first frame " << wait << " frames after joining, on average" << std::endl;
+    EXPECT_LT(wait, 1.0);
+}
+
+TEST_F(OPVDemodulatorTest, after_silence)
+{
+    // Digital silence, then a transmission: the correlator is primed when
+    // carrier is detected, rather than holding silence.
+    silence(samples_per_frame * 10);
+    transmission(10);
+    demodulate(0);
+
+    EXPECT_EQ(received.size(), 10u);
+}
+
+TEST_F(OPVDemodulatorTest, false_lock_dropped)
+{
+    // A sync word followed by a frame whose header does not decode does not
+    // confirm the lock: the frame is not passed on, and the search resumes
+    // in time for the next sync word.
+    transmission(10, 1);
+    auto stats = demodulate(0);
+
+    EXPECT_EQ(stats.counters().false_locks, 1u);
+    ASSERT_EQ(received.size(), 10u);
+    EXPECT_EQ(received.front(), 0u);
+}
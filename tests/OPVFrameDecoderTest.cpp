@@ -0,0 +1,103 @@
+#include "OPVFrameDecoder.h"
+#include "OPVModulator.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace mobilinkd;
+
+uint64_t debug_sample_count = 0;    // referenced by the frame header logging
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+// The shared tables are constant expressions.
+static_assert(OPVFrameDecoder::source_[1] == PolynomialInterleaverX + PolynomialInterleaverX2);
+static_assert(OPVRandomizer<>::dc_[0] == -1);     // DC starts 0xAC
+
+class OPVFrameDecoderTest : public ::testing::Test {
+ protected:
+
+  OPVFrameHeader::token_t token = {0x34, 0x56, 0x78};
+
+  // Mean nanoseconds to construct and destroy an object on the heap, as
+  // when a channel is started and stopped.
+  template <typename Make>
+  static double construction_ns(Make make, size_t count)
+  {
+      const void* volatile last = nullptr;
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i != count; ++i)
+      {
+          auto object = make();
+          last = object.get();
+      }
+      (void) last;
+      return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(OPVFrameDecoderTest, shared_tables)
+{
+    // The tables built at compile time match the interleaver polynomial and
+    // the randomization matrix they are built from.
+    for (size_t i = 0; i != stream_type4_size; ++i)
+    {
+        size_t index = (PolynomialInterleaverX * i + uint64_t(PolynomialInterleaverX2) * i * i) % stream_type4_size;
+        EXPECT_EQ(OPVFrameDecoder::source_[i], index) << i;
+        EXPECT_EQ(OPVRandomizer<>::dc_[i], (detail::DC[i / 8] >> (7 - i % 8)) & 1 ? -1 : 1) << i;
+        EXPECT_EQ(OPVFrameDecoder::sign_[i], OPVRandomizer<>::dc_[index]) << i;
+    }
+}
+
+TEST_F(OPVFrameDecoderTest, decodes_modulator_frame)
+{
+    OPVModulator modulator("W5NYV", token, true);
+    PRBS9 prbs;
+    auto payload = OPVModulator::fill_bert_frame(prbs);
+    auto bits = modulator.encode_frame(payload);
+
+    // Hard bits to soft bits, as the demodulator gives them.
+    std::array<int8_t, stream_type4_size> soft;
+    for (size_t i = 0; i != soft.size(); ++i) soft[i] = bits[i] ? 7 : -7;
+
+    OPVFrameDecoder decoder;
+    size_t cost = 0;
+    bool called = false;
+    auto result = decoder(std::span<const int8_t, stream_type4_size>(soft), cost,
+        [&](const OPVFrameDecoder::output_buffer_t& frame, int) {
+            called = true;
+            EXPECT_EQ(frame.type, OPVFrameDecoder::FrameType::OPV_BERT);
+            EXPECT_TRUE(std::equal(payload.begin(), payload.end(), frame.data.begin()));
+            return true;
+        });
+
+    EXPECT_TRUE(called);
+    EXPECT_EQ(result, OPVFrameDecoder::DecodeResult::OK);
+    EXPECT_EQ(cost, 0u);
+    EXPECT_EQ(std::string(decoder.fheader_.callsign.data()), "W5NYV");
+}
+
+TEST_F(OPVFrameDecoderTest, construction_cost)
+{
+    // Decoders and modulators share their tables rather than building them,
+    // so starting a channel costs little more than the allocation.
+    double decoder_ns = construction_ns([] { return std::make_unique<OPVFrameDecoder>(); }, 10000);
+    double modulator_ns = construction_ns([this] { return std::make_unique<OPVModulator>("W5NYV", token); }, 10000);
+
+    std::cout << "OPVFrameDecoder: " << sizeof(OPVFrameDecoder) << " bytes, constructed in "
+        << decoder_ns << " ns" << std::endl;
+    std::cout << "OPVModulator: " << sizeof(OPVModulator) << " bytes, constructed in "
+        << modulator_ns << " ns" << std::endl;
+}
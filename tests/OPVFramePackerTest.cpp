@@ -0,0 +1,155 @@
+#include "OPVFramePacker.h"
+#include "OPVCobsDecoder.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class OPVFramePackerTest : public ::testing::Test {
+ protected:
+
+  using packet_t = std::vector<uint8_t>;
+
+  OPVFramePacker packer;
+  OPVFramePacker::stream_frame_t payload;
+  OPVCobsDecoder cobs_decoder;
+  std::vector<packet_t> received;
+  std::mt19937 rng{5678};
+
+  packet_t make_packet(size_t length, int zero_density = 10)
+  {
+    packet_t packet(length);
+    for (auto& b : packet) b = (rng() % zero_density == 0) ? 0 : uint8_t(rng() | 1);
+    return packet;
+  }
+
+  // Fill the next frame and run it through the receiver's COBS decoder.
+  void next_frame()
+  {
+    packer.fill(payload);
+    cobs_decoder(payload.data(), payload.size(), [this](const uint8_t* data, unsigned int length) {
+        received.emplace_back(data, data + length);
+    });
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(OPVFramePackerTest, idle_frame_is_zero)
+{
+    EXPECT_TRUE(packer.idle());
+    packer.fill(payload);
+    EXPECT_TRUE(std::all_of(payload.begin(), payload.end(), [](uint8_t b) { return b == 0; }));
+    EXPECT_EQ(packer.stats().idle_bytes, payload.size());
+}
+
+TEST_F(OPVFramePackerTest, voice_packet_fills_frame)
+{
+    auto voice = make_packet(stream_frame_payload_bytes - 2, 1000);
+    voice[0] = 0x45;
+
+    ASSERT_TRUE(packer.voice(voice.data(), voice.size()));
+    packer.fill(payload);
+    EXPECT_TRUE(packer.idle());
+    EXPECT_EQ(packer.stats().idle_bytes, 0);
+
+    // The same as a frame built from the one packet.
+    std::array<uint8_t, stream_frame_payload_bytes> expected{};
+    OPVCobsEncoder::encode(voice.data(), voice.size(), expected.data());
+    EXPECT_EQ(payload, expected);
+}
+
+TEST_F(OPVFramePackerTest, data_spans_frames)
+{
+    std::vector<packet_t> sent;
+    for (size_t length : {20, 100, 121, 122, 300, 1000, 1500, 20, 20, 254, 255, 509})
+    {
+        sent.push_back(make_packet(length));
+        ASSERT_TRUE(packer.data(sent.back().data(), length));
+    }
+
+    size_t frames = 0;
+    while (!packer.idle())
+    {
+        next_frame();
+        frames++;
+    }
+
+    ASSERT_EQ(received.size(), sent.size());
+    EXPECT_EQ(received, sent);
+
+    // Packed back to back: padding only in the last frame.
+    size_t bytes = 0;
+    for (auto& packet : sent) bytes += OPVCobsEncoder::max_encoded_size(packet.size()) + 1;
+    EXPECT_LE(frames, (bytes + stream_frame_payload_bytes - 1) / stream_frame_payload_bytes);
+    EXPECT_LT(packer.stats().idle_bytes, stream_frame_payload_bytes);
+}
+
+TEST_F(OPVFramePackerTest, voice_goes_first)
+{
+    auto data = make_packet(200);
+    auto voice = make_packet(stream_frame_payload_bytes - 2, 1000);
+
+    packer.data(data.data(), data.size());
+    packer.voice(voice.data(), voice.size());
+    next_frame();
+
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received[0], voice);
+    EXPECT_EQ(packer.data_queued(), 1);
+}
+
+TEST_F(OPVFramePackerTest, data_waits_for_voice_to_end)
+{
+    auto voice = make_packet(stream_frame_payload_bytes - 2, 1000);
+    auto small = make_packet(30);
+    auto large = make_packet(400);
+
+    packer.voice(voice.data(), voice.size());
+    next_frame();
+
+    // Just after voice, only a packet that fits in the frame may start.
+    packer.data(small.data(), small.size());
+    packer.data(large.data(), large.size());
+    next_frame();
+    ASSERT_EQ(received.size(), 2);
+    EXPECT_EQ(received[1], small);
+    EXPECT_EQ(packer.data_queued(), 1);
+
+    // A frame later, anything goes.
+    while (!packer.idle()) next_frame();
+    ASSERT_EQ(received.size(), 3);
+    EXPECT_EQ(received[2], large);
+}
+
+TEST_F(OPVFramePackerTest, queue_limits)
+{
+    auto packet = make_packet(100);
+    for (size_t i = 0; i != OPVFramePacker::MAX_DATA_PACKETS; ++i)
+    {
+        ASSERT_TRUE(packer.data(packet.data(), packet.size()));
+    }
+    EXPECT_FALSE(packer.data(packet.data(), packet.size()));
+    EXPECT_EQ(packer.stats().data_dropped, 1);
+
+    // Voice has its own buffers.
+    EXPECT_TRUE(packer.voice(packet.data(), packet.size()));
+
+    auto jumbo = make_packet(OPVFramePacker::MAX_PACKET + 1);
+    packer.reset();
+    EXPECT_FALSE(packer.data(jumbo.data(), jumbo.size()));
+    EXPECT_FALSE(packer.data(packet.data(), 0));
+    EXPECT_EQ(packer.stats().rejected, 2);
+    EXPECT_TRUE(packer.idle());
+}
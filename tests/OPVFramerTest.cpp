@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 
 #include <cstdint>
+#include <tuple>
 
 // make CXXFLAGS="$(pkg-config --cflags gtest) $(pkg-config --libs gtest) -I. -O3 -std=c++17" tests/ConvolutionTest
 
@@ -23,3 +24,24 @@ TEST_F(OPVFramerTest, construct)
 {
     mobilinkd::OPVFramer<mobilinkd::stream_type4_size> framer;
 }
+
+TEST_F(OPVFramerTest, double_buffered)
+{
+    mobilinkd::OPVFramer<8> framer;
+    int8_t* first = nullptr;
+    int8_t* second = nullptr;
+
+    for (int i = 0; i != 4; ++i) framer(std::make_tuple<int8_t, int8_t>(int8_t(i), int8_t(-i)), &first);
+    ASSERT_NE(first, nullptr);
+
+    // Collecting the next frame leaves the completed one untouched.
+    for (int i = 0; i != 4; ++i) framer(std::make_tuple<int8_t, int8_t>(int8_t(7), int8_t(7)), &second);
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(first, second);
+    for (int i = 0; i != 4; ++i)
+    {
+        EXPECT_EQ(first[2 * i], i);
+        EXPECT_EQ(first[2 * i + 1], -i);
+        EXPECT_EQ(second[2 * i], 7);
+    }
+}
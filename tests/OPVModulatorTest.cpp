@@ -0,0 +1,193 @@
+#include "OPVModulator.h"
+#include "cobs.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class OPVModulatorTest : public ::testing::Test {
+ protected:
+
+  OPVFrameHeader::token_t token = {0x34, 0x56, 0x78};
+  std::vector<int16_t> baseband;
+  std::vector<uint8_t> bitstream;
+
+  void attach(OPVModulator& modulator)
+  {
+    modulator.baseband_output([this](const int16_t* samples, size_t len) {
+        baseband.insert(baseband.end(), samples, samples + len);
+    });
+    modulator.bitstream_output([this](const uint8_t* bytes, size_t len) {
+        bitstream.insert(bitstream.end(), bytes, bytes + len);
+    });
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(OPVModulatorTest, cobs_encoder_matches_reference)
+{
+    std::mt19937 rng(1234);
+    std::array<uint8_t, ip_mtu> packet;
+    std::array<uint8_t, OPVCobsEncoder::max_encoded_size(ip_mtu)> expected;
+    std::array<uint8_t, OPVCobsEncoder::max_encoded_size(ip_mtu)> actual;
+
+    for (size_t length : {0, 1, 2, 132, 253, 254, 255, 508, 509, 1500})
+    {
+        for (int zero_density : {0, 2, 50})
+        {
+            for (size_t i = 0; i != length; ++i)
+            {
+                uint8_t b = rng();
+                packet[i] = (zero_density && rng() % zero_density == 0) ? 0 : (b ? b : 1);
+            }
+
+            auto result = cobs_encode(expected.data(), expected.size(), packet.data(), length);
+            ASSERT_EQ(result.status, COBS_ENCODE_OK);
+
+            auto count = OPVCobsEncoder::encode(packet.data(), length, actual.data());
+            EXPECT_LE(count, OPVCobsEncoder::max_encoded_size(length));
+            ASSERT_EQ(count, result.out_len) << "length " << length << " density " << zero_density;
+            EXPECT_TRUE(std::equal(expected.begin(), expected.begin() + count, actual.begin()));
+        }
+    }
+}
+
+TEST_F(OPVModulatorTest, baseband_frame_size)
+{
+    OPVModulator modulator("W5NYV", token);
+    attach(modulator);
+
+    modulator.preamble();
+    EXPECT_EQ(baseband.size(), samples_per_frame);
+    modulator.bert();
+    EXPECT_EQ(baseband.size(), 2 * samples_per_frame);
+    modulator.eot();
+    EXPECT_EQ(baseband.size(), 2 * samples_per_frame + OPVModulator::EOT_SYMBOLS * OPVModulator::SAMPLES_PER_SYMBOL);
+    EXPECT_TRUE(bitstream.empty());
+}
+
+TEST_F(OPVModulatorTest, bitstream_frame)
+{
+    OPVModulator modulator("W5NYV", token);
+    modulator.output_mode(OPVModulator::OutputMode::BITSTREAM);
+    attach(modulator);
+
+    modulator.preamble();
+    ASSERT_EQ(bitstream.size(), baseband_frame_packed_bytes);
+    EXPECT_TRUE(std::all_of(bitstream.begin(), bitstream.end(), [](uint8_t b) { return b == OPVModulator::PREAMBLE_BYTE; }));
+
+    bitstream.clear();
+    modulator.bert(true);
+    ASSERT_EQ(bitstream.size(), baseband_frame_packed_bytes);
+    EXPECT_EQ(bitstream[0], OPVModulator::STREAM_SYNC_WORD[0]);
+    EXPECT_EQ(bitstream[1], OPVModulator::STREAM_SYNC_WORD[1]);
+    EXPECT_TRUE(modulator.fheader()[6] & 0x80) << "last frame flag not set";
+
+    bitstream.clear();
+    modulator.eot();
+    ASSERT_EQ(bitstream.size(), OPVModulator::EOT_SYMBOLS / 4);
+    EXPECT_EQ(bitstream[0], OPVModulator::EOT_SYNC[0]);
+    EXPECT_EQ(bitstream[1], OPVModulator::EOT_SYNC[1]);
+    EXPECT_TRUE(baseband.empty());
+}
+
+TEST_F(OPVModulatorTest, independent_instances)
+{
+    OPVModulator first("W5NYV", token);
+    OPVModulator second("W5NYV", token);
+
+    std::vector<int16_t> other;
+    attach(first);
+    second.baseband_output([&other](const int16_t* samples, size_t len) {
+        other.insert(other.end(), samples, samples + len);
+    });
+
+    // Interleave calls; each modulator must produce the same stream.
+    first.preamble();
+    second.preamble();
+    first.bert();
+    second.bert();
+    first.bert(true);
+    second.bert(true);
+    first.eot();
+    second.eot();
+
+    EXPECT_EQ(baseband, other);
+}
+
+TEST_F(OPVModulatorTest, split_frame)
+{
+    // Encoding on one modulator and shaping on another, as a pipelined
+    // transmitter does, gives the same output as frame().
+    OPVModulator whole("W5NYV", token);
+    OPVModulator framer("W5NYV", token);
+    OPVModulator shaper("W5NYV", token);
+
+    std::vector<int16_t> split;
+    attach(whole);
+    shaper.baseband_output([&split](const int16_t* samples, size_t len) {
+        split.insert(split.end(), samples, samples + len);
+    });
+
+    OPVModulator::stream_frame_t payload;
+    for (size_t i = 0; i != 3; ++i)
+    {
+        for (size_t j = 0; j != payload.size(); ++j) payload[j] = uint8_t(i * 31 + j);
+        bool last = i == 2;
+        whole.frame(payload, last);
+        shaper.send_encoded(framer.encode_frame(payload, last));
+    }
+
+    EXPECT_EQ(baseband, split);
+    EXPECT_EQ(whole.fheader(), framer.fheader());
+}
+
+TEST_F(OPVModulatorTest, invert)
+{
+    OPVModulator normal("W5NYV", token);
+    OPVModulator inverted("W5NYV", token);
+    inverted.invert(true);
+
+    std::vector<int16_t> other;
+    attach(normal);
+    inverted.baseband_output([&other](const int16_t* samples, size_t len) {
+        other.insert(other.end(), samples, samples + len);
+    });
+
+    normal.preamble();
+    inverted.preamble();
+
+    ASSERT_EQ(baseband.size(), other.size());
+    for (size_t i = 0; i != baseband.size(); ++i)
+    {
+        EXPECT_NEAR(baseband[i], -other[i], 1);
+    }
+}
+
+TEST_F(OPVModulatorTest, packet_too_large)
+{
+    OPVModulator modulator("W5NYV", token);
+    modulator.output_mode(OPVModulator::OutputMode::BITSTREAM);
+    attach(modulator);
+
+    std::array<uint8_t, stream_frame_payload_bytes> packet;
+    packet.fill(0x55);
+
+    EXPECT_FALSE(modulator.packet(packet.data(), packet.size()));
+    EXPECT_TRUE(bitstream.empty());
+
+    EXPECT_TRUE(modulator.packet(packet.data(), OPVModulator::voice_packet_bytes));
+    EXPECT_EQ(bitstream.size(), baseband_frame_packed_bytes);
+}
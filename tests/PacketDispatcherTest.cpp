@@ -0,0 +1,166 @@
+#include "PacketDispatcher.h"
+#include "OPVCobsDecoder.h"
+#include "OPVModulator.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class PacketDispatcherTest : public ::testing::Test {
+ protected:
+
+  PacketPool pool{8};
+  IPv4UDPBuilder builder{0xC0A80001, 5000, 0xC0A80002, 6000};
+
+  PacketHandle make_packet(const char* payload)
+  {
+      PacketHandle packet = pool.acquire();
+      size_t length = strlen(payload);
+      memcpy(packet.data() + IPv4UDP::HEADER_BYTES, payload, length);
+      packet.resize(builder.build(packet.data(), length));
+      return packet;
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+};
+
+TEST_F(PacketDispatcherTest, build_and_parse)
+{
+    auto packet = make_packet("hello, world");
+    ASSERT_EQ(packet.size(), IPv4UDP::HEADER_BYTES + 12);
+
+    IPv4UDP::Datagram datagram;
+    ASSERT_EQ(IPv4UDP::parse(packet.data(), packet.size(), datagram), IPv4UDP::Result::OK);
+    EXPECT_EQ(datagram.source_address, 0xC0A80001u);
+    EXPECT_EQ(datagram.dest_address, 0xC0A80002u);
+    EXPECT_EQ(datagram.source_port, 5000);
+    EXPECT_EQ(datagram.dest_port, 6000);
+    EXPECT_EQ(datagram.offset, IPv4UDP::HEADER_BYTES);
+    EXPECT_EQ(datagram.length, 12u);
+    EXPECT_EQ(memcmp(packet.data() + datagram.offset, "hello, world", 12), 0);
+
+    // The IP identification changes from packet to packet.
+    auto second = make_packet("hello, world");
+    EXPECT_NE(memcmp(packet.data(), second.data(), 6), 0);
+    EXPECT_EQ(IPv4UDP::parse(second.data(), second.size(), datagram), IPv4UDP::Result::OK);
+}
+
+TEST_F(PacketDispatcherTest, rejects_bad_packets)
+{
+    IPv4UDP::Datagram datagram;
+
+    auto packet = make_packet("payload");
+    packet.data()[IPv4UDP::HEADER_BYTES] ^= 0x01;
+    EXPECT_EQ(IPv4UDP::parse(packet.data(), packet.size(), datagram), IPv4UDP::Result::BAD_UDP_CHECKSUM);
+    EXPECT_EQ(IPv4UDP::parse(packet.data(), packet.size(), datagram, false), IPv4UDP::Result::OK);
+
+    packet = make_packet("payload");
+    packet.data()[8] = 1;     // TTL
+    EXPECT_EQ(IPv4UDP::parse(packet.data(), packet.size(), datagram), IPv4UDP::Result::BAD_IP_CHECKSUM);
+
+    packet = make_packet("payload");
+    EXPECT_EQ(IPv4UDP::parse(packet.data(), packet.size() - 1, datagram), IPv4UDP::Result::TRUNCATED);
+    EXPECT_EQ(IPv4UDP::parse(packet.data(), 10, datagram), IPv4UDP::Result::TRUNCATED);
+
+    packet.data()[0] = 0x60;
+    EXPECT_EQ(IPv4UDP::parse(packet.data(), packet.size(), datagram), IPv4UDP::Result::NOT_IPV4);
+
+    // A zero UDP checksum means none was sent.
+    packet = make_packet("payload");
+    packet.data()[26] = packet.data()[27] = 0;
+    EXPECT_EQ(IPv4UDP::parse(packet.data(), packet.size(), datagram), IPv4UDP::Result::OK);
+}
+
+TEST_F(PacketDispatcherTest, routes_by_port)
+{
+    PacketDispatcher dispatcher;
+    std::vector<std::string> voice, other;
+    std::vector<PacketDispatcher::Result> rejected;
+
+    dispatcher.route(6000, [&voice](PacketHandle packet, const IPv4UDP::Datagram& datagram) {
+        voice.emplace_back((const char*)packet.data() + datagram.offset, datagram.length);
+    });
+    dispatcher.route(7000, [&other](PacketHandle packet, const IPv4UDP::Datagram& datagram) {
+        other.emplace_back((const char*)packet.data() + datagram.offset, datagram.length);
+    });
+    dispatcher.fallback([&rejected](PacketHandle, PacketDispatcher::Result result) { rejected.push_back(result); });
+
+    dispatcher(make_packet("one"));
+    IPv4UDPBuilder data_builder{0xC0A80001, 5000, 0xC0A80002, 7000};
+    auto packet = pool.acquire();
+    memcpy(packet.data() + IPv4UDP::HEADER_BYTES, "two", 3);
+    packet.resize(data_builder.build(packet.data(), 3));
+    dispatcher(std::move(packet));
+
+    IPv4UDPBuilder unknown_builder{0xC0A80001, 5000, 0xC0A80002, 8000};
+    packet = pool.acquire();
+    packet.resize(unknown_builder.build(packet.data(), 0));
+    EXPECT_EQ(dispatcher(std::move(packet)), PacketDispatcher::Result::OK);
+
+    packet = make_packet("three");
+    packet.data()[9] = 6;   // TCP
+    dispatcher.verify_checksums(false);
+    EXPECT_EQ(dispatcher(std::move(packet)), PacketDispatcher::Result::NOT_UDP);
+
+    EXPECT_EQ(voice, std::vector<std::string>({"one"}));
+    EXPECT_EQ(other, std::vector<std::string>({"two"}));
+    EXPECT_EQ(rejected, std::vector<PacketDispatcher::Result>({PacketDispatcher::Result::OK, PacketDispatcher::Result::NOT_UDP}));
+    EXPECT_EQ(dispatcher.stats().packets, 4u);
+    EXPECT_EQ(dispatcher.stats().delivered, 2u);
+    EXPECT_EQ(dispatcher.stats().unrouted, 1u);
+    EXPECT_EQ(dispatcher.stats().not_udp, 1u);
+    EXPECT_EQ(pool.available(), pool.size());
+}
+
+TEST_F(PacketDispatcherTest, modulator_voice_packets)
+{
+    // Voice packets from the modulator, through the COBS decoder, arrive
+    // at the voice port with a valid RTP header.
+    OPVModulator modulator("W5NYV", {0x12, 0x34, 0x56});
+
+    std::array<uint8_t, opus_packet_size_bytes> opus;
+    for (size_t i = 0; i != opus.size(); ++i) opus[i] = uint8_t(i);
+
+    PacketDispatcher dispatcher;
+    std::vector<RTPHeader> headers;
+    dispatcher.route(voice_udp_port, [&](PacketHandle packet, const IPv4UDP::Datagram& datagram) {
+        RTPHeader rtp;
+        ASSERT_TRUE(rtp.parse(packet.data() + datagram.offset, datagram.length));
+        EXPECT_EQ(datagram.length - rtp.length, size_t(opus_packet_size_bytes));
+        EXPECT_EQ(memcmp(packet.data() + datagram.offset + rtp.length, opus.data(), opus.size()), 0);
+        headers.push_back(rtp);
+    });
+
+    OPVCobsDecoder decoder;
+    decoder.set_pool(&pool);
+    for (int i = 0; i != 3; ++i)
+    {
+        std::array<uint8_t, OPVModulator::voice_packet_bytes> packet;
+        std::copy(opus.begin(), opus.end(), packet.begin() + IPv4UDP::HEADER_BYTES + rtp_header_bytes);
+        modulator.build_voice_headers(packet.data());
+
+        OPVModulator::stream_frame_t payload{};
+        OPVCobsEncoder::encode(packet.data(), packet.size(), payload.data());
+        decoder(payload.data(), payload.size(), [&dispatcher](PacketHandle packet) { dispatcher(std::move(packet)); });
+    }
+    decoder.set_pool(nullptr);
+
+    ASSERT_EQ(headers.size(), 3u);
+    EXPECT_TRUE(headers[0].marker);
+    EXPECT_FALSE(headers[1].marker);
+    EXPECT_EQ(headers[0].payload_type, opus_rtp_payload_type);
+    EXPECT_EQ(uint16_t(headers[1].sequence - headers[0].sequence), 1);
+    EXPECT_EQ(headers[2].timestamp - headers[1].timestamp, uint32_t(audio_samples_per_opv_frame));
+    EXPECT_EQ(headers[0].ssrc, headers[2].ssrc);
+    EXPECT_EQ(dispatcher.stats().bad_checksum, 0u);
+}
@@ -0,0 +1,178 @@
+#include "PacketPool.h"
+#include "OPVCobsDecoder.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class PacketPoolTest : public ::testing::Test {
+ protected:
+  // void SetUp() override {}
+  // void TearDown() override {}
+};
+
+TEST_F(PacketPoolTest, acquire_until_exhausted)
+{
+    PacketPool pool(4);
+    std::vector<PacketHandle> held;
+    for (int i = 0; i != 4; ++i)
+    {
+        held.push_back(pool.acquire());
+        ASSERT_TRUE(held.back());
+        EXPECT_EQ(held.back().size(), 0u);
+    }
+    EXPECT_EQ(pool.available(), 0u);
+
+    EXPECT_FALSE(pool.acquire());
+    EXPECT_EQ(pool.exhausted(), 1u);
+
+    held.pop_back();
+    EXPECT_EQ(pool.available(), 1u);
+    EXPECT_TRUE(pool.acquire());
+}
+
+TEST_F(PacketPoolTest, shared_handles)
+{
+    PacketPool pool(2);
+    PacketHandle first = pool.acquire();
+    std::memcpy(first.data(), "hello", 5);
+    first.resize(5);
+
+    PacketHandle copy = first;
+    EXPECT_EQ(first.use_count(), 2u);
+    EXPECT_EQ(copy.data(), first.data());
+    EXPECT_EQ(copy.size(), 5u);
+
+    PacketHandle moved = std::move(first);
+    EXPECT_FALSE(first);
+    EXPECT_EQ(moved.use_count(), 2u);
+
+    copy.reset();
+    EXPECT_EQ(pool.available(), 1u);
+    moved.reset();
+    EXPECT_EQ(pool.available(), 2u);
+}
+
+TEST_F(PacketPoolTest, release_on_other_threads)
+{
+    PacketPool pool(16);
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> released{0};
+
+    // Consumers release what the producer hands them.
+    std::vector<PacketHandle> mailbox(16);
+    std::vector<std::atomic<bool>> full(16);
+    std::vector<std::thread> consumers;
+    for (size_t c = 0; c != 2; ++c)
+    {
+        consumers.emplace_back([&, c]()
+        {
+            while (!done)
+            {
+                for (size_t i = c; i < mailbox.size(); i += 2)
+                {
+                    if (full[i].load(std::memory_order_acquire))
+                    {
+                        EXPECT_EQ(mailbox[i].data()[0], uint8_t(i));
+                        mailbox[i].reset();
+                        full[i].store(false, std::memory_order_release);
+                        released++;
+                    }
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    uint64_t sent = 0;
+    while (sent != 20000)
+    {
+        for (size_t i = 0; i != mailbox.size() && sent != 20000; ++i)
+        {
+            if (full[i].load(std::memory_order_acquire)) continue;
+            PacketHandle packet = pool.acquire();
+            if (!packet) continue;
+            packet.data()[0] = uint8_t(i);
+            packet.resize(1);
+            mailbox[i] = std::move(packet);
+            full[i].store(true, std::memory_order_release);
+            sent++;
+        }
+    }
+    while (released != sent) std::this_thread::yield();
+    done = true;
+    for (auto& t : consumers) t.join();
+
+    EXPECT_EQ(pool.available(), pool.size());
+}
+
+TEST_F(PacketPoolTest, cobs_decoder_fills_pool_buffers)
+{
+    PacketPool pool(4);
+    OPVCobsDecoder decoder;
+    decoder.set_pool(&pool);
+
+    uint8_t frame[stream_frame_payload_bytes];
+    uint8_t data[] = "123456789012345678901234567890";
+    memset(frame, 0, stream_frame_payload_bytes);
+    frame[50] = sizeof(data); // +1 is taken care of by the string-terminating 0
+    memcpy(frame+51, data, sizeof(data)-1);
+
+    std::vector<PacketHandle> kept;
+    decoder(frame, stream_frame_payload_bytes, [&kept](PacketHandle packet) { kept.push_back(std::move(packet)); });
+    decoder(frame, stream_frame_payload_bytes, [&kept](PacketHandle packet) { kept.push_back(std::move(packet)); });
+
+    ASSERT_EQ(kept.size(), 2u);
+    EXPECT_NE(kept[0].data(), kept[1].data());
+    for (auto& packet : kept)
+    {
+        ASSERT_EQ(packet.size(), 30u);
+        EXPECT_EQ(memcmp(packet.data(), data, 30), 0);
+    }
+
+    // Two kept and one being assembled into.
+    EXPECT_EQ(pool.available(), 1u);
+    kept.clear();
+    EXPECT_EQ(pool.available(), 3u);
+
+    decoder.set_pool(nullptr);
+    EXPECT_EQ(pool.available(), 4u);
+}
+
+TEST_F(PacketPoolTest, cobs_decoder_pool_exhausted)
+{
+    PacketPool pool(1);
+    OPVCobsDecoder decoder;
+    decoder.set_pool(&pool);
+
+    uint8_t frame[stream_frame_payload_bytes];
+    uint8_t data[] = "123456789012345678901234567890";
+    memset(frame, 0, stream_frame_payload_bytes);
+    frame[50] = sizeof(data);
+    memcpy(frame+51, data, sizeof(data)-1);
+
+    std::vector<PacketHandle> kept;
+    auto keep = [&kept](PacketHandle packet) { kept.push_back(std::move(packet)); };
+    decoder(frame, stream_frame_payload_bytes, keep);
+    decoder(frame, stream_frame_payload_bytes, keep);     // no buffer free: dropped
+
+    ASSERT_EQ(kept.size(), 1u);
+    kept.clear();
+    decoder(frame, stream_frame_payload_bytes, keep);     // assembled locally, then copied
+    ASSERT_EQ(kept.size(), 1u);
+    EXPECT_EQ(memcmp(kept[0].data(), data, 30), 0);
+
+    kept.clear();
+    decoder.set_pool(nullptr);
+}
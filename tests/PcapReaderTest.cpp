@@ -0,0 +1,154 @@
+#include "PcapReader.h"
+#include "TempPath.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class PcapReaderTest : public ::testing::Test {
+ protected:
+
+  using bytes_t = std::vector<uint8_t>;
+
+  std::string path = temp_path(".pcap");
+  bool big_endian = false;
+  bytes_t file;
+
+  void put32(uint32_t value)
+  {
+    for (int i = 0; i != 4; ++i)
+    {
+        int shift = big_endian ? 24 - 8 * i : 8 * i;
+        file.push_back(uint8_t(value >> shift));
+    }
+  }
+
+  void header(uint32_t link_type)
+  {
+    file.clear();
+    put32(0xA1B2C3D4);
+    put32(0x00040002);  // version 2.4 (the halves are not checked)
+    put32(0);
+    put32(0);
+    put32(65535);
+    put32(link_type);
+  }
+
+  void record(const bytes_t& frame, uint32_t original = 0)
+  {
+    put32(0);
+    put32(0);
+    put32(frame.size());
+    put32(original ? original : frame.size());
+    file.insert(file.end(), frame.begin(), frame.end());
+  }
+
+  void write()
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(file.data()), file.size());
+  }
+
+  static bytes_t ip_packet(size_t length, uint8_t fill)
+  {
+    bytes_t packet(length, fill);
+    packet[0] = 0x45;
+    return packet;
+  }
+
+  std::vector<bytes_t> read_all(PcapReader& reader)
+  {
+    std::vector<bytes_t> packets;
+    const uint8_t* packet;
+    size_t length;
+    while (reader.next(packet, length)) packets.emplace_back(packet, packet + length);
+    return packets;
+  }
+
+  void TearDown() override
+  {
+    std::remove(path.c_str());
+  }
+
+};
+
+TEST_F(PcapReaderTest, raw_ip_either_byte_order)
+{
+    for (bool order : {false, true})
+    {
+        big_endian = order;
+        header(PcapReader::LINKTYPE_RAW);
+        record(ip_packet(20, 1));
+        record(ip_packet(1500, 2));
+        write();
+
+        PcapReader reader;
+        ASSERT_TRUE(reader.open(path));
+        auto packets = read_all(reader);
+        ASSERT_EQ(packets.size(), 2);
+        EXPECT_EQ(packets[0], ip_packet(20, 1));
+        EXPECT_EQ(packets[1], ip_packet(1500, 2));
+    }
+}
+
+TEST_F(PcapReaderTest, ethernet_headers_stripped)
+{
+    header(PcapReader::LINKTYPE_ETHERNET);
+
+    bytes_t ethernet(12, 0xEE);
+    ethernet.push_back(0x08);
+    ethernet.push_back(0x00);
+    auto frame = ethernet;
+    auto packet = ip_packet(40, 3);
+    frame.insert(frame.end(), packet.begin(), packet.end());
+    record(frame);
+
+    auto arp = ethernet;
+    arp[13] = 0x06;     // ethertype 0x0806
+    arp.resize(42, 0);
+    record(arp);
+    write();
+
+    PcapReader reader;
+    ASSERT_TRUE(reader.open(path));
+    auto packets = read_all(reader);
+    ASSERT_EQ(packets.size(), 1);
+    EXPECT_EQ(packets[0], packet);
+    EXPECT_EQ(reader.skipped(), 1);
+}
+
+TEST_F(PcapReaderTest, truncated_records_skipped)
+{
+    header(PcapReader::LINKTYPE_RAW);
+    record(ip_packet(64, 4), 1000);     // snapped by the capture
+    record(ip_packet(64, 5));
+    write();
+
+    PcapReader reader;
+    ASSERT_TRUE(reader.open(path));
+    auto packets = read_all(reader);
+    ASSERT_EQ(packets.size(), 1);
+    EXPECT_EQ(packets[0], ip_packet(64, 5));
+    EXPECT_EQ(reader.skipped(), 1);
+}
+
+TEST_F(PcapReaderTest, not_pcap)
+{
+    file.assign(100, 0x55);
+    write();
+
+    PcapReader reader;
+    EXPECT_FALSE(reader.open(path));
+    EXPECT_FALSE(reader.open(path + ".missing"));
+}
@@ -0,0 +1,58 @@
+#include "RRCTaps.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class RRCTapsTest : public ::testing::Test {
+ protected:
+
+  // Symmetric about the centre tap, with unit energy per sample of the
+  // symbol period, at any oversampling.
+  template <size_t SamplesPerSymbol>
+  void check_shape()
+  {
+      constexpr auto& taps = detail::Taps<double, SamplesPerSymbol>::rrc_taps;
+      constexpr size_t N = 15 * SamplesPerSymbol;
+      constexpr size_t CENTRE = (N - 1) / 2;
+
+      double energy = 0;
+      for (size_t i = 0; i != taps.size(); ++i)
+      {
+          if (i <= 2 * CENTRE) EXPECT_DOUBLE_EQ(taps[i], taps[2 * CENTRE - i]) << SamplesPerSymbol << " sps, tap " << i;
+          else EXPECT_EQ(taps[i], 0.0);
+          energy += taps[i] * taps[i];
+      }
+      EXPECT_NEAR(taps[CENTRE], 1.0 - 0.5 + 2.0 / M_PI, 1e-12) << "1 - a + 4a/pi, a = 0.5";
+      EXPECT_NEAR(energy, SamplesPerSymbol, 0.01 * SamplesPerSymbol);
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(RRCTapsTest, shape)
+{
+    check_shape<2>();
+    check_shape<4>();
+    check_shape<5>();
+    check_shape<10>();
+}
+
+TEST_F(RRCTapsTest, default_rate)
+{
+    // The 10 sample per symbol taps, as once tabulated offline.
+    constexpr auto& taps = detail::Taps<double>::rrc_taps;
+    static_assert(taps.size() == 150);
+    EXPECT_DOUBLE_EQ(taps[74], 1.1366197723675815);
+    EXPECT_DOUBLE_EQ(taps[0], taps[148]);
+    EXPECT_EQ(taps[149], 0.0);
+}
@@ -0,0 +1,169 @@
+#include "Resampler.h"
+#include "Numerology.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class ResamplerTest : public ::testing::Test {
+ protected:
+
+  // Resample a tone of the given frequency and amplitude, returning the
+  // output.
+  std::vector<double> tone(Resampler<double>& resampler, uint32_t input_rate, double frequency,
+      double amplitude, size_t samples)
+  {
+      std::vector<double> output;
+      for (size_t i = 0; i != samples; ++i)
+      {
+          resampler(amplitude * std::sin(2 * M_PI * frequency * i / input_rate), [&output](double y)
+          {
+              output.push_back(y);
+          });
+      }
+      return output;
+  }
+
+  // Amplitude of the output at the given frequency, by correlation, after
+  // skipping the filter's start-up.
+  double amplitude(const std::vector<double>& output, uint32_t output_rate, double frequency, size_t skip)
+  {
+      double i_sum = 0;
+      double q_sum = 0;
+      for (size_t n = skip; n != output.size(); ++n)
+      {
+          double w = 2 * M_PI * frequency * n / output_rate;
+          i_sum += output[n] * std::cos(w);
+          q_sum += output[n] * std::sin(w);
+      }
+      return 2 * std::hypot(i_sum, q_sum) / (output.size() - skip);
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(ResamplerTest, ratio)
+{
+    Resampler<double> down(sample_rate, 48000);
+    EXPECT_EQ(down.interpolation(), 48u);
+    EXPECT_EQ(down.decimation(), 271u);
+    EXPECT_EQ(down.taps_per_phase(), Resampler<double>::DEFAULT_TAPS * 6) << "scaled for decimation";
+
+    Resampler<double> up(sample_rate, 2400000);
+    EXPECT_EQ(up.interpolation(), 2400u);
+    EXPECT_EQ(up.decimation(), 271u);
+    EXPECT_EQ(up.taps_per_phase(), Resampler<double>::DEFAULT_TAPS);
+
+    EXPECT_FALSE(Resampler<double>::supported(sample_rate, 0));
+    EXPECT_FALSE(Resampler<double>::supported(sample_rate, 48001)) << "too many phases";
+    EXPECT_THROW(Resampler<double>(sample_rate, 48001), std::invalid_argument);
+}
+
+TEST_F(ResamplerTest, output_count)
+{
+    for (uint32_t rate : {48000u, 108400u, 250000u, 2400000u})
+    {
+        Resampler<double> resampler(sample_rate, rate);
+        size_t count = 0;
+        for (size_t i = 0; i != sample_rate; ++i) resampler(0.0, [&count](double) { count++; });
+        EXPECT_EQ(count, rate) << "one second at " << rate;
+    }
+}
+
+TEST_F(ResamplerTest, designs_are_shared)
+{
+    Resampler<double> a(sample_rate, 250000);
+    Resampler<double> b(sample_rate * 2, 500000);
+    ASSERT_EQ(a.taps_per_phase(), b.taps_per_phase());
+    auto design = Resampler<double>::design(250, 271, a.taps_per_phase());
+    EXPECT_EQ(design, Resampler<double>::design(250, 271, a.taps_per_phase()));
+    EXPECT_EQ(design.use_count(), 4) << "cache, a, b and this";
+}
+
+TEST_F(ResamplerTest, dc_gain)
+{
+    Resampler<double> resampler(sample_rate, 250000);
+    double last = 0;
+    for (size_t i = 0; i != 2000; ++i) resampler(1.0, [&last](double y) { last = y; });
+    EXPECT_NEAR(last, 1.0, 1e-3);
+}
+
+TEST_F(ResamplerTest, passband)
+{
+    // The OPV baseband reaches about 20kHz; it passes to each output rate.
+    for (uint32_t rate : {48000u, 108400u, 250000u, 2400000u})
+    {
+        Resampler<double> resampler(sample_rate, rate);
+        for (double frequency : {1000.0, 10000.0, 17000.0})
+        {
+            resampler.reset();
+            auto output = tone(resampler, sample_rate, frequency, 1.0, sample_rate / 10);
+            EXPECT_NEAR(amplitude(output, rate, frequency, rate / 100), 1.0, 0.01)
+                << frequency << " Hz at " << rate;
+        }
+    }
+}
+
+TEST_F(ResamplerTest, stopband)
+{
+    // A tone above the output's Nyquist rate does not alias into it.
+    Resampler<double> resampler(sample_rate, 48000);
+    auto output = tone(resampler, sample_rate, 40000.0, 1.0, sample_rate / 10);
+    double alias = 48000 - 40000.0;
+    EXPECT_LT(amplitude(output, 48000, alias, 480), 1e-3);
+}
+
+TEST_F(ResamplerTest, round_trip)
+{
+    // Up to 2.4M and back, the baseband comes through delayed by both filters.
+    Resampler<double> up(sample_rate, 2400000);
+    Resampler<double> down(2400000, sample_rate);
+    auto signal = [](double t)
+    {
+        return std::sin(2 * M_PI * 3000.0 * t / sample_rate) + 0.5 * std::sin(2 * M_PI * 11000.0 * t / sample_rate);
+    };
+
+    std::vector<double> output;
+    for (size_t i = 0; i != 20000; ++i)
+    {
+        up(signal(i), [&down, &output](double y) { down(y, [&output](double z) { output.push_back(z); }); });
+    }
+    double delay = up.delay() + down.delay() * sample_rate / 2400000.0;
+
+    double error = 0;
+    for (size_t i = 1000; i != output.size(); ++i) error = std::max(error, std::abs(output[i] - signal(i - delay)));
+    EXPECT_LT(error, 0.01);
+}
+
+TEST_F(ResamplerTest, benchmark)
+{
+    // Cost per output sample for a few common rates; for information, with
+    // only a loose bound.
+    for (uint32_t rate : {48000u, 250000u, 2400000u})
+    {
+        Resampler<float> resampler(sample_rate, rate);
+        float sum = 0;
+        size_t count = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i != sample_rate; ++i)
+        {
+            resampler(float(i % 7), [&sum, &count](float y) { sum += y; count++; });
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "271000 -> " << rate << ": " << double(ns) / count << " ns per output sample, "
+            << resampler.taps_per_phase() << " taps (" << sum << ")" << std::endl;
+        EXPECT_LT(double(ns) / count, 20000.0);
+    }
+}
@@ -0,0 +1,142 @@
+#include "SpscQueue.h"
+#include "ThreadAffinity.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class SpscQueueTest : public ::testing::Test {
+ protected:
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(SpscQueueTest, fifo)
+{
+    SpscQueue<int, 4> queue;
+    EXPECT_TRUE(queue.empty());
+
+    for (int i = 0; i != 4; ++i) EXPECT_TRUE(queue.try_push(i));
+    EXPECT_FALSE(queue.try_push(4)) << "full";
+    EXPECT_EQ(queue.size(), 4u);
+
+    int value;
+    for (int i = 0; i != 4; ++i)
+    {
+        ASSERT_TRUE(queue.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.try_pop(value)) << "empty";
+}
+
+TEST_F(SpscQueueTest, wraps)
+{
+    SpscQueue<int, 2> queue;
+    int value;
+    for (int i = 0; i != 1000; ++i)
+    {
+        ASSERT_TRUE(queue.try_push(i));
+        ASSERT_TRUE(queue.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(SpscQueueTest, moves_items)
+{
+    SpscQueue<std::unique_ptr<int>, 2> queue;
+    EXPECT_TRUE(queue.push(std::make_unique<int>(7)));
+
+    std::unique_ptr<int> value;
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, 7);
+}
+
+TEST_F(SpscQueueTest, close_drains)
+{
+    SpscQueue<int, 4> queue;
+    queue.push(1);
+    queue.push(2);
+    queue.close();
+
+    EXPECT_FALSE(queue.push(3)) << "closed";
+    EXPECT_FALSE(queue.is_finished());
+
+    int value;
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 1);
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 2);
+    EXPECT_FALSE(queue.pop(value));
+    EXPECT_TRUE(queue.is_finished());
+}
+
+TEST_F(SpscQueueTest, pop_for_times_out)
+{
+    SpscQueue<int, 4> queue;
+    int value;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(queue.pop_for(value, std::chrono::milliseconds(20)));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    queue.push(5);
+    EXPECT_TRUE(queue.pop_for(value, std::chrono::milliseconds(20)));
+    EXPECT_EQ(value, 5);
+}
+
+TEST_F(SpscQueueTest, threads)
+{
+    // A producer and consumer at full speed through a small queue; every
+    // item arrives once, in order.
+    constexpr uint64_t COUNT = 200000;
+    SpscQueue<uint64_t, 8> queue;
+
+    std::thread producer([&queue]()
+    {
+        for (uint64_t i = 0; i != COUNT; ++i) queue.push(i);
+        queue.close();
+    });
+
+    uint64_t expected = 0;
+    uint64_t value;
+    while (queue.pop(value))
+    {
+        if (value != expected) break;
+        expected++;
+    }
+    producer.join();
+
+    EXPECT_EQ(expected, COUNT);
+}
+
+TEST_F(SpscQueueTest, cpu_list)
+{
+    std::vector<int> cpus;
+    EXPECT_TRUE(parse_cpu_list("", cpus));
+    EXPECT_TRUE(cpus.empty());
+
+    EXPECT_TRUE(parse_cpu_list("0,2,-,3,", cpus));
+    EXPECT_EQ(cpus, (std::vector<int>{0, 2, -1, 3, -1}));
+
+    EXPECT_FALSE(parse_cpu_list("1,x", cpus));
+    EXPECT_FALSE(parse_cpu_list("1,2.5", cpus));
+    EXPECT_FALSE(parse_cpu_list("-2", cpus));
+
+    std::thread thread([](){});
+    EXPECT_TRUE(pin_thread(thread, -1)) << "unpinned is always allowed";
+    thread.join();
+}
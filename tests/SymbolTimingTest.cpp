@@ -0,0 +1,246 @@
+#include "SymbolTiming.h"
+#include "FirFilter.h"
+#include "RRCTaps.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class SymbolTimingTest : public ::testing::Test {
+ protected:
+
+  using rrc_t = BaseFirFilter<double, detail::Taps<double>::rrc_taps.size()>;
+
+  static constexpr double FILTER_DELAY = detail::Taps<double>::rrc_taps.size() - 1;    // transmit and receive
+
+  // Random four-level symbols, RRC-shaped twice (transmitter and matched
+  // filter), with the transmitter clock off by ppm, fed to the loop.
+  // Returns the RMS error of the symbol samples after the first 2000,
+  // in symbol units (the levels are +/-1 and +/-3).
+  double run(SymbolTiming<double, 10>& timing, double ppm, double start_error, size_t symbols = 20000)
+  {
+      rrc_t tx{detail::Taps<double>::rrc_taps};
+      rrc_t rx{detail::Taps<double>::rrc_taps};
+      double gain = 0;
+      for (auto t : detail::Taps<double>::rrc_taps) gain += t * t;
+
+      std::mt19937 rng(1);
+      const int levels[] = {-3, -1, 1, 3};
+      timing.reset(FILTER_DELAY + start_error, true);
+
+      double step = 1.0 + ppm * 1e-6;
+      double position = 0;
+      double previous = 0;
+      double sum = 0;
+      size_t count = 0;
+      size_t strobes = 0;
+      for (size_t i = 0; i != symbols; ++i)
+      {
+          double level = levels[rng() % 4];
+          for (size_t j = 0; j != 10; ++j)
+          {
+              double x = tx(j == 0 ? level : 0.0);
+              for (; position < 1.0; position += step)      // transmitter clock error
+              {
+                  if (!timing(rx(previous + (x - previous) * position))) continue;
+                  if (++strobes < 2000) continue;
+                  double y = timing.symbol() / gain;
+                  double error = y - (std::round((y + 3) / 2) * 2 - 3);
+                  sum += error * error;
+                  count++;
+              }
+              position -= 1.0;
+              previous = x;
+          }
+      }
+      return count ? std::sqrt(sum / count) : 1.0;
+  }
+
+  // As run(), at a lower receive rate: the symbols are shaped at 20
+  // samples per symbol, so the transmitter clock error is applied with
+  // little distortion, and then decimated to SamplesPerSymbol.
+  template <size_t SamplesPerSymbol>
+  double run_at(SymbolTiming<double, SamplesPerSymbol>& timing, double ppm, double start_error, size_t symbols = 20000)
+  {
+      constexpr size_t TX_SPS = 20;
+      using tx_taps = detail::Taps<double, TX_SPS>;
+      using rx_taps = detail::Taps<double, SamplesPerSymbol>;
+      BaseFirFilter<double, tx_taps::rrc_taps.size()> tx{tx_taps::rrc_taps};
+      BaseFirFilter<double, rx_taps::rrc_taps.size()> rx{rx_taps::rrc_taps};
+      double gain = 0;
+      for (auto t : rx_taps::rrc_taps) gain += t * t;
+
+      std::mt19937 rng(1);
+      const int levels[] = {-3, -1, 1, 3};
+      timing.reset(double(rx_taps::rrc_taps.size() - 1) + start_error, true);
+
+      double step = 1.0 + ppm * 1e-6;
+      double position = 0;
+      double previous = 0;
+      double sum = 0;
+      size_t count = 0;
+      size_t strobes = 0;
+      size_t n = 0;
+      for (size_t i = 0; i != symbols; ++i)
+      {
+          double level = levels[rng() % 4];
+          for (size_t j = 0; j != TX_SPS; ++j)
+          {
+              double x = tx(j == 0 ? level : 0.0);
+              for (; position < 1.0; position += step)
+              {
+                  if (n++ % (TX_SPS / SamplesPerSymbol) != 0) continue;
+                  if (!timing(rx(previous + (x - previous) * position))) continue;
+                  if (++strobes < 2000) continue;
+                  double y = timing.symbol() / gain;
+                  double error = y - (std::round((y + 3) / 2) * 2 - 3);
+                  sum += error * error;
+                  count++;
+              }
+              position -= 1.0;
+              previous = x;
+          }
+      }
+      return count ? std::sqrt(sum / count) : 1.0;
+  }
+
+  template <size_t SamplesPerSymbol>
+  void check_rate()
+  {
+      for (double start_error : {0.3, -0.3, 0.5})
+      {
+          for (double ppm : {0.0, 500.0, -1000.0})
+          {
+              SymbolTiming<double, SamplesPerSymbol> timing;
+              EXPECT_LT(run_at(timing, ppm, start_error * SamplesPerSymbol), 0.05)
+                  << SamplesPerSymbol << " sps, " << start_error << " symbols, " << ppm << " ppm";
+              EXPECT_NEAR(timing.clock(), 1.0 + ppm * 1e-6, 50e-6)
+                  << SamplesPerSymbol << " sps, " << start_error << " symbols, " << ppm << " ppm";
+          }
+      }
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+
+};
+
+TEST_F(SymbolTimingTest, interpolates_cubics_exactly)
+{
+    // With the loop open, strobes fall every 10 samples from where they
+    // start, and the interpolator is exact for a cubic.
+    SymbolTiming<double, 10> timing(0.0);
+    auto f = [](double t) { return 0.001 * t * t * t - 0.02 * t * t + 0.5 * t - 3.0; };
+
+    timing.reset(3.25, true);   // before sample 0, so the first strobe is at 2.25
+    size_t strobes = 0;
+    for (int n = 0; n != 60; ++n)
+    {
+        if (!timing(f(n))) continue;
+        double t = 2.25 + 10.0 * strobes++;
+        EXPECT_NEAR(timing.symbol(), f(t), 1e-9) << "strobe " << strobes;
+        EXPECT_NEAR(timing.since_strobe(), n - t, 1e-9);
+    }
+    EXPECT_EQ(strobes, 6u);
+}
+
+TEST_F(SymbolTimingTest, open_loop_misses_timing)
+{
+    SymbolTiming<double, 10> timing(0.0);
+    EXPECT_GT(run(timing, 0.0, 4.0), 0.3);
+}
+
+TEST_F(SymbolTimingTest, pulls_in_phase)
+{
+    SymbolTiming<double, 10> timing;
+    EXPECT_LT(run(timing, 0.0, 4.0), 0.05);
+    EXPECT_NEAR(timing.clock(), 1.0, 50e-6);
+}
+
+TEST_F(SymbolTimingTest, tracks_clock_error)
+{
+    for (double ppm : {-1000.0, -300.0, 500.0, 1500.0})
+    {
+        SymbolTiming<double, 10> timing;
+        EXPECT_LT(run(timing, ppm, -2.0), 0.05) << ppm << " ppm";
+        EXPECT_NEAR(timing.clock(), 1.0 + ppm * 1e-6, 50e-6) << ppm << " ppm";
+    }
+}
+
+TEST_F(SymbolTimingTest, clock_error_limit)
+{
+    // A clock error beyond the loop's range is not followed past it.
+    SymbolTiming<double, 10> timing;
+    run(timing, 5000.0, 0.0, 5000);
+    EXPECT_GT(timing.clock(), 1.001);
+    EXPECT_LE(timing.clock(), 1.0 / (1.0 - SymbolTiming<double, 10>::MAX_CLOCK_ERROR) + 1e-12);
+}
+
+TEST_F(SymbolTimingTest, sinc_interpolator)
+{
+    // Each row has unit gain, and the end rows pass a sample straight through.
+    constexpr auto& table = detail::sinc_interpolator<double, 8, 128>;
+    for (const auto& row : table)
+    {
+        double sum = 0;
+        for (auto h : row) sum += h;
+        EXPECT_NEAR(sum, 1.0, 1e-12);
+    }
+    for (size_t k = 0; k != 8; ++k)
+    {
+        EXPECT_NEAR(table[0][k], k == 3 ? 1.0 : 0.0, 1e-12);
+        EXPECT_NEAR(table[128][k], k == 4 ? 1.0 : 0.0, 1e-12);
+    }
+    EXPECT_NEAR(table[64][3], table[64][4], 1e-12) << "midpoint is symmetric";
+}
+
+TEST_F(SymbolTimingTest, five_samples_per_symbol)
+{
+    check_rate<5>();
+}
+
+TEST_F(SymbolTimingTest, four_samples_per_symbol)
+{
+    check_rate<4>();
+}
+
+TEST_F(SymbolTimingTest, two_samples_per_symbol)
+{
+    check_rate<2>();
+}
+
+TEST_F(SymbolTimingTest, wants_sample)
+{
+    // Samples the loop says it won't want never reach a strobe: a loop fed
+    // garbage in their place makes exactly the same strobes.
+    SymbolTiming<double, 10> full;
+    SymbolTiming<double, 10> sparse;
+    full.reset(3.3, true);
+    sparse.reset(3.3, true);
+
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise;
+    double x = 0;
+    size_t wanted = 0;
+    for (size_t i = 0; i != 100000; ++i)
+    {
+        x = 0.9 * x + noise(rng);
+        bool wants = sparse.wants_sample();
+        wanted += wants;
+        bool strobe = full(x);
+        ASSERT_EQ(sparse(wants ? x : 1e6), strobe) << "sample " << i;
+        if (strobe)
+        {
+            ASSERT_EQ(sparse.symbol(), full.symbol()) << "sample " << i;
+        }
+    }
+    EXPECT_LT(wanted, 85000u) << "two 4-sample windows per 10 samples";
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+/**
+ * A temporary file path for the running test, named after it. ctest runs
+ * each test as its own process, in parallel with -j, so tests must not
+ * share files.
+ */
+inline std::string temp_path(const std::string& extension)
+{
+    auto info = ::testing::UnitTest::GetInstance()->current_test_info();
+    return std::string(::testing::TempDir()) + info->test_suite_name() + "." + info->name() + extension;
+}
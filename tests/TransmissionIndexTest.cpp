@@ -0,0 +1,128 @@
+#include "TransmissionIndex.h"
+#include "TempPath.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class TransmissionIndexTest : public ::testing::Test {
+ protected:
+
+  std::string path = temp_path(".idx");
+
+  static constexpr uint64_t FRAME = 10840;
+
+  OPVFrameHeader header(const char* callsign, OPVFrameHeader::flags_t flags = 0)
+  {
+      OPVFrameHeader result;
+      std::copy(callsign, callsign + std::strlen(callsign), result.callsign.begin());
+      result.flags = flags;
+      return result;
+  }
+
+  // void SetUp() override {}
+  void TearDown() override { std::remove(path.c_str()); }
+
+};
+
+TEST_F(TransmissionIndexTest, sidecar)
+{
+    EXPECT_EQ(TransmissionIndex::sidecar("/data/pass.raw"), "/data/pass.raw.idx");
+}
+
+TEST_F(TransmissionIndexTest, round_trip)
+{
+    TransmissionIndex index;
+    index.sample_rate = 271000;
+    index.samples = 23400000000ULL;     // a day at 271 ksps
+    index.transmissions.push_back({100, 200000, 18, true, "W5NYV"});
+    index.transmissions.push_back({22000000000ULL, 22000500000ULL, 46, false, ""});
+    ASSERT_TRUE(index.save(path));
+
+    TransmissionIndex loaded;
+    ASSERT_TRUE(loaded.load(path));
+    EXPECT_EQ(loaded.sample_rate, index.sample_rate);
+    EXPECT_EQ(loaded.samples, index.samples);
+    EXPECT_EQ(loaded.transmissions, index.transmissions);
+}
+
+TEST_F(TransmissionIndexTest, rejects_other_files)
+{
+    TransmissionIndex index;
+    EXPECT_FALSE(index.load(path));
+
+    std::ofstream(path) << "sample_rate 271000\n";
+    EXPECT_FALSE(index.load(path));
+
+    std::ofstream(path) << TransmissionIndex::HEADER << "\nsample_rate 271000\n0 100 200\n";
+    EXPECT_FALSE(index.load(path));
+}
+
+TEST_F(TransmissionIndexTest, tracker_eos)
+{
+    TransmissionTracker tracker(FRAME, 100 * FRAME);
+    using HeaderResult = OPVFrameHeader::HeaderResult;
+
+    for (uint64_t i = 3; i != 10; ++i) tracker.frame(i * FRAME, header("W5NYV"), HeaderResult::NOCHANGE);
+    tracker.frame(10 * FRAME, header("W5NYV", OPVFrameHeader::LAST_FRAME), HeaderResult::UPDATED);
+
+    // The next frame, right after the EOS, starts another transmission.
+    tracker.frame(12 * FRAME, header("KB5MU"), HeaderResult::UPDATED);
+    tracker.finish();
+
+    ASSERT_EQ(tracker.transmissions().size(), 2u);
+    auto& first = tracker.transmissions()[0];
+    EXPECT_EQ(first.start, 1 * FRAME);
+    EXPECT_EQ(first.end, 10 * FRAME);
+    EXPECT_EQ(first.frames, 8u);
+    EXPECT_TRUE(first.eos);
+    EXPECT_EQ(first.callsign, "W5NYV");
+
+    auto& second = tracker.transmissions()[1];
+    EXPECT_EQ(second.start, 10 * FRAME);
+    EXPECT_EQ(second.frames, 1u);
+    EXPECT_FALSE(second.eos);
+    EXPECT_EQ(second.callsign, "KB5MU");
+}
+
+TEST_F(TransmissionIndexTest, tracker_gap)
+{
+    TransmissionTracker tracker(FRAME, 10 * FRAME);
+    using HeaderResult = OPVFrameHeader::HeaderResult;
+
+    // A fade shorter than the gap is part of the same transmission.
+    tracker.frame(5 * FRAME, header("W5NYV"), HeaderResult::UPDATED);
+    tracker.frame(6 * FRAME, header("W5NYV"), HeaderResult::NOCHANGE);
+    tracker.frame(14 * FRAME, header("W5NYV"), HeaderResult::NOCHANGE);
+    tracker.advance(20 * FRAME);
+    EXPECT_TRUE(tracker.transmissions().empty());
+    tracker.advance(25 * FRAME);
+    ASSERT_EQ(tracker.transmissions().size(), 1u);
+    EXPECT_EQ(tracker.transmissions()[0].frames, 3u);
+    EXPECT_EQ(tracker.transmissions()[0].end, 14 * FRAME);
+    EXPECT_FALSE(tracker.transmissions()[0].eos);
+
+    // A frame whose header failed does not give the callsign, or end the
+    // transmission, whatever the decoder still holds.
+    tracker.frame(40 * FRAME, header("W5NYV", OPVFrameHeader::LAST_FRAME), HeaderResult::FAIL);
+    tracker.frame(41 * FRAME, header("KB5MU"), HeaderResult::UPDATED);
+    tracker.frame(60 * FRAME, header("KB5MU"), HeaderResult::UPDATED);
+    tracker.finish();
+
+    ASSERT_EQ(tracker.transmissions().size(), 3u);
+    EXPECT_EQ(tracker.transmissions()[1].start, 38 * FRAME);
+    EXPECT_EQ(tracker.transmissions()[1].frames, 2u);
+    EXPECT_EQ(tracker.transmissions()[1].callsign, "KB5MU");
+    EXPECT_EQ(tracker.transmissions()[2].start, 58 * FRAME);
+}
@@ -0,0 +1,119 @@
+#include "UDPNetwork.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class UDPNetworkTest : public ::testing::Test {
+ protected:
+
+  UDPNetwork sender;
+  UDPNetwork receiver;
+
+  void open(size_t send_batch, size_t receive_batch)
+  {
+      UDPNetwork::Config config;
+      config.batch_size = receive_batch;
+      config.receive_buffer = 1 << 20;
+      ASSERT_TRUE(receiver.open(0, config));
+
+      config.batch_size = send_batch;
+      ASSERT_TRUE(sender.open(0, config));
+      ASSERT_TRUE(sender.destination("127.0.0.1", receiver.local_port()));
+  }
+
+  // Receive until @p count datagrams have arrived or a second has passed.
+  std::vector<std::vector<uint8_t>> receive(size_t count)
+  {
+      std::vector<std::vector<uint8_t>> result;
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+      while (result.size() < count && std::chrono::steady_clock::now() < deadline)
+      {
+          receiver.receive([&result](const uint8_t* data, size_t length) {
+              result.emplace_back(data, data + length);
+          }, 100);
+      }
+      return result;
+  }
+
+  // void SetUp() override {}
+  // void TearDown() override {}
+};
+
+TEST_F(UDPNetworkTest, batched_send_and_receive)
+{
+    open(8, 4);
+
+    for (uint8_t i = 0; i != 20; ++i)
+    {
+        std::vector<uint8_t> frame(271, i);
+        sender.send_packet(frame.size(), frame.data());
+    }
+    EXPECT_EQ(sender.stats().sent, 16u);    // two full batches
+    EXPECT_EQ(sender.stats().send_calls, 2u);
+    sender.flush();
+    EXPECT_EQ(sender.stats().sent, 20u);
+    EXPECT_EQ(sender.stats().send_calls, 3u);
+
+    auto received = receive(20);
+    ASSERT_EQ(received.size(), 20u);
+    for (uint8_t i = 0; i != 20; ++i)
+    {
+        EXPECT_EQ(received[i], std::vector<uint8_t>(271, i));
+    }
+    EXPECT_EQ(receiver.stats().received, 20u);
+    EXPECT_LT(receiver.stats().receive_calls, 20u);
+}
+
+TEST_F(UDPNetworkTest, receive_does_not_block)
+{
+    open(1, 4);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t count = receiver.receive([](const uint8_t*, size_t) {});
+    EXPECT_EQ(count, 0u);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+    count = receiver.receive([](const uint8_t*, size_t) {}, 20);
+    EXPECT_EQ(count, 0u);
+    EXPECT_EQ(receiver.stats().receive_errors, 0u);
+}
+
+TEST_F(UDPNetworkTest, unbatched_and_large_datagrams)
+{
+    open(1, 2);
+
+    std::vector<uint8_t> small(10, 0x55);
+    sender.send_packet(small.size(), small.data());
+    EXPECT_EQ(sender.stats().sent, 1u);
+
+    std::vector<uint8_t> large(UDPNetwork::MAX_DATAGRAM + 100, 0xAA);
+    sender.send_packet(large.size(), large.data());
+    EXPECT_EQ(sender.stats().sent, 2u);
+
+    auto received = receive(2);
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_EQ(received[0], small);
+    EXPECT_EQ(received[1].size(), UDPNetwork::MAX_DATAGRAM);   // cut to the receive buffer
+    EXPECT_EQ(receiver.stats().truncated, 1u);
+}
+
+TEST_F(UDPNetworkTest, close_flushes)
+{
+    open(16, 16);
+
+    std::vector<uint8_t> frame(100, 1);
+    for (int i = 0; i != 5; ++i) sender.send_packet(frame.size(), frame.data());
+    EXPECT_EQ(sender.stats().sent, 0u);
+    sender.close();
+    EXPECT_EQ(sender.stats().sent, 5u);
+
+    EXPECT_EQ(receive(5).size(), 5u);
+}
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <chrono>
+#include <span>
 
 // make CXXFLAGS="$(pkg-config --cflags gtest) $(pkg-config --libs gtest) -I. -O3 -std=c++17" tests/ViterbiTest
 
@@ -195,3 +196,28 @@ TEST_F(ViterbiTest, decode_ber_lsf)
 
 }
 
+
+TEST_F(ViterbiTest, decode_packed_matches_bits)
+{
+    // A full OPV payload of random soft bits with errors and erasures.
+    std::array<int8_t, mobilinkd::stream_type3_payload_size> encoded;
+    uint32_t state = 12345;
+    for (auto& s : encoded)
+    {
+        state = state * 1103515245 + 12345;
+        s = int8_t(int((state >> 16) % 15) - 7);
+    }
+
+    mobilinkd::Trellis<4,2> trellis({mobilinkd::ConvolutionPolyA,mobilinkd::ConvolutionPolyB});
+    mobilinkd::Viterbi<decltype(trellis), 4> viterbi(trellis);
+
+    std::array<uint8_t, mobilinkd::stream_frame_payload_size> bits;
+    auto bit_cost = viterbi.decode(encoded, bits);
+
+    std::array<uint8_t, mobilinkd::stream_frame_payload_bytes> bytes;
+    auto byte_cost = viterbi.decode(std::span<const int8_t, mobilinkd::stream_type3_payload_size>(encoded), std::span(bytes));
+
+    EXPECT_EQ(byte_cost, bit_cost);
+    auto expected = mobilinkd::to_byte_array(bits);
+    for (size_t i = 0; i != bytes.size(); ++i) EXPECT_EQ(bytes[i], expected[i]) << "byte " << i;
+}